@@ -1,4 +1,7 @@
 ﻿#include "Sprite.h"
+#include "ConstantBufferRing.h"
+#include "PipelineCache.h"
+#include "ShaderCache.h"
 #include "TextureManager.h"
 #include <cassert>
 #include <d3dcompiler.h>
@@ -32,54 +35,21 @@ void Sprite::StaticInitialize(
 	  sDevice_->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
 	HRESULT result = S_FALSE;
-	ComPtr<ID3DBlob> vsBlob;    // 頂点シェーダオブジェクト
-	ComPtr<ID3DBlob> psBlob;    // ピクセルシェーダオブジェクト
 	ComPtr<ID3DBlob> errorBlob; // エラーオブジェクト
 
 	// 頂点シェーダの読み込みとコンパイル
-	std::wstring vsFile = directoryPath + L"/shaders/SpriteVS.hlsl";
-	result = D3DCompileFromFile(
-	  vsFile.c_str(), // シェーダファイル名
-	  nullptr,
-	  D3D_COMPILE_STANDARD_FILE_INCLUDE, // インクルード可能にする
-	  "main", "vs_5_0", // エントリーポイント名、シェーダーモデル指定
-	  D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // デバッグ用設定
-	  0, &vsBlob, &errorBlob);
-	if (FAILED(result)) {
-		// errorBlobからエラー内容をstring型にコピー
-		std::string errstr;
-		errstr.resize(errorBlob->GetBufferSize());
-
-		std::copy_n(
-		  (char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize(), errstr.begin());
-		errstr += "\n";
-		// エラー内容を出力ウィンドウに表示
-		OutputDebugStringA(errstr.c_str());
-		exit(1);
-	}
-
-	// ピクセルシェーダの読み込みとコンパイル
-	std::wstring psFile = directoryPath + L"/shaders/SpritePS.hlsl";
-	result = D3DCompileFromFile(
-	  psFile.c_str(), // シェーダファイル名
-	  nullptr,
-	  D3D_COMPILE_STANDARD_FILE_INCLUDE, // インクルード可能にする
-	  "main", "ps_5_0", // エントリーポイント名、シェーダーモデル指定
-	  D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // デバッグ用設定
-	  0, &psBlob, &errorBlob);
-	if (FAILED(result)) {
-		// errorBlobからエラー内容をstring型にコピー
-		std::string errstr;
-		errstr.resize(errorBlob->GetBufferSize());
-
-		std::copy_n(
-		  (char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize(), errstr.begin());
-		errstr += "\n";
-		// エラー内容を出力ウィンドウに表示
-		OutputDebugStringA(errstr.c_str());
-
-		exit(1);
-	}
+	ComPtr<ID3DBlob> vsBlob = ShaderCache::GetInstance()->Load(
+	  directoryPath + L"/shaders/SpriteVS.hlsl", nullptr, "vs_5_0");
+
+	// ピクセルシェーダの読み込みとコンパイル（バインドレスならテクスチャ配列を使う版）
+	bool bindless = TextureManager::GetInstance()->IsBindless();
+	D3D_SHADER_MACRO bindlessDefines[] = {
+	  {"BINDLESS", "1"},
+	  {nullptr, nullptr},
+	};
+	ComPtr<ID3DBlob> psBlob = ShaderCache::GetInstance()->Load(
+	  directoryPath + L"/shaders/SpritePS.hlsl", bindless ? bindlessDefines : nullptr,
+	  bindless ? "ps_5_1" : "ps_5_0");
 
 	// 頂点レイアウト
 	D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
@@ -121,12 +91,17 @@ void Sprite::StaticInitialize(
 
 	// デスクリプタレンジ
 	CD3DX12_DESCRIPTOR_RANGE descRangeSRV;
-	descRangeSRV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0); // t0 レジスタ
+	if (bindless) {
+		descRangeSRV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1); // t0～ space1
+	} else {
+		descRangeSRV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0); // t0 レジスタ
+	}
 
 	// ルートパラメータ
-	CD3DX12_ROOT_PARAMETER rootparams[2] = {};
+	CD3DX12_ROOT_PARAMETER rootparams[3] = {};
 	rootparams[0].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_ALL);
 	rootparams[1].InitAsDescriptorTable(1, &descRangeSRV, D3D12_SHADER_VISIBILITY_ALL);
+	rootparams[2].InitAsConstants(1, 1, 0, D3D12_SHADER_VISIBILITY_PIXEL); // テクスチャ番号
 
 	// スタティックサンプラー
 	CD3DX12_STATIC_SAMPLER_DESC samplerDesc =
@@ -147,9 +122,9 @@ void Sprite::StaticInitialize(
 	  &rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_0, &rootSigBlob, &errorBlob);
 	assert(SUCCEEDED(result));
 	// ルートシグネチャの生成
-	result = sDevice_->CreateRootSignature(
-	  0, rootSigBlob->GetBufferPointer(), rootSigBlob->GetBufferSize(),
-	  IID_PPV_ARGS(&sRootSignature_));
+	PipelineCache* pipelineCache = PipelineCache::GetInstance();
+	result =
+	  pipelineCache->CreateRootSignature(rootSigBlob.Get(), IID_PPV_ARGS(&sRootSignature_));
 	assert(SUCCEEDED(result));
 
 	gpipeline.pRootSignature = sRootSignature_.Get();
@@ -161,8 +136,8 @@ void Sprite::StaticInitialize(
 	gpipeline.BlendState.RenderTarget[0] = blenddesc;
 
 	// グラフィックスパイプラインの生成
-	result = sDevice_->CreateGraphicsPipelineState(
-	  &gpipeline, IID_PPV_ARGS(&sPipelineStates_[size_t(BlendMode::kNone)]));
+	result = pipelineCache->CreateGraphicsPipelineState(
+	  gpipeline, IID_PPV_ARGS(&sPipelineStates_[size_t(BlendMode::kNone)]));
 	assert(SUCCEEDED(result));
 
 	// 通常αブレンド
@@ -175,8 +150,8 @@ void Sprite::StaticInitialize(
 	blenddesc.SrcBlendAlpha = D3D12_BLEND_ONE;
 	blenddesc.DestBlendAlpha = D3D12_BLEND_ZERO;
 	gpipeline.BlendState.RenderTarget[0] = blenddesc;
-	result = sDevice_->CreateGraphicsPipelineState(
-	  &gpipeline, IID_PPV_ARGS(&sPipelineStates_[size_t(BlendMode::kNormal)]));
+	result = pipelineCache->CreateGraphicsPipelineState(
+	  gpipeline, IID_PPV_ARGS(&sPipelineStates_[size_t(BlendMode::kNormal)]));
 	assert(SUCCEEDED(result));
 
 	// 加算
@@ -184,8 +159,8 @@ void Sprite::StaticInitialize(
 	blenddesc.SrcBlend = D3D12_BLEND_SRC_ALPHA;
 	blenddesc.DestBlend = D3D12_BLEND_ONE;
 	gpipeline.BlendState.RenderTarget[0] = blenddesc;
-	result = sDevice_->CreateGraphicsPipelineState(
-	  &gpipeline, IID_PPV_ARGS(&sPipelineStates_[size_t(BlendMode::kAdd)]));
+	result = pipelineCache->CreateGraphicsPipelineState(
+	  gpipeline, IID_PPV_ARGS(&sPipelineStates_[size_t(BlendMode::kAdd)]));
 	assert(SUCCEEDED(result));
 
 	// 減算
@@ -193,8 +168,8 @@ void Sprite::StaticInitialize(
 	blenddesc.SrcBlend = D3D12_BLEND_SRC_ALPHA;
 	blenddesc.DestBlend = D3D12_BLEND_ONE;
 	gpipeline.BlendState.RenderTarget[0] = blenddesc;
-	result = sDevice_->CreateGraphicsPipelineState(
-	  &gpipeline, IID_PPV_ARGS(&sPipelineStates_[size_t(BlendMode::kSubtract)]));
+	result = pipelineCache->CreateGraphicsPipelineState(
+	  gpipeline, IID_PPV_ARGS(&sPipelineStates_[size_t(BlendMode::kSubtract)]));
 	assert(SUCCEEDED(result));
 
 	// 乗算
@@ -202,8 +177,8 @@ void Sprite::StaticInitialize(
 	blenddesc.SrcBlend = D3D12_BLEND_ZERO;
 	blenddesc.DestBlend = D3D12_BLEND_SRC_COLOR;
 	gpipeline.BlendState.RenderTarget[0] = blenddesc;
-	result = sDevice_->CreateGraphicsPipelineState(
-	  &gpipeline, IID_PPV_ARGS(&sPipelineStates_[size_t(BlendMode::kMultily)]));
+	result = pipelineCache->CreateGraphicsPipelineState(
+	  gpipeline, IID_PPV_ARGS(&sPipelineStates_[size_t(BlendMode::kMultily)]));
 	assert(SUCCEEDED(result));
 
 	// スクリーン
@@ -211,8 +186,8 @@ void Sprite::StaticInitialize(
 	blenddesc.SrcBlend = D3D12_BLEND_INV_DEST_COLOR;
 	blenddesc.DestBlend = D3D12_BLEND_ONE;
 	gpipeline.BlendState.RenderTarget[0] = blenddesc;
-	result = sDevice_->CreateGraphicsPipelineState(
-	  &gpipeline, IID_PPV_ARGS(&sPipelineStates_[size_t(BlendMode::kScreen)]));
+	result = pipelineCache->CreateGraphicsPipelineState(
+	  gpipeline, IID_PPV_ARGS(&sPipelineStates_[size_t(BlendMode::kScreen)]));
 	assert(SUCCEEDED(result));
 
 	// 射影行列計算
@@ -236,6 +211,11 @@ void Sprite::PreDraw(ID3D12GraphicsCommandList* commandList, BlendMode blendMode
 	sCommandList_->SetGraphicsRootSignature(sRootSignature_.Get());
 	// プリミティブ形状を設定
 	sCommandList_->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	// バインドレスなら全テクスチャのテーブルを1回だけセット
+	TextureManager* textureManager = TextureManager::GetInstance();
+	if (textureManager->IsBindless()) {
+		textureManager->SetGraphicsRootBindlessTable(sCommandList_, 1);
+	}
 }
 
 void Sprite::PostDraw() {
@@ -294,54 +274,15 @@ bool Sprite::Initialize() {
 	// nullptrチェック
 	assert(sDevice_);
 
-	HRESULT result = S_FALSE;
-
 	resourceDesc_ = TextureManager::GetInstance()->GetResoureDesc(textureHandle_);
 
-	{
-		// ヒーププロパティ
-		CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-		// リソース設定
-		CD3DX12_RESOURCE_DESC resourceDesc =
-		  CD3DX12_RESOURCE_DESC::Buffer(sizeof(VertexPosUv) * kVertNum);
-
-		// 頂点バッファ生成
-		result = sDevice_->CreateCommittedResource(
-		  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ,
-		  nullptr, IID_PPV_ARGS(&vertBuff_));
-		assert(SUCCEEDED(result));
-
-		// 頂点バッファマッピング
-		result = vertBuff_->Map(0, nullptr, (void**)&vertMap_);
-		assert(SUCCEEDED(result));
-	}
-
-	// 頂点バッファへのデータ転送
+	// 頂点データの計算
 	TransferVertices();
 
-	// 頂点バッファビューの作成
-	vbView_.BufferLocation = vertBuff_->GetGPUVirtualAddress();
+	// 頂点バッファビューの作成（アドレスは描画ごとに決まる）
 	vbView_.SizeInBytes = sizeof(VertexPosUv) * 4;
 	vbView_.StrideInBytes = sizeof(VertexPosUv);
 
-	{
-		// ヒーププロパティ
-		CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-		// リソース設定
-		CD3DX12_RESOURCE_DESC resourceDesc =
-		  CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferData) + 0xff) & ~0xff);
-
-		// 定数バッファの生成
-		result = sDevice_->CreateCommittedResource(
-		  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ,
-		  nullptr, IID_PPV_ARGS(&constBuff_));
-		assert(SUCCEEDED(result));
-	}
-
-	// 定数バッファマッピング
-	result = constBuff_->Map(0, nullptr, (void**)&constMap_);
-	assert(SUCCEEDED(result));
-
 	return true;
 }
 
@@ -406,17 +347,32 @@ void Sprite::Draw() {
 	matWorld_ *= XMMatrixRotationZ(rotation_);
 	matWorld_ *= XMMatrixTranslation(position_.x, position_.y, 0.0f);
 
-	// 定数バッファにデータ転送
-	constMap_->color = color_;
-	constMap_->mat = matWorld_ * sMatProjection_; // 行列の合成
+	// 定数バッファにデータ転送（描画ごとに新しい領域を使う）
+	ConstantBufferRing::Allocation constBuffer =
+	  ConstantBufferRing::GetInstance()->Allocate(sizeof(ConstBufferData));
+	ConstBufferData* constMap = static_cast<ConstBufferData*>(constBuffer.cpuAddress);
+	constMap->color = color_;
+	constMap->mat = matWorld_ * sMatProjection_; // 行列の合成
+
+	// 頂点バッファにデータ転送（GPUが前のフレームで使用中の領域は書き換えない）
+	ConstantBufferRing::Allocation vertBuff =
+	  ConstantBufferRing::GetInstance()->Allocate(sizeof(vertices_));
+	memcpy(vertBuff.cpuAddress, vertices_, sizeof(vertices_));
+	vbView_.BufferLocation = vertBuff.gpuAddress;
 
 	// 頂点バッファの設定
 	sCommandList_->IASetVertexBuffers(0, 1, &vbView_);
 
 	// 定数バッファビューをセット
-	sCommandList_->SetGraphicsRootConstantBufferView(0, constBuff_->GetGPUVirtualAddress());
-	// シェーダリソースビューをセット
-	TextureManager::GetInstance()->SetGraphicsRootDescriptorTable(sCommandList_, 1, textureHandle_);
+	sCommandList_->SetGraphicsRootConstantBufferView(0, constBuffer.gpuAddress);
+	// シェーダリソースビューをセット（バインドレスならテクスチャ番号だけ）
+	TextureManager* textureManager = TextureManager::GetInstance();
+	if (textureManager->IsBindless()) {
+		sCommandList_->SetGraphicsRoot32BitConstant(
+		  2, textureManager->GetDescriptorIndex(textureHandle_), 0);
+	} else {
+		textureManager->SetGraphicsRootDescriptorTable(sCommandList_, 1, textureHandle_);
+	}
 	// 描画コマンド
 	sCommandList_->DrawInstanced(4, 1, 0, 0);
 }
@@ -463,5 +419,5 @@ void Sprite::TransferVertices() {
 	}
 
 	// 頂点バッファへのデータ転送
-	memcpy(vertMap_, vertices, sizeof(vertices));
+	memcpy(vertices_, vertices, sizeof(vertices));
 }
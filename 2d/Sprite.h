@@ -189,14 +189,8 @@ class Sprite {
 	void Draw();
 
   private: // メンバ変数
-	// 頂点バッファ
-	Microsoft::WRL::ComPtr<ID3D12Resource> vertBuff_;
-	// 定数バッファ
-	Microsoft::WRL::ComPtr<ID3D12Resource> constBuff_;
-	// 頂点バッファマップ
-	VertexPosUv* vertMap_ = nullptr;
-	// 定数バッファマップ
-	ConstBufferData* constMap_ = nullptr;
+	// 頂点データ（描画時にアップロードリングへ転送する）
+	VertexPosUv vertices_[kVertNum] = {};
 	// 頂点バッファビュー
 	D3D12_VERTEX_BUFFER_VIEW vbView_{};
 	// テクスチャ番号
@@ -0,0 +1,59 @@
+﻿#include "Frustum.h"
+#include <algorithm>
+
+using namespace DirectX;
+
+void Frustum::Update(const XMMATRIX& matViewProjection) {
+	// 行ベクトル形式なので、列から平面を取り出す（D3Dのクリップ空間はzが0～w）
+	XMMATRIX columns = XMMatrixTranspose(matViewProjection);
+	XMVECTOR planes[8] = {
+	  XMVectorAdd(columns.r[3], columns.r[0]),      // 左
+	  XMVectorSubtract(columns.r[3], columns.r[0]), // 右
+	  XMVectorAdd(columns.r[3], columns.r[1]),      // 下
+	  XMVectorSubtract(columns.r[3], columns.r[1]), // 上
+	  columns.r[2],                                 // 手前
+	  XMVectorSubtract(columns.r[3], columns.r[2]), // 奥
+	  XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f),          // 余り（常に内側）
+	  XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f),          // 余り（常に内側）
+	};
+	for (int i = 0; i < 6; i++) {
+		// 距離として扱えるように法線を正規化
+		planes[i] = XMPlaneNormalize(planes[i]);
+	}
+
+	// 4平面ずつ転置してSoAにする
+	for (int i = 0; i < 2; i++) {
+		XMMATRIX soa = XMMatrixTranspose(
+		  XMMATRIX(planes[i * 4], planes[i * 4 + 1], planes[i * 4 + 2], planes[i * 4 + 3]));
+		planeX_[i] = soa.r[0];
+		planeY_[i] = soa.r[1];
+		planeZ_[i] = soa.r[2];
+		planeW_[i] = soa.r[3];
+	}
+}
+
+bool Frustum::IntersectsSphere(FXMVECTOR center, float radius) const {
+	XMVECTOR x = XMVectorSplatX(center);
+	XMVECTOR y = XMVectorSplatY(center);
+	XMVECTOR z = XMVectorSplatZ(center);
+	XMVECTOR negativeRadius = XMVectorReplicate(-radius);
+
+	// 4平面分の符号付き距離をまとめて計算し、どれか1つでも半径より外なら外側
+	XMVECTOR outside = XMVectorFalseInt();
+	for (int i = 0; i < 2; i++) {
+		XMVECTOR distance = XMVectorMultiplyAdd(
+		  x, planeX_[i],
+		  XMVectorMultiplyAdd(y, planeY_[i], XMVectorMultiplyAdd(z, planeZ_[i], planeW_[i])));
+		outside = XMVectorOrInt(outside, XMVectorLess(distance, negativeRadius));
+	}
+	return XMComparisonAllTrue(XMVector4EqualIntR(outside, XMVectorFalseInt()));
+}
+
+bool Frustum::IntersectsSphere(
+  const XMFLOAT3& center, float radius, const XMMATRIX& matWorld) const {
+	XMVECTOR worldCenter = XMVector3Transform(XMLoadFloat3(&center), matWorld);
+	float scale = std::max(
+	  {XMVectorGetX(XMVector3Length(matWorld.r[0])), XMVectorGetX(XMVector3Length(matWorld.r[1])),
+	   XMVectorGetX(XMVector3Length(matWorld.r[2]))});
+	return IntersectsSphere(worldCenter, radius * scale);
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+
+/// <summary>
+/// 視錐台
+/// ビュープロジェクション行列から6平面を取り出し、球との判定を4平面ずつSIMDで行う
+/// </summary>
+class Frustum {
+  public: // メンバ関数
+	/// <summary>
+	/// 平面の更新
+	/// </summary>
+	/// <param name="matViewProjection">ビュー行列と射影行列の積</param>
+	void Update(const DirectX::XMMATRIX& matViewProjection);
+
+	/// <summary>
+	/// 球が視錐台と重なるか（完全に外側にある場合だけfalse）
+	/// </summary>
+	/// <param name="center">中心（ワールド座標）</param>
+	/// <param name="radius">半径</param>
+	/// <returns>重なるか</returns>
+	bool IntersectsSphere(DirectX::FXMVECTOR center, float radius) const;
+
+	/// <summary>
+	/// モデル座標の球が視錐台と重なるか（半径はワールド行列の最大の拡大率で広げる）
+	/// </summary>
+	/// <param name="center">中心（モデル座標）</param>
+	/// <param name="radius">半径</param>
+	/// <param name="matWorld">ワールド行列</param>
+	/// <returns>重なるか</returns>
+	bool IntersectsSphere(
+	  const DirectX::XMFLOAT3& center, float radius, const DirectX::XMMATRIX& matWorld) const;
+
+  private: // メンバ変数
+	// 平面の係数(ax+by+cz+d)をSoAで保持（6平面を8個に切り上げ、余りは常に内側）
+	DirectX::XMVECTOR planeX_[2] = {};
+	DirectX::XMVECTOR planeY_[2] = {};
+	DirectX::XMVECTOR planeZ_[2] = {};
+	DirectX::XMVECTOR planeW_[2] = {};
+};
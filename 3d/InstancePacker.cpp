@@ -0,0 +1,25 @@
+﻿#include "InstancePacker.h"
+
+using namespace DirectX;
+
+InstancePacker::Result InstancePacker::Pack(
+  const WorldTransform* const* transforms, size_t count, const XMFLOAT3& boundCenter,
+  float boundRadius, const Frustum& frustum, XMFLOAT4X4* dest, size_t capacity,
+  uint32_t* packedIndices) {
+	Result result{0, 0};
+	for (size_t i = 0; i < count && result.packedCount < capacity; i++) {
+		const XMMATRIX& matWorld = transforms[i]->matWorld_;
+		// 視錐台の外なら除く
+		if (!frustum.IntersectsSphere(boundCenter, boundRadius, matWorld)) {
+			result.culledCount++;
+			continue;
+		}
+		// 定数バッファと同じく行優先のまま書き込む
+		XMStoreFloat4x4(&dest[result.packedCount], matWorld);
+		if (packedIndices) {
+			packedIndices[result.packedCount] = static_cast<uint32_t>(i);
+		}
+		result.packedCount++;
+	}
+	return result;
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include "Frustum.h"
+#include "WorldTransform.h"
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// インスタンス描画用のワールド行列の詰め込み
+/// 視錐台の外のインスタンスを除き、書き込み先（構造化バッファのマップ済みメモリなど）へ連続で書き込む
+/// GPUに依存しないので、CPUだけで結果を検証できる
+/// </summary>
+class InstancePacker {
+  public: // サブクラス
+	// 詰め込みの結果
+	struct Result {
+		uint32_t packedCount; // 書き込んだインスタンス数
+		uint32_t culledCount; // 視錐台の外で除いたインスタンス数
+	};
+
+  public: // 静的メンバ関数
+	/// <summary>
+	/// 詰め込み（書き込み先が一杯になったら残りは書き込まない）
+	/// </summary>
+	/// <param name="transforms">ワールドトランスフォームの配列</param>
+	/// <param name="count">インスタンス数</param>
+	/// <param name="boundCenter">境界球の中心（モデル座標）</param>
+	/// <param name="boundRadius">境界球の半径</param>
+	/// <param name="frustum">視錐台</param>
+	/// <param name="dest">ワールド行列の書き込み先</param>
+	/// <param name="capacity">書き込み先の要素数</param>
+	/// <param name="packedIndices">書き込んだインスタンスの元の番号（null可、count個分）</param>
+	/// <returns>結果</returns>
+	static Result Pack(
+	  const WorldTransform* const* transforms, size_t count, const DirectX::XMFLOAT3& boundCenter,
+	  float boundRadius, const Frustum& frustum, DirectX::XMFLOAT4X4* dest, size_t capacity,
+	  uint32_t* packedIndices);
+};
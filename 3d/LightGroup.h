@@ -6,6 +6,7 @@
 #include <DirectXMath.h>
 #include <d3dx12.h>
 
+#include "ConstantBufferRing.h"
 #include "DirectionalLight.h"
 #include "PointLight.h"
 #include "SpotLight.h"
@@ -78,7 +79,7 @@ public: // メンバ関数
 	void Draw(ID3D12GraphicsCommandList* cmdList, UINT rootParameterIndex);
 
 	/// <summary>
-	/// 定数バッファ転送
+	/// 定数バッファ用データの更新（次の描画から反映する）
 	/// </summary>
 	void TransferConstBuffer();
 
@@ -227,10 +228,10 @@ public: // メンバ関数
 	void SetCircleShadowFactorAngle(int index, const XMFLOAT2& lightFactorAngle);
 
 private: // メンバ変数
-	// 定数バッファ
-	ComPtr<ID3D12Resource> constBuff_;
-	// 定数バッファのマップ
-	ConstBufferData* constMap_ = nullptr;
+	// 定数バッファに転送するデータ
+	ConstBufferData constData_{};
+	// 今のフレームで転送済みの定数バッファ
+	ConstantBufferRing::FrameCache constBufferCache_;
 
 	// 環境光の色
 	XMFLOAT3 ambientColor_ = { 1,1,1 };
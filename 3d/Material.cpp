@@ -1,8 +1,8 @@
-﻿#include "DirectXCommon.h"
-#include "Material.h"
+﻿#include "Material.h"
 #include "TextureManager.h"
 #include <DirectXTex.h>
 #include <cassert>
+#include <cstring>
 
 using namespace DirectX;
 using namespace std;
@@ -16,28 +16,8 @@ Material* Material::Create() {
 }
 
 void Material::Initialize() {
-	// 定数バッファの生成
-	CreateConstantBuffer();
-}
-
-void Material::CreateConstantBuffer() {
-	HRESULT result;
-
-	// ヒーププロパティ
-	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	// リソース設定
-	CD3DX12_RESOURCE_DESC resourceDesc =
-	  CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferData) + 0xff) & ~0xff);
-
-	// 定数バッファの生成
-	result = DirectXCommon::GetInstance()->GetDevice()->CreateCommittedResource(
-	  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-	  IID_PPV_ARGS(&constBuff_));
-	assert(SUCCEEDED(result));
-
-	// 定数バッファとのデータリンク
-	result = constBuff_->Map(0, nullptr, (void**)&constMap_);
-	assert(SUCCEEDED(result));
+	// 定数バッファ用データの初期化
+	Update();
 }
 
 void Material::LoadTexture(const std::string& directoryPath) {
@@ -60,11 +40,23 @@ void Material::LoadTexture(const std::string& directoryPath) {
 }
 
 void Material::Update() {
-	// 定数バッファへデータ転送
-	constMap_->ambient = ambient_;
-	constMap_->diffuse = diffuse_;
-	constMap_->specular = specular_;
-	constMap_->alpha = alpha_;
+	// 定数バッファ用データの更新
+	constData_.ambient = ambient_;
+	constData_.diffuse = diffuse_;
+	constData_.specular = specular_;
+	constData_.alpha = alpha_;
+
+	// 同じフレーム内で変更された場合も転送し直す
+	constBufferCache_ = {};
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS Material::TransferConstBuffer() {
+	void* constMap =
+	  ConstantBufferRing::GetInstance()->Allocate(sizeof(ConstBufferData), constBufferCache_);
+	if (constMap) {
+		memcpy(constMap, &constData_, sizeof(ConstBufferData));
+	}
+	return constBufferCache_.gpuAddress;
 }
 
 void Material::SetGraphicsCommand(
@@ -77,7 +69,7 @@ void Material::SetGraphicsCommand(
 
 	// マテリアルの定数バッファをセット
 	commandList->SetGraphicsRootConstantBufferView(
-	  rooParameterIndexMaterial, constBuff_->GetGPUVirtualAddress());
+	  rooParameterIndexMaterial, TransferConstBuffer());
 }
 
 void Material::SetGraphicsCommand(
@@ -90,5 +82,5 @@ void Material::SetGraphicsCommand(
 
 	// マテリアルの定数バッファをセット
 	commandList->SetGraphicsRootConstantBufferView(
-	  rooParameterIndexMaterial, constBuff_->GetGPUVirtualAddress());
+	  rooParameterIndexMaterial, TransferConstBuffer());
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include "ConstantBufferRing.h"
 #include <DirectXMath.h>
 #include <d3d12.h>
 #include <d3dx12.h>
@@ -47,18 +48,13 @@ class Material {
 
   public:
 	/// <summary>
-	/// 定数バッファの取得
-	/// </summary>
-	/// <returns></returns>
-	ID3D12Resource* GetConstantBuffer() { return constBuff_.Get(); }
-
 	/// テクスチャ読み込み
 	/// </summary>
 	/// <param name="directoryPath">読み込みディレクトリパス</param>
 	void LoadTexture(const std::string& directoryPath);
 
 	/// <summary>
-	/// 更新
+	/// 更新（係数の変更を次の描画から反映する）
 	/// </summary>
 	void Update();
 
@@ -86,11 +82,17 @@ class Material {
 	// テクスチャハンドル
 	uint32_t GetTextureHadle() { return textureHandle_; }
 
+	/// <summary>
+	/// 定数バッファへのデータ転送（同じフレーム内では1回だけ）
+	/// </summary>
+	/// <returns>定数バッファのGPUアドレス</returns>
+	D3D12_GPU_VIRTUAL_ADDRESS TransferConstBuffer();
+
   private:
-	// 定数バッファ
-	ComPtr<ID3D12Resource> constBuff_;
-	// 定数バッファのマップ
-	ConstBufferData* constMap_ = nullptr;
+	// 定数バッファに転送するデータ
+	ConstBufferData constData_{};
+	// 今のフレームで転送済みの定数バッファ
+	ConstantBufferRing::FrameCache constBufferCache_;
 	// テクスチャハンドル
 	uint32_t textureHandle_ = 0;
 
@@ -107,9 +109,4 @@ class Material {
 	/// 初期化
 	/// </summary>
 	void Initialize();
-
-	/// <summary>
-	/// 定数バッファの生成
-	/// </summary>
-	void CreateConstantBuffer();
 };
@@ -1,106 +1,307 @@
 ﻿#include "DirectXCommon.h"
+#include "GpuMemoryAllocator.h"
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "UploadManager.h"
+#include "VertexQuantizer.h"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <d3dcompiler.h>
 
 #pragma comment(lib, "d3dcompiler.lib")
 
 using namespace DirectX;
 
+Mesh::~Mesh() {
+	// 前のフレームの描画で使用中かもしれないので、GPUの完了まで解放を遅らせる
+	if (vertBuff_) {
+		DirectXCommon::GetInstance()->ReleaseDeferred(std::move(vertBuff_));
+	}
+	if (indexBuff_) {
+		DirectXCommon::GetInstance()->ReleaseDeferred(std::move(indexBuff_));
+	}
+}
+
 void Mesh::SetName(const std::string& name_) { this->name_ = name_; }
 
 void Mesh::AddVertex(const VertexPosNormalUv& vertex) { vertices_.emplace_back(vertex); }
 
-void Mesh::AddIndex(unsigned short index) { indices_.emplace_back(index); }
+void Mesh::AddIndex(uint32_t index) { indices_.emplace_back(index); }
 
-void Mesh::AddSmoothData(unsigned short indexPosition, unsigned short indexVertex) {
-	smoothData_[indexPosition].emplace_back(indexVertex);
+void Mesh::AddSmoothData(uint32_t indexPosition, uint32_t indexVertex) {
+	smoothData_.push_back({indexPosition, indexVertex});
 }
 
 void Mesh::CalculateSmoothedVertexNormals() {
-	auto itr = smoothData_.begin();
-	for (; itr != smoothData_.end(); ++itr) {
-		// 各面用の共通頂点コレクション
-		std::vector<unsigned short>& v = itr->second;
-		// 全頂点の法線を平均する
-		XMVECTOR normal = {};
-		for (unsigned short index : v) {
-			normal += XMVectorSet(
-			  vertices_[index].normal.x, vertices_[index].normal.y, vertices_[index].normal.z, 0);
+	if (smoothData_.empty()) {
+		return;
+	}
+
+	// 座標インデックスの範囲
+	uint32_t positionCount = 0;
+	for (const SmoothData& data : smoothData_) {
+		positionCount = std::max(positionCount, data.indexPosition + 1);
+	}
+
+	// 1パス目：座標インデックスごとの角の数を数えて先頭位置を求める
+	std::vector<uint32_t> offsets(positionCount + 1, 0);
+	for (const SmoothData& data : smoothData_) {
+		offsets[data.indexPosition + 1]++;
+	}
+	for (uint32_t i = 0; i < positionCount; i++) {
+		offsets[i + 1] += offsets[i];
+	}
+
+	// 2パス目：頂点インデックスを座標インデックス順に並べる（登録順は保つ）
+	std::vector<uint32_t> cornerVertices(smoothData_.size());
+	{
+		std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+		for (const SmoothData& data : smoothData_) {
+			cornerVertices[cursor[data.indexPosition]++] = data.indexVertex;
 		}
-		normal = XMVector3Normalize(normal / (float)v.size());
+	}
 
-		for (unsigned short index : v) {
-			vertices_[index].normal = {normal.m128_f32[0], normal.m128_f32[1], normal.m128_f32[2]};
+	// 使われている座標だけを詰めたグループ（SIMDの4個単位に切り上げる）
+	std::vector<uint32_t> groups;
+	groups.reserve(positionCount);
+	for (uint32_t i = 0; i < positionCount; i++) {
+		if (offsets[i + 1] > offsets[i]) {
+			groups.push_back(i);
+		}
+	}
+	const size_t groupCount = groups.size();
+	const size_t paddedCount = (groupCount + 3) & ~size_t(3);
+
+	// グループごとの法線の合計（SoA）
+	std::vector<float> sumX(paddedCount, 0.0f), sumY(paddedCount, 0.0f), sumZ(paddedCount, 0.0f);
+	for (size_t g = 0; g < groupCount; g++) {
+		float x = 0.0f, y = 0.0f, z = 0.0f;
+		for (uint32_t j = offsets[groups[g]]; j < offsets[groups[g] + 1]; j++) {
+			const XMFLOAT3& normal = vertices_[cornerVertices[j]].normal;
+			x += normal.x;
+			y += normal.y;
+			z += normal.z;
+		}
+		sumX[g] = x;
+		sumY[g] = y;
+		sumZ[g] = z;
+	}
+
+	// 4グループずつまとめて正規化（長さ0は0のまま）
+	const XMVECTOR zero = XMVectorZero();
+	for (size_t g = 0; g < paddedCount; g += 4) {
+		XMVECTOR x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&sumX[g]));
+		XMVECTOR y = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&sumY[g]));
+		XMVECTOR z = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&sumZ[g]));
+		XMVECTOR lengthSq = XMVectorMultiplyAdd(x, x, XMVectorMultiplyAdd(y, y, z * z));
+		XMVECTOR length = XMVectorSqrt(lengthSq);
+		XMVECTOR nonZero = XMVectorGreater(length, zero);
+		XMVECTOR invLength = XMVectorSelect(zero, XMVectorReciprocal(length), nonZero);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&sumX[g]), x * invLength);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&sumY[g]), y * invLength);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&sumZ[g]), z * invLength);
+	}
+
+	// グループ内の全頂点に書き戻す
+	for (size_t g = 0; g < groupCount; g++) {
+		const XMFLOAT3 normal = {sumX[g], sumY[g], sumZ[g]};
+		for (uint32_t j = offsets[groups[g]]; j < offsets[groups[g] + 1]; j++) {
+			vertices_[cornerVertices[j]].normal = normal;
 		}
 	}
 }
 
 void Mesh::SetMaterial(Material* material) { this->material_ = material; }
 
-void Mesh::CreateBuffers() {
-	HRESULT result;
+void Mesh::Optimize() {
+	// 三角形の並べ替え
+	MeshOptimizer::OptimizeVertexCache(indices_, vertices_.size());
 
-	UINT sizeVB = static_cast<UINT>(sizeof(VertexPosNormalUv) * vertices_.size());
+	// 頂点の並べ替え
+	std::vector<uint32_t> remap = MeshOptimizer::OptimizeVertexFetch(indices_, vertices_.size());
+	std::vector<VertexPosNormalUv> vertices(vertices_.size());
+	for (size_t i = 0; i < vertices_.size(); i++) {
+		vertices[remap[i]] = vertices_[i];
+	}
+	vertices_.swap(vertices);
 
-	// ヒーププロパティ
-	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	// リソース設定
-	CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeVB);
+	// 平滑化用のデータは旧頂点番号なので破棄
+	smoothData_.clear();
+}
+
+void Mesh::GenerateLods(uint32_t lodCount, float reduction, bool optimize) {
+	lods_.clear();
+	if (lodCount <= 1 || indices_.empty()) {
+		return;
+	}
 
-	// 頂点バッファ生成
-	result = DirectXCommon::GetInstance()->GetDevice()->CreateCommittedResource(
-	  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-	  IID_PPV_ARGS(&vertBuff_));
-	assert(SUCCEEDED(result));
+	// 元のメッシュをLOD0とする
+	lods_.push_back({0, static_cast<uint32_t>(indices_.size())});
 
-	// 頂点バッファへのデータ転送
-	VertexPosNormalUv* vertMap = nullptr;
-	result = vertBuff_->Map(0, nullptr, (void**)&vertMap);
-	if (SUCCEEDED(result)) {
-		std::copy(vertices_.begin(), vertices_.end(), vertMap);
-		vertBuff_->Unmap(0, nullptr);
+	std::vector<uint32_t> source(indices_.begin(), indices_.end());
+	float ratio = 1.0f;
+	for (uint32_t i = 1; i < lodCount; i++) {
+		ratio *= reduction;
+		size_t targetIndexCount = static_cast<size_t>(lods_[0].indexCount * ratio) / 3 * 3;
+		// 1つ前のLODから簡略化する
+		std::vector<uint32_t> simplified = MeshSimplifier::Simplify(
+		  source, &vertices_[0].pos.x, vertices_.size(), sizeof(VertexPosNormalUv),
+		  targetIndexCount);
+		// ほとんど減らせなかったらLODを打ち切る
+		if (simplified.empty() || simplified.size() * 10 > source.size() * 9) {
+			break;
+		}
+		if (optimize) {
+			MeshOptimizer::OptimizeVertexCache(simplified, vertices_.size());
+		}
+		lods_.push_back(
+		  {static_cast<uint32_t>(indices_.size()), static_cast<uint32_t>(simplified.size())});
+		indices_.insert(indices_.end(), simplified.begin(), simplified.end());
+		source.swap(simplified);
 	}
 
-	// 頂点バッファビューの作成
-	vbView_.BufferLocation = vertBuff_->GetGPUVirtualAddress();
-	vbView_.SizeInBytes = sizeVB;
-	vbView_.StrideInBytes = sizeof(vertices_[0]);
+	// LODが作れなければ元のメッシュのみ
+	if (lods_.size() == 1) {
+		lods_.clear();
+	}
+}
 
+void Mesh::SetLods(const LodLevel* lods, size_t lodCount) { lods_.assign(lods, lods + lodCount); }
+
+Mesh::VertexDecode Mesh::GetVertexDecode() const {
+	// シェーダーではUNORMの値(0～1)にAABBの大きさを掛けて最小座標を足す
+	VertexDecode decode{};
+	decode.positionScale = {
+	  aabbMax_.x - aabbMin_.x, aabbMax_.y - aabbMin_.y, aabbMax_.z - aabbMin_.z, 0.0f};
+	decode.positionOffset = {aabbMin_.x, aabbMin_.y, aabbMin_.z, 0.0f};
+	return decode;
+}
+
+void Mesh::CalculateBounds() {
+	if (vertices_.empty()) {
+		SetBounds({0, 0, 0}, {0, 0, 0});
+		return;
+	}
+
+	XMVECTOR vMin = XMLoadFloat3(&vertices_[0].pos);
+	XMVECTOR vMax = vMin;
+	for (const VertexPosNormalUv& vertex : vertices_) {
+		XMVECTOR pos = XMLoadFloat3(&vertex.pos);
+		vMin = XMVectorMin(vMin, pos);
+		vMax = XMVectorMax(vMax, pos);
+	}
+	XMFLOAT3 aabbMin, aabbMax;
+	XMStoreFloat3(&aabbMin, vMin);
+	XMStoreFloat3(&aabbMax, vMax);
+	SetBounds(aabbMin, aabbMax);
+}
+
+void Mesh::SetBounds(const XMFLOAT3& aabbMin, const XMFLOAT3& aabbMax) {
+	aabbMin_ = aabbMin;
+	aabbMax_ = aabbMax;
+
+	// AABBに外接する球（キャッシュから読み込んだ場合と結果を揃える）
+	XMVECTOR vMin = XMLoadFloat3(&aabbMin_);
+	XMVECTOR vMax = XMLoadFloat3(&aabbMax_);
+	XMStoreFloat3(&boundCenter_, XMVectorScale(XMVectorAdd(vMin, vMax), 0.5f));
+	boundRadius_ = XMVectorGetX(XMVector3Length(XMVectorSubtract(vMax, vMin))) * 0.5f;
+}
+
+DXGI_FORMAT Mesh::SelectIndexFormat(size_t vertexCount) {
+	// 0～65535の範囲に収まるなら16bit
+	return vertexCount <= 0x10000 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
+
+UINT Mesh::GetIndexStride(DXGI_FORMAT indexFormat) {
+	return indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+void Mesh::CreateBuffers() {
+	DXGI_FORMAT indexFormat = SelectIndexFormat(vertices_.size());
+	if (indexFormat == DXGI_FORMAT_R16_UINT) {
+		// 16bitに詰め直して転送する
+		std::vector<uint16_t> indices16(indices_.begin(), indices_.end());
+		CreateBuffers(
+		  vertices_.data(), vertices_.size(), indices16.data(), indices16.size(), indexFormat);
+	} else {
+		CreateBuffers(
+		  vertices_.data(), vertices_.size(), indices_.data(), indices_.size(), indexFormat);
+	}
+}
+
+void Mesh::CreateBuffers(
+  const VertexPosNormalUv* vertices, size_t vertexCount, const void* indices,
+  size_t indexCount, DXGI_FORMAT indexFormat) {
+	HRESULT result;
+
+	// 量子化する場合は転送前に詰め直す
+	std::vector<VertexPosNormalUvPacked> packedVertices;
+	const void* vertexData = vertices;
+	UINT vertexStride = sizeof(VertexPosNormalUv);
+	if (vertexFormat_ == VertexFormat::kPacked) {
+		packedVertices.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++) {
+			const VertexPosNormalUv& v = vertices[i];
+			packedVertices[i] =
+			  VertexQuantizer::Encode(v.pos, v.normal, v.uv, aabbMin_, aabbMax_);
+		}
+		vertexData = packedVertices.data();
+		vertexStride = sizeof(VertexPosNormalUvPacked);
+	}
+
+	UINT sizeVB = static_cast<UINT>(vertexStride * vertexCount);
+
+	// リソース設定
+	CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeVB);
+
+	// 頂点バッファ生成（コピーキューで書き込むのでCOMMON状態）
+	result = GpuMemoryAllocator::GetInstance()->CreateResource(
+	  resourceDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&vertBuff_));
 	if (FAILED(result)) {
 		assert(0);
 		return;
 	}
 
-	UINT sizeIB = static_cast<UINT>(sizeof(unsigned short) * indices_.size());
+	UINT sizeIB = static_cast<UINT>(GetIndexStride(indexFormat) * indexCount);
 	// リソース設定
 	resourceDesc.Width = sizeIB;
 	// インデックスバッファ生成
-	result = DirectXCommon::GetInstance()->GetDevice()->CreateCommittedResource(
-	  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-	  IID_PPV_ARGS(&indexBuff_));
+	result = GpuMemoryAllocator::GetInstance()->CreateResource(
+	  resourceDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&indexBuff_));
 	if (FAILED(result)) {
 		assert(0);
 		return;
 	}
 
-	// インデックスバッファへのデータ転送
-	unsigned short* indexMap = nullptr;
-	result = indexBuff_->Map(0, nullptr, (void**)&indexMap);
-	if (SUCCEEDED(result)) {
-		std::copy(indices_.begin(), indices_.end(), indexMap);
-		indexBuff_->Unmap(0, nullptr);
-	}
+	// 頂点バッファへのデータ転送を予約
+	UploadManager::GetInstance()->UploadBuffer(vertBuff_.Get(), vertexData, sizeVB);
+	// インデックスバッファへのデータ転送を予約
+	UploadManager::GetInstance()->UploadBuffer(indexBuff_.Get(), indices, sizeIB);
+
+	// 頂点バッファビューの作成
+	vbView_.BufferLocation = vertBuff_->GetGPUVirtualAddress();
+	vbView_.SizeInBytes = sizeVB;
+	vbView_.StrideInBytes = vertexStride;
 
 	// インデックスバッファビューの作成
 	ibView_.BufferLocation = indexBuff_->GetGPUVirtualAddress();
-	ibView_.Format = DXGI_FORMAT_R16_UINT;
+	ibView_.Format = indexFormat;
 	ibView_.SizeInBytes = sizeIB;
+	indexCount_ = static_cast<UINT>(indexCount);
+}
+
+Mesh::LodLevel Mesh::GetLodLevel(uint32_t lodLevel) const {
+	if (lods_.empty()) {
+		return {0, indexCount_};
+	}
+	return lods_[lodLevel < lods_.size() ? lodLevel : lods_.size() - 1];
 }
 
 void Mesh::Draw(
   ID3D12GraphicsCommandList* commandList, UINT rooParameterIndexMaterial,
-  UINT rooParameterIndexTexture) {
+  UINT rooParameterIndexTexture, uint32_t lodLevel, uint32_t instanceCount) {
 	// 頂点バッファをセット
 	commandList->IASetVertexBuffers(0, 1, &vbView_);
 	// インデックスバッファをセット
@@ -110,12 +311,14 @@ void Mesh::Draw(
 	material_->SetGraphicsCommand(commandList, rooParameterIndexMaterial, rooParameterIndexTexture);
 
 	// 描画コマンド
-	commandList->DrawIndexedInstanced((UINT)indices_.size(), 1, 0, 0, 0);
+	LodLevel lod = GetLodLevel(lodLevel);
+	commandList->DrawIndexedInstanced(lod.indexCount, instanceCount, lod.indexOffset, 0, 0);
 }
 
 void Mesh::Draw(
   ID3D12GraphicsCommandList* commandList, UINT rooParameterIndexMaterial,
-  UINT rooParameterIndexTexture, uint32_t textureHandle) {
+  UINT rooParameterIndexTexture, uint32_t textureHandle, uint32_t lodLevel,
+  uint32_t instanceCount) {
 	// 頂点バッファをセット
 	commandList->IASetVertexBuffers(0, 1, &vbView_);
 	// インデックスバッファをセット
@@ -126,5 +329,6 @@ void Mesh::Draw(
 	  commandList, rooParameterIndexMaterial, rooParameterIndexTexture, textureHandle);
 
 	// 描画コマンド
-	commandList->DrawIndexedInstanced((UINT)indices_.size(), 1, 0, 0, 0);
+	LodLevel lod = GetLodLevel(lodLevel);
+	commandList->DrawIndexedInstanced(lod.indexCount, instanceCount, lod.indexOffset, 0, 0);
 }
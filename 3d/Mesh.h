@@ -1,11 +1,11 @@
 ﻿#pragma once
 
 #include "Material.h"
+#include "VertexQuantizer.h"
 #include <DirectXMath.h>
 #include <Windows.h>
 #include <d3d12.h>
 #include <d3dx12.h>
-#include <unordered_map>
 #include <vector>
 #include <wrl.h>
 
@@ -30,7 +30,41 @@ class Mesh {
 		XMFLOAT2 uv;     // uv座標
 	};
 
+	// 量子化済み頂点データ構造体（16バイト）
+	using VertexPosNormalUvPacked = VertexQuantizer::PackedVertex;
+
+	// GPUに転送する頂点フォーマット
+	enum class VertexFormat {
+		kFloat,  // VertexPosNormalUv
+		kPacked, // VertexPosNormalUvPacked
+	};
+
+	// 量子化座標の復元用定数（頂点シェーダーのルート定数）
+	struct VertexDecode {
+		DirectX::XMFLOAT4 positionScale;  // 拡大率（AABBの大きさ）
+		DirectX::XMFLOAT4 positionOffset; // オフセット（AABBの最小座標）
+	};
+
+	// エッジ平滑化データ（角ごとの座標インデックスと頂点インデックスの組）
+	struct SmoothData {
+		uint32_t indexPosition; // 座標インデックス
+		uint32_t indexVertex;   // 頂点インデックス
+	};
+
+	// LODのインデックス範囲
+	struct LodLevel {
+		uint32_t indexOffset; // 先頭のインデックス位置
+		uint32_t indexCount;  // インデックス数
+	};
+
   public: // メンバ関数
+	Mesh() = default;
+
+	/// <summary>
+	/// デストラクタ（GPUが使用中かもしれないバッファはフレームの完了後に解放する）
+	/// </summary>
+	~Mesh();
+
 	/// <summary>
 	/// 名前を取得
 	/// </summary>
@@ -53,7 +87,7 @@ class Mesh {
 	/// 頂点インデックスの追加
 	/// </summary>
 	/// <param name="index">インデックス</param>
-	void AddIndex(unsigned short index);
+	void AddIndex(uint32_t index);
 
 	/// <summary>
 	/// 頂点データの数を取得
@@ -66,10 +100,12 @@ class Mesh {
 	/// </summary>
 	/// <param name="indexPosition">座標インデックス</param>
 	/// <param name="indexVertex">頂点インデックス</param>
-	void AddSmoothData(unsigned short indexPosition, unsigned short indexVertex);
+	void AddSmoothData(uint32_t indexPosition, uint32_t indexVertex);
 
 	/// <summary>
 	/// 平滑化された頂点法線の計算
+	/// 座標インデックスごとの頂点リストを計数ソートで連続配列(CSR)に並べ、
+	/// 法線の合計と正規化はSoA配列上でSIMD演算する
 	/// </summary>
 	void CalculateSmoothedVertexNormals();
 
@@ -85,11 +121,126 @@ class Mesh {
 	/// <param name="material">マテリアル</param>
 	void SetMaterial(Material* material);
 
+	/// <summary>
+	/// 頂点キャッシュ・頂点フェッチの最適化
+	/// 三角形を並べ替えた後、参照順に頂点を並べ替える（平滑化後に呼ぶこと）
+	/// </summary>
+	void Optimize();
+
+	/// <summary>
+	/// 簡略化したLODの生成
+	/// 全LODは頂点配列を共有し、インデックス配列の後ろに詳細度の高い順に並ぶ
+	/// </summary>
+	/// <param name="lodCount">LOD数（元のメッシュを含む）</param>
+	/// <param name="reduction">1段階ごとの三角形数の比率</param>
+	/// <param name="optimize">各LODに頂点キャッシュ最適化をかけるか</param>
+	void GenerateLods(uint32_t lodCount, float reduction, bool optimize);
+
+	/// <summary>
+	/// LODのインデックス範囲をセット
+	/// </summary>
+	/// <param name="lods">LODのインデックス範囲</param>
+	/// <param name="lodCount">LOD数</param>
+	void SetLods(const LodLevel* lods, size_t lodCount);
+
+	/// <summary>
+	/// LODのインデックス範囲を取得
+	/// </summary>
+	/// <returns>LODのインデックス範囲（未生成なら空）</returns>
+	const std::vector<LodLevel>& GetLods() const { return lods_; }
+
+	/// <summary>
+	/// LOD数を取得
+	/// </summary>
+	/// <returns>LOD数</returns>
+	uint32_t GetLodCount() const { return lods_.empty() ? 1 : static_cast<uint32_t>(lods_.size()); }
+
+	/// <summary>
+	/// GPUに転送する頂点フォーマットをセット（バッファ生成前に呼ぶこと）
+	/// </summary>
+	/// <param name="vertexFormat">頂点フォーマット</param>
+	void SetVertexFormat(VertexFormat vertexFormat) { vertexFormat_ = vertexFormat; }
+
+	/// <summary>
+	/// GPUに転送する頂点フォーマットを取得
+	/// </summary>
+	/// <returns>頂点フォーマット</returns>
+	VertexFormat GetVertexFormat() const { return vertexFormat_; }
+
+	/// <summary>
+	/// 量子化座標の復元用定数を取得
+	/// </summary>
+	/// <returns>復元用定数</returns>
+	VertexDecode GetVertexDecode() const;
+
+	/// <summary>
+	/// 頂点座標からAABBと境界球を計算
+	/// </summary>
+	void CalculateBounds();
+
+	/// <summary>
+	/// AABBをセット（境界球はAABBから求める）
+	/// </summary>
+	/// <param name="aabbMin">最小座標</param>
+	/// <param name="aabbMax">最大座標</param>
+	void SetBounds(const XMFLOAT3& aabbMin, const XMFLOAT3& aabbMax);
+
+	/// <summary>
+	/// AABBの最小座標を取得
+	/// </summary>
+	/// <returns>最小座標</returns>
+	const XMFLOAT3& GetAabbMin() const { return aabbMin_; }
+
+	/// <summary>
+	/// AABBの最大座標を取得
+	/// </summary>
+	/// <returns>最大座標</returns>
+	const XMFLOAT3& GetAabbMax() const { return aabbMax_; }
+
+	/// <summary>
+	/// 境界球の中心を取得
+	/// </summary>
+	/// <returns>中心（モデル座標）</returns>
+	const XMFLOAT3& GetBoundCenter() const { return boundCenter_; }
+
+	/// <summary>
+	/// 境界球の半径を取得
+	/// </summary>
+	/// <returns>半径</returns>
+	float GetBoundRadius() const { return boundRadius_; }
+
+	/// <summary>
+	/// 頂点数に合わせたインデックスのフォーマットを選択
+	/// 16bitで表せる場合はR16_UINT、それ以外はR32_UINT
+	/// </summary>
+	/// <param name="vertexCount">頂点数</param>
+	/// <returns>インデックスのフォーマット</returns>
+	static DXGI_FORMAT SelectIndexFormat(size_t vertexCount);
+
+	/// <summary>
+	/// インデックス1個分のバイト数を取得
+	/// </summary>
+	/// <param name="indexFormat">インデックスのフォーマット</param>
+	/// <returns>バイト数</returns>
+	static UINT GetIndexStride(DXGI_FORMAT indexFormat);
+
 	/// <summary>
 	/// バッファの生成
 	/// </summary>
 	void CreateBuffers();
 
+	/// <summary>
+	/// 外部の頂点・インデックス配列からバッファの生成
+	/// </summary>
+	/// <param name="vertices">頂点配列の先頭</param>
+	/// <param name="vertexCount">頂点数</param>
+	/// <param name="indices">インデックス配列の先頭</param>
+	/// <param name="indexCount">インデックス数</param>
+	/// <param name="indexFormat">インデックスのフォーマット（R16_UINTかR32_UINT）</param>
+	void CreateBuffers(
+	  const VertexPosNormalUv* vertices, size_t vertexCount, const void* indices,
+	  size_t indexCount, DXGI_FORMAT indexFormat);
+
 	/// <summary>
 	/// 頂点バッファ取得
 	/// </summary>
@@ -102,15 +253,23 @@ class Mesh {
 	/// <returns>インデックスバッファ</returns>
 	const D3D12_INDEX_BUFFER_VIEW& GetIBView() { return ibView_; }
 
+	/// <summary>
+	/// 頂点バッファとインデックスバッファのバイト数を取得
+	/// </summary>
+	/// <returns>バイト数</returns>
+	size_t GetBufferSize() const { return size_t(vbView_.SizeInBytes) + ibView_.SizeInBytes; }
+
 	/// <summary>
 	/// 描画
 	/// </summary>
 	/// <param name="commandList">命令発行先コマンドリスト</param>
 	/// <param name="rooParameterIndexMaterial">マテリアルのルートパラメータ番号</param>
 	/// <param name="rooParameterIndexTexture">テクスチャのルートパラメータ番号</param>
+	/// <param name="lodLevel">LOD番号</param>
+	/// <param name="instanceCount">インスタンス数</param>
 	void Draw(
 	  ID3D12GraphicsCommandList* commandList, UINT rooParameterIndexMaterial,
-	  UINT rooParameterIndexTexture);
+	  UINT rooParameterIndexTexture, uint32_t lodLevel = 0, uint32_t instanceCount = 1);
 
 	/// <summary>
 	/// 描画（テクスチャ差し替え版）
@@ -119,9 +278,19 @@ class Mesh {
 	/// <param name="rooParameterIndexMaterial">マテリアルのルートパラメータ番号</param>
 	/// <param name="rooParameterIndexTexture">テクスチャのルートパラメータ番号</param>
 	/// <param name="textureHandle">差し替えるテクスチャハンドル</param>
+	/// <param name="lodLevel">LOD番号</param>
+	/// <param name="instanceCount">インスタンス数</param>
 	void Draw(
 	  ID3D12GraphicsCommandList* commandList, UINT rooParameterIndexMaterial,
-	  UINT rooParameterIndexTexture, uint32_t textureHandle);
+	  UINT rooParameterIndexTexture, uint32_t textureHandle, uint32_t lodLevel,
+	  uint32_t instanceCount = 1);
+
+	/// <summary>
+	/// 描画するLODのインデックス範囲を取得
+	/// </summary>
+	/// <param name="lodLevel">LOD番号（範囲外なら最も粗いLOD）</param>
+	/// <returns>インデックス範囲</returns>
+	LodLevel GetLodLevel(uint32_t lodLevel) const;
 
 	/// <summary>
 	/// 頂点配列を取得
@@ -133,7 +302,7 @@ class Mesh {
 	/// インデックス配列を取得
 	/// </summary>
 	/// <returns>インデックス配列</returns>
-	inline const std::vector<unsigned short>& GetIndices() { return indices_; }
+	inline const std::vector<uint32_t>& GetIndices() { return indices_; }
 
   private: // メンバ変数
 	// 名前
@@ -146,12 +315,26 @@ class Mesh {
 	D3D12_VERTEX_BUFFER_VIEW vbView_ = {};
 	// インデックスバッファビュー
 	D3D12_INDEX_BUFFER_VIEW ibView_ = {};
+	// インデックス数
+	UINT indexCount_ = 0;
+	// AABBの最小座標
+	XMFLOAT3 aabbMin_ = {0, 0, 0};
+	// AABBの最大座標
+	XMFLOAT3 aabbMax_ = {0, 0, 0};
+	// 境界球の中心（AABBに外接する球）
+	XMFLOAT3 boundCenter_ = {0, 0, 0};
+	// 境界球の半径
+	float boundRadius_ = 0.0f;
 	// 頂点データ配列
 	std::vector<VertexPosNormalUv> vertices_;
 	// 頂点インデックス配列
-	std::vector<unsigned short> indices_;
+	std::vector<uint32_t> indices_;
+	// LODのインデックス範囲
+	std::vector<LodLevel> lods_;
+	// GPUに転送する頂点フォーマット
+	VertexFormat vertexFormat_ = VertexFormat::kFloat;
 	// 頂点法線スムージング用データ
-	std::unordered_map<unsigned short, std::vector<unsigned short>> smoothData_;
+	std::vector<SmoothData> smoothData_;
 	// マテリアル
 	Material* material_ = nullptr;
 };
@@ -0,0 +1,239 @@
+﻿#include "MeshCache.h"
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+using namespace std;
+
+const std::string MeshCache::kCacheDirectoryName = "cache/";
+
+namespace {
+
+// 4バイト境界に揃える
+inline size_t AlignTo4(size_t size) { return (size + 3) & ~size_t(3); }
+
+// 書き込み位置を4バイト境界に揃える
+void WritePadding(ofstream& file, size_t size) {
+	static const char kZero[4] = {};
+	file.write(kZero, AlignTo4(size) - size);
+}
+
+// 文字列の書き込み（長さはヘッダに記録済み）
+void WriteString(ofstream& file, const string& str) {
+	file.write(str.data(), str.size());
+	WritePadding(file, str.size());
+}
+
+/// <summary>
+/// マップ済みファイルの読み込み位置
+/// </summary>
+class Reader {
+  public:
+	Reader(const char* data, size_t size) : current_(data), end_(data + size) {}
+
+	// 指定バイト数を読み進める（範囲外ならnullptr）
+	const char* Read(size_t size) {
+		if (static_cast<size_t>(end_ - current_) < size) {
+			return nullptr;
+		}
+		const char* ptr = current_;
+		current_ += AlignTo4(size) <= static_cast<size_t>(end_ - current_) ? AlignTo4(size) : size;
+		return ptr;
+	}
+
+  private:
+	const char* current_;
+	const char* end_;
+};
+
+} // namespace
+
+uint64_t MeshCache::CalculateHash(const void* data, size_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::string MeshCache::MakeFilePath(
+  const std::string& directoryPath, const std::string& modelname, uint32_t importFlags) {
+	// 変換結果はリポジトリに含めないキャッシュ用のディレクトリに置く
+	string path = directoryPath + kCacheDirectoryName + modelname;
+	if (importFlags & kSmoothing) {
+		path += ".smooth";
+	}
+	if (importFlags & kOptimize) {
+		path += ".opt";
+	}
+	uint32_t lodCount = (importFlags >> kLodCountShift) & 0xff;
+	if (lodCount > 1) {
+		path += ".lod" + to_string(lodCount);
+	}
+	return path + ".mesh";
+}
+
+bool MeshCache::Save(
+  const std::string& filePath, uint64_t sourceHash, uint32_t importFlags,
+  const std::vector<std::string>& materialLibraries, const std::vector<Mesh*>& meshes) {
+	error_code error;
+	filesystem::create_directories(filesystem::path(filePath).parent_path(), error);
+
+	// 書きかけのファイルを読まれないように、一時ファイルに書いてから置き換える
+	// （一時ファイル名はスレッドごとに変え、同時に保存しても混ざらないようにする）
+	const string tempPath =
+	  filePath + ".tmp" + to_string(hash<thread::id>()(this_thread::get_id()));
+	if (!Write(tempPath, sourceHash, importFlags, materialLibraries, meshes)) {
+		filesystem::remove(tempPath, error);
+		return false;
+	}
+	filesystem::rename(tempPath, filePath, error);
+	if (error) {
+		// 読み込み中でマップされているなどで置き換えられなければ、今回は保存しない
+		filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::Write(
+  const std::string& filePath, uint64_t sourceHash, uint32_t importFlags,
+  const std::vector<std::string>& materialLibraries, const std::vector<Mesh*>& meshes) {
+	ofstream file(filePath, ios::binary | ios::trunc);
+	if (file.fail()) {
+		return false;
+	}
+
+	// ファイルヘッダ
+	FileHeader header{};
+	header.magic = kMagic;
+	header.version = kVersion;
+	header.sourceHash = sourceHash;
+	header.importFlags = importFlags;
+	header.libraryCount = static_cast<uint32_t>(materialLibraries.size());
+	header.meshCount = static_cast<uint32_t>(meshes.size());
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	// マテリアルライブラリ名
+	for (const string& library : materialLibraries) {
+		uint32_t length = static_cast<uint32_t>(library.size());
+		file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+		WriteString(file, library);
+	}
+
+	// メッシュ
+	for (Mesh* mesh : meshes) {
+		const string& materialName = mesh->GetMaterial() ? mesh->GetMaterial()->name_ : string();
+		const auto& vertices = mesh->GetVertices();
+		const auto& indices = mesh->GetIndices();
+
+		MeshHeader meshHeader{};
+		meshHeader.nameLength = static_cast<uint32_t>(mesh->GetName().size());
+		meshHeader.materialNameLength = static_cast<uint32_t>(materialName.size());
+		meshHeader.vertexCount = static_cast<uint32_t>(vertices.size());
+		meshHeader.indexCount = static_cast<uint32_t>(indices.size());
+		meshHeader.indexFormat = Mesh::SelectIndexFormat(vertices.size());
+		meshHeader.lodCount = static_cast<uint32_t>(mesh->GetLods().size());
+		meshHeader.aabbMin = mesh->GetAabbMin();
+		meshHeader.aabbMax = mesh->GetAabbMax();
+		file.write(reinterpret_cast<const char*>(&meshHeader), sizeof(meshHeader));
+
+		WriteString(file, mesh->GetName());
+		WriteString(file, materialName);
+
+		file.write(
+		  reinterpret_cast<const char*>(mesh->GetLods().data()),
+		  sizeof(Mesh::LodLevel) * mesh->GetLods().size());
+
+		size_t vertexSize = sizeof(Mesh::VertexPosNormalUv) * vertices.size();
+		file.write(reinterpret_cast<const char*>(vertices.data()), vertexSize);
+		size_t indexSize = Mesh::GetIndexStride(DXGI_FORMAT(meshHeader.indexFormat)) * indices.size();
+		if (meshHeader.indexFormat == DXGI_FORMAT_R16_UINT) {
+			// 16bitに詰めて書き込む
+			vector<uint16_t> indices16(indices.begin(), indices.end());
+			file.write(reinterpret_cast<const char*>(indices16.data()), indexSize);
+		} else {
+			file.write(reinterpret_cast<const char*>(indices.data()), indexSize);
+		}
+		WritePadding(file, indexSize);
+	}
+
+	file.close();
+	return !file.fail();
+}
+
+bool MeshCache::Load(const std::string& filePath, uint64_t sourceHash, uint32_t importFlags) {
+	materialLibraries_.clear();
+	meshes_.clear();
+
+	if (!file_.Open(filePath)) {
+		return false;
+	}
+
+	Reader reader(file_.GetData(), file_.GetSize());
+
+	// ヘッダの検証
+	const FileHeader* header = reinterpret_cast<const FileHeader*>(reader.Read(sizeof(FileHeader)));
+	if (
+	  header == nullptr || header->magic != kMagic || header->version != kVersion ||
+	  header->sourceHash != sourceHash || header->importFlags != importFlags) {
+		file_.Close();
+		return false;
+	}
+
+	// マテリアルライブラリ名
+	for (uint32_t i = 0; i < header->libraryCount; i++) {
+		const uint32_t* length = reinterpret_cast<const uint32_t*>(reader.Read(sizeof(uint32_t)));
+		const char* name = length ? reader.Read(*length) : nullptr;
+		if (name == nullptr) {
+			file_.Close();
+			return false;
+		}
+		materialLibraries_.emplace_back(name, *length);
+	}
+
+	// メッシュ
+	for (uint32_t i = 0; i < header->meshCount; i++) {
+		const MeshHeader* meshHeader =
+		  reinterpret_cast<const MeshHeader*>(reader.Read(sizeof(MeshHeader)));
+		if (
+		  meshHeader == nullptr || (meshHeader->indexFormat != DXGI_FORMAT_R16_UINT &&
+		                            meshHeader->indexFormat != DXGI_FORMAT_R32_UINT)) {
+			file_.Close();
+			return false;
+		}
+		const char* name = reader.Read(meshHeader->nameLength);
+		const char* materialName = reader.Read(meshHeader->materialNameLength);
+		const char* lods = reader.Read(sizeof(Mesh::LodLevel) * meshHeader->lodCount);
+		const char* vertices =
+		  reader.Read(sizeof(Mesh::VertexPosNormalUv) * meshHeader->vertexCount);
+		const DXGI_FORMAT indexFormat = DXGI_FORMAT(meshHeader->indexFormat);
+		const char* indices =
+		  reader.Read(Mesh::GetIndexStride(indexFormat) * meshHeader->indexCount);
+		if (
+		  name == nullptr || materialName == nullptr || lods == nullptr || vertices == nullptr ||
+		  indices == nullptr) {
+			file_.Close();
+			return false;
+		}
+
+		MeshData mesh{};
+		mesh.name = string_view(name, meshHeader->nameLength);
+		mesh.materialName = string_view(materialName, meshHeader->materialNameLength);
+		mesh.aabbMin = meshHeader->aabbMin;
+		mesh.aabbMax = meshHeader->aabbMax;
+		mesh.vertices = reinterpret_cast<const Mesh::VertexPosNormalUv*>(vertices);
+		mesh.vertexCount = meshHeader->vertexCount;
+		mesh.indices = indices;
+		mesh.indexCount = meshHeader->indexCount;
+		mesh.indexFormat = indexFormat;
+		mesh.lods = reinterpret_cast<const Mesh::LodLevel*>(lods);
+		mesh.lodCount = meshHeader->lodCount;
+		meshes_.push_back(mesh);
+	}
+
+	return true;
+}
@@ -0,0 +1,147 @@
+﻿#pragma once
+
+#include "MappedFile.h"
+#include "Mesh.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// <summary>
+/// 変換済みメッシュキャッシュ
+/// OBJを解析した結果をバイナリで保存し、次回以降はメモリマップして読み込む
+/// </summary>
+class MeshCache {
+  public: // 定数
+	// ファイル識別子
+	static const uint32_t kMagic = 0x4353484d; // "MHSC"
+	// フォーマットのバージョン（構造を変えたら更新する）
+	static const uint32_t kVersion = 5;
+	// キャッシュを置くディレクトリ名（モデルのディレクトリ直下、リポジトリには含めない）
+	static const std::string kCacheDirectoryName;
+
+	// 読み込み設定のフラグ
+	enum ImportFlag : uint32_t {
+		kSmoothing = 1 << 0, // エッジ平滑化
+		kOptimize = 1 << 1,  // 頂点キャッシュ最適化
+		kLodCountShift = 8,      // LOD数（8bit）
+		kLodReductionShift = 16, // LODの三角形数の比率（百分率、8bit）
+	};
+
+  public: // サブクラス
+	// ファイルヘッダ
+	struct FileHeader {
+		uint32_t magic;            // ファイル識別子
+		uint32_t version;          // フォーマットのバージョン
+		uint64_t sourceHash;       // 元ファイルのハッシュ
+		uint32_t importFlags;      // 読み込み設定のフラグ
+		uint32_t libraryCount;     // マテリアルライブラリ数
+		uint32_t meshCount;        // メッシュ数
+		uint32_t reserved;         // 予約
+	};
+
+	// メッシュヘッダ（直後に名前、マテリアル名、LOD配列、頂点配列、インデックス配列が続く）
+	struct MeshHeader {
+		uint32_t nameLength;         // 名前の長さ
+		uint32_t materialNameLength; // マテリアル名の長さ
+		uint32_t vertexCount;        // 頂点数
+		uint32_t indexCount;         // インデックス数
+		uint32_t indexFormat;        // インデックスのフォーマット(DXGI_FORMAT)
+		uint32_t lodCount;           // LOD数（0ならLODなし）
+		DirectX::XMFLOAT3 aabbMin;   // AABBの最小座標
+		DirectX::XMFLOAT3 aabbMax;   // AABBの最大座標
+	};
+
+	// キャッシュ内のメッシュデータ（マップ済みファイルを直接指す）
+	struct MeshData {
+		std::string_view name;                       // 名前
+		std::string_view materialName;               // マテリアル名
+		DirectX::XMFLOAT3 aabbMin;                   // AABBの最小座標
+		DirectX::XMFLOAT3 aabbMax;                   // AABBの最大座標
+		const Mesh::VertexPosNormalUv* vertices;     // 頂点配列
+		uint32_t vertexCount;                        // 頂点数
+		const void* indices;                         // インデックス配列
+		uint32_t indexCount;                         // インデックス数
+		DXGI_FORMAT indexFormat;                     // インデックスのフォーマット
+		const Mesh::LodLevel* lods;                  // LODのインデックス範囲
+		uint32_t lodCount;                           // LOD数
+	};
+
+  public: // 静的メンバ関数
+	/// <summary>
+	/// 元ファイルのハッシュ値計算(FNV-1a)
+	/// </summary>
+	/// <param name="data">データ</param>
+	/// <param name="size">サイズ</param>
+	/// <returns>ハッシュ値</returns>
+	static uint64_t CalculateHash(const void* data, size_t size);
+
+	/// <summary>
+	/// キャッシュファイルのパスを作成
+	/// </summary>
+	/// <param name="directoryPath">モデルのディレクトリパス</param>
+	/// <param name="modelname">モデル名</param>
+	/// <param name="importFlags">読み込み設定のフラグ</param>
+	/// <returns>キャッシュファイルのパス</returns>
+	static std::string MakeFilePath(
+	  const std::string& directoryPath, const std::string& modelname, uint32_t importFlags);
+
+	/// <summary>
+	/// キャッシュ書き込み
+	/// 一時ファイルに書き込んでから置き換えるので、中断しても壊れたファイルは残らない
+	/// </summary>
+	/// <param name="filePath">キャッシュファイルのパス</param>
+	/// <param name="sourceHash">元ファイルのハッシュ</param>
+	/// <param name="importFlags">読み込み設定のフラグ</param>
+	/// <param name="materialLibraries">マテリアルライブラリのファイル名</param>
+	/// <param name="meshes">メッシュコンテナ</param>
+	/// <returns>成否</returns>
+	static bool Save(
+	  const std::string& filePath, uint64_t sourceHash, uint32_t importFlags,
+	  const std::vector<std::string>& materialLibraries, const std::vector<Mesh*>& meshes);
+
+  public: // メンバ関数
+	/// <summary>
+	/// キャッシュ読み込み
+	/// 元ファイルのハッシュと読み込み設定が一致した場合のみ成功する
+	/// </summary>
+	/// <param name="filePath">キャッシュファイルのパス</param>
+	/// <param name="sourceHash">元ファイルのハッシュ</param>
+	/// <param name="importFlags">読み込み設定のフラグ</param>
+	/// <returns>成否</returns>
+	bool Load(const std::string& filePath, uint64_t sourceHash, uint32_t importFlags);
+
+	/// <summary>
+	/// マテリアルライブラリのファイル名を取得
+	/// </summary>
+	/// <returns>マテリアルライブラリのファイル名</returns>
+	const std::vector<std::string_view>& GetMaterialLibraries() const { return materialLibraries_; }
+
+	/// <summary>
+	/// メッシュデータを取得
+	/// </summary>
+	/// <returns>メッシュデータ</returns>
+	const std::vector<MeshData>& GetMeshes() const { return meshes_; }
+
+  private: // 静的メンバ関数
+	/// <summary>
+	/// キャッシュの内容をファイルへ書き込む
+	/// </summary>
+	/// <param name="filePath">書き込み先のパス</param>
+	/// <param name="sourceHash">元ファイルのハッシュ</param>
+	/// <param name="importFlags">読み込み設定のフラグ</param>
+	/// <param name="materialLibraries">マテリアルライブラリのファイル名</param>
+	/// <param name="meshes">メッシュコンテナ</param>
+	/// <returns>成否</returns>
+	static bool Write(
+	  const std::string& filePath, uint64_t sourceHash, uint32_t importFlags,
+	  const std::vector<std::string>& materialLibraries, const std::vector<Mesh*>& meshes);
+
+  private: // メンバ変数
+	// マップ済みキャッシュファイル
+	MappedFile file_;
+	// マテリアルライブラリのファイル名
+	std::vector<std::string_view> materialLibraries_;
+	// メッシュデータ
+	std::vector<MeshData> meshes_;
+};
@@ -0,0 +1,234 @@
+﻿#include "MeshOptimizer.h"
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+// Forsyth方式のスコア計算用パラメータ
+const float kCacheDecayPower = 1.5f;
+const float kLastTriangleScore = 0.75f;
+const float kValenceBoostScale = 2.0f;
+const float kValenceBoostPower = 0.5f;
+// スコア計算でキャッシュ位置として扱う範囲（直前の三角形の3頂点分を含む）
+const uint32_t kMaxCachePosition = MeshOptimizer::kOptimizeCacheSize + 3;
+// スコアテーブルに載せる残り三角形数の上限
+const uint32_t kMaxValence = 32;
+
+// キャッシュ位置ごとのスコアテーブル
+struct ScoreTable {
+	float cache[kMaxCachePosition];
+	float valence[kMaxValence];
+
+	ScoreTable() {
+		const uint32_t cacheSize = MeshOptimizer::kOptimizeCacheSize;
+		for (uint32_t i = 0; i < kMaxCachePosition; i++) {
+			if (i < 3) {
+				// 直前の三角形で使った頂点は一律のスコア
+				cache[i] = kLastTriangleScore;
+			} else if (i < cacheSize) {
+				float scaler = 1.0f / float(cacheSize - 3);
+				cache[i] = powf(1.0f - float(i - 3) * scaler, kCacheDecayPower);
+			} else {
+				cache[i] = 0.0f;
+			}
+		}
+		valence[0] = 0.0f;
+		for (uint32_t i = 1; i < kMaxValence; i++) {
+			// 残り三角形が少ない頂点を優先して、孤立した三角形を残さない
+			valence[i] = kValenceBoostScale * powf(float(i), -kValenceBoostPower);
+		}
+	}
+};
+
+// 頂点のスコア計算
+float CalculateVertexScore(const ScoreTable& table, int32_t cachePosition, uint32_t valence) {
+	if (valence == 0) {
+		// 使われない頂点
+		return -1.0f;
+	}
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		score += table.cache[cachePosition];
+	}
+	score += table.valence[valence < kMaxValence ? valence : kMaxValence - 1];
+	return score;
+}
+
+} // namespace
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+	static const ScoreTable kTable;
+
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0) {
+		return;
+	}
+
+	// 頂点ごとの隣接三角形リスト（CSR形式）
+	vector<uint32_t> valence(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++) {
+		valence[indices[i]]++;
+	}
+	vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++) {
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+	}
+	vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		vector<uint32_t> cursor(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (size_t k = 0; k < 3; k++) {
+				adjacency[cursor[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+			}
+		}
+	}
+
+	// 頂点スコアと三角形スコアの初期化
+	vector<int32_t> cachePosition(vertexCount, -1);
+	vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		vertexScore[v] = CalculateVertexScore(kTable, -1, valence[v]);
+	}
+	vector<bool> emitted(triangleCount, false);
+	int64_t bestTriangle = -1;
+	float bestScore = -1.0f;
+	for (size_t t = 0; t < triangleCount; t++) {
+		float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] +
+		              vertexScore[indices[t * 3 + 2]];
+		if (score > bestScore) {
+			bestScore = score;
+			bestTriangle = static_cast<int64_t>(t);
+		}
+	}
+
+	vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	// LRUキャッシュ（直前の三角形の頂点を先頭に追加するので+3）
+	uint32_t cache[kMaxCachePosition + 3];
+	uint32_t cacheCount = 0;
+	// スコアの良い三角形が見つからなかったときの探索開始位置
+	size_t scanCursor = 0;
+
+	while (output.size() < triangleCount * 3) {
+		if (bestTriangle < 0) {
+			// 未出力の三角形を順に探す
+			while (emitted[scanCursor]) {
+				scanCursor++;
+			}
+			bestTriangle = static_cast<int64_t>(scanCursor);
+		}
+
+		// 三角形を出力
+		const size_t triangle = static_cast<size_t>(bestTriangle);
+		emitted[triangle] = true;
+		const uint32_t* corners = &indices[triangle * 3];
+		output.insert(output.end(), corners, corners + 3);
+
+		// 出力した三角形を隣接リストから取り除く
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t v = corners[k];
+			uint32_t* begin = &adjacency[adjacencyOffset[v]];
+			uint32_t* end = begin + valence[v];
+			for (uint32_t* it = begin; it != end; ++it) {
+				if (*it == triangle) {
+					*it = end[-1];
+					break;
+				}
+			}
+			valence[v]--;
+		}
+
+		// 三角形の頂点をキャッシュの先頭に移動
+		uint32_t newCache[kMaxCachePosition + 3];
+		uint32_t newCacheCount = 0;
+		for (size_t k = 0; k < 3; k++) {
+			newCache[newCacheCount++] = corners[k];
+		}
+		for (uint32_t i = 0; i < cacheCount; i++) {
+			uint32_t v = cache[i];
+			if (v != corners[0] && v != corners[1] && v != corners[2]) {
+				newCache[newCacheCount++] = v;
+			}
+		}
+		// キャッシュから溢れた頂点の位置をリセット
+		for (uint32_t i = kMaxCachePosition; i < newCacheCount; i++) {
+			cachePosition[newCache[i]] = -1;
+			vertexScore[newCache[i]] = CalculateVertexScore(kTable, -1, valence[newCache[i]]);
+		}
+		cacheCount = newCacheCount < kMaxCachePosition ? newCacheCount : kMaxCachePosition;
+		for (uint32_t i = 0; i < cacheCount; i++) {
+			cache[i] = newCache[i];
+		}
+
+		// キャッシュ内の頂点のスコアを更新
+		for (uint32_t i = 0; i < cacheCount; i++) {
+			uint32_t v = cache[i];
+			cachePosition[v] = static_cast<int32_t>(i);
+			vertexScore[v] = CalculateVertexScore(kTable, cachePosition[v], valence[v]);
+		}
+
+		// キャッシュ内の頂点に隣接する三角形から次の候補を選ぶ
+		bestTriangle = -1;
+		bestScore = -1.0f;
+		for (uint32_t i = 0; i < cacheCount; i++) {
+			uint32_t v = cache[i];
+			for (uint32_t j = 0; j < valence[v]; j++) {
+				uint32_t t = adjacency[adjacencyOffset[v] + j];
+				const uint32_t* tc = &indices[t * 3];
+				float score = vertexScore[tc[0]] + vertexScore[tc[1]] + vertexScore[tc[2]];
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	// 三角形リスト以外の端数はそのまま残す
+	copy(output.begin(), output.end(), indices.begin());
+}
+
+std::vector<uint32_t>
+  MeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) {
+	const uint32_t kUnused = UINT32_MAX;
+	vector<uint32_t> remap(vertexCount, kUnused);
+	uint32_t nextVertex = 0;
+
+	// 参照された順に番号を振る
+	for (uint32_t& index : indices) {
+		if (remap[index] == kUnused) {
+			remap[index] = nextVertex++;
+		}
+		index = remap[index];
+	}
+	// 未参照の頂点は末尾へ
+	for (uint32_t& r : remap) {
+		if (r == kUnused) {
+			r = nextVertex++;
+		}
+	}
+	return remap;
+}
+
+MeshOptimizer::CacheStatistics MeshOptimizer::AnalyzeVertexCache(
+  const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+	CacheStatistics statistics{};
+	statistics.triangleCount = indices.size() / 3;
+
+	// 頂点ごとにキャッシュへ入った時刻を記録し、FIFOを時刻の差で表現する
+	vector<size_t> timestamp(vertexCount, 0);
+	size_t time = cacheSize + 1;
+	for (size_t i = 0; i < statistics.triangleCount * 3; i++) {
+		uint32_t index = indices[i];
+		if (timestamp[index] == 0) {
+			statistics.vertexCount++;
+		}
+		if (time - timestamp[index] > cacheSize) {
+			// キャッシュミス
+			timestamp[index] = time++;
+			statistics.missCount++;
+		}
+	}
+	return statistics;
+}
@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// インデックス配列の最適化
+/// GPUに依存しないので、CPUだけで結果を検証できる
+/// </summary>
+class MeshOptimizer {
+  public: // 定数
+	// 最適化で想定する頂点キャッシュのサイズ
+	static const uint32_t kOptimizeCacheSize = 32;
+	// 解析に使うFIFOキャッシュのサイズ
+	static const uint32_t kAnalyzeCacheSize = 16;
+
+  public: // サブクラス
+	// 頂点キャッシュの解析結果
+	struct CacheStatistics {
+		size_t triangleCount; // 三角形の数
+		size_t vertexCount;   // 参照されている頂点の数
+		size_t missCount;     // キャッシュミス（頂点シェーダーの実行）回数
+
+		// 三角形あたりのキャッシュミス数(ACMR)
+		float GetAcmr() const {
+			return triangleCount > 0 ? float(missCount) / float(triangleCount) : 0.0f;
+		}
+		// 頂点あたりのキャッシュミス数(ATVR、1.0が理想)
+		float GetAtvr() const {
+			return vertexCount > 0 ? float(missCount) / float(vertexCount) : 0.0f;
+		}
+	};
+
+  public: // 静的メンバ関数
+	/// <summary>
+	/// 頂点キャッシュ効率が上がるように三角形を並べ替える(Forsyth方式)
+	/// </summary>
+	/// <param name="indices">三角形リストのインデックス配列</param>
+	/// <param name="vertexCount">頂点数</param>
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	/// <summary>
+	/// 頂点の参照順に並ぶように頂点番号を振り直す
+	/// </summary>
+	/// <param name="indices">インデックス配列（新しい頂点番号に書き換わる）</param>
+	/// <param name="vertexCount">頂点数</param>
+	/// <returns>旧頂点番号から新頂点番号への対応表（未参照の頂点は末尾に詰める）</returns>
+	static std::vector<uint32_t>
+	  OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+
+	/// <summary>
+	/// FIFOキャッシュをシミュレートして頂点キャッシュ効率を解析
+	/// </summary>
+	/// <param name="indices">三角形リストのインデックス配列</param>
+	/// <param name="vertexCount">頂点数</param>
+	/// <param name="cacheSize">キャッシュサイズ</param>
+	/// <returns>解析結果</returns>
+	static CacheStatistics AnalyzeVertexCache(
+	  const std::vector<uint32_t>& indices, size_t vertexCount,
+	  uint32_t cacheSize = kAnalyzeCacheSize);
+};
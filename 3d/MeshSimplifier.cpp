@@ -0,0 +1,294 @@
+﻿#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+// 縮約前後で面の法線がなす角の下限(cos)
+const double kMinNormalCos = 0.25;
+
+// 3次元ベクトル
+struct Vector3 {
+	double x, y, z;
+};
+
+inline Vector3 Sub(const Vector3& a, const Vector3& b) {
+	return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+inline Vector3 Cross(const Vector3& a, const Vector3& b) {
+	return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+inline double Dot(const Vector3& a, const Vector3& b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// 二次誤差行列（対称4x4の上三角）
+struct Quadric {
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+	// 平面(a,b,c,d)の誤差を重み付きで加算
+	void AddPlane(double a, double b, double c, double d, double weight) {
+		a2 += weight * a * a;
+		ab += weight * a * b;
+		ac += weight * a * c;
+		ad += weight * a * d;
+		b2 += weight * b * b;
+		bc += weight * b * c;
+		bd += weight * b * d;
+		c2 += weight * c * c;
+		cd += weight * c * d;
+		d2 += weight * d * d;
+	}
+
+	void Add(const Quadric& q) {
+		a2 += q.a2;
+		ab += q.ab;
+		ac += q.ac;
+		ad += q.ad;
+		b2 += q.b2;
+		bc += q.bc;
+		bd += q.bd;
+		c2 += q.c2;
+		cd += q.cd;
+		d2 += q.d2;
+	}
+
+	// 座標pに置いたときの誤差
+	double Evaluate(const Vector3& p) const {
+		double x = p.x, y = p.y, z = p.z;
+		double error = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x + b2 * y * y +
+		               2 * bc * y * z + 2 * bd * y + c2 * z * z + 2 * cd * z + d2;
+		return fabs(error);
+	}
+};
+
+// 縮約候補（fromをtoに移動する）
+struct Collapse {
+	uint32_t from;
+	uint32_t to;
+	double error;
+};
+
+// 辺のキー
+inline uint64_t MakeEdgeKey(uint32_t a, uint32_t b) {
+	return a < b ? (uint64_t(a) << 32 | b) : (uint64_t(b) << 32 | a);
+}
+
+// 座標のハッシュ（継ぎ目検出用）
+struct PositionHash {
+	size_t operator()(const Vector3& p) const {
+		// -0.0と0.0を同一視するため、比較と同じ値で計算する
+		hash<double> h;
+		return h(p.x + 0.0) ^ (h(p.y + 0.0) * 31) ^ (h(p.z + 0.0) * 131);
+	}
+};
+struct PositionEqual {
+	bool operator()(const Vector3& a, const Vector3& b) const {
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+};
+
+} // namespace
+
+std::vector<uint32_t> MeshSimplifier::Simplify(
+  const std::vector<uint32_t>& indices, const float* positions, size_t vertexCount,
+  size_t vertexStride, size_t targetIndexCount) {
+	vector<uint32_t> result(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+	if (result.size() <= targetIndexCount || vertexCount == 0) {
+		return result;
+	}
+
+	// 座標の取り出し
+	vector<Vector3> points(vertexCount);
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(positions);
+	for (size_t i = 0; i < vertexCount; i++) {
+		const float* p = reinterpret_cast<const float*>(bytes + vertexStride * i);
+		points[i] = {p[0], p[1], p[2]};
+	}
+
+	// 動かさない頂点
+	vector<bool> locked(vertexCount, false);
+
+	// 同じ座標を持つ頂点が複数あれば継ぎ目
+	{
+		unordered_map<Vector3, uint32_t, PositionHash, PositionEqual> firstVertex;
+		firstVertex.reserve(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			auto inserted = firstVertex.try_emplace(points[i], i);
+			if (!inserted.second) {
+				locked[i] = true;
+				locked[inserted.first->second] = true;
+			}
+		}
+	}
+
+	// 1つの三角形にしか使われていない辺は境界
+	{
+		unordered_map<uint64_t, uint32_t> edgeCount;
+		edgeCount.reserve(result.size());
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (size_t k = 0; k < 3; k++) {
+				edgeCount[MakeEdgeKey(result[i + k], result[i + (k + 1) % 3])]++;
+			}
+		}
+		for (const auto& edge : edgeCount) {
+			if (edge.second == 1) {
+				locked[uint32_t(edge.first >> 32)] = true;
+				locked[uint32_t(edge.first & 0xffffffff)] = true;
+			}
+		}
+	}
+
+	// 面の平面から頂点ごとの二次誤差を求める
+	vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t i = 0; i < result.size(); i += 3) {
+		const Vector3& p0 = points[result[i]];
+		const Vector3& p1 = points[result[i + 1]];
+		const Vector3& p2 = points[result[i + 2]];
+		Vector3 normal = Cross(Sub(p1, p0), Sub(p2, p0));
+		double length = sqrt(Dot(normal, normal));
+		if (length <= 0.0) {
+			continue;
+		}
+		// 面積で重み付けする
+		double area = length * 0.5;
+		normal = {normal.x / length, normal.y / length, normal.z / length};
+		double d = -Dot(normal, p0);
+		for (size_t k = 0; k < 3; k++) {
+			quadrics[result[i + k]].AddPlane(normal.x, normal.y, normal.z, d, area);
+		}
+	}
+
+	vector<uint32_t> remap(vertexCount);
+	vector<bool> touched(vertexCount);
+	vector<uint32_t> adjacencyOffset(vertexCount + 1);
+	vector<uint32_t> adjacency;
+	vector<Collapse> collapses;
+
+	while (result.size() > targetIndexCount) {
+		const size_t triangleCount = result.size() / 3;
+
+		// 頂点ごとの隣接三角形（CSR形式）
+		fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+		for (uint32_t index : result) {
+			adjacencyOffset[index + 1]++;
+		}
+		for (size_t v = 0; v < vertexCount; v++) {
+			adjacencyOffset[v + 1] += adjacencyOffset[v];
+		}
+		adjacency.resize(result.size());
+		{
+			vector<uint32_t> cursor(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+			for (size_t t = 0; t < triangleCount; t++) {
+				for (size_t k = 0; k < 3; k++) {
+					adjacency[cursor[result[t * 3 + k]]++] = static_cast<uint32_t>(t);
+				}
+			}
+		}
+
+		// 縮約候補を誤差の小さい順に並べる
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (size_t k = 0; k < 3; k++) {
+				uint32_t a = result[i + k];
+				uint32_t b = result[i + (k + 1) % 3];
+				// 辺は2つの三角形で共有されるので片方だけ見る
+				if (a > b) {
+					continue;
+				}
+				Quadric q = quadrics[a];
+				q.Add(quadrics[b]);
+				if (!locked[a]) {
+					collapses.push_back({a, b, q.Evaluate(points[b])});
+				}
+				if (!locked[b]) {
+					collapses.push_back({b, a, q.Evaluate(points[a])});
+				}
+			}
+		}
+		if (collapses.empty()) {
+			break;
+		}
+		sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+			return a.error < b.error;
+		});
+
+		// 1回の縮約で三角形はおおよそ2枚減る
+		size_t collapseLimit = (result.size() - targetIndexCount) / 6 + 1;
+		size_t collapseCount = 0;
+		for (uint32_t v = 0; v < vertexCount; v++) {
+			remap[v] = v;
+		}
+		fill(touched.begin(), touched.end(), false);
+
+		for (const Collapse& collapse : collapses) {
+			if (collapseCount >= collapseLimit) {
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to]) {
+				continue;
+			}
+
+			// 移動で裏返る三角形があれば縮約しない
+			bool flipped = false;
+			const Vector3& target = points[collapse.to];
+			for (uint32_t j = adjacencyOffset[collapse.from];
+			     j < adjacencyOffset[collapse.from + 1] && !flipped; j++) {
+				const uint32_t* tri = &result[adjacency[j] * 3];
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) {
+					// 縮約で消える三角形
+					continue;
+				}
+				Vector3 p[3] = {points[tri[0]], points[tri[1]], points[tri[2]]};
+				Vector3 before = Cross(Sub(p[1], p[0]), Sub(p[2], p[0]));
+				for (size_t k = 0; k < 3; k++) {
+					if (tri[k] == collapse.from) {
+						p[k] = target;
+					}
+				}
+				Vector3 after = Cross(Sub(p[1], p[0]), Sub(p[2], p[0]));
+				// 法線が大きく傾く場合も裏返りとして扱う
+				double limit = kMinNormalCos * sqrt(Dot(before, before) * Dot(after, after));
+				flipped = Dot(before, after) <= limit;
+			}
+			if (flipped) {
+				continue;
+			}
+
+			// 周囲の頂点は同じパスで動かさない（裏返り判定を正しく保つ）
+			for (uint32_t j = adjacencyOffset[collapse.from]; j < adjacencyOffset[collapse.from + 1];
+			     j++) {
+				const uint32_t* tri = &result[adjacency[j] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+			}
+			touched[collapse.to] = true;
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].Add(quadrics[collapse.from]);
+			collapseCount++;
+		}
+		if (collapseCount == 0) {
+			break;
+		}
+
+		// 縮約を反映し、潰れた三角形を取り除く
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			uint32_t a = remap[result[i]];
+			uint32_t b = remap[result[i + 1]];
+			uint32_t c = remap[result[i + 2]];
+			if (a == b || b == c || c == a) {
+				continue;
+			}
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	return result;
+}
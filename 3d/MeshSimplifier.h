@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// 二次誤差(QEM)による辺の縮約でメッシュを簡略化する
+/// 頂点は既存のものを使い回し、インデックス配列だけを生成する
+/// GPUに依存しないので、CPUだけで結果を検証できる
+/// </summary>
+class MeshSimplifier {
+  public: // 静的メンバ関数
+	/// <summary>
+	/// 簡略化
+	/// 境界の辺と、UV・法線の継ぎ目（同じ座標の別頂点）は形状が崩れないように動かさない
+	/// </summary>
+	/// <param name="indices">三角形リストのインデックス配列</param>
+	/// <param name="positions">頂点配列の先頭の座標(float3)</param>
+	/// <param name="vertexCount">頂点数</param>
+	/// <param name="vertexStride">頂点1個分のバイト数</param>
+	/// <param name="targetIndexCount">目標のインデックス数</param>
+	/// <returns>簡略化したインデックス配列（目標まで減らせない場合もある）</returns>
+	static std::vector<uint32_t> Simplify(
+	  const std::vector<uint32_t>& indices, const float* positions, size_t vertexCount,
+	  size_t vertexStride, size_t targetIndexCount);
+};
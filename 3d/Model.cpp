@@ -1,31 +1,91 @@
 ﻿#include "DirectXCommon.h"
+#include "InstancePacker.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
 #include "Model.h"
+#include "ObjChunkParser.h"
+#include "ObjTokenizer.h"
+#include "PipelineCache.h"
+#include "ShaderCache.h"
+#include "TextureManager.h"
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <d3dcompiler.h>
-#include <fstream>
-#include <sstream>
+#include <future>
+#include <string_view>
+#include <unordered_map>
 
 #pragma comment(lib, "d3dcompiler.lib")
 
 using namespace std;
 using namespace Microsoft::WRL;
 
+namespace {
+
+// 頂点溶接のキー（座標・UV・法線の番号、未使用は0）
+struct VertexKey {
+	uint32_t position;
+	uint32_t texcoord;
+	uint32_t normal;
+
+	bool operator==(const VertexKey& other) const {
+		return position == other.position && texcoord == other.texcoord && normal == other.normal;
+	}
+};
+
+// 頂点溶接のキーのハッシュ
+struct VertexKeyHash {
+	size_t operator()(const VertexKey& key) const {
+		uint64_t hash = key.position;
+		hash = hash * 0x9e3779b97f4a7c15ull ^ key.texcoord;
+		hash = hash * 0x9e3779b97f4a7c15ull ^ key.normal;
+		return static_cast<size_t>(hash ^ (hash >> 32));
+	}
+};
+
+// ワールド行列の最大の拡大率（境界球の半径に掛ける）
+inline float GetMaxScale(const DirectX::XMMATRIX& matWorld) {
+	return max(
+	  {DirectX::XMVectorGetX(DirectX::XMVector3Length(matWorld.r[0])),
+	   DirectX::XMVectorGetX(DirectX::XMVector3Length(matWorld.r[1])),
+	   DirectX::XMVectorGetX(DirectX::XMVector3Length(matWorld.r[2]))});
+}
+
+} // namespace
+
 /// <summary>
 /// 静的メンバ変数の実体
 /// </summary>
 const std::string Model::kBaseDirectory = "Resources/";
 const std::string Model::kDefaultModelName = "cube";
+const float Model::kLodHysteresis = 0.1f;
 UINT Model::sDescriptorHandleIncrementSize_ = 0;
 ID3D12GraphicsCommandList* Model::sCommandList_ = nullptr;
 ComPtr<ID3D12RootSignature> Model::sRootSignature_;
 ComPtr<ID3D12PipelineState> Model::sPipelineState_;
+ComPtr<ID3D12PipelineState> Model::sPipelineStatePacked_;
+ComPtr<ID3D12PipelineState> Model::sPipelineStateInstanced_;
+ComPtr<ID3D12PipelineState> Model::sPipelineStatePackedInstanced_;
+RenderQueue Model::sRenderQueue_;
+ComPtr<ID3D12Resource> Model::sInstanceBuffer_;
+DirectX::XMFLOAT4X4* Model::sInstanceMap_ = nullptr;
+uint32_t Model::sInstanceBegin_ = 0;
+uint32_t Model::sInstanceCount_ = 0;
+uint64_t Model::sInstanceFrameNumber_ = UINT64_MAX;
+uint32_t Model::sLoadThreadCount_ = 0;
+std::vector<Model*> Model::sAsyncLoadModels_;
+Model::DrawStatistics Model::sDrawStatistics_;
 std::unique_ptr<LightGroup> Model::lightGroup;
 
 void Model::StaticInitialize() {
 
 	// パイプライン初期化
 	InitializeGraphicsPipeline();
+
+	// インスタンスバッファ生成
+	CreateInstanceBuffer();
 		
 	// ライト生成
 	lightGroup.reset(LightGroup::Create());
@@ -33,51 +93,40 @@ void Model::StaticInitialize() {
 
 void Model::InitializeGraphicsPipeline() {
 	HRESULT result = S_FALSE;
-	ComPtr<ID3DBlob> vsBlob;    // 頂点シェーダオブジェクト
-	ComPtr<ID3DBlob> psBlob;    // ピクセルシェーダオブジェクト
 	ComPtr<ID3DBlob> errorBlob; // エラーオブジェクト
 
-	// 頂点シェーダの読み込みとコンパイル
-	result = D3DCompileFromFile(
-	  L"Resources/shaders/ObjVS.hlsl", // シェーダファイル名
-	  nullptr,
-	  D3D_COMPILE_STANDARD_FILE_INCLUDE, // インクルード可能にする
-	  "main", "vs_5_0", // エントリーポイント名、シェーダーモデル指定
-	  D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // デバッグ用設定
-	  0, &vsBlob, &errorBlob);
-	if (FAILED(result)) {
-		// errorBlobからエラー内容をstring型にコピー
-		std::string errstr;
-		errstr.resize(errorBlob->GetBufferSize());
-
-		std::copy_n(
-		  (char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize(), errstr.begin());
-		errstr += "\n";
-		// エラー内容を出力ウィンドウに表示
-		OutputDebugStringA(errstr.c_str());
-		exit(1);
-	}
-
-	// ピクセルシェーダの読み込みとコンパイル
-	result = D3DCompileFromFile(
-	  L"Resources/shaders/ObjPS.hlsl", // シェーダファイル名
-	  nullptr,
-	  D3D_COMPILE_STANDARD_FILE_INCLUDE, // インクルード可能にする
-	  "main", "ps_5_0", // エントリーポイント名、シェーダーモデル指定
-	  D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // デバッグ用設定
-	  0, &psBlob, &errorBlob);
-	if (FAILED(result)) {
-		// errorBlobからエラー内容をstring型にコピー
-		std::string errstr;
-		errstr.resize(errorBlob->GetBufferSize());
-
-		std::copy_n(
-		  (char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize(), errstr.begin());
-		errstr += "\n";
-		// エラー内容を出力ウィンドウに表示
-		OutputDebugStringA(errstr.c_str());
-		exit(1);
-	}
+	// 頂点シェーダの読み込みとコンパイル（頂点フォーマットとインスタンス描画の組み合わせごと）
+	D3D_SHADER_MACRO packedDefines[] = {
+	  {"PACKED_VERTEX", "1"},
+	  {nullptr, nullptr},
+	};
+	D3D_SHADER_MACRO instancedDefines[] = {
+	  {"INSTANCED", "1"},
+	  {nullptr, nullptr},
+	};
+	D3D_SHADER_MACRO packedInstancedDefines[] = {
+	  {"PACKED_VERTEX", "1"},
+	  {"INSTANCED", "1"},
+	  {nullptr, nullptr},
+	};
+	ShaderCache* shaderCache = ShaderCache::GetInstance();
+	ComPtr<ID3DBlob> vsBlob = shaderCache->Load(L"Resources/shaders/ObjVS.hlsl", nullptr, "vs_5_0");
+	ComPtr<ID3DBlob> vsPackedBlob =
+	  shaderCache->Load(L"Resources/shaders/ObjVS.hlsl", packedDefines, "vs_5_0");
+	ComPtr<ID3DBlob> vsInstancedBlob =
+	  shaderCache->Load(L"Resources/shaders/ObjVS.hlsl", instancedDefines, "vs_5_0");
+	ComPtr<ID3DBlob> vsPackedInstancedBlob =
+	  shaderCache->Load(L"Resources/shaders/ObjVS.hlsl", packedInstancedDefines, "vs_5_0");
+
+	// ピクセルシェーダの読み込みとコンパイル（バインドレスならテクスチャ配列を使う版）
+	bool bindless = TextureManager::GetInstance()->IsBindless();
+	D3D_SHADER_MACRO bindlessDefines[] = {
+	  {"BINDLESS", "1"},
+	  {nullptr, nullptr},
+	};
+	ComPtr<ID3DBlob> psBlob = shaderCache->Load(
+	  L"Resources/shaders/ObjPS.hlsl", bindless ? bindlessDefines : nullptr,
+	  bindless ? "ps_5_1" : "ps_5_0");
 
 	// 頂点レイアウト
 	D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
@@ -92,6 +141,19 @@ void Model::InitializeGraphicsPipeline() {
 	   D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
 	};
 
+	// 頂点レイアウト（量子化頂点）
+	D3D12_INPUT_ELEMENT_DESC inputLayoutPacked[] = {
+	  {// AABB内の相対座標
+	   "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+	   D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+	  {// 八面体エンコードした法線
+	   "NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,       0, D3D12_APPEND_ALIGNED_ELEMENT,
+	   D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+	  {// uv座標(半精度)
+	   "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       0, D3D12_APPEND_ALIGNED_ELEMENT,
+	   D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+	};
+
 	// グラフィックスパイプラインの流れを設定
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC gpipeline{};
 	gpipeline.VS = CD3DX12_SHADER_BYTECODE(vsBlob.Get());
@@ -136,16 +198,25 @@ void Model::InitializeGraphicsPipeline() {
 	gpipeline.SampleDesc.Count = 1; // 1ピクセルにつき1回サンプリング
 
 	// デスクリプタレンジ
+	// （バインドレスならヒープ全体。インスタンスのt1と重ならないようにspace1に置く）
 	CD3DX12_DESCRIPTOR_RANGE descRangeSRV;
-	descRangeSRV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0); // t0 レジスタ
+	if (bindless) {
+		descRangeSRV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1); // t0～ space1
+	} else {
+		descRangeSRV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0); // t0 レジスタ
+	}
 
 	// ルートパラメータ
-	CD3DX12_ROOT_PARAMETER rootparams[5];
+	CD3DX12_ROOT_PARAMETER rootparams[8];
 	rootparams[0].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_ALL);
 	rootparams[1].InitAsConstantBufferView(1, 0, D3D12_SHADER_VISIBILITY_ALL);
 	rootparams[2].InitAsConstantBufferView(2, 0, D3D12_SHADER_VISIBILITY_ALL);
 	rootparams[3].InitAsDescriptorTable(1, &descRangeSRV, D3D12_SHADER_VISIBILITY_ALL);
 	rootparams[4].InitAsConstantBufferView(3, 0, D3D12_SHADER_VISIBILITY_ALL);
+	rootparams[5].InitAsConstants(
+	  sizeof(Mesh::VertexDecode) / sizeof(uint32_t), 4, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+	rootparams[6].InitAsShaderResourceView(1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+	rootparams[7].InitAsConstants(1, 5, 0, D3D12_SHADER_VISIBILITY_PIXEL); // テクスチャ番号
 
 	// スタティックサンプラー
 	CD3DX12_STATIC_SAMPLER_DESC samplerDesc = CD3DX12_STATIC_SAMPLER_DESC(0);
@@ -161,16 +232,57 @@ void Model::InitializeGraphicsPipeline() {
 	result = D3DX12SerializeVersionedRootSignature(
 	  &rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_0, &rootSigBlob, &errorBlob);
 	// ルートシグネチャの生成
-	result = DirectXCommon::GetInstance()->GetDevice()->CreateRootSignature(
-	  0, rootSigBlob->GetBufferPointer(), rootSigBlob->GetBufferSize(),
-	  IID_PPV_ARGS(&sRootSignature_));
+	PipelineCache* pipelineCache = PipelineCache::GetInstance();
+	result =
+	  pipelineCache->CreateRootSignature(rootSigBlob.Get(), IID_PPV_ARGS(&sRootSignature_));
 	assert(SUCCEEDED(result));
 
 	gpipeline.pRootSignature = sRootSignature_.Get();
 
 	// グラフィックスパイプラインの生成
-	result = DirectXCommon::GetInstance()->GetDevice()->CreateGraphicsPipelineState(
-	  &gpipeline, IID_PPV_ARGS(&sPipelineState_));
+	result = pipelineCache->CreateGraphicsPipelineState(
+	  gpipeline, IID_PPV_ARGS(&sPipelineState_));
+	assert(SUCCEEDED(result));
+
+	// インスタンス描画用のグラフィックスパイプラインの生成
+	gpipeline.VS = CD3DX12_SHADER_BYTECODE(vsInstancedBlob.Get());
+	result = pipelineCache->CreateGraphicsPipelineState(
+	  gpipeline, IID_PPV_ARGS(&sPipelineStateInstanced_));
+	assert(SUCCEEDED(result));
+
+	// 量子化頂点用のグラフィックスパイプラインの生成
+	gpipeline.VS = CD3DX12_SHADER_BYTECODE(vsPackedBlob.Get());
+	gpipeline.InputLayout.pInputElementDescs = inputLayoutPacked;
+	gpipeline.InputLayout.NumElements = _countof(inputLayoutPacked);
+	result = pipelineCache->CreateGraphicsPipelineState(
+	  gpipeline, IID_PPV_ARGS(&sPipelineStatePacked_));
+	assert(SUCCEEDED(result));
+
+	// 量子化頂点・インスタンス描画用のグラフィックスパイプラインの生成
+	gpipeline.VS = CD3DX12_SHADER_BYTECODE(vsPackedInstancedBlob.Get());
+	result = pipelineCache->CreateGraphicsPipelineState(
+	  gpipeline, IID_PPV_ARGS(&sPipelineStatePackedInstanced_));
+	assert(SUCCEEDED(result));
+}
+
+void Model::CreateInstanceBuffer() {
+	HRESULT result;
+
+	// ヒーププロパティ
+	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	// リソース設定
+	CD3DX12_RESOURCE_DESC resourceDesc =
+	  CD3DX12_RESOURCE_DESC::Buffer(
+	    sizeof(DirectX::XMFLOAT4X4) * kMaxInstanceCount * DirectXCommon::kFrameCount);
+
+	// インスタンスバッファの生成
+	result = DirectXCommon::GetInstance()->GetDevice()->CreateCommittedResource(
+	  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+	  IID_PPV_ARGS(&sInstanceBuffer_));
+	assert(SUCCEEDED(result));
+
+	// 毎フレーム書き込むのでマップしたままにする
+	result = sInstanceBuffer_->Map(0, nullptr, (void**)&sInstanceMap_);
 	assert(SUCCEEDED(result));
 }
 
@@ -190,6 +302,70 @@ Model* Model::CreateFromOBJ(const std::string& modelname, bool smoothing) {
 	return instance;
 }
 
+Model* Model::CreateFromOBJ(const std::string& modelname, const ImportSettings& settings) {
+	// メモリ確保
+	Model* instance = new Model;
+	instance->Initialize(modelname, settings);
+
+	return instance;
+}
+
+void Model::SetLoadThreadCount(uint32_t threadCount) { sLoadThreadCount_ = threadCount; }
+
+Model* Model::CreateFromOBJAsync(const std::string& modelname, bool smoothing) {
+	ImportSettings settings;
+	settings.smoothing = smoothing;
+	return CreateFromOBJAsync(modelname, settings);
+}
+
+Model* Model::CreateFromOBJAsync(const std::string& modelname, const ImportSettings& settings) {
+	// メモリ確保
+	Model* instance = new Model;
+	// CPU処理をワーカースレッドで開始
+	instance->loadFuture_ = async(launch::async, [instance, modelname, settings]() {
+		instance->Import(modelname, settings);
+	});
+	sAsyncLoadModels_.push_back(instance);
+
+	return instance;
+}
+
+Model* Model::ImportFromOBJ(const std::string& modelname, bool smoothing) {
+	ImportSettings settings;
+	settings.smoothing = smoothing;
+	return ImportFromOBJ(modelname, settings);
+}
+
+Model* Model::ImportFromOBJ(const std::string& modelname, const ImportSettings& settings) {
+	// メモリ確保
+	Model* instance = new Model;
+	instance->Import(modelname, settings);
+
+	// マテリアルのテクスチャをデコードしておく（LoadTexturesと同じファイル名）
+	for (auto& m : instance->materials_) {
+		const Material* material = m.second;
+		if (material->textureFilename_.size() > 0) {
+			TextureManager::Preload(modelname + "/" + material->textureFilename_);
+		}
+	}
+
+	return instance;
+}
+
+void Model::UpdateAsyncLoads() {
+	for (auto itr = sAsyncLoadModels_.begin(); itr != sAsyncLoadModels_.end();) {
+		Model* model = *itr;
+		// CPU処理が終わっていなければ次のフレームへ
+		if (model->loadFuture_.wait_for(chrono::seconds(0)) != future_status::ready) {
+			++itr;
+			continue;
+		}
+		model->loadFuture_.get();
+		model->CreateGpuResources();
+		itr = sAsyncLoadModels_.erase(itr);
+	}
+}
+
 void Model::PreDraw(ID3D12GraphicsCommandList* commandList) {
 	// PreDrawとPostDrawがペアで呼ばれていなければエラー
 	assert(Model::sCommandList_ == nullptr);
@@ -197,8 +373,19 @@ void Model::PreDraw(ID3D12GraphicsCommandList* commandList) {
 	// コマンドリストをセット
 	sCommandList_ = commandList;
 
-	// パイプラインステートの設定
-	commandList->SetPipelineState(sPipelineState_.Get());
+	// インスタンスバッファはフレームごとの領域を先頭から使う
+	// （同じ領域を使った前回のフレームのGPU処理はPostDrawで完了済み）
+	// コマンドリストの送信はフレームの最後なので、同じフレームの2回目以降の描画パスでは
+	// 先に積んだ描画が参照する行列を上書きしないよう続きから使う
+	DirectXCommon* dxCommon = DirectXCommon::GetInstance();
+	if (sInstanceFrameNumber_ != dxCommon->GetFrameNumber()) {
+		sInstanceFrameNumber_ = dxCommon->GetFrameNumber();
+		sInstanceBegin_ = dxCommon->GetFrameIndex() * kMaxInstanceCount;
+		sInstanceCount_ = 0;
+	}
+	// 描画の統計をリセット
+	sDrawStatistics_ = DrawStatistics();
+	sRenderQueue_.ResetStatistics();
 	// ルートシグネチャの設定
 	commandList->SetGraphicsRootSignature(sRootSignature_.Get());
 	// プリミティブ形状を設定
@@ -206,11 +393,35 @@ void Model::PreDraw(ID3D12GraphicsCommandList* commandList) {
 }
 
 void Model::PostDraw() {
+	// ライトは全モデル共通なので1回だけセット
+	lightGroup->Draw(sCommandList_, static_cast<UINT>(RoomParameter::kLight));
+
+	// 溜めた描画を並べ替えて、同じ状態のバインドを省きながら積む
+	RenderQueue::RootParameters rootParameters = {};
+	rootParameters.worldTransform = static_cast<UINT>(RoomParameter::kWorldTransform);
+	rootParameters.viewProjection = static_cast<UINT>(RoomParameter::kViewProjection);
+	rootParameters.material = static_cast<UINT>(RoomParameter::kMaterial);
+	rootParameters.texture = static_cast<UINT>(RoomParameter::kTexture);
+	rootParameters.vertexDecode = static_cast<UINT>(RoomParameter::kVertexDecode);
+	rootParameters.instance = static_cast<UINT>(RoomParameter::kInstance);
+	rootParameters.textureIndex = static_cast<UINT>(RoomParameter::kTextureIndex);
+	sRenderQueue_.Flush(
+	  sCommandList_, rootParameters, TextureManager::GetInstance()->GetDescriptorHeap());
+
 	// コマンドリストを解除
 	sCommandList_ = nullptr;
 }
 
 Model::~Model() {
+	// 非同期読み込み中ならCPU処理の終了を待って登録を外す
+	if (loadFuture_.valid()) {
+		loadFuture_.wait();
+		sAsyncLoadModels_.erase(
+		  remove(sAsyncLoadModels_.begin(), sAsyncLoadModels_.end(), this),
+		  sAsyncLoadModels_.end());
+	}
+
+	// GPUが使用中かもしれないバッファはMeshのデストラクタで解放を遅らせるので、ここでは待たない
 	for (auto m : meshes_) {
 		delete m;
 	}
@@ -223,9 +434,76 @@ Model::~Model() {
 }
 
 void Model::Initialize(const std::string& modelname, bool smoothing) {
-	// モデル読み込み
-	LoadModel(modelname, smoothing);
+	ImportSettings settings;
+	settings.smoothing = smoothing;
+	Initialize(modelname, settings);
+}
 
+void Model::Initialize(const std::string& modelname, const ImportSettings& settings) {
+	// CPU側の読み込み
+	Import(modelname, settings);
+	// GPUリソースの生成
+	CreateGpuResources();
+}
+
+void Model::Import(const std::string& modelname, const ImportSettings& settings) {
+	const string directoryPath = kBaseDirectory + modelname + "/";
+
+	name_ = modelname;
+
+	// .objファイルをメモリにマップする
+	MappedFile file;
+	// ファイルオープン失敗をチェック
+	if (!file.Open(directoryPath + modelname + ".obj")) {
+		assert(0);
+	}
+
+	// 変換済みのキャッシュがあればOBJの解析を省略する
+	const uint64_t sourceHash = MeshCache::CalculateHash(file.GetData(), file.GetSize());
+	// 読み込み設定ごとに別のキャッシュを持つ
+	uint32_t importFlags = 0;
+	if (settings.smoothing) {
+		importFlags |= MeshCache::kSmoothing;
+	}
+	if (settings.optimize) {
+		importFlags |= MeshCache::kOptimize;
+	}
+	if (settings.lodCount > 1) {
+		uint32_t lodReduction = static_cast<uint32_t>(settings.lodReduction * 100.0f + 0.5f);
+		importFlags |= (min(settings.lodCount, 0xffu) << MeshCache::kLodCountShift) |
+		               (min(lodReduction, 0xffu) << MeshCache::kLodReductionShift);
+	}
+	const string cachePath = MeshCache::MakeFilePath(directoryPath, modelname, importFlags);
+	loadCache_ = make_unique<MeshCache>();
+	if (loadCache_->Load(cachePath, sourceHash, importFlags)) {
+		// キャッシュからメッシュ生成（バッファ生成まではマップしたままにする）
+		LoadModelCache(directoryPath, *loadCache_);
+	} else {
+		loadCache_.reset();
+		// モデル読み込み
+		LoadModel(directoryPath, file, settings);
+		// 頂点キャッシュ最適化
+		if (settings.optimize) {
+			OptimizeMeshes();
+		}
+		// LOD生成
+		if (settings.lodCount > 1) {
+			GenerateLods(settings);
+		}
+		// 次回用にキャッシュを保存
+		MeshCache::Save(cachePath, sourceHash, importFlags, materialLibraries_, meshes_);
+	}
+	file.Close();
+
+	// LOD選択用の境界球
+	CalculateBoundingSphere();
+	for (auto& m : meshes_) {
+		lodCount_ = max(lodCount_, m->GetLodCount());
+	}
+	vertexFormat_ = settings.vertexFormat;
+}
+
+void Model::CreateGpuResources() {
 	// メッシュのマテリアルチェック
 	for (auto& m : meshes_) {
 		// マテリアルの割り当てがない
@@ -242,236 +520,368 @@ void Model::Initialize(const std::string& modelname, bool smoothing) {
 	}
 
 	// メッシュのバッファ生成
-	for (auto& m : meshes_) {
-		m->CreateBuffers();
+	for (size_t i = 0; i < meshes_.size(); i++) {
+		meshes_[i]->SetVertexFormat(vertexFormat_);
+		if (loadCache_) {
+			// マップ済みのキャッシュから直接転送する
+			const MeshCache::MeshData& data = loadCache_->GetMeshes()[i];
+			meshes_[i]->CreateBuffers(
+			  data.vertices, data.vertexCount, data.indices, data.indexCount, data.indexFormat);
+		} else {
+			meshes_[i]->CreateBuffers();
+		}
 	}
 
-	// マテリアルの数値を定数バッファに反映
+	// マテリアルの数値を定数バッファ用データに反映
 	for (auto& m : materials_) {
 		m.second->Update();
 	}
 
+	// 転送が終わったのでキャッシュのマップを解除
+	loadCache_.reset();
+
 	// テクスチャの読み込み
 	LoadTextures();
-}
 
-void Model::LoadModel(const std::string& modelname, bool smoothing) {
-	const string filename = modelname + ".obj";
-	const string directoryPath = kBaseDirectory + modelname + "/";
+	ready_ = true;
+}
 
-	// ファイルストリーム
-	std::ifstream file;
-	// .objファイルを開く
-	file.open(directoryPath + filename);
-	// ファイルオープン失敗をチェック
-	if (file.fail()) {
-		assert(0);
+void Model::LoadModel(
+  const std::string& directoryPath, const MappedFile& file, const ImportSettings& settings) {
+	// 計測開始
+	auto startTime = chrono::steady_clock::now();
+
+	// ファイルをチャンクに分けて並列に字句解析する
+	ObjChunkParser parser;
+	parser.Parse(file.GetData(), file.GetSize(), sLoadThreadCount_);
+	auto parseTime = chrono::steady_clock::now();
+
+	// ファイル順に命令を処理してメッシュを組み立てる
+	size_t cornerCount = BuildMeshes(
+	  directoryPath, parser.GetChunks(), parser.GetPositions(), parser.GetNormals(),
+	  parser.GetTexcoords(), settings.smoothing);
+
+	// 読み込み速度をデバッグ出力
+	auto endTime = chrono::steady_clock::now();
+	double seconds = chrono::duration<double>(endTime - startTime).count();
+	double parseSeconds = chrono::duration<double>(parseTime - startTime).count();
+	double megaBytes = file.GetSize() / (1024.0 * 1024.0);
+	char str[256];
+	sprintf_s(
+	  str, "Model::LoadModel %s: %.3fMB %.3fms (%.1fMB/s, parse %.3fms x%u threads, build %.3fms)\n",
+	  name_.c_str(), megaBytes, seconds * 1000.0, seconds > 0.0 ? megaBytes / seconds : 0.0,
+	  parseSeconds * 1000.0, parser.GetThreadCount(), (seconds - parseSeconds) * 1000.0);
+	OutputDebugStringA(str);
+
+	// 頂点溶接による削減率をデバッグ出力
+	size_t vertexCount = 0;
+	for (auto& m : meshes_) {
+		vertexCount += m->GetVertexCount();
 	}
+	sprintf_s(
+	  str, "Model::LoadModel %s: vertices %zu -> %zu (%.1f%% reduced, %.2fKB saved)\n",
+	  name_.c_str(), cornerCount, vertexCount,
+	  cornerCount > 0 ? 100.0 * (cornerCount - vertexCount) / cornerCount : 0.0,
+	  (cornerCount - vertexCount) * sizeof(Mesh::VertexPosNormalUv) / 1024.0);
+	OutputDebugStringA(str);
+}
 
-	name_ = modelname;
-
+size_t Model::BuildMeshes(
+  const std::string& directoryPath, const std::vector<ObjChunkParser::Chunk>& chunks,
+  const std::vector<XMFLOAT3>& positions, const std::vector<XMFLOAT3>& normals,
+  const std::vector<XMFLOAT2>& texcoords, bool smoothing) {
 	// メッシュ生成
 	meshes_.emplace_back(new Mesh);
 	Mesh* mesh = meshes_.back();
-	int indexCountTex = 0;
-	int indexCountNoTex = 0;
-
-	vector<XMFLOAT3> positions; // 頂点座標
-	vector<XMFLOAT3> normals;   // 法線ベクトル
-	vector<XMFLOAT2> texcoords; // テクスチャUV
-	// 1行ずつ読み込む
-	string line;
-	while (getline(file, line)) {
 
-		// 1行分の文字列をストリームに変換して解析しやすくする
-		std::istringstream line_stream(line);
-
-		// 半角スペース区切りで行の先頭文字列を取得
-		string key;
-		getline(line_stream, key, ' ');
-
-		//マテリアル
-		if (key == "mtllib") {
-			// マテリアルのファイル名読み込み
-			string filename;
-			line_stream >> filename;
-			// マテリアル読み込み
-			LoadMaterial(directoryPath, filename);
-		}
-		// 先頭文字列がgならグループの開始
-		if (key == "g") {
-
-			// カレントメッシュの情報が揃っているなら
-			if (mesh->GetName().size() > 0 && mesh->GetVertexCount() > 0) {
-				// 頂点法線の平均によるエッジの平滑化
-				if (smoothing) {
-					mesh->CalculateSmoothedVertexNormals();
-				}
-				// 次のメッシュ生成
-				meshes_.emplace_back(new Mesh);
-				mesh = meshes_.back();
-				indexCountTex = 0;
+	// 頂点溶接用（メッシュごとに頂点番号の組み合わせから頂点インデックスを引く）
+	unordered_map<VertexKey, uint32_t, VertexKeyHash> vertexMap;
+	// 多角形の頂点インデックス
+	static const int kMaxFaceVertices = 64;
+	uint32_t faceVertices[kMaxFaceVertices] = {};
+	// 溶接前の頂点数
+	size_t cornerCount = 0;
+
+	for (const ObjChunkParser::Chunk& chunk : chunks) {
+		for (const ObjChunkParser::Command& command : chunk.commands) {
+
+			//マテリアル
+			if (command.type == ObjChunkParser::CommandType::kMaterialLibrary) {
+				// マテリアルのファイル名読み込み
+				string filename(command.name);
+				// マテリアル読み込み
+				LoadMaterial(directoryPath, filename);
+				materialLibraries_.push_back(filename);
 			}
+			// gならグループの開始
+			else if (command.type == ObjChunkParser::CommandType::kGroup) {
 
-			// グループ名読み込み
-			string groupName;
-			line_stream >> groupName;
+				// カレントメッシュの情報が揃っているなら
+				if (mesh->GetName().size() > 0 && mesh->GetVertexCount() > 0) {
+					// 頂点法線の平均によるエッジの平滑化
+					if (smoothing) {
+						mesh->CalculateSmoothedVertexNormals();
+					}
+					// 次のメッシュ生成
+					meshes_.emplace_back(new Mesh);
+					mesh = meshes_.back();
+					vertexMap.clear();
+				}
 
-			// メッシュに名前をセット
-			mesh->SetName(groupName);
-		}
-		// 先頭文字列がvなら頂点座標
-		if (key == "v") {
-			// X,Y,Z座標読み込み
-			XMFLOAT3 position{};
-			line_stream >> position.x;
-			line_stream >> position.y;
-			line_stream >> position.z;
-			positions.emplace_back(position);
-		}
-		// 先頭文字列がvtならテクスチャ
-		if (key == "vt") {
-			// U,V成分読み込み
-			XMFLOAT2 texcoord{};
-			line_stream >> texcoord.x;
-			line_stream >> texcoord.y;
-			// V方向反転
-			texcoord.y = 1.0f - texcoord.y;
-			// テクスチャ座標データに追加
-			texcoords.emplace_back(texcoord);
-		}
-		// 先頭文字列がvnなら法線ベクトル
-		if (key == "vn") {
-			// X,Y,Z成分読み込み
-			XMFLOAT3 normal{};
-			line_stream >> normal.x;
-			line_stream >> normal.y;
-			line_stream >> normal.z;
-			// 法線ベクトルデータに追加
-			normals.emplace_back(normal);
-		}
-		// 先頭文字列がusemtlならマテリアルを割り当てる
-		if (key == "usemtl") {
-			if (mesh->GetMaterial() == nullptr) {
-				// マテリアルの名読み込み
-				string materialName;
-				line_stream >> materialName;
-
-				// マテリアル名で検索し、マテリアルを割り当てる
-				auto itr = materials_.find(materialName);
-				if (itr != materials_.end()) {
-					mesh->SetMaterial(itr->second);
+				// メッシュに名前をセット
+				mesh->SetName(string(command.name));
+			}
+			// usemtlならマテリアルを割り当てる
+			else if (command.type == ObjChunkParser::CommandType::kUseMaterial) {
+				if (mesh->GetMaterial() == nullptr) {
+					// マテリアル名で検索し、マテリアルを割り当てる
+					auto itr = materials_.find(string(command.name));
+					if (itr != materials_.end()) {
+						mesh->SetMaterial(itr->second);
+					}
 				}
 			}
-		}
-		// 先頭文字列がfならポリゴン（三角形）
-		if (key == "f") {
-			int faceIndexCount = 0;
-			// 半角スペース区切りで行の続きを読み込む
-			string index_string;
-			while (getline(line_stream, index_string, ' ')) {
-				// 頂点インデックス1個分の文字列をストリームに変換して解析しやすくする
-				std::istringstream index_stream(index_string);
-				unsigned short indexPosition, indexNormal, indexTexcoord;
-				// 頂点番号
-				index_stream >> indexPosition;
-
-				Material* material = mesh->GetMaterial();
-				index_stream.seekg(1, ios_base::cur); // スラッシュを飛ばす
-				// マテリアル、テクスチャがある場合
-				if (material && material->textureFilename_.size() > 0) {
-					index_stream >> indexTexcoord;
-					index_stream.seekg(1, ios_base::cur); // スラッシュを飛ばす
-					index_stream >> indexNormal;
-					// 頂点データの追加
+			// fならポリゴン（三角形）
+			else if (command.type == ObjChunkParser::CommandType::kFace) {
+				int faceIndexCount = 0;
+				for (uint32_t i = 0; i < command.cornerCount; i++) {
+					const ObjChunkParser::Corner& corner = chunk.corners[command.cornerBegin + i];
+					uint32_t indexPosition = corner.position;
+					uint32_t indexNormal = corner.normal;
+					uint32_t indexTexcoord = corner.texcoord;
+
 					Mesh::VertexPosNormalUv vertex{};
 					vertex.pos = positions[indexPosition - 1];
-					vertex.normal = normals[indexNormal - 1];
-					vertex.uv = texcoords[indexTexcoord - 1];
-					mesh->AddVertex(vertex);
-					// エッジ平滑化用のデータを追加
-					if (smoothing) {
-						mesh->AddSmoothData(
-						  indexPosition, (unsigned short)mesh->GetVertexCount() - 1);
+					Material* material = mesh->GetMaterial();
+					// マテリアル、テクスチャがある場合
+					if (material && material->textureFilename_.size() > 0) {
+						vertex.normal = normals[indexNormal - 1];
+						vertex.uv = texcoords[indexTexcoord - 1];
+					} else {
+						// スラッシュ2連続の場合、頂点番号のみ
+						if (corner.positionOnly) {
+							vertex.normal = {0, 0, 1};
+							vertex.uv = {0, 0};
+							indexNormal = 0;
+						} else {
+							vertex.normal = normals[indexNormal - 1];
+							vertex.uv = {0, 0};
+						}
+						// テクスチャを使わないのでUVは溶接のキーに含めない
+						indexTexcoord = 0;
 					}
-				} else {
-					char c;
-					index_stream >> c;
-					// スラッシュ2連続の場合、頂点番号のみ
-					if (c == '/') {
+
+					// 同じ組み合わせの頂点があれば共有する
+					VertexKey vertexKey{indexPosition, indexTexcoord, indexNormal};
+					auto result = vertexMap.try_emplace(
+					  vertexKey, static_cast<uint32_t>(mesh->GetVertexCount()));
+					uint32_t indexVertex = result.first->second;
+					if (result.second) {
 						// 頂点データの追加
-						Mesh::VertexPosNormalUv vertex{};
-						vertex.pos = positions[indexPosition - 1];
-						vertex.normal = {0, 0, 1};
-						vertex.uv = {0, 0};
 						mesh->AddVertex(vertex);
+					}
+					cornerCount++;
+
+					// エッジ平滑化用のデータを追加（法線なしの頂点は対象外）
+					// 角ごとに登録して、共有前と同じ重みで平均する
+					if (smoothing && indexNormal != 0) {
+						mesh->AddSmoothData(indexPosition, indexVertex);
+					}
+
+					// インデックスデータの追加
+					if (faceIndexCount >= 3) {
+						// 四角形ポリゴンの4点目なので、
+						// 四角形の0,1,2,3の内 2,3,0で三角形を構築する
+						// (5角形以上も従来どおり n-1,n,n-3 の順で構築する)
+						mesh->AddIndex(faceVertices[faceIndexCount - 1]);
+						mesh->AddIndex(indexVertex);
+						mesh->AddIndex(faceVertices[faceIndexCount - 3]);
 					} else {
-						index_stream.seekg(-1, ios_base::cur); // 1文字戻る
-						index_stream >> indexTexcoord;
-						index_stream.seekg(1, ios_base::cur); // スラッシュを飛ばす
-						index_stream >> indexNormal;
-						// 頂点データの追加
-						Mesh::VertexPosNormalUv vertex{};
-						vertex.pos = positions[indexPosition - 1];
-						vertex.normal = normals[indexNormal - 1];
-						vertex.uv = {0, 0};
-						mesh->AddVertex(vertex);
-						// エッジ平滑化用のデータを追加
-						if (smoothing) {
-							mesh->AddSmoothData(
-							  indexPosition, (unsigned short)mesh->GetVertexCount() - 1);
-						}
+						mesh->AddIndex(indexVertex);
+					}
+					if (faceIndexCount < kMaxFaceVertices) {
+						faceVertices[faceIndexCount] = indexVertex;
+						faceIndexCount++;
 					}
 				}
-				// インデックスデータの追加
-				if (faceIndexCount >= 3) {
-					// 四角形ポリゴンの4点目なので、
-					// 四角形の0,1,2,3の内 2,3,0で三角形を構築する
-					mesh->AddIndex(indexCountTex - 1);
-					mesh->AddIndex(indexCountTex);
-					mesh->AddIndex(indexCountTex - 3);
-				} else {
-					mesh->AddIndex(indexCountTex);
-				}
-				indexCountTex++;
-				faceIndexCount++;
 			}
 		}
 	}
-	file.close();
 
 	// 頂点法線の平均によるエッジの平滑化
 	if (smoothing) {
 		mesh->CalculateSmoothedVertexNormals();
 	}
+
+	// AABBの計算
+	for (auto& m : meshes_) {
+		m->CalculateBounds();
+	}
+
+	return cornerCount;
+}
+
+void Model::LoadModelCache(const std::string& directoryPath, const MeshCache& cache) {
+	// マテリアル読み込み
+	for (const string_view& library : cache.GetMaterialLibraries()) {
+		LoadMaterial(directoryPath, string(library));
+		materialLibraries_.emplace_back(library);
+	}
+
+	// メッシュ生成
+	for (const MeshCache::MeshData& data : cache.GetMeshes()) {
+		Mesh* mesh = new Mesh;
+		mesh->SetName(string(data.name));
+		mesh->SetBounds(data.aabbMin, data.aabbMax);
+		mesh->SetLods(data.lods, data.lodCount);
+
+		// マテリアル名で検索し、マテリアルを割り当てる
+		auto itr = materials_.find(string(data.materialName));
+		if (itr != materials_.end()) {
+			mesh->SetMaterial(itr->second);
+		}
+		meshes_.emplace_back(mesh);
+	}
+}
+
+void Model::OptimizeMeshes() {
+	// 計測開始
+	auto startTime = chrono::steady_clock::now();
+
+	MeshOptimizer::CacheStatistics before{}, after{};
+	for (auto& m : meshes_) {
+		const auto& indices = m->GetIndices();
+		size_t vertexCount = m->GetVertexCount();
+
+		MeshOptimizer::CacheStatistics statistics =
+		  MeshOptimizer::AnalyzeVertexCache(indices, vertexCount);
+		before.triangleCount += statistics.triangleCount;
+		before.vertexCount += statistics.vertexCount;
+		before.missCount += statistics.missCount;
+
+		m->Optimize();
+
+		statistics = MeshOptimizer::AnalyzeVertexCache(m->GetIndices(), vertexCount);
+		after.triangleCount += statistics.triangleCount;
+		after.vertexCount += statistics.vertexCount;
+		after.missCount += statistics.missCount;
+	}
+
+	// 最適化前後のキャッシュ効率をデバッグ出力
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+	char str[256];
+	sprintf_s(
+	  str, "Model::OptimizeMeshes %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%.3fms)\n",
+	  name_.c_str(), before.GetAcmr(), after.GetAcmr(), before.GetAtvr(), after.GetAtvr(),
+	  seconds * 1000.0);
+	OutputDebugStringA(str);
+}
+
+void Model::GenerateLods(const ImportSettings& settings) {
+	// 計測開始
+	auto startTime = chrono::steady_clock::now();
+
+	// LODごとの三角形数
+	vector<size_t> triangleCounts;
+	for (auto& m : meshes_) {
+		m->GenerateLods(settings.lodCount, settings.lodReduction, settings.optimize);
+
+		const auto& lods = m->GetLods();
+		if (triangleCounts.size() < lods.size()) {
+			triangleCounts.resize(lods.size(), 0);
+		}
+		for (size_t i = 0; i < lods.size(); i++) {
+			triangleCounts[i] += lods[i].indexCount / 3;
+		}
+	}
+
+	// LODごとの三角形数をデバッグ出力
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+	string counts;
+	for (size_t count : triangleCounts) {
+		counts += (counts.empty() ? "" : " -> ") + to_string(count);
+	}
+	char str[256];
+	sprintf_s(
+	  str, "Model::GenerateLods %s: triangles %s (%.3fms)\n", name_.c_str(),
+	  counts.empty() ? "-" : counts.c_str(), seconds * 1000.0);
+	OutputDebugStringA(str);
+}
+
+void Model::CalculateBoundingSphere() {
+	if (meshes_.empty()) {
+		return;
+	}
+
+	// 全メッシュのAABBを合わせた箱に外接する球
+	DirectX::XMVECTOR vMin = DirectX::XMLoadFloat3(&meshes_[0]->GetAabbMin());
+	DirectX::XMVECTOR vMax = DirectX::XMLoadFloat3(&meshes_[0]->GetAabbMax());
+	for (auto& m : meshes_) {
+		vMin = DirectX::XMVectorMin(vMin, DirectX::XMLoadFloat3(&m->GetAabbMin()));
+		vMax = DirectX::XMVectorMax(vMax, DirectX::XMLoadFloat3(&m->GetAabbMax()));
+	}
+	DirectX::XMStoreFloat3(
+	  &boundCenter_, DirectX::XMVectorScale(DirectX::XMVectorAdd(vMin, vMax), 0.5f));
+	boundRadius_ =
+	  DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(vMax, vMin))) * 0.5f;
+}
+
+uint32_t
+  Model::SelectLod(const WorldTransform& worldTransform, const ViewProjection& viewProjection) {
+	if (lodCount_ <= 1) {
+		return 0;
+	}
+
+	// 境界球をワールド座標へ
+	const DirectX::XMMATRIX& matWorld = worldTransform.matWorld_;
+	DirectX::XMVECTOR center =
+	  DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&boundCenter_), matWorld);
+	float radius = boundRadius_ * GetMaxScale(matWorld);
+
+	// 画面の高さに対する境界球の直径の比率
+	float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(
+	  DirectX::XMVectorSubtract(center, DirectX::XMLoadFloat3(&viewProjection.eye))));
+	float screenSize = 1.0f;
+	if (distance > radius) {
+		screenSize = radius / (distance * tanf(viewProjection.fovAngleY * 0.5f));
+	}
+
+	// 閾値付近でLODが頻繁に切り替わらないよう、前回のLODから離れるときだけ余裕を持たせる
+	// （前回のLODはワールドトランスフォーム側に持たせ、モデルは破棄済みの要素を覚えない）
+	uint32_t level = min(worldTransform.lodLevel_, lodCount_ - 1);
+	while (level + 1 < lodCount_ &&
+	       screenSize < lodScreenSize_ / float(1u << level) * (1.0f - kLodHysteresis)) {
+		level++;
+	}
+	while (level > 0 &&
+	       screenSize > lodScreenSize_ / float(1u << (level - 1)) * (1.0f + kLodHysteresis)) {
+		level--;
+	}
+	worldTransform.lodLevel_ = level;
+	return level;
 }
 
 void Model::LoadMaterial(const std::string& directoryPath, const std::string& filename) {
-	// ファイルストリーム
-	std::ifstream file;
-	// マテリアルファイルを開く
-	file.open(directoryPath + filename);
+	// マテリアルファイルをメモリにマップする
+	MappedFile file;
 	// ファイルオープン失敗をチェック
-	if (file.fail()) {
+	if (!file.Open(directoryPath + filename)) {
 		assert(0);
 	}
 
 	Material* material = nullptr;
 
 	// 1行ずつ読み込む
-	string line;
-	while (getline(file, line)) {
-
-		// 1行分の文字列をストリームに変換して解析しやすくする
-		std::istringstream line_stream(line);
+	ObjTokenizer tokenizer(file.GetData(), file.GetData() + file.GetSize());
+	string_view line;
+	while (tokenizer.NextLine(line)) {
 
 		// 半角スペース区切りで行の先頭文字列を取得
-		string key;
-		getline(line_stream, key, ' ');
+		string_view key = ObjTokenizer::Split(line, ' ');
 
 		// 先頭のタブ文字は無視する
-		if (key[0] == '\t') {
-			key.erase(key.begin()); // 先頭の文字を削除
+		while (!key.empty() && key.front() == '\t') {
+			key.remove_prefix(1); // 先頭の文字を削除
 		}
 
 		// 先頭文字列がnewmtlならマテリアル名
@@ -486,48 +896,45 @@ void Model::LoadMaterial(const std::string& directoryPath, const std::string& fi
 			// 新しいマテリアルを生成
 			material = Material::Create();
 			// マテリアル名読み込み
-			line_stream >> material->name_;
+			material->name_ = ObjTokenizer::ReadWord(line);
+		}
+		// newmtlより前の行は無視する
+		if (material == nullptr) {
+			continue;
 		}
 		// 先頭文字列がKaならアンビエント色
 		if (key == "Ka") {
-			line_stream >> material->ambient_.x;
-			line_stream >> material->ambient_.y;
-			line_stream >> material->ambient_.z;
+			material->ambient_.x = ObjTokenizer::ReadFloat(line);
+			material->ambient_.y = ObjTokenizer::ReadFloat(line);
+			material->ambient_.z = ObjTokenizer::ReadFloat(line);
 		}
 		// 先頭文字列がKdならディフューズ色
 		if (key == "Kd") {
-			line_stream >> material->diffuse_.x;
-			line_stream >> material->diffuse_.y;
-			line_stream >> material->diffuse_.z;
+			material->diffuse_.x = ObjTokenizer::ReadFloat(line);
+			material->diffuse_.y = ObjTokenizer::ReadFloat(line);
+			material->diffuse_.z = ObjTokenizer::ReadFloat(line);
 		}
 		// 先頭文字列がKsならスペキュラー色
 		if (key == "Ks") {
-			line_stream >> material->specular_.x;
-			line_stream >> material->specular_.y;
-			line_stream >> material->specular_.z;
+			material->specular_.x = ObjTokenizer::ReadFloat(line);
+			material->specular_.y = ObjTokenizer::ReadFloat(line);
+			material->specular_.z = ObjTokenizer::ReadFloat(line);
 		}
 		// 先頭文字列がmap_Kdならテクスチャファイル名
 		if (key == "map_Kd") {
 			// テクスチャのファイル名読み込み
-			line_stream >> material->textureFilename_;
+			string_view textureFilename = ObjTokenizer::ReadWord(line);
 
 			// フルパスからファイル名を取り出す
-			size_t pos1;
-			pos1 = material->textureFilename_.rfind('\\');
-			if (pos1 != string::npos) {
-				material->textureFilename_ = material->textureFilename_.substr(
-				  pos1 + 1, material->textureFilename_.size() - pos1 - 1);
-			}
-
-			pos1 = material->textureFilename_.rfind('/');
-			if (pos1 != string::npos) {
-				material->textureFilename_ = material->textureFilename_.substr(
-				  pos1 + 1, material->textureFilename_.size() - pos1 - 1);
+			size_t pos1 = textureFilename.find_last_of("\\/");
+			if (pos1 != string_view::npos) {
+				textureFilename.remove_prefix(pos1 + 1);
 			}
+			material->textureFilename_ = textureFilename;
 		}
 	}
 	// ファイルを閉じる
-	file.close();
+	file.Close();
 
 	if (material) {
 		// マテリアルを登録
@@ -564,47 +971,214 @@ void Model::LoadTextures() {
 
 void Model::Draw(
   const WorldTransform& worldTransform, const ViewProjection& viewProjection) {
+	// 読み込み中は描画しない
+	if (!ready_) {
+		return;
+	}
 
-	// ライトの描画
-	lightGroup->Draw(sCommandList_, static_cast<UINT>(RoomParameter::kLight));
-
-	// CBVをセット（ワールド行列）
-	sCommandList_->SetGraphicsRootConstantBufferView(
-	  static_cast<UINT>(RoomParameter::kWorldTransform),
-	  worldTransform.constBuff_->GetGPUVirtualAddress());
+	// モデル全体が視錐台の外ならコマンドを積まない
+	if (!IsVisible(boundCenter_, boundRadius_, worldTransform, viewProjection)) {
+		sDrawStatistics_.culledMeshCount += static_cast<uint32_t>(meshes_.size());
+		return;
+	}
 
-	// CBVをセット（ビュープロジェクション行列）
-	sCommandList_->SetGraphicsRootConstantBufferView(
-	  static_cast<UINT>(RoomParameter::kViewProjection),
-	  viewProjection.constBuff_->GetGPUVirtualAddress());
+	// CBVに転送（ワールド行列とビュープロジェクション行列）
+	D3D12_GPU_VIRTUAL_ADDRESS transform = worldTransform.TransferMatrix();
+	D3D12_GPU_VIRTUAL_ADDRESS viewProjectionAddress = viewProjection.TransferMatrix();
+	float depth = CalculateDepth(worldTransform, viewProjection);
 
-	// 全メッシュを描画
+	// 全メッシュを描画キューに追加
+	uint32_t lodLevel = SelectLod(worldTransform, viewProjection);
 	for (auto& mesh : meshes_) {
-		mesh->Draw(sCommandList_, (UINT)RoomParameter::kMaterial, (UINT)RoomParameter::kTexture);
+		// 複数メッシュならメッシュ単位でも判定する
+		if (
+		  meshes_.size() > 1 &&
+		  !IsVisible(mesh->GetBoundCenter(), mesh->GetBoundRadius(), worldTransform, viewProjection)) {
+			sDrawStatistics_.culledMeshCount++;
+			continue;
+		}
+		sDrawStatistics_.visibleMeshCount++;
+		sDrawStatistics_.drawCallCount++;
+		SubmitMesh(
+		  *mesh, false, transform, viewProjectionAddress, mesh->GetMaterial()->GetTextureHadle(),
+		  lodLevel, 1, depth);
 	}
 }
 
 void Model::Draw(
   const WorldTransform& worldTransform, const ViewProjection& viewProjection,
   uint32_t textureHadle) {
+	// 読み込み中は描画しない
+	if (!ready_) {
+		return;
+	}
 
-	// ライトの描画
-	lightGroup->Draw(sCommandList_, static_cast<UINT>(RoomParameter::kLight));
+	// モデル全体が視錐台の外ならコマンドを積まない
+	if (!IsVisible(boundCenter_, boundRadius_, worldTransform, viewProjection)) {
+		sDrawStatistics_.culledMeshCount += static_cast<uint32_t>(meshes_.size());
+		return;
+	}
 
-	// CBVをセット（ワールド行列）
-	sCommandList_->SetGraphicsRootConstantBufferView(
-	  static_cast<UINT>(RoomParameter::kWorldTransform),
-	  worldTransform.constBuff_->GetGPUVirtualAddress());
+	// CBVに転送（ワールド行列とビュープロジェクション行列）
+	D3D12_GPU_VIRTUAL_ADDRESS transform = worldTransform.TransferMatrix();
+	D3D12_GPU_VIRTUAL_ADDRESS viewProjectionAddress = viewProjection.TransferMatrix();
+	float depth = CalculateDepth(worldTransform, viewProjection);
 
-	// CBVをセット（ビュープロジェクション行列）
-	sCommandList_->SetGraphicsRootConstantBufferView(
-	  static_cast<UINT>(RoomParameter::kViewProjection),
-	  viewProjection.constBuff_->GetGPUVirtualAddress());
+	// 全メッシュを描画キューに追加
+	uint32_t lodLevel = SelectLod(worldTransform, viewProjection);
+	for (auto& mesh : meshes_) {
+		// 複数メッシュならメッシュ単位でも判定する
+		if (
+		  meshes_.size() > 1 &&
+		  !IsVisible(mesh->GetBoundCenter(), mesh->GetBoundRadius(), worldTransform, viewProjection)) {
+			sDrawStatistics_.culledMeshCount++;
+			continue;
+		}
+		sDrawStatistics_.visibleMeshCount++;
+		sDrawStatistics_.drawCallCount++;
+		SubmitMesh(
+		  *mesh, false, transform, viewProjectionAddress, textureHadle, lodLevel, 1, depth);
+	}
+}
 
-	// 全メッシュを描画
+void Model::DrawInstanced(
+  const WorldTransform* worldTransforms, size_t count, const ViewProjection& viewProjection,
+  uint32_t textureHadle) {
+	// ポインタの配列にして描画
+	instanceTransforms_.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		instanceTransforms_[i] = &worldTransforms[i];
+	}
+	DrawInstanced(instanceTransforms_.data(), count, viewProjection, textureHadle);
+}
+
+void Model::DrawInstanced(
+  const WorldTransform* const* worldTransforms, size_t count,
+  const ViewProjection& viewProjection, uint32_t textureHadle) {
+	// 読み込み中は描画しない
+	if (!ready_ || count == 0) {
+		return;
+	}
+
+	// 視錐台と重なるインスタンスのワールド行列をインスタンスバッファに詰める
+	const uint32_t instanceOffset = sInstanceBegin_ + sInstanceCount_;
+	instanceIndices_.resize(count);
+	InstancePacker::Result result = InstancePacker::Pack(
+	  worldTransforms, count, boundCenter_, boundRadius_, viewProjection.frustum,
+	  sInstanceMap_ + instanceOffset, kMaxInstanceCount - sInstanceCount_, instanceIndices_.data());
+	sInstanceCount_ += result.packedCount;
+	sDrawStatistics_.culledMeshCount += result.culledCount * static_cast<uint32_t>(meshes_.size());
+
+	// インスタンスバッファが一杯で判定まで届かなかった残りは、1個ずつの描画に切り替える
+	// （詰め込みは先頭から順に行うので、残りは判定済みの数より後ろ）
+	const uint32_t processedCount = result.packedCount + result.culledCount;
+	if (processedCount < count) {
+		sDrawStatistics_.overflowInstanceCount += static_cast<uint32_t>(count - processedCount);
+		for (size_t i = processedCount; i < count; i++) {
+			Draw(*worldTransforms[i], viewProjection, textureHadle);
+		}
+	}
+	if (result.packedCount == 0) {
+		return;
+	}
+
+	// 画面上で最も大きいインスタンスに合わせてLODを選ぶ
+	// （半透明なら最も奥のインスタンスの深度で並べる）
+	uint32_t lodLevel = lodCount_;
+	float depth = 0.0f;
+	for (uint32_t i = 0; i < result.packedCount; i++) {
+		const WorldTransform& worldTransform = *worldTransforms[instanceIndices_[i]];
+		lodLevel = min(lodLevel, SelectLod(worldTransform, viewProjection));
+		depth = max(depth, CalculateDepth(worldTransform, viewProjection));
+	}
+
+	// インスタンスごとのワールド行列（SRV）とビュープロジェクション行列（CBV）
+	D3D12_GPU_VIRTUAL_ADDRESS instances =
+	  sInstanceBuffer_->GetGPUVirtualAddress() + sizeof(DirectX::XMFLOAT4X4) * instanceOffset;
+	D3D12_GPU_VIRTUAL_ADDRESS viewProjectionAddress = viewProjection.TransferMatrix();
+
+	// 全メッシュを描画キューに追加
 	for (auto& mesh : meshes_) {
-		mesh->Draw(
-		  sCommandList_, (UINT)RoomParameter::kMaterial, (UINT)RoomParameter::kTexture,
-		  textureHadle);
+		sDrawStatistics_.visibleMeshCount += result.packedCount;
+		sDrawStatistics_.drawCallCount++;
+		SubmitMesh(
+		  *mesh, true, instances, viewProjectionAddress, textureHadle, lodLevel,
+		  result.packedCount, depth);
 	}
 }
+
+bool Model::IsVisible(
+  const XMFLOAT3& center, float radius, const WorldTransform& worldTransform,
+  const ViewProjection& viewProjection) const {
+	return viewProjection.frustum.IntersectsSphere(center, radius, worldTransform.matWorld_);
+}
+
+size_t Model::GetGpuMemorySize() const {
+	size_t size = 0;
+	for (const Mesh* mesh : meshes_) {
+		size += mesh->GetBufferSize();
+	}
+	return size;
+}
+
+uint32_t Model::GetPipelineIndex(bool instanced) const {
+	return (vertexFormat_ == Mesh::VertexFormat::kPacked ? 1 : 0) | (instanced ? 2 : 0);
+}
+
+void Model::SubmitMesh(
+  Mesh& mesh, bool instanced, D3D12_GPU_VIRTUAL_ADDRESS transform,
+  D3D12_GPU_VIRTUAL_ADDRESS viewProjection, uint32_t textureHandle, uint32_t lodLevel,
+  uint32_t instanceCount, float depth) {
+	// 頂点フォーマットと描画方法に合わせたパイプラインステート
+	ID3D12PipelineState* pipelineStates[] = {
+	  sPipelineState_.Get(), sPipelineStatePacked_.Get(), sPipelineStateInstanced_.Get(),
+	  sPipelineStatePackedInstanced_.Get()};
+	uint32_t pipelineIndex = GetPipelineIndex(instanced);
+
+	RenderQueue::DrawCommand command = {};
+	command.pipelineState = pipelineStates[pipelineIndex];
+	command.viewProjection = viewProjection;
+	command.transform = transform;
+	command.material = mesh.GetMaterial()->TransferConstBuffer();
+	// バインドレスならテーブルは全描画で共通になり、テクスチャは番号で選ぶ
+	TextureManager* textureManager = TextureManager::GetInstance();
+	command.bindless = textureManager->IsBindless();
+	if (command.bindless) {
+		command.texture = textureManager->GetGpuDescHandleTable();
+		command.textureIndex = textureManager->GetDescriptorIndex(textureHandle);
+	} else {
+		command.texture = textureManager->GetGpuDescHandleSRV(textureHandle);
+	}
+	command.vbView = mesh.GetVBView();
+	command.ibView = mesh.GetIBView();
+	// 座標の復元にはメッシュごとのAABBを使う
+	command.packed = vertexFormat_ == Mesh::VertexFormat::kPacked;
+	if (command.packed) {
+		command.vertexDecode = mesh.GetVertexDecode();
+	}
+	command.instanced = instanced;
+	Mesh::LodLevel lod = mesh.GetLodLevel(lodLevel);
+	command.indexCount = lod.indexCount;
+	command.indexOffset = lod.indexOffset;
+	command.instanceCount = instanceCount;
+
+	// 不透明は状態ごとにまとめて手前から（インスタンスは散らばっているので最も手前）、
+	// 半透明はブレンドの順序を守るため不透明の後に奥から描く
+	uint64_t key = 0;
+	if (mesh.GetMaterial()->alpha_ < 1.0f) {
+		key = RenderQueue::MakeTranslucentSortKey(depth);
+	} else {
+		key = RenderQueue::MakeSortKey(
+		  pipelineIndex, command.material, textureHandle, command.vbView.BufferLocation,
+		  instanced ? 0.0f : depth);
+	}
+	sRenderQueue_.Submit(key, command);
+}
+
+float Model::CalculateDepth(
+  const WorldTransform& worldTransform, const ViewProjection& viewProjection) const {
+	DirectX::XMVECTOR center = DirectX::XMLoadFloat3(&boundCenter_);
+	center = DirectX::XMVector3Transform(center, worldTransform.matWorld_);
+	center = DirectX::XMVector3Transform(center, viewProjection.matView);
+	return DirectX::XMVectorGetZ(center) / viewProjection.farZ;
+}
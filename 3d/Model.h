@@ -4,11 +4,18 @@
 #include "ViewProjection.h"
 #include "WorldTransform.h"
 #include "Mesh.h"
+#include "RenderQueue.h"
 #include "LightGroup.h"
+#include "ObjChunkParser.h"
+#include <future>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+class MappedFile;
+class MeshCache;
+
 /// <summary>
 /// モデルデータ
 /// </summary>
@@ -32,11 +39,40 @@ class Model {
 		kMaterial,       // マテリアル
 		kTexture,        // テクスチャ
 		kLight,          // ライト
+		kVertexDecode,   // 量子化頂点の復元用定数
+		kInstance,       // インスタンスごとのワールド行列
+		kTextureIndex,   // バインドレス描画のテクスチャ番号
+	};
+
+  public: // サブクラス
+	/// <summary>
+	/// OBJ読み込み設定
+	/// </summary>
+	struct ImportSettings {
+		bool smoothing = false;    // エッジ平滑化フラグ
+		bool optimize = false;     // 頂点キャッシュ最適化フラグ
+		uint32_t lodCount = 1;     // LOD数（元のメッシュを含む、1ならLODなし）
+		float lodReduction = 0.5f; // LOD1段階ごとの三角形数の比率
+		Mesh::VertexFormat vertexFormat = Mesh::VertexFormat::kFloat; // GPUに転送する頂点フォーマット
+	};
+
+	/// <summary>
+	/// 描画の統計（PreDrawでリセット）
+	/// </summary>
+	struct DrawStatistics {
+		uint32_t visibleMeshCount = 0;      // 描画したメッシュ数（インスタンスごとに数える）
+		uint32_t culledMeshCount = 0;       // 視錐台の外で省略したメッシュ数
+		uint32_t drawCallCount = 0;         // 発行した描画コマンド数
+		uint32_t overflowInstanceCount = 0; // インスタンスバッファに入りきらず個別に描画した数
 	};
 
   private:
 	static const std::string kBaseDirectory;
 	static const std::string kDefaultModelName;
+	// LOD切り替えのヒステリシス（閾値に対する比率）
+	static const float kLodHysteresis;
+	// 1フレームに描画できるインスタンス数の上限
+	static const uint32_t kMaxInstanceCount = 4096;
 
   private: // 静的メンバ変数
 	// デスクリプタサイズ
@@ -47,8 +83,32 @@ class Model {
 	static Microsoft::WRL::ComPtr<ID3D12RootSignature> sRootSignature_;
 	// パイプラインステートオブジェクト
 	static Microsoft::WRL::ComPtr<ID3D12PipelineState> sPipelineState_;
+	// パイプラインステートオブジェクト（量子化頂点）
+	static Microsoft::WRL::ComPtr<ID3D12PipelineState> sPipelineStatePacked_;
+	// パイプラインステートオブジェクト（インスタンス描画）
+	static Microsoft::WRL::ComPtr<ID3D12PipelineState> sPipelineStateInstanced_;
+	// パイプラインステートオブジェクト（量子化頂点・インスタンス描画）
+	static Microsoft::WRL::ComPtr<ID3D12PipelineState> sPipelineStatePackedInstanced_;
+	// 描画の並べ替えキュー（PostDrawでまとめてコマンドを積む）
+	static RenderQueue sRenderQueue_;
+	// インスタンスごとのワールド行列（構造化バッファ）
+	static Microsoft::WRL::ComPtr<ID3D12Resource> sInstanceBuffer_;
+	// インスタンスバッファのマップ
+	static DirectX::XMFLOAT4X4* sInstanceMap_;
+	// 今フレームで使うインスタンスバッファの先頭（フレームごとに領域を分ける）
+	static uint32_t sInstanceBegin_;
+	// 今フレームで使用済みのインスタンス数
+	static uint32_t sInstanceCount_;
+	// インスタンスバッファの領域を割り当てたフレーム数（同じフレームの2回目以降のPreDrawでは続きから使う）
+	static uint64_t sInstanceFrameNumber_;
 	// ライト
 	static std::unique_ptr<LightGroup> lightGroup;
+	// OBJ解析のスレッド数（0なら論理コア数）
+	static uint32_t sLoadThreadCount_;
+	// 非同期読み込み中のモデル
+	static std::vector<Model*> sAsyncLoadModels_;
+	// 描画の統計
+	static DrawStatistics sDrawStatistics_;
 
   public: // 静的メンバ関数
 	/// <summary>
@@ -61,6 +121,11 @@ class Model {
 	/// </summary>
 	static void InitializeGraphicsPipeline();
 
+	/// <summary>
+	/// インスタンスバッファの生成
+	/// </summary>
+	static void CreateInstanceBuffer();
+
 			/// <summary>
 	/// 3Dモデル生成
 	/// </summary>
@@ -75,6 +140,82 @@ class Model {
 	/// <returns>生成されたモデル</returns>
 	static Model* CreateFromOBJ(const std::string& modelname, bool smoothing = false);
 
+	/// <summary>
+	/// OBJファイルからメッシュ生成
+	/// </summary>
+	/// <param name="modelname">モデル名</param>
+	/// <param name="settings">読み込み設定</param>
+	/// <returns>生成されたモデル</returns>
+	static Model* CreateFromOBJ(const std::string& modelname, const ImportSettings& settings);
+
+	/// <summary>
+	/// OBJ解析のスレッド数を設定
+	/// </summary>
+	/// <param name="threadCount">スレッド数（0なら論理コア数）</param>
+	static void SetLoadThreadCount(uint32_t threadCount);
+
+	/// <summary>
+	/// OBJファイルからメッシュを非同期に生成
+	/// 解析などのCPU処理はワーカースレッドで行い、GPUリソースの生成はUpdateAsyncLoadsで行う
+	/// 読み込みが終わるまではIsReadyがfalseを返し、描画しても何も描かれない
+	/// </summary>
+	/// <param name="modelname">モデル名</param>
+	/// <param name="smoothing">エッジ平滑化フラグ</param>
+	/// <returns>生成されたモデル（読み込み中）</returns>
+	static Model* CreateFromOBJAsync(const std::string& modelname, bool smoothing = false);
+
+	/// <summary>
+	/// OBJファイルからメッシュを非同期に生成
+	/// </summary>
+	/// <param name="modelname">モデル名</param>
+	/// <param name="settings">読み込み設定</param>
+	/// <returns>生成されたモデル（読み込み中）</returns>
+	static Model* CreateFromOBJAsync(const std::string& modelname, const ImportSettings& settings);
+
+	/// <summary>
+	/// OBJファイルのCPU側の読み込みだけを行う（ワーカースレッドから呼べる）
+	/// マテリアルのテクスチャもTextureManager::Preloadでデコードしておく
+	/// 描画する前にメインスレッドでCreateGpuResourcesを呼ぶ
+	/// </summary>
+	/// <param name="modelname">モデル名</param>
+	/// <param name="smoothing">エッジ平滑化フラグ</param>
+	/// <returns>生成されたモデル（GPUリソースは未生成）</returns>
+	static Model* ImportFromOBJ(const std::string& modelname, bool smoothing = false);
+
+	/// <summary>
+	/// OBJファイルのCPU側の読み込みだけを行う（ワーカースレッドから呼べる）
+	/// </summary>
+	/// <param name="modelname">モデル名</param>
+	/// <param name="settings">読み込み設定</param>
+	/// <returns>生成されたモデル（GPUリソースは未生成）</returns>
+	static Model* ImportFromOBJ(const std::string& modelname, const ImportSettings& settings);
+
+	/// <summary>
+	/// 非同期読み込みの更新（メインスレッドで毎フレーム呼ぶ）
+	/// CPU処理の終わったモデルのGPUリソースを生成する
+	/// </summary>
+	static void UpdateAsyncLoads();
+
+	/// <summary>
+	/// デフォルトモデル名を取得
+	/// </summary>
+	/// <returns>デフォルトモデル名</returns>
+	static const std::string& GetDefaultModelName() { return kDefaultModelName; }
+
+	/// <summary>
+	/// 描画の統計を取得
+	/// </summary>
+	/// <returns>前回のPreDraw以降の統計</returns>
+	static const DrawStatistics& GetDrawStatistics() { return sDrawStatistics_; }
+
+	/// <summary>
+	/// 描画の並べ替えの統計を取得
+	/// </summary>
+	/// <returns>前回のPreDraw以降の統計</returns>
+	static const RenderQueue::Statistics& GetRenderQueueStatistics() {
+		return sRenderQueue_.GetStatistics();
+	}
+
 		/// <summary>
 	/// 描画前処理
 	/// </summary>
@@ -82,7 +223,7 @@ class Model {
 	static void PreDraw(ID3D12GraphicsCommandList* commandList);
 
 	/// <summary>
-	/// 描画後処理
+	/// 描画後処理（溜めた描画を並べ替えてコマンドリストに積む）
 	/// </summary>
 	static void PostDraw();
 
@@ -99,6 +240,18 @@ class Model {
 	/// <param name="modelname">エッジ平滑化フラグ</param>
 	void Initialize(const std::string& modelname, bool smoothing = false);
 
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="modelname">モデル名</param>
+	/// <param name="settings">読み込み設定</param>
+	void Initialize(const std::string& modelname, const ImportSettings& settings);
+
+	/// <summary>
+	/// GPUリソースの生成（メインスレッドで呼ぶ）
+	/// </summary>
+	void CreateGpuResources();
+
 	/// <summary>
 	/// 描画
 	/// </summary>
@@ -117,12 +270,61 @@ class Model {
 	  const WorldTransform& worldTransform, const ViewProjection& viewProjection,
 	  uint32_t textureHadle);
 
+	/// <summary>
+	/// インスタンス描画
+	/// 視錐台と重なるインスタンスのワールド行列を構造化バッファに詰め、メッシュごとに1回で描画する
+	/// LODは最も細かいものが必要なインスタンスに合わせる
+	/// </summary>
+	/// <param name="worldTransforms">ワールドトランスフォームの配列</param>
+	/// <param name="count">インスタンス数</param>
+	/// <param name="viewProjection">ビュープロジェクション</param>
+	/// <param name="textureHadle">テクスチャハンドル</param>
+	void DrawInstanced(
+	  const WorldTransform* worldTransforms, size_t count, const ViewProjection& viewProjection,
+	  uint32_t textureHadle);
+
+	/// <summary>
+	/// インスタンス描画（ポインタの配列）
+	/// </summary>
+	/// <param name="worldTransforms">ワールドトランスフォームのポインタの配列</param>
+	/// <param name="count">インスタンス数</param>
+	/// <param name="viewProjection">ビュープロジェクション</param>
+	/// <param name="textureHadle">テクスチャハンドル</param>
+	void DrawInstanced(
+	  const WorldTransform* const* worldTransforms, size_t count,
+	  const ViewProjection& viewProjection, uint32_t textureHadle);
+
 	/// <summary>
 	/// メッシュコンテナを取得
 	/// </summary>
 	/// <returns>メッシュコンテナ</returns>
 	inline const std::vector<Mesh*>& GetMeshes() { return meshes_; }
 
+	/// <summary>
+	/// LOD1に切り替える画面サイズをセット
+	/// 画面の高さに対する境界球の直径の比率で、以降のLODは半分ずつになる
+	/// </summary>
+	/// <param name="screenSize">画面サイズ</param>
+	void SetLodScreenSize(float screenSize) { lodScreenSize_ = screenSize; }
+
+	/// <summary>
+	/// LOD数を取得
+	/// </summary>
+	/// <returns>LOD数</returns>
+	uint32_t GetLodCount() const { return lodCount_; }
+
+	/// <summary>
+	/// 読み込みが完了して描画できるか
+	/// </summary>
+	/// <returns>描画できるか</returns>
+	bool IsReady() const { return ready_; }
+
+	/// <summary>
+	/// GPUメモリの使用量を取得（頂点・インデックスバッファ）
+	/// </summary>
+	/// <returns>バイト数</returns>
+	size_t GetGpuMemorySize() const;
+
   private: // メンバ変数
 	// 名前
 	std::string name_;
@@ -132,14 +334,135 @@ class Model {
 	std::unordered_map<std::string, Material*> materials_;
 	// デフォルトマテリアル
 	Material* defaultMaterial_ = nullptr;
+	// マテリアルライブラリのファイル名
+	std::vector<std::string> materialLibraries_;
+	// 境界球の中心（モデル座標）
+	XMFLOAT3 boundCenter_ = {0, 0, 0};
+	// 境界球の半径
+	float boundRadius_ = 0.0f;
+	// LOD数（全メッシュの最大）
+	uint32_t lodCount_ = 1;
+	// LOD1に切り替える画面サイズ
+	float lodScreenSize_ = 0.5f;
+	// GPUに転送する頂点フォーマット
+	Mesh::VertexFormat vertexFormat_ = Mesh::VertexFormat::kFloat;
+	// 読み込み完了フラグ
+	bool ready_ = false;
+	// インスタンス描画で詰めたインスタンスの元の番号（作業用）
+	std::vector<uint32_t> instanceIndices_;
+	// インスタンス描画でポインタの配列に変換する作業用
+	std::vector<const WorldTransform*> instanceTransforms_;
+	// 非同期読み込みのCPU処理
+	std::future<void> loadFuture_;
+	// GPUリソース生成まで保持する変換済みキャッシュ（キャッシュがなければnull）
+	std::unique_ptr<MeshCache> loadCache_;
 
   private: // メンバ関数
 	/// <summary>
-	/// モデル読み込み
+	/// 境界球が視錐台と重なるか
+	/// </summary>
+	/// <param name="center">境界球の中心（モデル座標）</param>
+	/// <param name="radius">境界球の半径</param>
+	/// <param name="worldTransform">ワールドトランスフォーム</param>
+	/// <param name="viewProjection">ビュープロジェクション</param>
+	/// <returns>重なるか</returns>
+	bool IsVisible(
+	  const XMFLOAT3& center, float radius, const WorldTransform& worldTransform,
+	  const ViewProjection& viewProjection) const;
+
+	/// <summary>
+	/// CPU側の読み込み（ワーカースレッドからも呼べる）
 	/// </summary>
 	/// <param name="modelname">モデル名</param>
-	/// <param name="modelname">エッジ平滑化フラグ</param>
-	void LoadModel(const std::string& modelname, bool smoothing);
+	/// <param name="settings">読み込み設定</param>
+	void Import(const std::string& modelname, const ImportSettings& settings);
+
+	/// <summary>
+	/// 頂点フォーマットと描画方法に合わせたパイプラインの番号
+	/// </summary>
+	/// <param name="instanced">インスタンス描画か</param>
+	/// <returns>パイプラインの番号</returns>
+	uint32_t GetPipelineIndex(bool instanced) const;
+
+	/// <summary>
+	/// メッシュの描画をキューに追加
+	/// </summary>
+	/// <param name="mesh">メッシュ</param>
+	/// <param name="instanced">インスタンス描画か</param>
+	/// <param name="transform">ワールド行列のCBV（インスタンス描画ならインスタンスバッファ）</param>
+	/// <param name="viewProjection">ビュープロジェクションのCBV</param>
+	/// <param name="textureHandle">テクスチャハンドル</param>
+	/// <param name="lodLevel">LOD番号</param>
+	/// <param name="instanceCount">インスタンス数</param>
+	/// <param name="depth">[0,1]のカメラからの距離（インスタンス描画なら最も奥のインスタンス）</param>
+	void SubmitMesh(
+	  Mesh& mesh, bool instanced, D3D12_GPU_VIRTUAL_ADDRESS transform,
+	  D3D12_GPU_VIRTUAL_ADDRESS viewProjection, uint32_t textureHandle, uint32_t lodLevel,
+	  uint32_t instanceCount, float depth);
+
+	/// <summary>
+	/// カメラからの距離を[0,1]で求める（並べ替え用）
+	/// </summary>
+	/// <param name="worldTransform">ワールドトランスフォーム</param>
+	/// <param name="viewProjection">ビュープロジェクション</param>
+	/// <returns>ファークリップを1とした距離</returns>
+	float CalculateDepth(
+	  const WorldTransform& worldTransform, const ViewProjection& viewProjection) const;
+
+	/// <summary>
+	/// モデル読み込み
+	/// </summary>
+	/// <param name="directoryPath">モデルのディレクトリパス</param>
+	/// <param name="file">マップ済みの.objファイル</param>
+	/// <param name="settings">読み込み設定</param>
+	void LoadModel(
+	  const std::string& directoryPath, const MappedFile& file, const ImportSettings& settings);
+
+	/// <summary>
+	/// 字句解析の結果をファイル順に処理してメッシュを組み立てる
+	/// </summary>
+	/// <param name="directoryPath">モデルのディレクトリパス</param>
+	/// <param name="chunks">命令と面の頂点</param>
+	/// <param name="positions">頂点座標</param>
+	/// <param name="normals">法線ベクトル</param>
+	/// <param name="texcoords">テクスチャUV</param>
+	/// <param name="smoothing">エッジ平滑化フラグ</param>
+	/// <returns>溶接前の頂点数</returns>
+	size_t BuildMeshes(
+	  const std::string& directoryPath, const std::vector<ObjChunkParser::Chunk>& chunks,
+	  const std::vector<XMFLOAT3>& positions, const std::vector<XMFLOAT3>& normals,
+	  const std::vector<XMFLOAT2>& texcoords, bool smoothing);
+
+	/// <summary>
+	/// 変換済みキャッシュからモデル読み込み
+	/// </summary>
+	/// <param name="directoryPath">モデルのディレクトリパス</param>
+	/// <param name="cache">読み込み済みのキャッシュ</param>
+	void LoadModelCache(const std::string& directoryPath, const MeshCache& cache);
+
+	/// <summary>
+	/// 全メッシュの頂点キャッシュ最適化
+	/// </summary>
+	void OptimizeMeshes();
+
+	/// <summary>
+	/// 全メッシュのLOD生成
+	/// </summary>
+	/// <param name="settings">読み込み設定</param>
+	void GenerateLods(const ImportSettings& settings);
+
+	/// <summary>
+	/// 境界球の計算
+	/// </summary>
+	void CalculateBoundingSphere();
+
+	/// <summary>
+	/// 画面サイズからLODを選択
+	/// </summary>
+	/// <param name="worldTransform">ワールドトランスフォーム</param>
+	/// <param name="viewProjection">ビュープロジェクション</param>
+	/// <returns>LOD番号</returns>
+	uint32_t SelectLod(const WorldTransform& worldTransform, const ViewProjection& viewProjection);
 
 	/// <summary>
 	/// マテリアル読み込み
@@ -0,0 +1,129 @@
+﻿#include "ModelManager.h"
+#include <Windows.h>
+#include <chrono>
+
+using namespace std;
+
+std::shared_ptr<Model> ModelManager::Load(
+  const std::string& modelname, bool smoothing, Mesh::VertexFormat vertexFormat) {
+	return ModelManager::GetInstance()->LoadInternal(modelname, smoothing, vertexFormat);
+}
+
+void ModelManager::Preload(
+  const std::string& modelname, bool smoothing, Mesh::VertexFormat vertexFormat) {
+	ModelManager* modelManager = ModelManager::GetInstance();
+	Key key(modelname, smoothing, vertexFormat);
+
+	// 確認と登録を同じ排他制御の中で行い、同じモデルを二重に読み込まないようにする
+	promise<void> ready;
+	shared_future<void> loading;
+	{
+		lock_guard<mutex> lock(modelManager->preloadMutex_);
+		auto it = modelManager->preloadedModels_.find(key);
+		if (it != modelManager->preloadedModels_.end()) {
+			loading = it->second.ready;
+		} else {
+			modelManager->preloadedModels_[key].ready = ready.get_future().share();
+		}
+	}
+	if (loading.valid()) {
+		// 他のスレッドが読み込み中なら完了を待つ
+		loading.wait();
+		return;
+	}
+
+	// 読み込みは排他制御の外で行う
+	auto startTime = chrono::steady_clock::now();
+	unique_ptr<Model> model(
+	  Model::ImportFromOBJ(modelname, MakeImportSettings(smoothing, vertexFormat)));
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+	{
+		lock_guard<mutex> lock(modelManager->preloadMutex_);
+		PreloadedModel& preloaded = modelManager->preloadedModels_[key];
+		preloaded.model = move(model);
+		preloaded.seconds = seconds;
+	}
+	ready.set_value();
+}
+
+ModelManager* ModelManager::GetInstance() {
+	static ModelManager instance;
+	return &instance;
+}
+
+void ModelManager::OutputStatistics() const {
+	char str[256];
+	sprintf_s(
+	  str,
+	  "ModelManager: loaded %u (%u preloaded), shared %u, load %.3fms, GPU memory %.2fKB "
+	  "(%.2fKB saved)\n",
+	  statistics_.loadCount, statistics_.preloadCount, statistics_.shareCount,
+	  statistics_.loadSeconds * 1000.0, statistics_.gpuMemorySize / 1024.0,
+	  statistics_.savedGpuMemorySize / 1024.0);
+	OutputDebugStringA(str);
+}
+
+std::shared_ptr<Model> ModelManager::LoadInternal(
+  const std::string& modelname, bool smoothing, Mesh::VertexFormat vertexFormat) {
+	// 読み込み済みのモデルを検索
+	Key key(modelname, smoothing, vertexFormat);
+	weak_ptr<Model>& entry = models_[key];
+	shared_ptr<Model> model = entry.lock();
+	if (model) {
+		// 共有したので読み込みとGPUメモリの確保を省略できた
+		statistics_.shareCount++;
+		statistics_.savedGpuMemorySize += model->GetGpuMemorySize();
+		return model;
+	}
+
+	// 事前読み込み済みならGPUリソースの生成だけを行う
+	unique_ptr<Model> preloaded;
+	double preloadSeconds = 0.0;
+	shared_future<void> loading;
+	{
+		lock_guard<mutex> lock(preloadMutex_);
+		auto it = preloadedModels_.find(key);
+		if (it != preloadedModels_.end()) {
+			loading = it->second.ready;
+		}
+	}
+	if (loading.valid()) {
+		// 事前読み込み中なら、読み直さずに完了を待って引き取る
+		loading.wait();
+		lock_guard<mutex> lock(preloadMutex_);
+		auto it = preloadedModels_.find(key);
+		if (it != preloadedModels_.end()) {
+			preloaded = move(it->second.model);
+			preloadSeconds = it->second.seconds;
+			preloadedModels_.erase(it);
+		}
+	}
+
+	// 読み込み
+	auto startTime = chrono::steady_clock::now();
+	if (preloaded) {
+		preloaded->CreateGpuResources();
+		model = move(preloaded);
+		statistics_.preloadCount++;
+	} else {
+		model.reset(Model::CreateFromOBJ(modelname, MakeImportSettings(smoothing, vertexFormat)));
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+	seconds += preloadSeconds;
+	entry = model;
+
+	statistics_.loadCount++;
+	statistics_.loadSeconds += seconds;
+	statistics_.gpuMemorySize += model->GetGpuMemorySize();
+
+	return model;
+}
+
+Model::ImportSettings ModelManager::MakeImportSettings(
+  bool smoothing, Mesh::VertexFormat vertexFormat) {
+	Model::ImportSettings settings;
+	settings.smoothing = smoothing;
+	settings.vertexFormat = vertexFormat;
+	return settings;
+}
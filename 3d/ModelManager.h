@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include "Model.h"
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+/// <summary>
+/// モデルマネージャ
+/// 同じモデル名・平滑化設定・頂点フォーマットの読み込みでは読み込み済みのモデルを共有する
+/// テクスチャの差し替えはModel::Drawのテクスチャハンドル指定で行う
+/// Preloadでワーカースレッドから先にCPU側の読み込みを済ませておける
+/// </summary>
+class ModelManager {
+  public:
+	/// <summary>
+	/// 読み込みの統計
+	/// </summary>
+	struct Statistics {
+		uint32_t loadCount = 0;        // 実際に読み込んだ回数
+		uint32_t shareCount = 0;       // 読み込み済みのモデルを共有した回数
+		uint32_t preloadCount = 0;     // 事前読み込みしたモデルを使った回数
+		double loadSeconds = 0.0;      // 読み込みにかかった時間の合計（事前読み込みを含む）
+		size_t gpuMemorySize = 0;      // 読み込んだモデルのGPUメモリの合計
+		size_t savedGpuMemorySize = 0; // 共有で確保せずに済んだGPUメモリの合計
+	};
+
+	/// <summary>
+	/// 読み込み（読み込み済みなら共有）
+	/// </summary>
+	/// <param name="modelname">モデル名</param>
+	/// <param name="smoothing">エッジ平滑化フラグ</param>
+	/// <param name="vertexFormat">GPUに転送する頂点フォーマット</param>
+	/// <returns>モデル</returns>
+	static std::shared_ptr<Model> Load(
+	  const std::string& modelname, bool smoothing = false,
+	  Mesh::VertexFormat vertexFormat = Mesh::VertexFormat::kFloat);
+
+	/// <summary>
+	/// 事前読み込み（ワーカースレッドから呼べる）
+	/// CPU側の読み込みだけを行い、GPUリソースは次のLoadで生成する
+	/// 同じモデルを読み込み中なら、重複して読み込まずにその完了を待つ
+	/// </summary>
+	/// <param name="modelname">モデル名</param>
+	/// <param name="smoothing">エッジ平滑化フラグ</param>
+	/// <param name="vertexFormat">GPUに転送する頂点フォーマット</param>
+	static void Preload(
+	  const std::string& modelname, bool smoothing = false,
+	  Mesh::VertexFormat vertexFormat = Mesh::VertexFormat::kFloat);
+
+	/// <summary>
+	/// シングルトンインスタンスの取得
+	/// </summary>
+	/// <returns>シングルトンインスタンス</returns>
+	static ModelManager* GetInstance();
+
+	/// <summary>
+	/// 統計を取得
+	/// </summary>
+	/// <returns>統計</returns>
+	const Statistics& GetStatistics() const { return statistics_; }
+
+	/// <summary>
+	/// 統計を出力ウィンドウに表示
+	/// </summary>
+	void OutputStatistics() const;
+
+  private:
+	// モデルのキー（モデル名、平滑化フラグ、頂点フォーマット）
+	using Key = std::tuple<std::string, bool, Mesh::VertexFormat>;
+
+	// 事前読み込みしたモデル
+	struct PreloadedModel {
+		std::shared_future<void> ready; // 読み込み完了（読み込み中に登録し、他の呼び出し側が待つ）
+		std::unique_ptr<Model> model;   // 読み込んだモデル（GPUリソースは未生成）
+		double seconds = 0.0;           // 読み込みにかかった時間
+	};
+
+	ModelManager() = default;
+	~ModelManager() = default;
+	ModelManager(const ModelManager&) = delete;
+	ModelManager& operator=(const ModelManager&) = delete;
+
+	// モデルコンテナ（使われなくなったモデルは解放される）
+	std::map<Key, std::weak_ptr<Model>> models_;
+	// 事前読み込みしたモデル（読み込み中のものも含む）
+	std::map<Key, PreloadedModel> preloadedModels_;
+	// 事前読み込みの排他制御
+	std::mutex preloadMutex_;
+	// 読み込みの統計
+	Statistics statistics_;
+
+	/// <summary>
+	/// 読み込み
+	/// </summary>
+	/// <param name="modelname">モデル名</param>
+	/// <param name="smoothing">エッジ平滑化フラグ</param>
+	/// <param name="vertexFormat">GPUに転送する頂点フォーマット</param>
+	/// <returns>モデル</returns>
+	std::shared_ptr<Model> LoadInternal(
+	  const std::string& modelname, bool smoothing, Mesh::VertexFormat vertexFormat);
+
+	/// <summary>
+	/// 読み込み設定の作成
+	/// </summary>
+	/// <param name="smoothing">エッジ平滑化フラグ</param>
+	/// <param name="vertexFormat">GPUに転送する頂点フォーマット</param>
+	/// <returns>読み込み設定</returns>
+	static Model::ImportSettings MakeImportSettings(
+	  bool smoothing, Mesh::VertexFormat vertexFormat);
+};
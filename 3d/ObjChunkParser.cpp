@@ -0,0 +1,140 @@
+﻿#include "ObjChunkParser.h"
+#include "ObjTokenizer.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+using namespace DirectX;
+using namespace std;
+
+namespace {
+
+// チャンク1個分の字句解析
+void ParseChunk(const char* begin, const char* end, ObjChunkParser::Chunk& chunk) {
+	using Command = ObjChunkParser::Command;
+	using CommandType = ObjChunkParser::CommandType;
+
+	ObjTokenizer tokenizer(begin, end);
+	string_view line;
+	while (tokenizer.NextLine(line)) {
+
+		// 半角スペース区切りで行の先頭文字列を取得
+		string_view key = ObjTokenizer::Split(line, ' ');
+
+		if (key == "v") {
+			XMFLOAT3 position{};
+			position.x = ObjTokenizer::ReadFloat(line);
+			position.y = ObjTokenizer::ReadFloat(line);
+			position.z = ObjTokenizer::ReadFloat(line);
+			chunk.positions.emplace_back(position);
+		} else if (key == "vt") {
+			XMFLOAT2 texcoord{};
+			texcoord.x = ObjTokenizer::ReadFloat(line);
+			texcoord.y = ObjTokenizer::ReadFloat(line);
+			// V方向反転
+			texcoord.y = 1.0f - texcoord.y;
+			chunk.texcoords.emplace_back(texcoord);
+		} else if (key == "vn") {
+			XMFLOAT3 normal{};
+			normal.x = ObjTokenizer::ReadFloat(line);
+			normal.y = ObjTokenizer::ReadFloat(line);
+			normal.z = ObjTokenizer::ReadFloat(line);
+			chunk.normals.emplace_back(normal);
+		} else if (key == "f") {
+			Command command{CommandType::kFace, {}, static_cast<uint32_t>(chunk.corners.size()), 0};
+			// 半角スペース区切りで行の続きを読み込む
+			while (!line.empty()) {
+				// 頂点インデックス1個分の文字列
+				string_view indexString = ObjTokenizer::Split(line, ' ');
+				if (indexString.empty()) {
+					continue;
+				}
+				ObjChunkParser::Corner corner{};
+				// 頂点番号
+				ObjTokenizer::ReadIndex(indexString, corner.position);
+				indexString.remove_prefix(min<size_t>(1, indexString.size())); // スラッシュを飛ばす
+				// スラッシュ2連続の場合、UV番号は省略
+				if (!indexString.empty() && indexString.front() == '/') {
+					corner.positionOnly = true;
+				} else {
+					ObjTokenizer::ReadIndex(indexString, corner.texcoord);
+				}
+				indexString.remove_prefix(min<size_t>(1, indexString.size())); // スラッシュを飛ばす
+				ObjTokenizer::ReadIndex(indexString, corner.normal);
+				chunk.corners.push_back(corner);
+				command.cornerCount++;
+			}
+			chunk.commands.push_back(command);
+		} else if (key == "g") {
+			chunk.commands.push_back({CommandType::kGroup, ObjTokenizer::ReadWord(line), 0, 0});
+		} else if (key == "usemtl") {
+			chunk.commands.push_back(
+			  {CommandType::kUseMaterial, ObjTokenizer::ReadWord(line), 0, 0});
+		} else if (key == "mtllib") {
+			chunk.commands.push_back(
+			  {CommandType::kMaterialLibrary, ObjTokenizer::ReadWord(line), 0, 0});
+		}
+	}
+}
+
+// 配列の末尾に連結する
+template<class T> void Append(vector<T>& dest, vector<T>& src) {
+	dest.insert(dest.end(), src.begin(), src.end());
+	vector<T>().swap(src);
+}
+
+} // namespace
+
+uint32_t ObjChunkParser::GetDefaultThreadCount() {
+	uint32_t count = thread::hardware_concurrency();
+	return count > 0 ? count : 1;
+}
+
+void ObjChunkParser::Parse(const char* data, size_t size, uint32_t threadCount) {
+	if (threadCount == 0) {
+		threadCount = GetDefaultThreadCount();
+	}
+	// 小さいファイルはスレッドを減らす
+	size_t maxThreadCount = size / kMinChunkSize + 1;
+	if (threadCount > maxThreadCount) {
+		threadCount = static_cast<uint32_t>(maxThreadCount);
+	}
+
+	// 行の途中で切れないようにチャンクの境界を決める
+	vector<const char*> bounds(threadCount + 1);
+	const char* end = data + size;
+	bounds[0] = data;
+	for (uint32_t i = 1; i < threadCount; i++) {
+		const char* bound = data + size * i / threadCount;
+		if (bound < bounds[i - 1]) {
+			bound = bounds[i - 1];
+		}
+		const char* lineEnd =
+		  static_cast<const char*>(memchr(bound, '\n', static_cast<size_t>(end - bound)));
+		bounds[i] = lineEnd ? lineEnd + 1 : end;
+	}
+	bounds[threadCount] = end;
+
+	// チャンクごとに並列で解析（先頭のチャンクは呼び出し元のスレッドで処理）
+	chunks_.clear();
+	chunks_.resize(threadCount);
+	vector<thread> workers;
+	workers.reserve(threadCount - 1);
+	for (uint32_t i = 1; i < threadCount; i++) {
+		workers.emplace_back(ParseChunk, bounds[i], bounds[i + 1], ref(chunks_[i]));
+	}
+	ParseChunk(bounds[0], bounds[1], chunks_[0]);
+	for (thread& worker : workers) {
+		worker.join();
+	}
+
+	// 頂点属性をファイル順に連結する
+	positions_.clear();
+	normals_.clear();
+	texcoords_.clear();
+	for (Chunk& chunk : chunks_) {
+		Append(positions_, chunk.positions);
+		Append(normals_, chunk.normals);
+		Append(texcoords_, chunk.texcoords);
+	}
+}
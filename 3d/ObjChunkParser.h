@@ -0,0 +1,108 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// <summary>
+/// OBJテキストの並列字句解析
+/// ファイルを行単位のチャンクに分けてスレッドごとに解析し、ファイル順に連結する
+/// グループやマテリアルの解釈は行わないので、結果はスレッド数によらず同一になる
+/// </summary>
+class ObjChunkParser {
+  public: // 定数
+	// 1スレッドに割り当てる最小のバイト数（小さいファイルはスレッドを立てない）
+	static const size_t kMinChunkSize = 256 * 1024;
+
+  public: // サブクラス
+	// 面の頂点1個分の番号（1始まり、省略時は0）
+	struct Corner {
+		uint32_t position; // 座標番号
+		uint32_t texcoord; // UV番号
+		uint32_t normal;   // 法線番号
+		bool positionOnly; // "v//vn"形式か
+	};
+
+	// 命令の種類
+	enum class CommandType {
+		kMaterialLibrary, // mtllib
+		kGroup,           // g
+		kUseMaterial,     // usemtl
+		kFace,            // f
+	};
+
+	// ファイル順に並んだ命令
+	struct Command {
+		CommandType type;      // 種類
+		std::string_view name; // mtllib/g/usemtlの名前（ファイル内を直接指す）
+		uint32_t cornerBegin;  // fの先頭の頂点（corners内の位置）
+		uint32_t cornerCount;  // fの頂点数
+	};
+
+	// チャンクの解析結果
+	struct Chunk {
+		std::vector<DirectX::XMFLOAT3> positions; // 頂点座標
+		std::vector<DirectX::XMFLOAT3> normals;   // 法線ベクトル
+		std::vector<DirectX::XMFLOAT2> texcoords; // テクスチャUV（V反転済み）
+		std::vector<Corner> corners;              // 面の頂点
+		std::vector<Command> commands;            // 命令
+	};
+
+  public: // 静的メンバ関数
+	/// <summary>
+	/// 既定のスレッド数（論理コア数）を取得
+	/// </summary>
+	/// <returns>スレッド数</returns>
+	static uint32_t GetDefaultThreadCount();
+
+  public: // メンバ関数
+	/// <summary>
+	/// 解析
+	/// </summary>
+	/// <param name="data">テキストの先頭</param>
+	/// <param name="size">テキストのサイズ</param>
+	/// <param name="threadCount">スレッド数（0なら既定値）</param>
+	void Parse(const char* data, size_t size, uint32_t threadCount);
+
+	/// <summary>
+	/// 全チャンクを連結した頂点座標を取得
+	/// </summary>
+	/// <returns>頂点座標</returns>
+	const std::vector<DirectX::XMFLOAT3>& GetPositions() const { return positions_; }
+
+	/// <summary>
+	/// 全チャンクを連結した法線ベクトルを取得
+	/// </summary>
+	/// <returns>法線ベクトル</returns>
+	const std::vector<DirectX::XMFLOAT3>& GetNormals() const { return normals_; }
+
+	/// <summary>
+	/// 全チャンクを連結したテクスチャUVを取得
+	/// </summary>
+	/// <returns>テクスチャUV</returns>
+	const std::vector<DirectX::XMFLOAT2>& GetTexcoords() const { return texcoords_; }
+
+	/// <summary>
+	/// チャンクをファイル順に取得（命令と面の頂点のみ）
+	/// </summary>
+	/// <returns>チャンク</returns>
+	const std::vector<Chunk>& GetChunks() const { return chunks_; }
+
+	/// <summary>
+	/// 前回の解析に使ったスレッド数を取得
+	/// </summary>
+	/// <returns>スレッド数</returns>
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(chunks_.size()); }
+
+  private: // メンバ変数
+	// 連結した頂点座標
+	std::vector<DirectX::XMFLOAT3> positions_;
+	// 連結した法線ベクトル
+	std::vector<DirectX::XMFLOAT3> normals_;
+	// 連結したテクスチャUV
+	std::vector<DirectX::XMFLOAT2> texcoords_;
+	// チャンク
+	std::vector<Chunk> chunks_;
+};
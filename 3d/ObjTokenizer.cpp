@@ -0,0 +1,77 @@
+﻿#include "ObjTokenizer.h"
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+// operator>>が読み飛ばす空白文字か
+inline bool IsSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+} // namespace
+
+bool ObjTokenizer::NextLine(std::string_view& line) {
+	if (current_ >= end_) {
+		return false;
+	}
+
+	// 改行を検索
+	const char* lineEnd =
+	  static_cast<const char*>(std::memchr(current_, '\n', static_cast<size_t>(end_ - current_)));
+	const char* next = lineEnd ? lineEnd + 1 : end_;
+	if (lineEnd == nullptr) {
+		lineEnd = end_;
+	}
+	// CRLFのCRを取り除く
+	if (lineEnd > current_ && lineEnd[-1] == '\r') {
+		lineEnd--;
+	}
+
+	line = std::string_view(current_, static_cast<size_t>(lineEnd - current_));
+	current_ = next;
+	return true;
+}
+
+std::string_view ObjTokenizer::Split(std::string_view& text, char delimiter) {
+	size_t pos = text.find(delimiter);
+	std::string_view token = text.substr(0, pos);
+	text.remove_prefix(pos == std::string_view::npos ? text.size() : pos + 1);
+	return token;
+}
+
+std::string_view ObjTokenizer::ReadWord(std::string_view& text) {
+	// 先頭の空白を読み飛ばす
+	size_t begin = 0;
+	while (begin < text.size() && IsSpace(text[begin])) {
+		begin++;
+	}
+	// 次の空白までを単語とする
+	size_t end = begin;
+	while (end < text.size() && !IsSpace(text[end])) {
+		end++;
+	}
+	std::string_view word = text.substr(begin, end - begin);
+	text.remove_prefix(end);
+	return word;
+}
+
+float ObjTokenizer::ReadFloat(std::string_view& text) {
+	std::string_view word = ReadWord(text);
+	// from_charsは先頭の'+'を受け付けないので読み飛ばす
+	if (!word.empty() && word.front() == '+') {
+		word.remove_prefix(1);
+	}
+	float value = 0.0f;
+	std::from_chars(word.data(), word.data() + word.size(), value);
+	return value;
+}
+
+bool ObjTokenizer::ReadIndex(std::string_view& text, uint32_t& value) {
+	auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (ec != std::errc()) {
+		return false;
+	}
+	text.remove_prefix(static_cast<size_t>(ptr - text.data()));
+	return true;
+}
@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+/// <summary>
+/// OBJ/MTLテキストのトークナイザ
+/// ファイルの内容をコピーせず、その場で行・トークンに分割する
+/// </summary>
+class ObjTokenizer {
+  public: // メンバ関数
+	/// <summary>
+	/// コンストラクタ
+	/// </summary>
+	/// <param name="begin">テキストの先頭</param>
+	/// <param name="end">テキストの終端</param>
+	ObjTokenizer(const char* begin, const char* end) : current_(begin), end_(end) {}
+
+	/// <summary>
+	/// 次の1行を取得（改行コードは含まない）
+	/// </summary>
+	/// <param name="line">取得した行</param>
+	/// <returns>行を取得できたか</returns>
+	bool NextLine(std::string_view& line);
+
+  public: // 静的メンバ関数
+	/// <summary>
+	/// 区切り文字までの文字列を切り出す（std::getlineと同じ分割）
+	/// </summary>
+	/// <param name="text">解析中の文字列。切り出した分だけ進む</param>
+	/// <param name="delimiter">区切り文字</param>
+	/// <returns>切り出した文字列</returns>
+	static std::string_view Split(std::string_view& text, char delimiter);
+
+	/// <summary>
+	/// 空白を読み飛ばして1単語を切り出す（operator&gt;&gt;と同じ分割）
+	/// </summary>
+	/// <param name="text">解析中の文字列。切り出した分だけ進む</param>
+	/// <returns>切り出した単語</returns>
+	static std::string_view ReadWord(std::string_view& text);
+
+	/// <summary>
+	/// 1単語を浮動小数点数として読み込む
+	/// </summary>
+	/// <param name="text">解析中の文字列。読み込んだ分だけ進む</param>
+	/// <returns>読み込んだ値（失敗時は0）</returns>
+	static float ReadFloat(std::string_view& text);
+
+	/// <summary>
+	/// 先頭の符号なし整数を読み込む
+	/// </summary>
+	/// <param name="text">解析中の文字列。読み込んだ分だけ進む</param>
+	/// <param name="value">読み込んだ値</param>
+	/// <returns>読み込めたか</returns>
+	static bool ReadIndex(std::string_view& text, uint32_t& value);
+
+  private: // メンバ変数
+	// 現在の読み込み位置
+	const char* current_;
+	// テキストの終端
+	const char* end_;
+};
@@ -0,0 +1,192 @@
+﻿#include "RenderQueue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+// 64bit値を指定ビット数に畳み込む
+inline uint64_t FoldBits(uint64_t value, uint32_t bits) {
+	// 乗算で上位ビットに混ぜてから取り出す
+	return (value * 0x9e3779b97f4a7c15ull) >> (64 - bits);
+}
+
+// 同じ値ならバインドを省く
+template<class T> inline bool UpdateState(T& current, const T& value, bool& valid) {
+	if (valid && memcmp(&current, &value, sizeof(T)) == 0) {
+		return false;
+	}
+	current = value;
+	valid = true;
+	return true;
+}
+
+} // namespace
+
+uint64_t RenderQueue::MakeSortKey(
+  uint32_t pipeline, uint64_t material, uint32_t texture, uint64_t mesh, float depth) {
+	depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+	uint64_t key = pipeline & ((1u << kPipelineBits) - 1);
+	key = key << kMaterialBits | FoldBits(material, kMaterialBits);
+	key = key << kTextureBits | (texture & ((1u << kTextureBits) - 1));
+	key = key << kMeshBits | FoldBits(mesh, kMeshBits);
+	key = key << kDepthBits | static_cast<uint64_t>(depth * ((1u << kDepthBits) - 1) + 0.5f);
+	return key;
+}
+
+uint64_t RenderQueue::MakeTranslucentSortKey(float depth) {
+	depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+	const double maxDepth = static_cast<double>((1ull << kTranslucentDepthBits) - 1);
+	return kTranslucentBit | static_cast<uint64_t>((1.0 - depth) * maxDepth + 0.5);
+}
+
+void RenderQueue::RadixSort(std::vector<SortItem>& items, std::vector<SortItem>& work) {
+	const size_t count = items.size();
+	if (count <= 1) {
+		return;
+	}
+	work.resize(count);
+
+	// 全桁のヒストグラムを1回の走査で数える
+	static const uint32_t kDigitCount = 8;
+	uint32_t histograms[kDigitCount][256] = {};
+	for (const SortItem& item : items) {
+		for (uint32_t digit = 0; digit < kDigitCount; digit++) {
+			histograms[digit][(item.key >> (digit * 8)) & 0xff]++;
+		}
+	}
+
+	SortItem* source = items.data();
+	SortItem* dest = work.data();
+	for (uint32_t digit = 0; digit < kDigitCount; digit++) {
+		uint32_t* histogram = histograms[digit];
+		// 全要素が同じ値の桁は並びが変わらないので飛ばす
+		if (histogram[(source[0].key >> (digit * 8)) & 0xff] == count) {
+			continue;
+		}
+		uint32_t offset = 0;
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t n = histogram[i];
+			histogram[i] = offset;
+			offset += n;
+		}
+		for (size_t i = 0; i < count; i++) {
+			dest[histogram[(source[i].key >> (digit * 8)) & 0xff]++] = source[i];
+		}
+		swap(source, dest);
+	}
+
+	// 奇数回の入れ替えで作業領域に結果がある場合
+	if (source != items.data()) {
+		items.swap(work);
+	}
+}
+
+uint32_t RenderQueue::GetBindCount(const DrawCommand& command) {
+	// パイプライン・ビュープロジェクション・ワールド行列・マテリアル・デスクリプタヒープ・
+	// テクスチャ・頂点バッファ・インデックスバッファ・ライト（量子化頂点なら復元用定数、
+	// バインドレスならテクスチャ番号も）
+	return 9 + (command.packed ? 1 : 0) + (command.bindless ? 1 : 0);
+}
+
+void RenderQueue::Submit(uint64_t key, const DrawCommand& command) {
+	items_.push_back({key, static_cast<uint32_t>(commands_.size())});
+	commands_.push_back(command);
+}
+
+void RenderQueue::Flush(
+  ID3D12GraphicsCommandList* commandList, const RootParameters& rootParameters,
+  ID3D12DescriptorHeap* descriptorHeap) {
+	if (commands_.empty()) {
+		return;
+	}
+
+	// 並べ替え
+	auto startTime = chrono::steady_clock::now();
+	RadixSort(items_, work_);
+	statistics_.sortSeconds +=
+	  chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+	// 共通の設定（デスクリプタヒープと、呼び出し側で1回だけセットしたライト）
+	ID3D12DescriptorHeap* ppHeaps[] = {descriptorHeap};
+	commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+	uint32_t bindCount = 2;
+	uint32_t requestedBindCount = 0;
+
+	// 直前にセットした値
+	ID3D12PipelineState* pipelineState = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS viewProjection = 0, transform = 0, instance = 0, material = 0;
+	D3D12_GPU_DESCRIPTOR_HANDLE texture = {};
+	D3D12_VERTEX_BUFFER_VIEW vbView = {};
+	D3D12_INDEX_BUFFER_VIEW ibView = {};
+	Mesh::VertexDecode vertexDecode = {};
+	uint32_t textureIndex = 0;
+	bool pipelineValid = false, viewProjectionValid = false, transformValid = false;
+	bool instanceValid = false, materialValid = false, textureValid = false;
+	bool vbValid = false, ibValid = false, vertexDecodeValid = false, textureIndexValid = false;
+
+	for (const SortItem& item : items_) {
+		const DrawCommand& command = commands_[item.index];
+		requestedBindCount += GetBindCount(command);
+
+		if (UpdateState(pipelineState, command.pipelineState, pipelineValid)) {
+			commandList->SetPipelineState(pipelineState);
+			bindCount++;
+		}
+		if (UpdateState(viewProjection, command.viewProjection, viewProjectionValid)) {
+			commandList->SetGraphicsRootConstantBufferView(
+			  rootParameters.viewProjection, viewProjection);
+			bindCount++;
+		}
+		if (command.instanced) {
+			if (UpdateState(instance, command.transform, instanceValid)) {
+				commandList->SetGraphicsRootShaderResourceView(rootParameters.instance, instance);
+				bindCount++;
+			}
+		} else if (UpdateState(transform, command.transform, transformValid)) {
+			commandList->SetGraphicsRootConstantBufferView(
+			  rootParameters.worldTransform, transform);
+			bindCount++;
+		}
+		if (UpdateState(material, command.material, materialValid)) {
+			commandList->SetGraphicsRootConstantBufferView(rootParameters.material, material);
+			bindCount++;
+		}
+		if (UpdateState(texture, command.texture, textureValid)) {
+			commandList->SetGraphicsRootDescriptorTable(rootParameters.texture, texture);
+			bindCount++;
+		}
+		if (
+		  command.bindless && UpdateState(textureIndex, command.textureIndex, textureIndexValid)) {
+			commandList->SetGraphicsRoot32BitConstant(
+			  rootParameters.textureIndex, textureIndex, 0);
+			bindCount++;
+		}
+		if (UpdateState(vbView, command.vbView, vbValid)) {
+			commandList->IASetVertexBuffers(0, 1, &vbView);
+			bindCount++;
+		}
+		if (UpdateState(ibView, command.ibView, ibValid)) {
+			commandList->IASetIndexBuffer(&ibView);
+			bindCount++;
+		}
+		if (command.packed && UpdateState(vertexDecode, command.vertexDecode, vertexDecodeValid)) {
+			commandList->SetGraphicsRoot32BitConstants(
+			  rootParameters.vertexDecode, sizeof(Mesh::VertexDecode) / sizeof(uint32_t),
+			  &vertexDecode, 0);
+			bindCount++;
+		}
+
+		commandList->DrawIndexedInstanced(
+		  command.indexCount, command.instanceCount, command.indexOffset, 0, 0);
+	}
+
+	statistics_.drawCount += static_cast<uint32_t>(commands_.size());
+	statistics_.bindCount += bindCount;
+	statistics_.savedBindCount += requestedBindCount - min(bindCount, requestedBindCount);
+
+	commands_.clear();
+	items_.clear();
+}
@@ -0,0 +1,147 @@
+﻿#pragma once
+
+#include "Mesh.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <vector>
+
+/// <summary>
+/// 3D描画の並べ替えキュー
+/// 描画を64bitのソートキー（パイプライン・マテリアル・テクスチャ・メッシュ・深度）付きで溜め、
+/// 基数ソートしてから、直前と同じ値のバインドを省いてコマンドリストに積む
+/// 半透明の描画は状態で並べるとブレンドの結果が変わるので、不透明の後に奥から順に描く
+/// </summary>
+class RenderQueue {
+  public: // 定数
+	// ソートキーの各項目のビット数（上位から順に優先）
+	static const uint32_t kPipelineBits = 4;
+	static const uint32_t kMaterialBits = 12;
+	static const uint32_t kTextureBits = 12;
+	static const uint32_t kMeshBits = 16;
+	static const uint32_t kDepthBits = 16;
+	// 半透明の描画を示す最上位ビット（不透明のキーは下位60bitに収まる）
+	static const uint64_t kTranslucentBit = 1ull << 63;
+	// 半透明の深度のビット数
+	static const uint32_t kTranslucentDepthBits = 32;
+
+  public: // サブクラス
+	// ルートパラメータ番号
+	struct RootParameters {
+		UINT worldTransform; // ワールド変換行列(CBV)
+		UINT viewProjection; // ビュープロジェクション変換行列(CBV)
+		UINT material;       // マテリアル(CBV)
+		UINT texture;        // テクスチャ(デスクリプタテーブル)
+		UINT textureIndex;   // バインドレス描画のテクスチャ番号(ルート定数)
+		UINT vertexDecode;   // 量子化頂点の復元用定数(ルート定数)
+		UINT instance;       // インスタンスごとのワールド行列(SRV)
+	};
+
+	// 描画コマンド（描画に必要なバインドを全て値で持つ）
+	struct DrawCommand {
+		ID3D12PipelineState* pipelineState;       // パイプラインステート
+		D3D12_GPU_VIRTUAL_ADDRESS viewProjection; // ビュープロジェクションのCBV
+		D3D12_GPU_VIRTUAL_ADDRESS transform;      // ワールド行列のCBV（インスタンスならSRV）
+		D3D12_GPU_VIRTUAL_ADDRESS material;       // マテリアルのCBV
+		D3D12_GPU_DESCRIPTOR_HANDLE texture;      // テクスチャのSRV（バインドレスなら全体の先頭）
+		D3D12_VERTEX_BUFFER_VIEW vbView;          // 頂点バッファビュー
+		D3D12_INDEX_BUFFER_VIEW ibView;           // インデックスバッファビュー
+		Mesh::VertexDecode vertexDecode;          // 量子化頂点の復元用定数
+		uint32_t textureIndex;                    // バインドレス描画のテクスチャ番号
+		bool bindless;                            // バインドレス描画か
+		bool packed;                              // 量子化頂点か
+		bool instanced;                           // インスタンス描画か
+		uint32_t indexCount;                      // インデックス数
+		uint32_t indexOffset;                     // 先頭のインデックス位置
+		uint32_t instanceCount;                   // インスタンス数
+	};
+
+	// 並べ替えの要素
+	struct SortItem {
+		uint64_t key;   // ソートキー
+		uint32_t index; // 描画コマンドの番号
+	};
+
+	// 統計
+	struct Statistics {
+		uint32_t drawCount = 0;      // 描画コマンド数
+		uint32_t bindCount = 0;      // 発行したバインド数
+		uint32_t savedBindCount = 0; // 直前と同じで省いたバインド数
+		double sortSeconds = 0.0;    // ソートにかかった時間
+	};
+
+  public: // 静的メンバ関数
+	/// <summary>
+	/// ソートキーの生成
+	/// パイプライン以外は状態の値をハッシュして詰める（衝突してもまとまりが崩れるだけ）
+	/// </summary>
+	/// <param name="pipeline">パイプラインの番号</param>
+	/// <param name="material">マテリアルのCBVアドレス</param>
+	/// <param name="texture">テクスチャハンドル</param>
+	/// <param name="mesh">頂点バッファのアドレス</param>
+	/// <param name="depth">[0,1]のカメラからの距離（手前から描く）</param>
+	/// <returns>ソートキー</returns>
+	static uint64_t MakeSortKey(
+	  uint32_t pipeline, uint64_t material, uint32_t texture, uint64_t mesh, float depth);
+
+	/// <summary>
+	/// 半透明のソートキーの生成
+	/// 不透明の後に奥から順に並べる（同じ深度は追加した順のまま）
+	/// </summary>
+	/// <param name="depth">[0,1]のカメラからの距離</param>
+	/// <returns>ソートキー</returns>
+	static uint64_t MakeTranslucentSortKey(float depth);
+
+	/// <summary>
+	/// 基数ソート（8bitずつ下位から、全要素で同じ桁は飛ばす、安定）
+	/// </summary>
+	/// <param name="items">並べ替える要素</param>
+	/// <param name="work">作業領域</param>
+	static void RadixSort(std::vector<SortItem>& items, std::vector<SortItem>& work);
+
+	/// <summary>
+	/// 描画1回あたりのバインド数（並べ替えない場合に毎回積むもの）
+	/// </summary>
+	/// <param name="command">描画コマンド</param>
+	/// <returns>バインド数</returns>
+	static uint32_t GetBindCount(const DrawCommand& command);
+
+  public: // メンバ関数
+	/// <summary>
+	/// 描画の追加
+	/// </summary>
+	/// <param name="key">ソートキー</param>
+	/// <param name="command">描画コマンド</param>
+	void Submit(uint64_t key, const DrawCommand& command);
+
+	/// <summary>
+	/// 並べ替えてコマンドリストに積み、キューを空にする
+	/// ルートシグネチャとライトなどの共通の設定は呼び出し側で済ませておく
+	/// </summary>
+	/// <param name="commandList">コマンドリスト</param>
+	/// <param name="rootParameters">ルートパラメータ番号</param>
+	/// <param name="descriptorHeap">テクスチャのデスクリプタヒープ</param>
+	void Flush(
+	  ID3D12GraphicsCommandList* commandList, const RootParameters& rootParameters,
+	  ID3D12DescriptorHeap* descriptorHeap);
+
+	/// <summary>
+	/// 統計のリセット
+	/// </summary>
+	void ResetStatistics() { statistics_ = Statistics(); }
+
+	/// <summary>
+	/// 統計の取得
+	/// </summary>
+	/// <returns>前回のリセット以降の統計</returns>
+	const Statistics& GetStatistics() const { return statistics_; }
+
+  private: // メンバ変数
+	// 描画コマンド
+	std::vector<DrawCommand> commands_;
+	// 並べ替えの要素
+	std::vector<SortItem> items_;
+	// 並べ替えの作業領域
+	std::vector<SortItem> work_;
+	// 統計
+	Statistics statistics_;
+};
@@ -0,0 +1,191 @@
+﻿#include "TransformHierarchy.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace {
+
+// XMFLOAT3が同じ値か（ビット単位で比較）
+inline bool IsSame(const XMFLOAT3& a, const XMFLOAT3& b) {
+	return memcmp(&a, &b, sizeof(XMFLOAT3)) == 0;
+}
+
+} // namespace
+
+void TransformHierarchy::Add(WorldTransform* transform) {
+	assert(transform);
+	if (indices_.count(transform)) {
+		return;
+	}
+	// 親を先に登録する
+	if (transform->parent_) {
+		Add(transform->parent_);
+	}
+	// 削除されていた親が登録し直されたら、外していた子を付け直す
+	for (Node& node : nodes_) {
+		if (node.detached == transform) {
+			node.detached = nullptr;
+		}
+	}
+
+	Node node{};
+	node.transform = transform;
+	node.parent = transform->parent_;
+	node.parentIndex = -1;
+	node.localDirty = true;
+	indices_.emplace(transform, static_cast<uint32_t>(nodes_.size()));
+	nodes_.push_back(node);
+	orderDirty_ = true;
+}
+
+void TransformHierarchy::Remove(WorldTransform* transform) {
+	auto itr = indices_.find(transform);
+	if (itr == indices_.end()) {
+		return;
+	}
+	// 末尾と入れ替えて削除し、順序は次のUpdateで直す
+	uint32_t index = itr->second;
+	indices_.erase(itr);
+	if (index != nodes_.size() - 1) {
+		nodes_[index] = nodes_.back();
+		indices_[nodes_[index].transform] = index;
+	}
+	nodes_.pop_back();
+
+	// 残った子は削除したノードを指さないように階層の中でだけ親から外す
+	// （外した子はルートになる。呼び出し側のparent_はそのまま）
+	for (Node& node : nodes_) {
+		if (node.transform->parent_ == transform) {
+			node.detached = transform;
+		}
+		if (node.parent == transform) {
+			node.parent = nullptr;
+			node.localDirty = true;
+		}
+	}
+	orderDirty_ = true;
+}
+
+void TransformHierarchy::Clear() {
+	nodes_.clear();
+	indices_.clear();
+	worldDirty_.clear();
+	orderDirty_ = false;
+}
+
+void TransformHierarchy::MarkDirty(const WorldTransform* transform) {
+	auto itr = indices_.find(transform);
+	if (itr != indices_.end()) {
+		nodes_[itr->second].localDirty = true;
+	}
+}
+
+void TransformHierarchy::Update() {
+	// 親の付け替えがあれば並べ替える
+	for (Node& node : nodes_) {
+		const WorldTransform* parent = GetParent(node);
+		if (parent != node.parent) {
+			// 未登録の親はSortでルート扱いにする
+			assert(!parent || indices_.count(parent));
+			node.parent = parent;
+			node.localDirty = true;
+			orderDirty_ = true;
+		}
+	}
+	if (orderDirty_) {
+		Sort();
+	}
+
+	statistics_ = Statistics();
+	statistics_.nodeCount = static_cast<uint32_t>(nodes_.size());
+	worldDirty_.assign(nodes_.size(), 0);
+
+	for (size_t i = 0; i < nodes_.size(); i++) {
+		Node& node = nodes_[i];
+		WorldTransform& transform = *node.transform;
+
+		// 前回から値が変わっていればローカル行列を作り直す
+		if (
+		  node.localDirty || !IsSame(node.scale, transform.scale_) ||
+		  !IsSame(node.rotation, transform.rotation_) ||
+		  !IsSame(node.translation, transform.translation_)) {
+			node.scale = transform.scale_;
+			node.rotation = transform.rotation_;
+			node.translation = transform.translation_;
+			// 回転はZ→X→Yの順（UpdateMatrixと同じ）
+			XMMATRIX matLocal =
+			  XMMatrixScaling(node.scale.x, node.scale.y, node.scale.z) *
+			  XMMatrixRotationRollPitchYaw(node.rotation.x, node.rotation.y, node.rotation.z) *
+			  XMMatrixTranslation(node.translation.x, node.translation.y, node.translation.z);
+			XMStoreFloat4x4(&node.matLocal, matLocal);
+			node.localDirty = false;
+			worldDirty_[i] = 1;
+			statistics_.localCount++;
+		}
+
+		// 親のワールド行列が変わっていれば子も更新する
+		if (node.parentIndex >= 0 && worldDirty_[node.parentIndex]) {
+			worldDirty_[i] = 1;
+		}
+		if (!worldDirty_[i]) {
+			continue;
+		}
+
+		transform.matWorld_ = XMLoadFloat4x4(&node.matLocal);
+		if (node.parentIndex >= 0) {
+			transform.matWorld_ *= nodes_[node.parentIndex].transform->matWorld_;
+		}
+		statistics_.updatedCount++;
+	}
+}
+
+const WorldTransform* TransformHierarchy::GetParent(Node& node) {
+	const WorldTransform* parent = node.transform->parent_;
+	if (node.detached) {
+		// 外した後に親が付け替えられていれば解除する
+		if (parent == node.detached) {
+			return nullptr;
+		}
+		node.detached = nullptr;
+	}
+	return parent;
+}
+
+void TransformHierarchy::Sort() {
+	// 深さを求め、浅い順に安定ソートすれば親が子より前に並ぶ
+	// （階層の中での親をたどるので、外した親や未登録の親より先へは進まない）
+	for (Node& node : nodes_) {
+		uint32_t depth = 0;
+		for (const WorldTransform* parent = node.parent; parent;) {
+			auto itr = indices_.find(parent);
+			if (itr == indices_.end()) {
+				break;
+			}
+			depth++;
+			parent = nodes_[itr->second].parent;
+		}
+		node.depth = depth;
+	}
+	std::stable_sort(nodes_.begin(), nodes_.end(), [](const Node& a, const Node& b) {
+		return a.depth < b.depth;
+	});
+
+	// ノード番号を振り直す
+	for (uint32_t i = 0; i < nodes_.size(); i++) {
+		indices_[nodes_[i].transform] = i;
+	}
+	for (Node& node : nodes_) {
+		node.parentIndex = -1;
+		if (node.parent) {
+			auto itr = indices_.find(node.parent);
+			// 未登録の親はルートとして扱う
+			assert(itr != indices_.end());
+			if (itr != indices_.end()) {
+				node.parentIndex = static_cast<int32_t>(itr->second);
+			}
+		}
+	}
+	orderDirty_ = false;
+}
@@ -0,0 +1,98 @@
+﻿#pragma once
+
+#include "WorldTransform.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// ワールドトランスフォームの親子階層
+/// 親が子より前に並ぶ順に保持し、スケール・回転・平行移動が変わったノードと
+/// その子孫だけのワールド行列を再計算する
+/// </summary>
+class TransformHierarchy {
+  public: // サブクラス
+	// 更新の統計
+	struct Statistics {
+		uint32_t nodeCount = 0;    // ノード数
+		uint32_t localCount = 0;   // ローカル行列を再計算したノード数
+		uint32_t updatedCount = 0; // ワールド行列を更新したノード数
+	};
+
+  public: // メンバ関数
+	/// <summary>
+	/// ノードの追加（親が未登録なら先に親を追加する）
+	/// </summary>
+	/// <param name="transform">ワールドトランスフォーム</param>
+	void Add(WorldTransform* transform);
+
+	/// <summary>
+	/// ノードの削除（子はこの階層の中でだけ親から外してルートにする。
+	/// 子のparent_は書き換えず、子のワールド行列は次のUpdateで作り直す）
+	/// </summary>
+	/// <param name="transform">ワールドトランスフォーム</param>
+	void Remove(WorldTransform* transform);
+
+	/// <summary>
+	/// 全ノードの削除
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// 強制的に再計算させる（次のUpdateで子孫も含めて更新）
+	/// </summary>
+	/// <param name="transform">ワールドトランスフォーム</param>
+	void MarkDirty(const WorldTransform* transform);
+
+	/// <summary>
+	/// 変更のあったノードと子孫の行列を更新する
+	/// </summary>
+	void Update();
+
+	/// <summary>
+	/// 前回のUpdateの統計を取得
+	/// </summary>
+	/// <returns>統計</returns>
+	const Statistics& GetStatistics() const { return statistics_; }
+
+  private: // サブクラス
+	// ノード
+	struct Node {
+		WorldTransform* transform;       // ワールドトランスフォーム
+		const WorldTransform* parent;    // 並べ替え時点の親
+		const WorldTransform* detached;  // 削除済みのため無視する親（parent_が変われば解除）
+		int32_t parentIndex;             // 親のノード番号（なければ-1）
+		uint32_t depth;                  // 階層の深さ
+		bool localDirty;                 // ローカル行列の再計算が必要か
+		DirectX::XMFLOAT3 scale;         // 前回計算時のスケール
+		DirectX::XMFLOAT3 rotation;      // 前回計算時の回転角
+		DirectX::XMFLOAT3 translation;   // 前回計算時の平行移動
+		DirectX::XMFLOAT4X4 matLocal;    // ローカル行列
+	};
+
+  private: // メンバ関数
+	/// <summary>
+	/// 階層の中での親を取得（削除済みの親から外したノードはルート）
+	/// </summary>
+	/// <param name="node">ノード</param>
+	/// <returns>親</returns>
+	static const WorldTransform* GetParent(Node& node);
+
+	/// <summary>
+	/// 親が子より前に並ぶように並べ替える
+	/// </summary>
+	void Sort();
+
+  private: // メンバ変数
+	// ノード（Sort後は親が子より前）
+	std::vector<Node> nodes_;
+	// ワールドトランスフォームからノード番号を引く
+	std::unordered_map<const WorldTransform*, uint32_t> indices_;
+	// 今回のUpdateでワールド行列が変わったか（ノード番号順）
+	std::vector<uint8_t> worldDirty_;
+	// 並べ替えが必要か
+	bool orderDirty_ = false;
+	// 統計
+	Statistics statistics_;
+};
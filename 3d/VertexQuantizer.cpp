@@ -0,0 +1,172 @@
+﻿#include "VertexQuantizer.h"
+#include <DirectXPackedVector.h>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace {
+
+// 法線の許容誤差（復元した法線と元の法線の内積の下限、約0.1度）
+const float kNormalErrorCos = 0.9999985f;
+
+// [0,1]を16bit UNORMへ
+inline uint16_t ToUnorm16(float value) {
+	value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	return static_cast<uint16_t>(value * 65535.0f + 0.5f);
+}
+
+// [-1,1]を16bit SNORMへ
+inline int16_t ToSnorm16(float value) {
+	value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+	return static_cast<int16_t>(std::lround(value * 32767.0f));
+}
+
+// 16bit SNORMを[-1,1]へ（D3Dの変換規則と同じく-32768は-1）
+inline float FromSnorm16(int16_t value) {
+	float result = value / 32767.0f;
+	return result < -1.0f ? -1.0f : result;
+}
+
+// 符号（0は正として扱う）
+inline float SignNotZero(float value) { return value >= 0.0f ? 1.0f : -1.0f; }
+
+// AABBの1軸を量子化する拡大率
+inline float GetExtent(float min, float max) { return max > min ? max - min : 0.0f; }
+
+} // namespace
+
+VertexQuantizer::PackedVertex VertexQuantizer::Encode(
+  const XMFLOAT3& pos, const XMFLOAT3& normal, const XMFLOAT2& uv, const XMFLOAT3& aabbMin,
+  const XMFLOAT3& aabbMax) {
+	PackedVertex vertex{};
+
+	// 座標はAABB内の相対位置
+	const float extent[3] = {
+	  GetExtent(aabbMin.x, aabbMax.x), GetExtent(aabbMin.y, aabbMax.y),
+	  GetExtent(aabbMin.z, aabbMax.z)};
+	const float p[3] = {pos.x - aabbMin.x, pos.y - aabbMin.y, pos.z - aabbMin.z};
+	for (int i = 0; i < 3; i++) {
+		vertex.pos[i] = extent[i] > 0.0f ? ToUnorm16(p[i] / extent[i]) : 0;
+	}
+	vertex.pos[3] = 0;
+
+	EncodeOctahedral(normal, vertex.normal);
+
+	vertex.uv[0] = PackedVector::XMConvertFloatToHalf(uv.x);
+	vertex.uv[1] = PackedVector::XMConvertFloatToHalf(uv.y);
+	return vertex;
+}
+
+void VertexQuantizer::Decode(
+  const PackedVertex& vertex, const XMFLOAT3& aabbMin, const XMFLOAT3& aabbMax, XMFLOAT3& pos,
+  XMFLOAT3& normal, XMFLOAT2& uv) {
+	pos.x = aabbMin.x + vertex.pos[0] / 65535.0f * GetExtent(aabbMin.x, aabbMax.x);
+	pos.y = aabbMin.y + vertex.pos[1] / 65535.0f * GetExtent(aabbMin.y, aabbMax.y);
+	pos.z = aabbMin.z + vertex.pos[2] / 65535.0f * GetExtent(aabbMin.z, aabbMax.z);
+
+	normal = DecodeOctahedral(vertex.normal);
+
+	uv.x = PackedVector::XMConvertHalfToFloat(vertex.uv[0]);
+	uv.y = PackedVector::XMConvertHalfToFloat(vertex.uv[1]);
+}
+
+bool VertexQuantizer::IsWithinErrorBounds(
+  const XMFLOAT3& pos, const XMFLOAT3& normal, const XMFLOAT2& uv, const PackedVertex& vertex,
+  const XMFLOAT3& aabbMin, const XMFLOAT3& aabbMax) {
+	XMFLOAT3 decodedPos, decodedNormal;
+	XMFLOAT2 decodedUv;
+	Decode(vertex, aabbMin, aabbMax, decodedPos, decodedNormal, decodedUv);
+
+	// 座標：量子化幅の半分＋浮動小数点の丸め
+	const float original[3] = {pos.x, pos.y, pos.z};
+	const float decoded[3] = {decodedPos.x, decodedPos.y, decodedPos.z};
+	const float extent[3] = {
+	  GetExtent(aabbMin.x, aabbMax.x), GetExtent(aabbMin.y, aabbMax.y),
+	  GetExtent(aabbMin.z, aabbMax.z)};
+	const float base[3] = {aabbMin.x, aabbMin.y, aabbMin.z};
+	for (int i = 0; i < 3; i++) {
+		float bound = extent[i] / 65535.0f * 0.5f +
+		              (std::fabs(base[i]) + extent[i]) * 4.0f * FLT_EPSILON;
+		if (std::fabs(decoded[i] - original[i]) > bound) {
+			return false;
+		}
+	}
+
+	// 法線：元の法線を正規化して角度で比較
+	float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+	if (length > 0.0f) {
+		float cos = (normal.x * decodedNormal.x + normal.y * decodedNormal.y +
+		             normal.z * decodedNormal.z) /
+		            length;
+		if (cos < kNormalErrorCos) {
+			return false;
+		}
+	}
+
+	// UV：半精度の仮数部は10bitなので相対誤差2^-11（非正規化数は2^-25）
+	const float originalUv[2] = {uv.x, uv.y};
+	const float decodedUvs[2] = {decodedUv.x, decodedUv.y};
+	for (int i = 0; i < 2; i++) {
+		float bound = std::fabs(originalUv[i]) * (1.0f / 2048.0f) + (1.0f / 33554432.0f);
+		if (std::fabs(decodedUvs[i] - originalUv[i]) > bound) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void VertexQuantizer::EncodeOctahedral(const XMFLOAT3& normal, int16_t encoded[2]) {
+	float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	if (sum <= 0.0f) {
+		// 長さ0の法線は+Zとして扱う
+		encoded[0] = encoded[1] = 0;
+		return;
+	}
+
+	// 八面体へ投影し、下半分は折り返す
+	float x = normal.x / sum;
+	float y = normal.y / sum;
+	if (normal.z < 0.0f) {
+		float ox = (1.0f - std::fabs(y)) * SignNotZero(x);
+		float oy = (1.0f - std::fabs(x)) * SignNotZero(y);
+		x = ox;
+		y = oy;
+	}
+
+	// 丸め方向の組み合わせから誤差の最も小さいものを選ぶ
+	float bestCos = -2.0f;
+	float lengthSq = normal.x * normal.x + normal.y * normal.y + normal.z * normal.z;
+	float invLength = 1.0f / std::sqrt(lengthSq);
+	int16_t base[2] = {
+	  static_cast<int16_t>(std::floor(x * 32767.0f)),
+	  static_cast<int16_t>(std::floor(y * 32767.0f))};
+	for (int dy = 0; dy <= 1; dy++) {
+		for (int dx = 0; dx <= 1; dx++) {
+			int16_t candidate[2] = {
+			  ToSnorm16((base[0] + dx) / 32767.0f), ToSnorm16((base[1] + dy) / 32767.0f)};
+			XMFLOAT3 decoded = DecodeOctahedral(candidate);
+			float cos = (normal.x * decoded.x + normal.y * decoded.y + normal.z * decoded.z) *
+			            invLength;
+			if (cos > bestCos) {
+				bestCos = cos;
+				encoded[0] = candidate[0];
+				encoded[1] = candidate[1];
+			}
+		}
+	}
+}
+
+XMFLOAT3 VertexQuantizer::DecodeOctahedral(const int16_t encoded[2]) {
+	float x = FromSnorm16(encoded[0]);
+	float y = FromSnorm16(encoded[1]);
+	float z = 1.0f - std::fabs(x) - std::fabs(y);
+	// 下半分の折り返しを戻す
+	float t = z < 0.0f ? -z : 0.0f;
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	float length = std::sqrt(x * x + y * y + z * z);
+	return XMFLOAT3(x / length, y / length, z / length);
+}
+
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+
+/// <summary>
+/// 頂点の量子化
+/// 座標はAABB基準の16bit UNORM、法線は八面体エンコードの16bit SNORM、UVは半精度浮動小数点
+/// GPUに依存しないので、CPUだけで結果を検証できる（tests/VertexQuantizerTest）
+/// </summary>
+class VertexQuantizer {
+  public: // サブクラス
+	// 量子化済み頂点（16バイト）
+	struct PackedVertex {
+		uint16_t pos[4];   // xyz座標(R16G16B16A16_UNORM、wは未使用)
+		int16_t normal[2]; // 八面体エンコードした法線(R16G16_SNORM)
+		uint16_t uv[2];    // uv座標(R16G16_FLOAT)
+	};
+
+  public: // 静的メンバ関数
+	/// <summary>
+	/// 量子化
+	/// </summary>
+	/// <param name="pos">座標</param>
+	/// <param name="normal">法線ベクトル</param>
+	/// <param name="uv">uv座標</param>
+	/// <param name="aabbMin">メッシュのAABBの最小座標</param>
+	/// <param name="aabbMax">メッシュのAABBの最大座標</param>
+	/// <returns>量子化済み頂点</returns>
+	static PackedVertex Encode(
+	  const DirectX::XMFLOAT3& pos, const DirectX::XMFLOAT3& normal, const DirectX::XMFLOAT2& uv,
+	  const DirectX::XMFLOAT3& aabbMin, const DirectX::XMFLOAT3& aabbMax);
+
+	/// <summary>
+	/// 復元（頂点シェーダーと同じ計算）
+	/// </summary>
+	/// <param name="vertex">量子化済み頂点</param>
+	/// <param name="aabbMin">メッシュのAABBの最小座標</param>
+	/// <param name="aabbMax">メッシュのAABBの最大座標</param>
+	/// <param name="pos">座標</param>
+	/// <param name="normal">法線ベクトル</param>
+	/// <param name="uv">uv座標</param>
+	static void Decode(
+	  const PackedVertex& vertex, const DirectX::XMFLOAT3& aabbMin,
+	  const DirectX::XMFLOAT3& aabbMax, DirectX::XMFLOAT3& pos, DirectX::XMFLOAT3& normal,
+	  DirectX::XMFLOAT2& uv);
+
+	/// <summary>
+	/// 復元結果が量子化の誤差範囲に収まっているか
+	/// 座標は量子化幅の半分、法線は約0.1度、UVは半精度の丸め誤差まで
+	/// </summary>
+	/// <param name="pos">元の座標</param>
+	/// <param name="normal">元の法線ベクトル</param>
+	/// <param name="uv">元のuv座標</param>
+	/// <param name="vertex">量子化済み頂点</param>
+	/// <param name="aabbMin">メッシュのAABBの最小座標</param>
+	/// <param name="aabbMax">メッシュのAABBの最大座標</param>
+	/// <returns>誤差範囲に収まっているか</returns>
+	static bool IsWithinErrorBounds(
+	  const DirectX::XMFLOAT3& pos, const DirectX::XMFLOAT3& normal, const DirectX::XMFLOAT2& uv,
+	  const PackedVertex& vertex, const DirectX::XMFLOAT3& aabbMin,
+	  const DirectX::XMFLOAT3& aabbMax);
+
+	/// <summary>
+	/// 八面体エンコード
+	/// </summary>
+	/// <param name="normal">法線ベクトル</param>
+	/// <param name="encoded">エンコード結果(SNORM)</param>
+	static void EncodeOctahedral(const DirectX::XMFLOAT3& normal, int16_t encoded[2]);
+
+	/// <summary>
+	/// 八面体エンコードの復元
+	/// </summary>
+	/// <param name="encoded">エンコード結果(SNORM)</param>
+	/// <returns>正規化された法線ベクトル</returns>
+	static DirectX::XMFLOAT3 DecodeOctahedral(const int16_t encoded[2]);
+};
@@ -1,8 +1,9 @@
 ﻿#pragma once
 
+#include "ConstantBufferRing.h"
+#include "Frustum.h"
 #include <DirectXMath.h>
 #include <d3d12.h>
-#include <wrl.h>
 
 // 定数バッファ用データ構造体
 struct ConstBufferDataViewProjection {
@@ -15,11 +16,6 @@ struct ConstBufferDataViewProjection {
 /// ビュープロジェクション変換データ
 /// </summary>
 struct ViewProjection {
-	// 定数バッファ
-	Microsoft::WRL::ComPtr<ID3D12Resource> constBuff_;
-	// マッピング済みアドレス
-	ConstBufferDataViewProjection* constMap = nullptr;
-
 #pragma region ビュー行列の設定
 	// 視点座標
 	DirectX::XMFLOAT3 eye = {0, 0, -50.0f};
@@ -44,21 +40,22 @@ struct ViewProjection {
 	DirectX::XMMATRIX matView;
 	// 射影行列
 	DirectX::XMMATRIX matProjection;
+	// 視錐台（カリング用）
+	Frustum frustum;
+	// 今のフレームで転送済みの定数バッファ
+	mutable ConstantBufferRing::FrameCache constBufferCache_;
 
 	/// <summary>
 	/// 初期化
 	/// </summary>
 	void Initialize();
 	/// <summary>
-	/// 定数バッファ生成
-	/// </summary>
-	void CreateConstBuffer();
-	/// <summary>
-	/// マッピングする
-	/// </summary>
-	void Map();
-	/// <summary>
 	/// 行列を更新する
 	/// </summary>
 	void UpdateMatrix();
+	/// <summary>
+	/// 行列を今のフレームの定数バッファに転送する（同じフレーム内では1回だけ）
+	/// </summary>
+	/// <returns>定数バッファのGPUアドレス</returns>
+	D3D12_GPU_VIRTUAL_ADDRESS TransferMatrix() const;
 };
@@ -1,37 +1,24 @@
-﻿#include "DirectXCommon.h"
+﻿#include "ConstantBufferRing.h"
 #include "WorldTransform.h"
-#include <cassert>
-#include <d3dx12.h>
+#include <algorithm>
 
 using namespace DirectX;
 
-void WorldTransform::Initialize() {
-	CreateConstBuffer();
-	Map();
-	UpdateMatrix();
-}
+namespace {
 
-void WorldTransform::CreateConstBuffer() {
-	HRESULT result;
-
-	// ヒーププロパティ
-	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	// リソース設定
-	CD3DX12_RESOURCE_DESC resourceDesc =
-	  CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferDataWorldTransform) + 0xff) & ~0xff);
-
-	// 定数バッファの生成
-	result = DirectXCommon::GetInstance()->GetDevice()->CreateCommittedResource(
-	  &heapProps, // アップロード可能
-	  D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-	  IID_PPV_ARGS(&constBuff_));
-	assert(SUCCEEDED(result));
+// 4個分のXMFLOAT3をSoA(x,y,z)に転置
+inline void LoadSoA(const XMFLOAT3* const* v, XMVECTOR& x, XMVECTOR& y, XMVECTOR& z) {
+	XMMATRIX m = XMMatrixTranspose(
+	  XMMATRIX(XMLoadFloat3(v[0]), XMLoadFloat3(v[1]), XMLoadFloat3(v[2]), XMLoadFloat3(v[3])));
+	x = m.r[0];
+	y = m.r[1];
+	z = m.r[2];
 }
 
-void WorldTransform::Map() {
-	// 定数バッファとのデータリンク
-	HRESULT result = constBuff_->Map(0, nullptr, (void**)&constMap);
-	assert(SUCCEEDED(result));
+} // namespace
+
+void WorldTransform::Initialize() {
+	UpdateMatrix();
 }
 
 void WorldTransform::UpdateMatrix() {
@@ -55,7 +42,75 @@ void WorldTransform::UpdateMatrix() {
 	if (parent_) {
 		matWorld_ *= parent_->matWorld_;
 	}
+}
 
+D3D12_GPU_VIRTUAL_ADDRESS WorldTransform::TransferMatrix() const {
 	// 定数バッファに書き込み
-	constMap->matWorld = matWorld_;
+	ConstantBufferRing::Allocation allocation =
+	  ConstantBufferRing::GetInstance()->Allocate(sizeof(ConstBufferDataWorldTransform));
+	static_cast<ConstBufferDataWorldTransform*>(allocation.cpuAddress)->matWorld = matWorld_;
+	return allocation.gpuAddress;
+}
+
+void WorldTransform::UpdateMatrices(WorldTransform* transforms, size_t count) {
+	for (size_t base = 0; base < count; base += 4) {
+		// 4個に満たない端数は最後の要素で埋める
+		WorldTransform* lanes[4];
+		for (size_t j = 0; j < 4; j++) {
+			lanes[j] = &transforms[std::min(base + j, count - 1)];
+		}
+
+		// スケール、回転角、平行移動をSoAで読み込む
+		XMVECTOR sx, sy, sz, rx, ry, rz, tx, ty, tz;
+		const XMFLOAT3* scales[4] = {
+		  &lanes[0]->scale_, &lanes[1]->scale_, &lanes[2]->scale_, &lanes[3]->scale_};
+		const XMFLOAT3* rotations[4] = {
+		  &lanes[0]->rotation_, &lanes[1]->rotation_, &lanes[2]->rotation_, &lanes[3]->rotation_};
+		const XMFLOAT3* translations[4] = {
+		  &lanes[0]->translation_, &lanes[1]->translation_, &lanes[2]->translation_,
+		  &lanes[3]->translation_};
+		LoadSoA(scales, sx, sy, sz);
+		LoadSoA(rotations, rx, ry, rz);
+		LoadSoA(translations, tx, ty, tz);
+
+		XMVECTOR sinX, cosX, sinY, cosY, sinZ, cosZ;
+		XMVectorSinCos(&sinX, &cosX, rx);
+		XMVectorSinCos(&sinY, &cosY, ry);
+		XMVectorSinCos(&sinZ, &cosZ, rz);
+
+		// Rz*Rx*Ryを展開した回転行列の各行にスケールを掛ける
+		XMVECTOR sxsy = XMVectorMultiply(sinX, sinY);
+		XMVECTOR sxcy = XMVectorMultiply(sinX, cosY);
+		XMVECTOR m00 =
+		  XMVectorMultiply(sx, XMVectorMultiplyAdd(sinZ, sxsy, XMVectorMultiply(cosZ, cosY)));
+		XMVECTOR m01 = XMVectorMultiply(sx, XMVectorMultiply(sinZ, cosX));
+		XMVECTOR m02 = XMVectorMultiply(
+		  sx, XMVectorNegativeMultiplySubtract(cosZ, sinY, XMVectorMultiply(sinZ, sxcy)));
+		XMVECTOR m10 = XMVectorMultiply(
+		  sy, XMVectorNegativeMultiplySubtract(sinZ, cosY, XMVectorMultiply(cosZ, sxsy)));
+		XMVECTOR m11 = XMVectorMultiply(sy, XMVectorMultiply(cosZ, cosX));
+		XMVECTOR m12 =
+		  XMVectorMultiply(sy, XMVectorMultiplyAdd(sinZ, sinY, XMVectorMultiply(cosZ, sxcy)));
+		XMVECTOR m20 = XMVectorMultiply(sz, XMVectorMultiply(cosX, sinY));
+		XMVECTOR m21 = XMVectorMultiply(sz, XMVectorNegate(sinX));
+		XMVECTOR m22 = XMVectorMultiply(sz, XMVectorMultiply(cosX, cosY));
+
+		// レーンごとの行列に転置し直す
+		const XMVECTOR zero = XMVectorZero();
+		XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(m00, m01, m02, zero));
+		XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(m10, m11, m12, zero));
+		XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(m20, m21, m22, zero));
+		XMMATRIX row3 = XMMatrixTranspose(XMMATRIX(tx, ty, tz, XMVectorSplatOne()));
+
+		const size_t laneCount = std::min<size_t>(4, count - base);
+		for (size_t j = 0; j < laneCount; j++) {
+			WorldTransform& transform = *lanes[j];
+			transform.matWorld_ = XMMATRIX(row0.r[j], row1.r[j], row2.r[j], row3.r[j]);
+
+			// 親行列の指定がある場合は、掛け算する
+			if (transform.parent_) {
+				transform.matWorld_ *= transform.parent_->matWorld_;
+			}
+		}
+	}
 }
@@ -1,8 +1,8 @@
 ﻿#pragma once
 
 #include <DirectXMath.h>
+#include <cstdint>
 #include <d3d12.h>
-#include <wrl.h>
 
 // 定数バッファ用データ構造体
 struct ConstBufferDataWorldTransform {
@@ -13,10 +13,6 @@ struct ConstBufferDataWorldTransform {
 /// ワールド変換データ
 /// </summary>
 struct WorldTransform {
-	// 定数バッファ
-	Microsoft::WRL::ComPtr<ID3D12Resource> constBuff_;
-	// マッピング済みアドレス
-	ConstBufferDataWorldTransform* constMap = nullptr;
 	// ローカルスケール
 	DirectX::XMFLOAT3 scale_ = {1, 1, 1};
 	// X,Y,Z軸回りのローカル回転角
@@ -27,21 +23,29 @@ struct WorldTransform {
 	DirectX::XMMATRIX matWorld_;
 	// 親となるワールド変換へのポインタ
 	WorldTransform* parent_ = nullptr;
+	// 前回描画したときのLOD番号（切り替えのヒステリシス用、描画側が更新する）
+	mutable uint32_t lodLevel_ = 0;
 
 	/// <summary>
 	/// 初期化
 	/// </summary>
 	void Initialize();
 	/// <summary>
-	/// 定数バッファ生成
+	/// 行列を更新する
 	/// </summary>
-	void CreateConstBuffer();
+	void UpdateMatrix();
 	/// <summary>
-	/// マッピングする
+	/// 行列を今のフレームの定数バッファに転送する
 	/// </summary>
-	void Map();
+	/// <returns>定数バッファのGPUアドレス</returns>
+	D3D12_GPU_VIRTUAL_ADDRESS TransferMatrix() const;
+
 	/// <summary>
-	/// 行列を更新する
+	/// 配列の行列をまとめて更新する
+	/// 4個ずつSIMDの各レーンに割り当て、S*Rz*Rx*Ry*Tを行列の積なしで直接組み立てる
+	/// 親は配列の前方にあるか、更新済みであること
 	/// </summary>
-	void UpdateMatrix();
+	/// <param name="transforms">ワールドトランスフォームの配列</param>
+	/// <param name="count">要素数</param>
+	static void UpdateMatrices(WorldTransform* transforms, size_t count);
 };
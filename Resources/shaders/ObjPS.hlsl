@@ -1,12 +1,23 @@
 #include "Obj.hlsli"
 
+#ifdef BINDLESS
+Texture2D<float4> textures[] : register(t0, space1); // 全テクスチャ（デスクリプタヒープ全体）
+cbuffer TextureIndex : register(b5) {
+	uint textureIndex; // 描画するテクスチャの番号
+};
+#else
 Texture2D<float4> tex : register(t0);  // 0番スロットに設定されたテクスチャ
+#endif
 SamplerState smp : register(s0);      // 0番スロットに設定されたサンプラー
 
 float4 main(VSOutput input) : SV_TARGET
 {
 	// テクスチャマッピング
+#ifdef BINDLESS
+	float4 texcolor = textures[textureIndex].Sample(smp, input.uv);
+#else
 	float4 texcolor = tex.Sample(smp, input.uv);
+#endif
 		
 	// 光沢度
 	const float shininess = 4.0f;
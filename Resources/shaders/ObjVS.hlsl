@@ -1,14 +1,51 @@
 #include "Obj.hlsli"
 
-VSOutput main(float4 pos : POSITION, float3 normal : NORMAL, float2 uv : TEXCOORD)
+#ifdef INSTANCED
+struct InstanceData {
+	column_major matrix world; // ワールド行列（定数バッファと同じ並び）
+};
+StructuredBuffer<InstanceData> instances : register(t1);
+#endif
+
+#ifdef PACKED_VERTEX
+cbuffer VertexDecode : register(b4) {
+	float4 positionScale;  // 拡大率（AABBの大きさ）
+	float4 positionOffset; // オフセット（AABBの最小座標）
+};
+
+// 八面体エンコードした法線の復元
+float3 DecodeOctahedral(float2 e)
+{
+	float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += (n.xy >= 0.0f) ? -t : t;
+	return normalize(n);
+}
+
+VSOutput main(
+	float4 packedPos : POSITION, float2 packedNormal : NORMAL, float2 uv : TEXCOORD,
+	uint instanceId : SV_InstanceID)
+{
+	float4 pos = float4(packedPos.xyz * positionScale.xyz + positionOffset.xyz, 1.0f);
+	float3 normal = DecodeOctahedral(packedNormal);
+#else
+VSOutput main(
+	float4 pos : POSITION, float3 normal : NORMAL, float2 uv : TEXCOORD,
+	uint instanceId : SV_InstanceID)
 {
+#endif
+#ifdef INSTANCED
+	matrix worldMatrix = instances[instanceId].world;
+#else
+	matrix worldMatrix = world;
+#endif
 	// 法線にワールド行列によるスケーリング・回転を適用
 	// ※スケーリングが一様な場合のみ正しい
-	float4 worldNormal = normalize(mul(world, float4(normal, 0)));
-	float4 worldPos = mul(world, pos);
+	float4 worldNormal = normalize(mul(worldMatrix, float4(normal, 0)));
+	float4 worldPos = mul(worldMatrix, pos);
 
 	VSOutput output; // ピクセルシェーダーに渡す値
-	output.svpos = mul(mul(mul(projection, view), world), pos);
+	output.svpos = mul(mul(mul(projection, view), worldMatrix), pos);
 
 	output.worldpos = worldPos;
 	output.normal = worldNormal.xyz;
@@ -1,6 +1,19 @@
 #include "Sprite.hlsli"
 
+#ifdef BINDLESS
+Texture2D<float4> textures[] : register(t0, space1); // 全テクスチャ（デスクリプタヒープ全体）
+cbuffer TextureIndex : register(b1) {
+	uint textureIndex; // 描画するテクスチャの番号
+};
+#else
 Texture2D<float4> tex : register(t0); // 0番スロットに設定されたテクスチャ
+#endif
 SamplerState smp : register(s0);      // 0番スロットに設定されたサンプラー
 
-float4 main(VSOutput input) : SV_TARGET { return tex.Sample(smp, input.uv) * color; }
\ No newline at end of file
+float4 main(VSOutput input) : SV_TARGET {
+#ifdef BINDLESS
+	return textures[textureIndex].Sample(smp, input.uv) * color;
+#else
+	return tex.Sample(smp, input.uv) * color;
+#endif
+}
\ No newline at end of file
@@ -47,16 +47,19 @@ void Audio::Finalize() {
 }
 
 uint32_t Audio::LoadWave(const std::string& fileName) {
-	assert(indexSoundData_ < kMaxSoundData);
-	uint32_t handle = indexSoundData_;
 	// 読み込み済みサウンドデータを検索
-	auto it = std::find_if(soundDatas_.begin(), soundDatas_.end(), [&](const auto& soundData) {
-		return soundData.name_ == fileName;
-	});
-	if (it != soundDatas_.end()) {
-		// 読み込み済みサウンドデータの要素番号を取得
-		handle = static_cast<uint32_t>(std::distance(soundDatas_.begin(), it));
-		return handle;
+	auto findLoaded = [&]() {
+		return std::find_if(soundDatas_.begin(), soundDatas_.end(), [&](const auto& soundData) {
+			return soundData.name_ == fileName;
+		});
+	};
+	{
+		std::lock_guard<std::mutex> lock(soundDataMutex_);
+		auto it = findLoaded();
+		if (it != soundDatas_.end()) {
+			// 読み込み済みサウンドデータの要素番号を取得
+			return static_cast<uint32_t>(std::distance(soundDatas_.begin(), it));
+		}
 	}
 
 	// ディレクトリパスとファイル名を連結してフルパスを得る
@@ -117,6 +120,17 @@ uint32_t Audio::LoadWave(const std::string& fileName) {
 	// Waveファイルを閉じる
 	file.close();
 
+	// ファイルの読み込み中に他のスレッドが同じファイルを読み込んでいたらそちらを使う
+	std::lock_guard<std::mutex> lock(soundDataMutex_);
+	auto it = findLoaded();
+	if (it != soundDatas_.end()) {
+		delete[] pBuffer;
+		return static_cast<uint32_t>(std::distance(soundDatas_.begin(), it));
+	}
+
+	assert(indexSoundData_ < kMaxSoundData);
+	uint32_t handle = indexSoundData_;
+
 	// 書き込むサウンドデータの参照
 	SoundData& soundData = soundDatas_.at(handle);
 
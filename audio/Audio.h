@@ -2,6 +2,7 @@
 
 #include <array>
 #include <cstdint>
+#include <mutex>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -86,7 +87,7 @@ class Audio {
 	void Finalize();
 
 	/// <summary>
-	/// WAV音声読み込み
+	/// WAV音声読み込み（ワーカースレッドから呼べる）
 	/// </summary>
 	/// <param name="filename">WAVファイル名</param>
 	/// <returns>サウンドデータハンドル</returns>
@@ -146,6 +147,8 @@ class Audio {
 	std::string directoryPath_;
 	// 次に使うサウンドデータの番号
 	uint32_t indexSoundData_ = 0u;
+	// サウンドデータの排他制御
+	std::mutex soundDataMutex_;
 	// 次に使う再生中データの番号
 	uint32_t indexVoice_ = 0u;
 	// オーディオコールバック
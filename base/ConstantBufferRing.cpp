@@ -0,0 +1,130 @@
+﻿#include "ConstantBufferRing.h"
+#include <Windows.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <d3dx12.h>
+
+namespace {
+
+// 定数バッファの配置単位に切り上げる
+inline uint64_t AlignConstantBuffer(uint64_t size) {
+	return (size + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) &
+	       ~static_cast<uint64_t>(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+}
+
+} // namespace
+
+ConstantBufferRing* ConstantBufferRing::GetInstance() {
+	static ConstantBufferRing instance;
+	return &instance;
+}
+
+void ConstantBufferRing::Initialize(ID3D12Device* device, size_t size) {
+	assert(device);
+	HRESULT result;
+	device_ = device;
+
+	// ヒーププロパティ
+	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	// リソース設定
+	CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(AlignConstantBuffer(size));
+
+	// アップロードバッファの生成
+	result = device->CreateCommittedResource(
+	  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+	  IID_PPV_ARGS(&buffer_));
+	assert(SUCCEEDED(result));
+
+	// 常時マップしておく
+	result = buffer_->Map(0, nullptr, reinterpret_cast<void**>(&map_));
+	assert(SUCCEEDED(result));
+	gpuAddress_ = buffer_->GetGPUVirtualAddress();
+
+	allocator_.Initialize(resourceDesc.Width);
+	frameCount_ = 0;
+}
+
+ConstantBufferRing::Allocation ConstantBufferRing::Allocate(size_t size) {
+	uint64_t offset = allocator_.Allocate(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+	if (offset == RingAllocator::kInvalidOffset) {
+		// リングが一杯なら追加のバッファから割り当てる
+		return AllocateOverflow(size);
+	}
+	return {map_ + offset, gpuAddress_ + offset};
+}
+
+void* ConstantBufferRing::Allocate(size_t size, FrameCache& cache) {
+	if (cache.frame == frameCount_) {
+		return nullptr;
+	}
+	Allocation allocation = Allocate(size);
+	cache.frame = frameCount_;
+	cache.gpuAddress = allocation.gpuAddress;
+	return allocation.cpuAddress;
+}
+
+void ConstantBufferRing::FinishFrame(uint64_t fenceValue) {
+	allocator_.FinishFrame(fenceValue);
+	frameCount_++;
+
+	// 追加のバッファはこのフレームの完了まで残す
+	for (OverflowBuffer& buffer : overflowBuffers_) {
+		buffer.fenceValue = fenceValue;
+		pendingOverflowBuffers_.push_back(std::move(buffer));
+	}
+	overflowBuffers_.clear();
+}
+
+void ConstantBufferRing::Release(uint64_t completedFenceValue) {
+	allocator_.Release(completedFenceValue);
+
+	// 完了した追加のバッファは次に一杯になったときに使い回す
+	while (!pendingOverflowBuffers_.empty() &&
+	       pendingOverflowBuffers_.front().fenceValue <= completedFenceValue) {
+		OverflowBuffer& buffer = pendingOverflowBuffers_.front();
+		buffer.usedSize = 0;
+		freeOverflowBuffers_.push_back(std::move(buffer));
+		pendingOverflowBuffers_.pop_front();
+	}
+}
+
+ConstantBufferRing::Allocation ConstantBufferRing::AllocateOverflow(size_t size) {
+	const uint64_t alignedSize = AlignConstantBuffer(size);
+	if (overflowBuffers_.empty() ||
+	    overflowBuffers_.back().usedSize + alignedSize > overflowBuffers_.back().size) {
+		// 使い回せるバッファがなければ、リングと同じ大きさのバッファを作ってつなぐ
+		OverflowBuffer buffer{};
+		auto itr = std::find_if(
+		  freeOverflowBuffers_.begin(), freeOverflowBuffers_.end(),
+		  [alignedSize](const OverflowBuffer& candidate) { return candidate.size >= alignedSize; });
+		if (itr != freeOverflowBuffers_.end()) {
+			buffer = std::move(*itr);
+			freeOverflowBuffers_.erase(itr);
+		} else {
+			buffer.size = std::max<uint64_t>(allocator_.GetSize(), alignedSize);
+			CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+			CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(buffer.size);
+			HRESULT result = device_->CreateCommittedResource(
+			  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ,
+			  nullptr, IID_PPV_ARGS(&buffer.resource));
+			assert(SUCCEEDED(result));
+			result = buffer.resource->Map(0, nullptr, reinterpret_cast<void**>(&buffer.map));
+			assert(SUCCEEDED(result));
+			buffer.gpuAddress = buffer.resource->GetGPUVirtualAddress();
+		}
+
+		// 毎フレーム一杯になるようならkDefaultSizeを増やす
+		char str[128];
+		sprintf_s(
+		  str, "ConstantBufferRing: ring full (%.1fKB), chained a %.1fKB upload buffer\n",
+		  allocator_.GetSize() / 1024.0, buffer.size / 1024.0);
+		OutputDebugStringA(str);
+		overflowBuffers_.push_back(std::move(buffer));
+	}
+
+	OverflowBuffer& buffer = overflowBuffers_.back();
+	uint64_t offset = buffer.usedSize;
+	buffer.usedSize += alignedSize;
+	return {buffer.map + offset, buffer.gpuAddress + offset};
+}
@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include "RingAllocator.h"
+#include <d3d12.h>
+#include <deque>
+#include <vector>
+#include <wrl.h>
+
+/// <summary>
+/// 定数バッファ用のアップロードリング
+/// 1つの大きなアップロードヒープを常時マップしておき、256バイト単位で毎フレーム切り出す
+/// 割り当てはそのフレームのコマンドの完了まで有効（メインスレッドからのみ使用する）
+/// リングが一杯になったら追加のアップロードバッファをつないで割り当てを続ける
+/// </summary>
+class ConstantBufferRing {
+  public: // 定数
+	// デフォルトのバイト数
+	static const size_t kDefaultSize = 4 * 1024 * 1024;
+
+  public: // サブクラス
+	// 割り当て結果
+	struct Allocation {
+		void* cpuAddress;                     // 書き込み先
+		D3D12_GPU_VIRTUAL_ADDRESS gpuAddress; // CBVにセットするアドレス
+	};
+
+	// 同じフレーム内で割り当てを使い回すためのキャッシュ
+	struct FrameCache {
+		uint64_t frame = UINT64_MAX;              // 割り当てたフレーム
+		D3D12_GPU_VIRTUAL_ADDRESS gpuAddress = 0; // 割り当てたアドレス
+	};
+
+  public: // 静的メンバ関数
+	/// <summary>
+	/// シングルトンインスタンスの取得
+	/// </summary>
+	/// <returns>シングルトンインスタンス</returns>
+	static ConstantBufferRing* GetInstance();
+
+  public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="size">バイト数</param>
+	void Initialize(ID3D12Device* device, size_t size = kDefaultSize);
+
+	/// <summary>
+	/// 割り当て
+	/// </summary>
+	/// <param name="size">バイト数</param>
+	/// <returns>割り当て結果</returns>
+	Allocation Allocate(size_t size);
+
+	/// <summary>
+	/// キャッシュが今のフレームのものでなければ割り当て直す
+	/// </summary>
+	/// <param name="size">バイト数</param>
+	/// <param name="cache">キャッシュ（アドレスはcache.gpuAddress）</param>
+	/// <returns>割り当て直した場合は書き込み先、使い回せる場合はnullptr</returns>
+	void* Allocate(size_t size, FrameCache& cache);
+
+	/// <summary>
+	/// フレームの終了（コマンドリストの実行後、フェンスのシグナル直後に呼ぶ）
+	/// </summary>
+	/// <param name="fenceValue">このフレームのフェンス値</param>
+	void FinishFrame(uint64_t fenceValue);
+
+	/// <summary>
+	/// GPUの処理が完了したフレームの割り当てを解放する
+	/// </summary>
+	/// <param name="completedFenceValue">完了済みのフェンス値</param>
+	void Release(uint64_t completedFenceValue);
+
+	/// <summary>
+	/// 現在のフレーム番号を取得
+	/// </summary>
+	/// <returns>フレーム番号</returns>
+	uint64_t GetFrameCount() const { return frameCount_; }
+
+	/// <summary>
+	/// 使用中のバイト数を取得
+	/// </summary>
+	/// <returns>バイト数</returns>
+	uint64_t GetUsedSize() const { return allocator_.GetUsedSize(); }
+
+  private: // サブクラス
+	// リングが一杯のときにつなぐ追加のアップロードバッファ
+	struct OverflowBuffer {
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource; // アップロードバッファ
+		uint8_t* map;                                    // マップ済みアドレス
+		D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;            // 先頭のGPUアドレス
+		uint64_t size;                                   // バイト数
+		uint64_t usedSize;                               // 使用済みのバイト数
+		uint64_t fenceValue;                             // 使い終わったフレームのフェンス値
+	};
+
+  private: // メンバ変数
+	// デバイス（追加のアップロードバッファの生成用）
+	ID3D12Device* device_ = nullptr;
+	// アップロードバッファ
+	Microsoft::WRL::ComPtr<ID3D12Resource> buffer_;
+	// マップ済みアドレス
+	uint8_t* map_ = nullptr;
+	// バッファ先頭のGPUアドレス
+	D3D12_GPU_VIRTUAL_ADDRESS gpuAddress_ = 0;
+	// オフセットの割り当て
+	RingAllocator allocator_;
+	// フレーム番号
+	uint64_t frameCount_ = 0;
+	// 今のフレームでつないだ追加のバッファ（末尾から割り当てる）
+	std::vector<OverflowBuffer> overflowBuffers_;
+	// GPUの完了待ちの追加のバッファ（フェンス値の順）
+	std::deque<OverflowBuffer> pendingOverflowBuffers_;
+	// 再利用できる追加のバッファ
+	std::vector<OverflowBuffer> freeOverflowBuffers_;
+
+  private: // メンバ関数
+	/// <summary>
+	/// 追加のバッファから割り当てる（足りなければバッファをつなぐ）
+	/// </summary>
+	/// <param name="size">バイト数</param>
+	/// <returns>割り当て結果</returns>
+	Allocation AllocateOverflow(size_t size);
+
+	ConstantBufferRing() = default;
+	~ConstantBufferRing() = default;
+	ConstantBufferRing(const ConstantBufferRing&) = delete;
+	ConstantBufferRing& operator=(const ConstantBufferRing&) = delete;
+};
@@ -0,0 +1,73 @@
+﻿#include "DescriptorAllocator.h"
+#include <cassert>
+
+namespace {
+
+// 世代番号をハンドルに詰める
+inline uint32_t MakeHandle(uint32_t index, uint32_t generation) {
+	return generation << DescriptorAllocator::kIndexBits | index;
+}
+
+} // namespace
+
+void DescriptorAllocator::Initialize(uint32_t capacity) {
+	assert(capacity <= kMaxCapacity);
+	generations_.assign(capacity, 0);
+	allocated_.assign(capacity, false);
+	// 小さい番号から使うように逆順に積む
+	freeList_.resize(capacity);
+	for (uint32_t i = 0; i < capacity; i++) {
+		freeList_[i] = capacity - 1 - i;
+	}
+	framePending_.clear();
+	pending_.clear();
+	usedCount_ = 0;
+}
+
+uint32_t DescriptorAllocator::Allocate() {
+	if (freeList_.empty()) {
+		return kInvalidHandle;
+	}
+	uint32_t index = freeList_.back();
+	freeList_.pop_back();
+	allocated_[index] = true;
+	usedCount_++;
+	return MakeHandle(index, generations_[index]);
+}
+
+bool DescriptorAllocator::Free(uint32_t handle) {
+	if (!IsValid(handle)) {
+		return false;
+	}
+	uint32_t index = GetIndex(handle);
+	allocated_[index] = false;
+	// 世代番号を進めて古いハンドルを無効にする（一周したら0に戻る）
+	generations_[index] = (generations_[index] + 1) & ((1u << kGenerationBits) - 1);
+	usedCount_--;
+	framePending_.push_back(index);
+	return true;
+}
+
+void DescriptorAllocator::FinishFrame(uint64_t fenceValue) {
+	assert(pending_.empty() || pending_.back().fenceValue <= fenceValue);
+	for (uint32_t index : framePending_) {
+		pending_.push_back({fenceValue, index});
+	}
+	framePending_.clear();
+}
+
+void DescriptorAllocator::Release(
+  uint64_t completedFenceValue, std::vector<uint32_t>& released) {
+	while (!pending_.empty() && pending_.front().fenceValue <= completedFenceValue) {
+		freeList_.push_back(pending_.front().index);
+		released.push_back(pending_.front().index);
+		pending_.pop_front();
+	}
+}
+
+bool DescriptorAllocator::IsValid(uint32_t handle) const {
+	uint32_t index = GetIndex(handle);
+	return index < generations_.size() && allocated_[index] &&
+	       handle >> kIndexBits == generations_[index];
+}
+
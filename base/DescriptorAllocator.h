@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/// <summary>
+/// デスクリプタヒープの番号の割り当て
+/// 空き番号をフリーリストで管理し、世代番号付きのハンドルで解放済みの番号への参照を見分ける
+/// 解放した番号はGPUが使い終わるまで（フェンス値の完了まで）再利用しない
+/// 番号だけを扱うので、デスクリプタヒープやフェンスを用意しなくても動作を確認できる
+/// </summary>
+class DescriptorAllocator {
+  public: // 定数
+	// ハンドルの下位に持つ番号のビット数（シェーダから見えるヒープの上限100万個が収まる）
+	static const uint32_t kIndexBits = 20;
+	// ハンドルの上位に持つ世代番号のビット数
+	static const uint32_t kGenerationBits = 32 - kIndexBits;
+	// 番号の最大数
+	static const uint32_t kMaxCapacity = (1u << kIndexBits) - 1;
+	// 無効なハンドル（番号が範囲外なので、どの世代とも一致しない）
+	static const uint32_t kInvalidHandle = UINT32_MAX;
+
+  public: // メンバ関数
+	/// <summary>
+	/// 初期化（全ての番号を空きにする）
+	/// </summary>
+	/// <param name="capacity">番号の数</param>
+	void Initialize(uint32_t capacity);
+
+	/// <summary>
+	/// 割り当て（小さい番号から順に使い、解放された番号は最後に解放されたものから使う）
+	/// </summary>
+	/// <returns>ハンドル（空きがなければkInvalidHandle）</returns>
+	uint32_t Allocate();
+
+	/// <summary>
+	/// 解放
+	/// 世代番号はすぐに進めるので、以降このハンドルは無効になる
+	/// 番号はFinishFrameで渡したフェンス値の完了後にReleaseで空きに戻る
+	/// </summary>
+	/// <param name="handle">ハンドル</param>
+	/// <returns>有効なハンドルを解放したらtrue</returns>
+	bool Free(uint32_t handle);
+
+	/// <summary>
+	/// フレームの終了（ここまでに解放した番号をフェンス値と結び付ける）
+	/// </summary>
+	/// <param name="fenceValue">このフレームのコマンドの完了を示すフェンス値</param>
+	void FinishFrame(uint64_t fenceValue);
+
+	/// <summary>
+	/// GPUの処理が完了したフレームで解放した番号を空きに戻す
+	/// </summary>
+	/// <param name="completedFenceValue">完了済みのフェンス値</param>
+	/// <param name="released">空きに戻した番号の追加先</param>
+	void Release(uint64_t completedFenceValue, std::vector<uint32_t>& released);
+
+	/// <summary>
+	/// ハンドルが割り当て中の番号を指しているか
+	/// </summary>
+	/// <param name="handle">ハンドル</param>
+	/// <returns>有効ならtrue</returns>
+	bool IsValid(uint32_t handle) const;
+
+	/// <summary>
+	/// 番号の数を取得
+	/// </summary>
+	/// <returns>番号の数</returns>
+	uint32_t GetCapacity() const { return static_cast<uint32_t>(generations_.size()); }
+
+	/// <summary>
+	/// 割り当て中の番号の数を取得
+	/// </summary>
+	/// <returns>番号の数</returns>
+	uint32_t GetUsedCount() const { return usedCount_; }
+
+	/// <summary>
+	/// GPUの完了待ちの番号の数を取得
+	/// </summary>
+	/// <returns>番号の数</returns>
+	uint32_t GetPendingCount() const {
+		return static_cast<uint32_t>(pending_.size() + framePending_.size());
+	}
+
+  public: // 静的メンバ関数
+	/// <summary>
+	/// ハンドルから番号を取り出す
+	/// </summary>
+	/// <param name="handle">ハンドル</param>
+	/// <returns>番号</returns>
+	static uint32_t GetIndex(uint32_t handle) { return handle & kMaxCapacity; }
+
+  private: // サブクラス
+	// GPUの完了待ちの番号
+	struct Pending {
+		uint64_t fenceValue; // 完了を示すフェンス値
+		uint32_t index;      // 番号
+	};
+
+  private: // メンバ変数
+	// 番号ごとの現在の世代番号
+	std::vector<uint32_t> generations_;
+	// 番号ごとの割り当て中フラグ
+	std::vector<bool> allocated_;
+	// 空き番号（末尾から使う）
+	std::vector<uint32_t> freeList_;
+	// 現在のフレームで解放した番号
+	std::vector<uint32_t> framePending_;
+	// GPUの完了待ちの番号（古い順）
+	std::deque<Pending> pending_;
+	// 割り当て中の番号の数
+	uint32_t usedCount_ = 0;
+};
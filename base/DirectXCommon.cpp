@@ -1,5 +1,10 @@
 ﻿#include "DirectXCommon.h"
+#include "ConstantBufferRing.h"
+#include "GpuMemoryAllocator.h"
+#include "PipelineCache.h"
 #include "SafeDelete.h"
+#include "TextureManager.h"
+#include "UploadManager.h"
 #include <algorithm>
 #include <cassert>
 #include <vector>
@@ -15,6 +20,14 @@ DirectXCommon* DirectXCommon::GetInstance() {
 	return &instance;
 }
 
+DirectXCommon::~DirectXCommon() {
+	if (fenceEvent_) {
+		// GPUの処理が終わってから解放する
+		WaitForFenceValue(fenceVal_);
+		CloseHandle(fenceEvent_);
+	}
+}
+
 void DirectXCommon::Initialize(WinApp* winApp, int32_t backBufferWidth, int32_t backBufferHeight) {
 	// nullptrチェック
 	assert(winApp);
@@ -28,6 +41,9 @@ void DirectXCommon::Initialize(WinApp* winApp, int32_t backBufferWidth, int32_t
 	// DXGIデバイス初期化
 	InitializeDXGIDevice();
 
+	// GPUメモリの割り当ての初期化
+	GpuMemoryAllocator::GetInstance()->Initialize(device_.Get());
+
 	// コマンド関連初期化
 	InitializeCommand();
 
@@ -42,6 +58,15 @@ void DirectXCommon::Initialize(WinApp* winApp, int32_t backBufferWidth, int32_t
 
 	// フェンス生成
 	CreateFence();
+
+	// 定数バッファ用リングの初期化
+	ConstantBufferRing::GetInstance()->Initialize(device_.Get());
+
+	// デフォルトヒープへの転送の初期化
+	UploadManager::GetInstance()->Initialize(device_.Get());
+
+	// パイプラインキャッシュの初期化
+	PipelineCache::GetInstance()->Initialize(device_.Get());
 }
 
 void DirectXCommon::PreDraw() {
@@ -91,6 +116,9 @@ void DirectXCommon::PostDraw() {
 	// 命令のクローズ
 	commandList_->Close();
 
+	// このフレームまでに予約された転送を送信し、完了してから描画させる
+	UploadManager::GetInstance()->Submit(commandQueue_.Get());
+
 	// コマンドリストの実行
 	ID3D12CommandList* cmdLists[] = {commandList_.Get()}; // コマンドリストの配列
 	commandQueue_->ExecuteCommandLists(1, cmdLists);
@@ -111,18 +139,58 @@ void DirectXCommon::PostDraw() {
 	}
 #endif
 
-	// コマンドリストの実行完了を待つ
+	// このフレームの完了を示すフェンス値を記録
 	commandQueue_->Signal(fence_.Get(), ++fenceVal_);
-	if (fence_->GetCompletedValue() != fenceVal_) {
-		HANDLE event = CreateEvent(nullptr, false, false, nullptr);
-		fence_->SetEventOnCompletion(fenceVal_, event);
-		WaitForSingleObject(event, INFINITE);
-		CloseHandle(event);
+	frameFenceValues_[frameIndex_] = fenceVal_;
+	ConstantBufferRing::GetInstance()->FinishFrame(fenceVal_);
+	TextureManager::GetInstance()->FinishFrame(fenceVal_);
+
+	// 次のフレームのコマンドアロケータを前回使ったフレームの完了だけ待つ
+	frameIndex_ = (frameIndex_ + 1) % kFrameCount;
+	frameNumber_++;
+	auto waitStartTime = std::chrono::steady_clock::now();
+	WaitForFenceValue(frameFenceValues_[frameIndex_]);
+	auto now = std::chrono::steady_clock::now();
+	frameStatistics_.waitMilliseconds =
+	  std::chrono::duration<double, std::milli>(now - waitStartTime).count();
+	frameStatistics_.frameMilliseconds =
+	  std::chrono::duration<double, std::milli>(now - lastPostDrawTime_).count();
+	lastPostDrawTime_ = now;
+
+	// 完了したフレームの定数バッファと、Unloadしたテクスチャ、破棄したメッシュのバッファを解放
+	ConstantBufferRing::GetInstance()->Release(fence_->GetCompletedValue());
+	TextureManager::GetInstance()->Release(fence_->GetCompletedValue());
+	ReleaseDeferredResources(fence_->GetCompletedValue());
+
+	commandAllocators_[frameIndex_]->Reset(); // キューをクリア
+	commandList_->Reset(commandAllocators_[frameIndex_].Get(),
+	                    nullptr); // 再びコマンドリストを貯める準備
+}
+
+void DirectXCommon::WaitForGpu() {
+	// 最後に送信したフレームの完了を待つ
+	WaitForFenceValue(fenceVal_);
+	ConstantBufferRing::GetInstance()->Release(fence_->GetCompletedValue());
+	TextureManager::GetInstance()->Release(fence_->GetCompletedValue());
+	ReleaseDeferredResources(fence_->GetCompletedValue());
+}
+
+void DirectXCommon::ReleaseDeferred(Microsoft::WRL::ComPtr<ID3D12Resource> resource) {
+	// 記録中のコマンドは次のシグナルで完了する
+	deferredReleases_.emplace_back(fenceVal_ + 1, std::move(resource));
+}
+
+void DirectXCommon::ReleaseDeferredResources(UINT64 completedFenceValue) {
+	while (!deferredReleases_.empty() && deferredReleases_.front().first <= completedFenceValue) {
+		deferredReleases_.pop_front();
 	}
+}
 
-	commandAllocator_->Reset(); // キューをクリア
-	commandList_->Reset(commandAllocator_.Get(),
-	                    nullptr); // 再びコマンドリストを貯める準備
+void DirectXCommon::WaitForFenceValue(UINT64 fenceValue) {
+	if (fence_->GetCompletedValue() < fenceValue) {
+		fence_->SetEventOnCompletion(fenceValue, fenceEvent_);
+		WaitForSingleObject(fenceEvent_, INFINITE);
+	}
 }
 
 void DirectXCommon::ClearRenderTarget() {
@@ -283,14 +351,16 @@ void DirectXCommon::CreateSwapChain() {
 void DirectXCommon::InitializeCommand() {
 	HRESULT result = S_FALSE;
 
-	// コマンドアロケータを生成
-	result = device_->CreateCommandAllocator(
-	  D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator_));
-	assert(SUCCEEDED(result));
+	// コマンドアロケータをフレームの数だけ生成
+	for (ComPtr<ID3D12CommandAllocator>& commandAllocator : commandAllocators_) {
+		result = device_->CreateCommandAllocator(
+		  D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator));
+		assert(SUCCEEDED(result));
+	}
 
 	// コマンドリストを生成
 	result = device_->CreateCommandList(
-	  0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocator_.Get(), nullptr,
+	  0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocators_[frameIndex_].Get(), nullptr,
 	  IID_PPV_ARGS(&commandList_));
 	assert(SUCCEEDED(result));
 
@@ -338,16 +408,14 @@ void DirectXCommon::CreateFinalRenderTargets() {
 void DirectXCommon::CreateDepthBuffer() {
 	HRESULT result = S_FALSE;
 
-	// ヒーププロパティ
-	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
 	// リソース設定
 	CD3DX12_RESOURCE_DESC depthResDesc = CD3DX12_RESOURCE_DESC::Tex2D(
 	  DXGI_FORMAT_D32_FLOAT, backBufferWidth_, backBufferHeight_, 1, 0, 1, 0,
 	  D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
 	CD3DX12_CLEAR_VALUE clearValue = CD3DX12_CLEAR_VALUE(DXGI_FORMAT_D32_FLOAT, 1.0f, 0);
 	// リソースの生成
-	result = device_->CreateCommittedResource(
-	  &heapProps, D3D12_HEAP_FLAG_NONE, &depthResDesc,
+	result = GpuMemoryAllocator::GetInstance()->CreateResource(
+	  depthResDesc,
 	  D3D12_RESOURCE_STATE_DEPTH_WRITE, // 深度値書き込みに使用
 	  &clearValue, IID_PPV_ARGS(&depthBuffer_));
 	assert(SUCCEEDED(result));
@@ -373,4 +441,10 @@ void DirectXCommon::CreateFence() {
 	// フェンスの生成
 	result = device_->CreateFence(fenceVal_, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence_));
 	assert(SUCCEEDED(result));
+
+	// フェンス待ち用のイベントは使い回す
+	fenceEvent_ = CreateEvent(nullptr, false, false, nullptr);
+	assert(fenceEvent_);
+
+	lastPostDrawTime_ = std::chrono::steady_clock::now();
 }
@@ -1,8 +1,10 @@
 ﻿#pragma once
 
 #include <Windows.h>
+#include <chrono>
 #include <cstdlib>
 #include <d3d12.h>
+#include <deque>
 #include <d3dx12.h>
 #include <dxgi1_6.h>
 #include <wrl.h>
@@ -13,6 +15,17 @@
 /// DirectX汎用
 /// </summary>
 class DirectXCommon {
+  public: // 定数
+	// 同時に処理するフレーム数（1にすると毎フレームGPUの完了を待つ）
+	static const uint32_t kFrameCount = 2;
+
+  public: // サブクラス
+	// フレームの計測結果
+	struct FrameStatistics {
+		double frameMilliseconds = 0.0; // 前回のPostDrawからの時間
+		double waitMilliseconds = 0.0;  // GPUの完了待ちで止まっていた時間
+	};
+
   public: // メンバ関数
 
 	/// <summary>
@@ -38,6 +51,18 @@ class DirectXCommon {
 	/// </summary>
 	void PostDraw();
 
+	/// <summary>
+	/// 送信済みのコマンドがすべて完了するまで待つ（GPUが使用中のリソースを解放する前に呼ぶ）
+	/// </summary>
+	void WaitForGpu();
+
+	/// <summary>
+	/// GPUの処理完了後にリソースを解放する
+	/// 記録中のフレームの完了まで保持するので、描画に使用中のリソースも渡せる
+	/// </summary>
+	/// <param name="resource">リソース</param>
+	void ReleaseDeferred(Microsoft::WRL::ComPtr<ID3D12Resource> resource);
+
 	/// <summary>
 	/// レンダーターゲットのクリア
 	/// </summary>
@@ -60,6 +85,24 @@ class DirectXCommon {
 	/// <returns>描画コマンドリスト</returns>
 	ID3D12GraphicsCommandList* GetCommandList() { return commandList_.Get(); }
 
+	/// <summary>
+	/// 現在のフレームの番号を取得（0～kFrameCount-1）
+	/// </summary>
+	/// <returns>フレームの番号</returns>
+	uint32_t GetFrameIndex() const { return frameIndex_; }
+
+	/// <summary>
+	/// 起動からのフレーム数を取得（PostDrawごとに1増える）
+	/// </summary>
+	/// <returns>フレーム数</returns>
+	uint64_t GetFrameNumber() const { return frameNumber_; }
+
+	/// <summary>
+	/// 前回のPostDrawの計測結果を取得
+	/// </summary>
+	/// <returns>計測結果</returns>
+	const FrameStatistics& GetFrameStatistics() const { return frameStatistics_; }
+
 	/// <summary>
 	/// バックバッファの幅取得
 	/// </summary>
@@ -80,7 +123,7 @@ class DirectXCommon {
 	Microsoft::WRL::ComPtr<IDXGIFactory7> dxgiFactory_;
 	Microsoft::WRL::ComPtr<ID3D12Device> device_;
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList_;
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator_;
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocators_[kFrameCount];
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue_;
 	Microsoft::WRL::ComPtr<IDXGISwapChain4> swapChain_;
 	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> backBuffers_;
@@ -89,12 +132,26 @@ class DirectXCommon {
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> dsvHeap_;
 	Microsoft::WRL::ComPtr<ID3D12Fence> fence_;
 	UINT64 fenceVal_ = 0;
+	// フレームごとの完了を示すフェンス値
+	UINT64 frameFenceValues_[kFrameCount] = {};
+	// フェンス待ち用のイベント
+	HANDLE fenceEvent_ = nullptr;
+	// 解放待ちのリソースと解放できるフェンス値（フェンス値の順）
+	std::deque<std::pair<UINT64, Microsoft::WRL::ComPtr<ID3D12Resource>>> deferredReleases_;
+	// 現在のフレームの番号
+	uint32_t frameIndex_ = 0;
+	// 起動からのフレーム数
+	uint64_t frameNumber_ = 0;
+	// 前回のPostDrawの時刻
+	std::chrono::steady_clock::time_point lastPostDrawTime_;
+	// 前回のPostDrawの計測結果
+	FrameStatistics frameStatistics_;
 	int32_t backBufferWidth_ = 0;
 	int32_t backBufferHeight_ = 0;
 
   private: // メンバ関数
 	DirectXCommon() = default;
-	~DirectXCommon() = default;
+	~DirectXCommon();
 	DirectXCommon(const DirectXCommon&) = delete;
 	const DirectXCommon& operator=(const DirectXCommon&) = delete;
 		   
@@ -127,4 +184,16 @@ class DirectXCommon {
 	/// フェンス生成
 	/// </summary>
 	void CreateFence();
+
+	/// <summary>
+	/// フェンスが指定の値に達するまで待つ
+	/// </summary>
+	/// <param name="fenceValue">フェンス値</param>
+	void WaitForFenceValue(UINT64 fenceValue);
+
+	/// <summary>
+	/// GPUの処理が完了したリソースを解放する
+	/// </summary>
+	/// <param name="completedFenceValue">完了済みのフェンス値</param>
+	void ReleaseDeferredResources(UINT64 completedFenceValue);
 };
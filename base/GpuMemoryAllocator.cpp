@@ -0,0 +1,225 @@
+﻿#include "GpuMemoryAllocator.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <d3dx12.h>
+
+using namespace Microsoft::WRL;
+
+namespace {
+
+// プライベートデータのID
+const GUID kReleaserGuid = {
+  0x6c1d3f2a, 0x8b47, 0x4e19, {0x9a, 0x5e, 0x21, 0xd7, 0x4c, 0x83, 0xf0, 0x6b}};
+
+// ヒープのサイズとオフセットの単位
+const uint64_t kHeapAlignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+// プールの名前
+const char* const kPoolNames[] = {"buffer", "texture", "render target"};
+
+} // namespace
+
+class GpuMemoryAllocator::Releaser : public IUnknown {
+  public:
+	Releaser(const std::shared_ptr<Pool>& pool, Block* block, uint64_t offset)
+	    : pool_(pool), block_(block), offset_(offset) {}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override {
+		if (!object) {
+			return E_POINTER;
+		}
+		if (riid == __uuidof(IUnknown)) {
+			*object = static_cast<IUnknown*>(this);
+			AddRef();
+			return S_OK;
+		}
+		*object = nullptr;
+		return E_NOINTERFACE;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() override { return ++refCount_; }
+
+	ULONG STDMETHODCALLTYPE Release() override {
+		ULONG count = --refCount_;
+		if (count == 0) {
+			// リソースが破棄されたので領域を返却
+			GpuMemoryAllocator::Free(*pool_, block_, offset_);
+			delete this;
+		}
+		return count;
+	}
+
+  private:
+	std::atomic<ULONG> refCount_{1};
+	std::shared_ptr<Pool> pool_;
+	Block* block_;
+	uint64_t offset_;
+};
+
+GpuMemoryAllocator* GpuMemoryAllocator::GetInstance() {
+	static GpuMemoryAllocator instance;
+	return &instance;
+}
+
+void GpuMemoryAllocator::Initialize(ID3D12Device* device, uint64_t blockSize) {
+	assert(device);
+	assert(blockSize > 0 && blockSize % kHeapAlignment == 0);
+	device_ = device;
+	blockSize_ = blockSize;
+
+	// ヒープティア1ではバッファ・テクスチャ・レンダーターゲットを同じヒープに置けない
+	const D3D12_HEAP_FLAGS heapFlags[] = {
+	  D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES,
+	  D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES};
+	for (size_t i = 0; i < _countof(pools_); i++) {
+		pools_[i] = std::make_shared<Pool>();
+		pools_[i]->heapFlags = heapFlags[i];
+	}
+}
+
+HRESULT GpuMemoryAllocator::CreateResource(
+  const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState,
+  const D3D12_CLEAR_VALUE* clearValue, REFIID riid, void** resource) {
+	assert(device_);
+	assert(resource);
+	PoolType type = GetPoolType(desc);
+	const std::shared_ptr<Pool>& pool = pools_[static_cast<size_t>(type)];
+
+	// 小さいテクスチャは4KBアラインメントを試す（使えなければ既定の64KB）
+	D3D12_RESOURCE_DESC resourceDesc = desc;
+	D3D12_RESOURCE_ALLOCATION_INFO info;
+	if (type == PoolType::kTexture && desc.Alignment == 0 && desc.SampleDesc.Count <= 1) {
+		resourceDesc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+		info = device_->GetResourceAllocationInfo(0, 1, &resourceDesc);
+		if (info.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) {
+			resourceDesc.Alignment = 0;
+			info = device_->GetResourceAllocationInfo(0, 1, &resourceDesc);
+		}
+	} else {
+		info = device_->GetResourceAllocationInfo(0, 1, &resourceDesc);
+	}
+	if (info.SizeInBytes == UINT64_MAX) {
+		return E_INVALIDARG;
+	}
+
+	// 領域の割り当て
+	Block* block = nullptr;
+	uint64_t offset = TlsfAllocator::kInvalidOffset;
+	{
+		std::lock_guard<std::mutex> lock(pool->mutex);
+
+		// 既存のヒープから割り当て
+		for (const auto& candidate : pool->blocks) {
+			offset = candidate->allocator.Allocate(info.SizeInBytes, info.Alignment);
+			if (offset != TlsfAllocator::kInvalidOffset) {
+				block = candidate.get();
+				break;
+			}
+		}
+
+		// 空きがなければヒープを追加
+		if (!block) {
+			uint64_t heapSize = std::max(
+			  blockSize_,
+			  (info.SizeInBytes + kHeapAlignment - 1) / kHeapAlignment * kHeapAlignment);
+			CD3DX12_HEAP_DESC heapDesc(heapSize, D3D12_HEAP_TYPE_DEFAULT, 0, pool->heapFlags);
+			auto newBlock = std::make_unique<Block>();
+			HRESULT result = device_->CreateHeap(&heapDesc, IID_PPV_ARGS(&newBlock->heap));
+			if (FAILED(result)) {
+				return result;
+			}
+			newBlock->allocator.Initialize(heapSize);
+			offset = newBlock->allocator.Allocate(info.SizeInBytes, info.Alignment);
+			assert(offset != TlsfAllocator::kInvalidOffset);
+			block = newBlock.get();
+			pool->blocks.push_back(std::move(newBlock));
+		}
+	}
+
+	// 配置リソースを生成
+	ComPtr<ID3D12Resource> placedResource;
+	HRESULT result = device_->CreatePlacedResource(
+	  block->heap.Get(), offset, &resourceDesc, initialState, clearValue,
+	  IID_PPV_ARGS(&placedResource));
+	if (FAILED(result)) {
+		Free(*pool, block, offset);
+		return result;
+	}
+
+	// リソースの破棄と同時に領域を返却するよう、返却用オブジェクトを持たせる
+	Releaser* releaser = new Releaser(pool, block, offset);
+	result = placedResource->SetPrivateDataInterface(kReleaserGuid, releaser);
+	releaser->Release();
+	assert(SUCCEEDED(result));
+
+	return placedResource->QueryInterface(riid, resource);
+}
+
+GpuMemoryAllocator::Statistics GpuMemoryAllocator::GetStatistics(PoolType type) const {
+	Statistics statistics;
+	const std::shared_ptr<Pool>& pool = pools_[static_cast<size_t>(type)];
+	if (!pool) {
+		return statistics;
+	}
+
+	std::lock_guard<std::mutex> lock(pool->mutex);
+	uint64_t freeBytes = 0;
+	for (const auto& block : pool->blocks) {
+		TlsfAllocator::Statistics blockStatistics = block->allocator.GetStatistics();
+		statistics.blockCount++;
+		statistics.resourceCount += blockStatistics.allocationCount;
+		statistics.reservedBytes += blockStatistics.size;
+		statistics.liveBytes += blockStatistics.liveBytes;
+		statistics.largestFreeBlock =
+		  std::max(statistics.largestFreeBlock, blockStatistics.largestFreeBlock);
+		freeBytes += blockStatistics.freeBytes;
+	}
+	if (freeBytes > 0) {
+		statistics.fragmentation = 1.0f - static_cast<float>(
+		                                    static_cast<double>(statistics.largestFreeBlock) /
+		                                    freeBytes);
+	}
+	return statistics;
+}
+
+void GpuMemoryAllocator::OutputStatistics() const {
+	char str[256];
+	for (size_t i = 0; i < static_cast<size_t>(PoolType::kCount); i++) {
+		Statistics statistics = GetStatistics(static_cast<PoolType>(i));
+		sprintf_s(
+		  str,
+		  "GpuMemoryAllocator %s: %u heaps %.2fMB, %u resources %.2fMB, largest free %.2fMB, "
+		  "fragmentation %.3f\n",
+		  kPoolNames[i], statistics.blockCount, statistics.reservedBytes / (1024.0 * 1024.0),
+		  statistics.resourceCount, statistics.liveBytes / (1024.0 * 1024.0),
+		  statistics.largestFreeBlock / (1024.0 * 1024.0), statistics.fragmentation);
+		OutputDebugStringA(str);
+	}
+}
+
+GpuMemoryAllocator::PoolType GpuMemoryAllocator::GetPoolType(const D3D12_RESOURCE_DESC& desc) {
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) {
+		return PoolType::kBuffer;
+	}
+	if (
+	  desc.Flags &
+	  (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) {
+		return PoolType::kRenderTarget;
+	}
+	return PoolType::kTexture;
+}
+
+void GpuMemoryAllocator::Free(Pool& pool, Block* block, uint64_t offset) {
+	std::lock_guard<std::mutex> lock(pool.mutex);
+	block->allocator.Free(offset);
+
+	// 空になったヒープは、他にもヒープがあれば解放する（1個は再利用のために残す）
+	if (block->allocator.IsEmpty() && pool.blocks.size() > 1) {
+		auto itr = std::find_if(
+		  pool.blocks.begin(), pool.blocks.end(),
+		  [block](const std::unique_ptr<Block>& b) { return b.get() == block; });
+		assert(itr != pool.blocks.end());
+		pool.blocks.erase(itr);
+	}
+}
@@ -0,0 +1,125 @@
+﻿#pragma once
+
+#include "TlsfAllocator.h"
+#include <Windows.h>
+#include <d3d12.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <wrl.h>
+
+/// <summary>
+/// デフォルトヒープのGPUメモリの割り当て
+/// 大きなID3D12Heapをまとめて確保し、TlsfAllocatorで切り分けて配置リソースを生成する
+/// ヒープの種類ごとの制約(リソースヒープティア1)に合わせて、バッファ・テクスチャ・
+/// レンダーターゲットでプールを分ける。リソースを解放すると領域も自動で返却される
+/// </summary>
+class GpuMemoryAllocator {
+  public: // 定数
+	// ヒープ1個のデフォルトのバイト数
+	static const uint64_t kDefaultBlockSize = 32 * 1024 * 1024;
+
+  public: // 列挙子
+	// プールの種類
+	enum class PoolType {
+		kBuffer,       // バッファ
+		kTexture,      // テクスチャ
+		kRenderTarget, // レンダーターゲット・深度バッファ
+
+		kCount,
+	};
+
+  public: // サブクラス
+	// プールの統計
+	struct Statistics {
+		uint32_t blockCount = 0;       // ヒープの数
+		uint32_t resourceCount = 0;    // 生成中のリソース数
+		uint64_t reservedBytes = 0;    // ヒープの合計バイト数
+		uint64_t liveBytes = 0;        // リソースに割り当て中のバイト数
+		uint64_t largestFreeBlock = 0; // 最大の空き領域のバイト数
+		float fragmentation = 0.0f;    // 断片化率（1 - 最大の空き領域 / 空きの合計）
+	};
+
+  public: // 静的メンバ関数
+	/// <summary>
+	/// シングルトンインスタンスの取得
+	/// </summary>
+	/// <returns>シングルトンインスタンス</returns>
+	static GpuMemoryAllocator* GetInstance();
+
+  public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="blockSize">ヒープ1個のバイト数（64KBの倍数）</param>
+	void Initialize(ID3D12Device* device, uint64_t blockSize = kDefaultBlockSize);
+
+	/// <summary>
+	/// デフォルトヒープにリソースを生成する
+	/// CreateCommittedResourceの代わりに使う。ヒープより大きいリソースは専用のヒープに置く
+	/// </summary>
+	/// <param name="desc">リソース設定</param>
+	/// <param name="initialState">初期状態</param>
+	/// <param name="clearValue">クリア値（レンダーターゲット・深度バッファ以外はnullptr）</param>
+	/// <param name="riid">インターフェースのID</param>
+	/// <param name="resource">生成したリソース</param>
+	/// <returns>結果</returns>
+	HRESULT CreateResource(
+	  const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState,
+	  const D3D12_CLEAR_VALUE* clearValue, REFIID riid, void** resource);
+
+	/// <summary>
+	/// 統計の取得
+	/// </summary>
+	/// <param name="type">プールの種類</param>
+	/// <returns>統計</returns>
+	Statistics GetStatistics(PoolType type) const;
+
+	/// <summary>
+	/// 統計を出力ウィンドウに表示
+	/// </summary>
+	void OutputStatistics() const;
+
+  private: // サブクラス
+	// ヒープ1個分
+	struct Block {
+		Microsoft::WRL::ComPtr<ID3D12Heap> heap; // ヒープ
+		TlsfAllocator allocator;                 // ヒープ内の割り当て
+	};
+
+	// プール
+	struct Pool {
+		D3D12_HEAP_FLAGS heapFlags;                 // ヒープフラグ
+		std::mutex mutex;                           // 割り当てと解放の排他
+		std::vector<std::unique_ptr<Block>> blocks; // ヒープ
+	};
+
+	// リソースの破棄時に領域を返却するオブジェクト
+	// リソースのプライベートデータとして持たせ、リソースと一緒に解放される
+	class Releaser;
+
+  private: // メンバ関数
+	GpuMemoryAllocator() = default;
+	~GpuMemoryAllocator() = default;
+	GpuMemoryAllocator(const GpuMemoryAllocator&) = delete;
+	GpuMemoryAllocator& operator=(const GpuMemoryAllocator&) = delete;
+
+	/// <summary>
+	/// リソース設定からプールの種類を決める
+	/// </summary>
+	static PoolType GetPoolType(const D3D12_RESOURCE_DESC& desc);
+
+	/// <summary>
+	/// 領域を返却する（空になったヒープは他にヒープがあれば解放する）
+	/// </summary>
+	static void Free(Pool& pool, Block* block, uint64_t offset);
+
+  private: // メンバ変数
+	// デバイス
+	ID3D12Device* device_ = nullptr;
+	// ヒープ1個のバイト数
+	uint64_t blockSize_ = kDefaultBlockSize;
+	// プール（リソースより先に破棄されても返却できるよう共有で持つ）
+	std::shared_ptr<Pool> pools_[static_cast<size_t>(PoolType::kCount)];
+};
@@ -0,0 +1,60 @@
+﻿#include "MappedFile.h"
+
+MappedFile::~MappedFile() { Close(); }
+
+bool MappedFile::Open(const std::string& filePath) {
+	Close();
+
+	// ファイルを開く
+	file_ = CreateFileA(
+	  filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file_ == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	// ファイルサイズを取得
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(file_, &fileSize)) {
+		Close();
+		return false;
+	}
+	size_ = static_cast<size_t>(fileSize.QuadPart);
+
+	// 空ファイルはマップできないので、空の領域として扱う
+	if (size_ == 0) {
+		data_ = "";
+		return true;
+	}
+
+	// ファイル全体をマップする
+	mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping_ == nullptr) {
+		Close();
+		return false;
+	}
+	data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+	if (data_ == nullptr) {
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data_ && mapping_) {
+		UnmapViewOfFile(data_);
+	}
+	data_ = nullptr;
+	size_ = 0;
+
+	if (mapping_) {
+		CloseHandle(mapping_);
+		mapping_ = nullptr;
+	}
+	if (file_ != INVALID_HANDLE_VALUE) {
+		CloseHandle(file_);
+		file_ = INVALID_HANDLE_VALUE;
+	}
+}
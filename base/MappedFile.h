@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <Windows.h>
+#include <cstddef>
+#include <string>
+
+/// <summary>
+/// 読み込み専用メモリマップドファイル
+/// </summary>
+class MappedFile {
+  public: // メンバ関数
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/// <summary>
+	/// ファイルを開いてメモリにマップする
+	/// </summary>
+	/// <param name="filePath">ファイルパス</param>
+	/// <returns>成否</returns>
+	bool Open(const std::string& filePath);
+
+	/// <summary>
+	/// マップを解除してファイルを閉じる
+	/// </summary>
+	void Close();
+
+	/// <summary>
+	/// 先頭アドレスを取得
+	/// </summary>
+	/// <returns>先頭アドレス</returns>
+	const char* GetData() const { return data_; }
+
+	/// <summary>
+	/// ファイルサイズを取得
+	/// </summary>
+	/// <returns>ファイルサイズ</returns>
+	size_t GetSize() const { return size_; }
+
+	/// <summary>
+	/// 開いているか
+	/// </summary>
+	/// <returns>開いているか</returns>
+	bool IsOpen() const { return file_ != INVALID_HANDLE_VALUE; }
+
+  private: // メンバ変数
+	// ファイルハンドル
+	HANDLE file_ = INVALID_HANDLE_VALUE;
+	// ファイルマッピングハンドル
+	HANDLE mapping_ = nullptr;
+	// マップ済みアドレス
+	const char* data_ = nullptr;
+	// ファイルサイズ
+	size_t size_ = 0;
+};
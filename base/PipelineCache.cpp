@@ -0,0 +1,325 @@
+﻿#include "PipelineCache.h"
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <dxgi1_6.h>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+using namespace Microsoft::WRL;
+
+/// <summary>
+/// 静的メンバ変数の実体
+/// </summary>
+const std::wstring PipelineCache::kFilePath = L"Resources/shaders/cache/PipelineLibrary.bin";
+
+namespace {
+
+// ファイルの識別子とバージョン
+const uint32_t kMagic = 0x4c4f5350; // "PSOL"
+const uint32_t kVersion = 1;
+
+// FNV-1aハッシュ
+const uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ull;
+const uint64_t kFnvPrime = 0x100000001b3ull;
+
+inline uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * kFnvPrime;
+	}
+	return hash;
+}
+
+// スカラー値（構造体はパディングを含むことがあるので、メンバごとに渡す）
+template<class T> inline uint64_t HashValue(uint64_t hash, T value) {
+	static_assert(std::is_scalar<T>::value, "HashValue takes scalar values");
+	return HashBytes(hash, &value, sizeof(value));
+}
+
+// 文字列（nullptrと空文字列は区別しない）
+inline uint64_t HashString(uint64_t hash, const char* str) {
+	return str ? HashBytes(hash, str, strlen(str) + 1) : HashValue(hash, '\0');
+}
+
+inline uint64_t HashBytecode(uint64_t hash, const D3D12_SHADER_BYTECODE& bytecode) {
+	hash = HashValue(hash, bytecode.BytecodeLength);
+	return HashBytes(hash, bytecode.pShaderBytecode, bytecode.BytecodeLength);
+}
+
+inline uint64_t HashDepthStencilOp(uint64_t hash, const D3D12_DEPTH_STENCILOP_DESC& desc) {
+	hash = HashValue(hash, desc.StencilFailOp);
+	hash = HashValue(hash, desc.StencilDepthFailOp);
+	hash = HashValue(hash, desc.StencilPassOp);
+	return HashValue(hash, desc.StencilFunc);
+}
+
+} // namespace
+
+PipelineCache* PipelineCache::GetInstance() {
+	static PipelineCache instance;
+	return &instance;
+}
+
+void PipelineCache::Initialize(ID3D12Device* device, const std::wstring& filePath) {
+	assert(device);
+	device_ = device;
+	filePath_ = filePath;
+	library_.Reset();
+	libraryData_.clear();
+	dirty_ = false;
+	rootSignatureHashes_.clear();
+	statistics_ = Statistics();
+
+	// パイプラインライブラリはID3D12Device1から
+	ComPtr<ID3D12Device1> device1;
+	if (FAILED(device_->QueryInterface(IID_PPV_ARGS(&device1)))) {
+		return;
+	}
+
+	GetAdapterInfo(header_);
+	header_.magic = kMagic;
+	header_.version = kVersion;
+	header_.coldSeconds = 0.0;
+
+	// 保存済みのライブラリを読み込む（アダプタかドライバが変わっていたら使わない）
+	std::ifstream file(std::filesystem::path(filePath_), std::ios::binary);
+	FileHeader fileHeader{};
+	if (
+	  file && file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader)) &&
+	  fileHeader.magic == kMagic && fileHeader.version == kVersion &&
+	  fileHeader.vendorId == header_.vendorId && fileHeader.deviceId == header_.deviceId &&
+	  fileHeader.driverVersion == header_.driverVersion) {
+		libraryData_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		header_.coldSeconds = fileHeader.coldSeconds;
+	}
+	if (!libraryData_.empty()) {
+		HRESULT result = device1->CreatePipelineLibrary(
+		  libraryData_.data(), libraryData_.size(), IID_PPV_ARGS(&library_));
+		if (FAILED(result)) {
+			// ドライバの更新などで使えなくなったライブラリは作り直す
+			// (D3D12_ERROR_DRIVER_VERSION_MISMATCH, D3D12_ERROR_ADAPTER_NOT_FOUND など)
+			libraryData_.clear();
+			header_.coldSeconds = 0.0;
+		}
+	}
+	if (!library_) {
+		HRESULT result = device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library_));
+		assert(SUCCEEDED(result));
+	}
+}
+
+HRESULT PipelineCache::CreateRootSignature(ID3DBlob* blob, REFIID riid, void** rootSignature) {
+	assert(device_ && blob);
+	ComPtr<ID3D12RootSignature> created;
+	HRESULT result = device_->CreateRootSignature(
+	  0, blob->GetBufferPointer(), blob->GetBufferSize(), IID_PPV_ARGS(&created));
+	if (FAILED(result)) {
+		return result;
+	}
+	rootSignatureHashes_[created.Get()] =
+	  HashBytes(kFnvOffsetBasis, blob->GetBufferPointer(), blob->GetBufferSize());
+	return created->QueryInterface(riid, rootSignature);
+}
+
+HRESULT PipelineCache::CreateGraphicsPipelineState(
+  const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, REFIID riid, void** pipelineState) {
+	assert(device_);
+	auto startTime = std::chrono::steady_clock::now();
+
+	// ライブラリから読み込む（同じ名前で設定が違えばE_INVALIDARGになり、生成に回る）
+	uint64_t hash = 0;
+	bool cacheable = library_ && ComputeHash(desc, hash);
+	wchar_t name[32];
+	swprintf_s(name, L"PSO_%016llx", static_cast<unsigned long long>(hash));
+	HRESULT result = E_FAIL;
+	if (cacheable) {
+		result = library_->LoadGraphicsPipeline(name, &desc, riid, pipelineState);
+	}
+	bool loaded = SUCCEEDED(result);
+
+	// なければ生成してライブラリに登録
+	if (!loaded) {
+		ComPtr<ID3D12PipelineState> created;
+		result = device_->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&created));
+		if (FAILED(result)) {
+			return result;
+		}
+		// 名前が衝突した場合（ハッシュの衝突）は登録しない
+		if (cacheable && SUCCEEDED(library_->StorePipeline(name, created.Get()))) {
+			dirty_ = true;
+		}
+		result = created->QueryInterface(riid, pipelineState);
+	}
+
+	double seconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	statistics_.seconds += seconds;
+	if (loaded) {
+		statistics_.loadCount++;
+	} else {
+		statistics_.createCount++;
+		// ライブラリにない分は、ライブラリなしの起動時間として積み上げる
+		header_.coldSeconds += seconds;
+	}
+	return result;
+}
+
+void PipelineCache::Save() {
+	if (!library_ || !dirty_) {
+		return;
+	}
+
+	std::vector<char> data(library_->GetSerializedSize());
+	HRESULT result = library_->Serialize(data.data(), data.size());
+	assert(SUCCEEDED(result));
+	if (FAILED(result)) {
+		return;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(filePath_).parent_path(), error);
+	std::ofstream file(std::filesystem::path(filePath_), std::ios::binary);
+	file.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+	file.write(data.data(), data.size());
+	dirty_ = false;
+}
+
+void PipelineCache::OutputStatistics() const {
+	char str[256];
+	sprintf_s(
+	  str, "PipelineCache: %s start, %u from library, %u created, %.3fms (cold %.3fms)\n",
+	  statistics_.createCount == 0 && statistics_.loadCount > 0 ? "warm" : "cold",
+	  statistics_.loadCount, statistics_.createCount, statistics_.seconds * 1000.0,
+	  header_.coldSeconds * 1000.0);
+	OutputDebugStringA(str);
+}
+
+void PipelineCache::GetAdapterInfo(FileHeader& header) const {
+	header.vendorId = 0;
+	header.deviceId = 0;
+	header.driverVersion = 0;
+
+	// デバイスのアダプタを探す
+	ComPtr<IDXGIFactory4> factory;
+	ComPtr<IDXGIAdapter1> adapter;
+	if (
+	  FAILED(CreateDXGIFactory1(IID_PPV_ARGS(&factory))) ||
+	  FAILED(factory->EnumAdapterByLuid(device_->GetAdapterLuid(), IID_PPV_ARGS(&adapter)))) {
+		return;
+	}
+	DXGI_ADAPTER_DESC1 adapterDesc{};
+	adapter->GetDesc1(&adapterDesc);
+	header.vendorId = adapterDesc.VendorId;
+	header.deviceId = adapterDesc.DeviceId;
+
+	// ユーザーモードドライバのバージョン
+	LARGE_INTEGER umdVersion{};
+	if (SUCCEEDED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &umdVersion))) {
+		header.driverVersion = static_cast<uint64_t>(umdVersion.QuadPart);
+	}
+}
+
+bool PipelineCache::ComputeHash(
+  const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t& hash) const {
+	auto itr = rootSignatureHashes_.find(desc.pRootSignature);
+	if (itr == rootSignatureHashes_.end()) {
+		return false;
+	}
+	hash = HashValue(kFnvOffsetBasis, itr->second);
+
+	// シェーダ
+	hash = HashBytecode(hash, desc.VS);
+	hash = HashBytecode(hash, desc.PS);
+	hash = HashBytecode(hash, desc.DS);
+	hash = HashBytecode(hash, desc.HS);
+	hash = HashBytecode(hash, desc.GS);
+
+	// ストリーム出力
+	const D3D12_STREAM_OUTPUT_DESC& streamOutput = desc.StreamOutput;
+	hash = HashValue(hash, streamOutput.NumEntries);
+	for (UINT i = 0; i < streamOutput.NumEntries; i++) {
+		const D3D12_SO_DECLARATION_ENTRY& entry = streamOutput.pSODeclaration[i];
+		hash = HashValue(hash, entry.Stream);
+		hash = HashString(hash, entry.SemanticName);
+		hash = HashValue(hash, entry.SemanticIndex);
+		hash = HashValue(hash, entry.StartComponent);
+		hash = HashValue(hash, entry.ComponentCount);
+		hash = HashValue(hash, entry.OutputSlot);
+	}
+	hash = HashValue(hash, streamOutput.NumStrides);
+	for (UINT i = 0; i < streamOutput.NumStrides; i++) {
+		hash = HashValue(hash, streamOutput.pBufferStrides[i]);
+	}
+	hash = HashValue(hash, streamOutput.RasterizedStream);
+
+	// ブレンド
+	hash = HashValue(hash, desc.BlendState.AlphaToCoverageEnable);
+	hash = HashValue(hash, desc.BlendState.IndependentBlendEnable);
+	for (const D3D12_RENDER_TARGET_BLEND_DESC& blend : desc.BlendState.RenderTarget) {
+		hash = HashValue(hash, blend.BlendEnable);
+		hash = HashValue(hash, blend.LogicOpEnable);
+		hash = HashValue(hash, blend.SrcBlend);
+		hash = HashValue(hash, blend.DestBlend);
+		hash = HashValue(hash, blend.BlendOp);
+		hash = HashValue(hash, blend.SrcBlendAlpha);
+		hash = HashValue(hash, blend.DestBlendAlpha);
+		hash = HashValue(hash, blend.BlendOpAlpha);
+		hash = HashValue(hash, blend.LogicOp);
+		hash = HashValue(hash, blend.RenderTargetWriteMask);
+	}
+	hash = HashValue(hash, desc.SampleMask);
+
+	// ラスタライザ
+	const D3D12_RASTERIZER_DESC& rasterizer = desc.RasterizerState;
+	hash = HashValue(hash, rasterizer.FillMode);
+	hash = HashValue(hash, rasterizer.CullMode);
+	hash = HashValue(hash, rasterizer.FrontCounterClockwise);
+	hash = HashValue(hash, rasterizer.DepthBias);
+	hash = HashValue(hash, rasterizer.DepthBiasClamp);
+	hash = HashValue(hash, rasterizer.SlopeScaledDepthBias);
+	hash = HashValue(hash, rasterizer.DepthClipEnable);
+	hash = HashValue(hash, rasterizer.MultisampleEnable);
+	hash = HashValue(hash, rasterizer.AntialiasedLineEnable);
+	hash = HashValue(hash, rasterizer.ForcedSampleCount);
+	hash = HashValue(hash, rasterizer.ConservativeRaster);
+
+	// デプスステンシル
+	const D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+	hash = HashValue(hash, depthStencil.DepthEnable);
+	hash = HashValue(hash, depthStencil.DepthWriteMask);
+	hash = HashValue(hash, depthStencil.DepthFunc);
+	hash = HashValue(hash, depthStencil.StencilEnable);
+	hash = HashValue(hash, depthStencil.StencilReadMask);
+	hash = HashValue(hash, depthStencil.StencilWriteMask);
+	hash = HashDepthStencilOp(hash, depthStencil.FrontFace);
+	hash = HashDepthStencilOp(hash, depthStencil.BackFace);
+
+	// 頂点レイアウト
+	hash = HashValue(hash, desc.InputLayout.NumElements);
+	for (UINT i = 0; i < desc.InputLayout.NumElements; i++) {
+		const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+		hash = HashString(hash, element.SemanticName);
+		hash = HashValue(hash, element.SemanticIndex);
+		hash = HashValue(hash, element.Format);
+		hash = HashValue(hash, element.InputSlot);
+		hash = HashValue(hash, element.AlignedByteOffset);
+		hash = HashValue(hash, element.InputSlotClass);
+		hash = HashValue(hash, element.InstanceDataStepRate);
+	}
+
+	// 出力先など
+	hash = HashValue(hash, desc.IBStripCutValue);
+	hash = HashValue(hash, desc.PrimitiveTopologyType);
+	hash = HashValue(hash, desc.NumRenderTargets);
+	for (DXGI_FORMAT format : desc.RTVFormats) {
+		hash = HashValue(hash, format);
+	}
+	hash = HashValue(hash, desc.DSVFormat);
+	hash = HashValue(hash, desc.SampleDesc.Count);
+	hash = HashValue(hash, desc.SampleDesc.Quality);
+	hash = HashValue(hash, desc.NodeMask);
+	hash = HashValue(hash, desc.Flags);
+	return true;
+}
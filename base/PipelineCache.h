@@ -0,0 +1,132 @@
+﻿#pragma once
+
+#include <Windows.h>
+#include <d3d12.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <wrl.h>
+
+/// <summary>
+/// パイプラインステートのキャッシュ
+/// 生成したパイプラインをID3D12PipelineLibraryに登録してファイルに保存し、次回の起動では
+/// ライブラリから読み込んでドライバ内のシェーダコンパイルを省く
+/// パイプラインはD3D12_GRAPHICS_PIPELINE_STATE_DESCの全内容のハッシュで識別する
+/// （メインスレッドからのみ使用する）
+/// </summary>
+class PipelineCache {
+  public: // 定数
+	// 保存先
+	static const std::wstring kFilePath;
+
+  public: // サブクラス
+	// 統計
+	struct Statistics {
+		uint32_t loadCount = 0;   // ライブラリから読み込んだ数
+		uint32_t createCount = 0; // 生成した数
+		double seconds = 0.0;     // 今回の起動でパイプラインの用意にかかった時間
+		double coldSeconds = 0.0; // ライブラリなしで全て生成したときにかかった時間
+	};
+
+  public: // 静的メンバ関数
+	/// <summary>
+	/// シングルトンインスタンスの取得
+	/// </summary>
+	/// <returns>シングルトンインスタンス</returns>
+	static PipelineCache* GetInstance();
+
+  public: // メンバ関数
+	/// <summary>
+	/// 初期化（保存済みのライブラリがあれば読み込む）
+	/// ドライバやアダプタが変わっていたら保存済みのライブラリは捨てる
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="filePath">保存先</param>
+	void Initialize(ID3D12Device* device, const std::wstring& filePath = kFilePath);
+
+	/// <summary>
+	/// ルートシグネチャの生成
+	/// シリアライズ結果のハッシュを覚えておき、パイプラインの識別に使う
+	/// </summary>
+	/// <param name="blob">シリアライズしたルートシグネチャ</param>
+	/// <param name="riid">インターフェースのID</param>
+	/// <param name="rootSignature">生成したルートシグネチャ</param>
+	/// <returns>結果</returns>
+	HRESULT CreateRootSignature(ID3DBlob* blob, REFIID riid, void** rootSignature);
+
+	/// <summary>
+	/// グラフィックスパイプラインの生成（ライブラリにあれば読み込む）
+	/// ルートシグネチャはCreateRootSignatureで生成したものでないとキャッシュしない
+	/// </summary>
+	/// <param name="desc">パイプライン設定</param>
+	/// <param name="riid">インターフェースのID</param>
+	/// <param name="pipelineState">生成したパイプライン</param>
+	/// <returns>結果</returns>
+	HRESULT CreateGraphicsPipelineState(
+	  const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, REFIID riid, void** pipelineState);
+
+	/// <summary>
+	/// 新しく生成したパイプラインがあればライブラリをファイルに保存する
+	/// </summary>
+	void Save();
+
+	/// <summary>
+	/// 統計の取得
+	/// </summary>
+	/// <returns>統計</returns>
+	const Statistics& GetStatistics() const { return statistics_; }
+
+	/// <summary>
+	/// 統計を出力ウィンドウに表示
+	/// </summary>
+	void OutputStatistics() const;
+
+  private: // サブクラス
+	// ファイルの先頭
+	struct FileHeader {
+		uint32_t magic;         // 識別子
+		uint32_t version;       // 形式のバージョン
+		uint32_t vendorId;      // アダプタのベンダー
+		uint32_t deviceId;      // アダプタのデバイス
+		uint64_t driverVersion; // ドライバのバージョン
+		double coldSeconds;     // ライブラリなしで全て生成したときにかかった時間
+	};
+
+  private: // メンバ関数
+	PipelineCache() = default;
+	~PipelineCache() = default;
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	/// <summary>
+	/// 現在のアダプタとドライバの情報を取得する
+	/// </summary>
+	/// <param name="header">情報の書き込み先</param>
+	void GetAdapterInfo(FileHeader& header) const;
+
+	/// <summary>
+	/// パイプライン設定のハッシュを求める
+	/// </summary>
+	/// <param name="desc">パイプライン設定</param>
+	/// <param name="hash">ハッシュ</param>
+	/// <returns>求められたか（ルートシグネチャが未登録ならfalse）</returns>
+	bool ComputeHash(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t& hash) const;
+
+  private: // メンバ変数
+	// デバイス
+	ID3D12Device* device_ = nullptr;
+	// パイプラインライブラリ（非対応のデバイスではnullptr）
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> library_;
+	// ライブラリの元データ（ライブラリが参照するので破棄しない）
+	std::vector<char> libraryData_;
+	// 保存先
+	std::wstring filePath_;
+	// アダプタとドライバの情報
+	FileHeader header_{};
+	// 保存していないパイプラインがあるか
+	bool dirty_ = false;
+	// ルートシグネチャ → シリアライズ結果のハッシュ
+	std::unordered_map<ID3D12RootSignature*, uint64_t> rootSignatureHashes_;
+	// 統計
+	Statistics statistics_;
+};
@@ -0,0 +1,55 @@
+﻿#include "RingAllocator.h"
+#include <cassert>
+
+void RingAllocator::Initialize(uint64_t size) {
+	size_ = size;
+	head_ = 0;
+	usedSize_ = 0;
+	frameSize_ = 0;
+	frames_.clear();
+}
+
+uint64_t RingAllocator::Allocate(uint64_t size, uint64_t alignment) {
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+	if (size == 0 || size > size_) {
+		return kInvalidOffset;
+	}
+
+	uint64_t offset = (head_ + alignment - 1) & ~(alignment - 1);
+	// 末尾に収まらなければ先頭に戻る
+	if (offset + size > size_) {
+		offset = 0;
+	}
+
+	// 読み飛ばした分も含めて空きに収まるか
+	uint64_t consumed = (offset >= head_ ? offset - head_ : size_ - head_) + size;
+	if (usedSize_ + consumed > size_) {
+		return kInvalidOffset;
+	}
+
+	head_ = offset + size;
+	usedSize_ += consumed;
+	frameSize_ += consumed;
+	return offset;
+}
+
+void RingAllocator::FinishFrame(uint64_t fenceValue) {
+	if (frameSize_ == 0) {
+		return;
+	}
+	assert(frames_.empty() || frames_.back().fenceValue <= fenceValue);
+	frames_.push_back({fenceValue, frameSize_});
+	frameSize_ = 0;
+}
+
+void RingAllocator::Release(uint64_t completedFenceValue) {
+	while (!frames_.empty() && frames_.front().fenceValue <= completedFenceValue) {
+		usedSize_ -= frames_.front().size;
+		frames_.pop_front();
+	}
+	// 空になったら先頭から使い直す（折り返しで捨てる分を減らす）
+	if (usedSize_ == 0) {
+		head_ = 0;
+	}
+}
+
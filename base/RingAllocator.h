@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <deque>
+
+/// <summary>
+/// フレーム単位で解放するリングバッファの割り当て
+/// 先頭から順に切り出し、GPUが使い終わったフレームの分をまとめて返す
+/// オフセットだけを扱うので、バッファ本体やフェンスを用意しなくても動作を確認できる
+/// </summary>
+class RingAllocator {
+  public: // 定数
+	// 割り当て失敗
+	static const uint64_t kInvalidOffset = UINT64_MAX;
+
+  public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="size">リング全体のバイト数</param>
+	void Initialize(uint64_t size);
+
+	/// <summary>
+	/// 割り当て
+	/// 末尾に収まらない場合は残りを捨てて先頭から切り出す
+	/// </summary>
+	/// <param name="size">バイト数</param>
+	/// <param name="alignment">アラインメント（2の累乗）</param>
+	/// <returns>オフセット（空きがなければkInvalidOffset）</returns>
+	uint64_t Allocate(uint64_t size, uint64_t alignment);
+
+	/// <summary>
+	/// フレームの終了（ここまでの割り当てをフェンス値と結び付ける）
+	/// </summary>
+	/// <param name="fenceValue">このフレームのコマンドの完了を示すフェンス値</param>
+	void FinishFrame(uint64_t fenceValue);
+
+	/// <summary>
+	/// GPUの処理が完了したフレームの割り当てを解放する
+	/// </summary>
+	/// <param name="completedFenceValue">完了済みのフェンス値</param>
+	void Release(uint64_t completedFenceValue);
+
+	/// <summary>
+	/// リング全体のバイト数を取得
+	/// </summary>
+	/// <returns>バイト数</returns>
+	uint64_t GetSize() const { return size_; }
+
+	/// <summary>
+	/// 使用中のバイト数を取得（アラインメントと折り返しで捨てた分を含む）
+	/// </summary>
+	/// <returns>バイト数</returns>
+	uint64_t GetUsedSize() const { return usedSize_; }
+
+  private: // サブクラス
+	// 完了待ちのフレーム
+	struct Frame {
+		uint64_t fenceValue; // 完了を示すフェンス値
+		uint64_t size;       // 使用したバイト数
+	};
+
+  private: // メンバ変数
+	// リング全体のバイト数
+	uint64_t size_ = 0;
+	// 次に切り出す位置
+	uint64_t head_ = 0;
+	// 使用中のバイト数
+	uint64_t usedSize_ = 0;
+	// 現在のフレームで使用したバイト数
+	uint64_t frameSize_ = 0;
+	// 完了待ちのフレーム（古い順）
+	std::deque<Frame> frames_;
+};
@@ -0,0 +1,325 @@
+﻿#include "ShaderCache.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#pragma comment(lib, "d3dcompiler.lib")
+
+using namespace Microsoft::WRL;
+
+/// <summary>
+/// 静的メンバ変数の実体
+/// </summary>
+const std::wstring ShaderCache::kCacheDirectory = L"Resources/shaders/cache/";
+const std::wstring ShaderCache::kManifestPath = L"Resources/shaders/ShaderCache.txt";
+
+namespace {
+
+// 実行時コンパイルの設定（デバッグ用）
+const UINT kDebugFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+// キャッシュに保存するバイトコードの設定
+const UINT kReleaseFlags = D3DCOMPILE_OPTIMIZATION_LEVEL3;
+
+// FNV-1aハッシュ
+const uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ull;
+const uint64_t kFnvPrime = 0x100000001b3ull;
+
+inline uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * kFnvPrime;
+	}
+	return hash;
+}
+
+// 文字列を終端込みでハッシュする（区切りを区別するため）
+inline uint64_t HashString(uint64_t hash, const char* str) {
+	return HashBytes(hash, str, strlen(str) + 1);
+}
+
+// ソースと、そこから#include "..."されるファイルを再帰的にハッシュする
+bool HashSource(
+  const std::filesystem::path& filePath, uint64_t& hash,
+  std::vector<std::filesystem::path>& visited) {
+	std::filesystem::path normalPath = filePath.lexically_normal();
+	for (const auto& path : visited) {
+		if (path == normalPath) {
+			return true;
+		}
+	}
+	visited.push_back(normalPath);
+
+	std::ifstream file(normalPath, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	std::string source(
+	  (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	hash = HashBytes(hash, source.data(), source.size());
+
+	std::istringstream stream(source);
+	std::string line;
+	while (std::getline(stream, line)) {
+		size_t pos = line.find_first_not_of(" \t");
+		if (pos == std::string::npos || line.compare(pos, 8, "#include") != 0) {
+			continue;
+		}
+		size_t begin = line.find('"', pos);
+		size_t end = begin != std::string::npos ? line.find('"', begin + 1) : std::string::npos;
+		if (end == std::string::npos) {
+			continue;
+		}
+		// インクルードは読み込み元からの相対パス
+		std::filesystem::path includePath =
+		  normalPath.parent_path() / line.substr(begin + 1, end - begin - 1);
+		if (!HashSource(includePath, hash, visited)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// 一覧の1項目
+struct ManifestEntry {
+	std::wstring filePath;
+	std::string target;
+	std::vector<std::pair<std::string, std::string>> defines;
+	std::vector<D3D_SHADER_MACRO> macros;
+};
+
+// シェーダの一覧を読み込む（#から行末まではコメント）
+bool LoadManifest(const std::wstring& manifestPath, std::vector<ManifestEntry>& entries) {
+	std::filesystem::path path = manifestPath;
+	std::ifstream file(path);
+	if (!file) {
+		return false;
+	}
+	std::filesystem::path directory = path.parent_path();
+	std::string line;
+	while (std::getline(file, line)) {
+		line = line.substr(0, line.find('#'));
+		std::istringstream stream(line);
+		std::string fileName, target;
+		if (!(stream >> fileName >> target)) {
+			continue;
+		}
+		ManifestEntry entry;
+		entry.filePath = (directory / fileName).wstring();
+		entry.target = target;
+		std::string define;
+		while (stream >> define) {
+			size_t pos = define.find('=');
+			entry.defines.emplace_back(
+			  define.substr(0, pos), pos != std::string::npos ? define.substr(pos + 1) : "1");
+		}
+		entries.push_back(std::move(entry));
+	}
+
+	// 配列の再確保が終わってからマクロ定義の文字列を指す
+	for (ManifestEntry& entry : entries) {
+		for (const auto& define : entry.defines) {
+			entry.macros.push_back({define.first.c_str(), define.second.c_str()});
+		}
+		entry.macros.push_back({nullptr, nullptr});
+	}
+	return true;
+}
+
+} // namespace
+
+ShaderCache* ShaderCache::GetInstance() {
+	static ShaderCache instance;
+	return &instance;
+}
+
+ComPtr<ID3DBlob> ShaderCache::Load(
+  const std::wstring& filePath, const D3D_SHADER_MACRO* defines, const char* target) {
+	// 先読み済みならそれを使う
+	std::wstring key = GetBlobKey(filePath, defines, target);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = blobs_.find(key);
+		if (it != blobs_.end()) {
+			statistics_.loadCount++;
+			statistics_.reuseCount++;
+			return it->second;
+		}
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	bool hit = false;
+#ifdef _DEBUG
+	// デバッグ用設定で毎回コンパイル（シェーダの編集をすぐ反映できる）
+	ComPtr<ID3DBlob> blob = Compile(filePath, defines, target, kDebugFlags);
+#else
+	ComPtr<ID3DBlob> blob = LoadCached(filePath, defines, target, hit);
+#endif
+	if (!blob) {
+		exit(1);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	blobs_.emplace(key, blob);
+	statistics_.loadCount++;
+	statistics_.hitCount += hit ? 1 : 0;
+	statistics_.compileCount += hit ? 0 : 1;
+	statistics_.seconds +=
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	return blob;
+}
+
+bool ShaderCache::Build(const std::wstring& manifestPath) {
+	std::vector<ManifestEntry> entries;
+	if (!LoadManifest(manifestPath, entries)) {
+		OutputDebugStringA("ShaderCache::Build: manifest not found\n");
+		return false;
+	}
+
+	bool succeeded = true;
+	char str[256];
+	for (const ManifestEntry& entry : entries) {
+		bool hit = false;
+		ComPtr<ID3DBlob> blob =
+		  LoadCached(entry.filePath, entry.macros.data(), entry.target.c_str(), hit);
+		succeeded &= blob != nullptr;
+		sprintf_s(
+		  str, "ShaderCache::Build %ls %s: %s\n", entry.filePath.c_str(), entry.target.c_str(),
+		  !blob ? "FAILED" : (hit ? "up to date" : "compiled"));
+		OutputDebugStringA(str);
+	}
+	return succeeded;
+}
+
+std::vector<TaskGraph::TaskId>
+  ShaderCache::AddPreloadTasks(TaskGraph& taskGraph, const std::wstring& manifestPath) {
+	// マクロ定義は一覧の文字列を指すので、タスクが終わるまで一覧を残す
+	auto entries = std::make_shared<std::vector<ManifestEntry>>();
+	std::vector<TaskGraph::TaskId> tasks;
+	if (!LoadManifest(manifestPath, *entries)) {
+		return tasks;
+	}
+
+	for (size_t i = 0; i < entries->size(); i++) {
+		const ManifestEntry& entry = (*entries)[i];
+		std::string name = std::filesystem::path(entry.filePath).filename().string();
+		for (const auto& define : entry.defines) {
+			name += " " + define.first;
+		}
+		tasks.push_back(taskGraph.Add(name, [this, entries, i]() {
+			const ManifestEntry& entry = (*entries)[i];
+			Load(entry.filePath, entry.macros.data(), entry.target.c_str());
+		}));
+	}
+	return tasks;
+}
+
+ShaderCache::Statistics ShaderCache::GetStatistics() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return statistics_;
+}
+
+void ShaderCache::OutputStatistics() const {
+	Statistics statistics = GetStatistics();
+	char str[256];
+	sprintf_s(
+	  str, "ShaderCache: loaded %u (%u from cache, %u compiled, %u reused), %.3fms\n",
+	  statistics.loadCount, statistics.hitCount, statistics.compileCount, statistics.reuseCount,
+	  statistics.seconds * 1000.0);
+	OutputDebugStringA(str);
+}
+
+ComPtr<ID3DBlob> ShaderCache::LoadCached(
+  const std::wstring& filePath, const D3D_SHADER_MACRO* defines, const char* target,
+  bool& hit) {
+	hit = false;
+	std::wstring cachePath = GetCachePath(filePath, defines, target, kReleaseFlags);
+	if (cachePath.empty()) {
+		OutputDebugStringA("ShaderCache: shader source not found\n");
+		return nullptr;
+	}
+
+	// キャッシュがあればそのまま使う
+	ComPtr<ID3DBlob> blob;
+	if (SUCCEEDED(D3DReadFileToBlob(cachePath.c_str(), &blob))) {
+		hit = true;
+		return blob;
+	}
+
+	// なければ最適化コンパイルして保存
+	blob = Compile(filePath, defines, target, kReleaseFlags);
+	if (blob) {
+		std::error_code error;
+		std::filesystem::create_directories(kCacheDirectory, error);
+		D3DWriteBlobToFile(blob.Get(), cachePath.c_str(), TRUE);
+	}
+	return blob;
+}
+
+ComPtr<ID3DBlob> ShaderCache::Compile(
+  const std::wstring& filePath, const D3D_SHADER_MACRO* defines, const char* target,
+  UINT flags) {
+	ComPtr<ID3DBlob> blob;
+	ComPtr<ID3DBlob> errorBlob; // エラーオブジェクト
+	HRESULT result = D3DCompileFromFile(
+	  filePath.c_str(), // シェーダファイル名
+	  defines,
+	  D3D_COMPILE_STANDARD_FILE_INCLUDE, // インクルード可能にする
+	  "main", target, // エントリーポイント名、シェーダーモデル指定
+	  flags, 0, &blob, &errorBlob);
+	if (FAILED(result)) {
+		// エラー内容を出力ウィンドウに表示
+		if (errorBlob) {
+			std::string errstr(
+			  static_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
+			errstr += "\n";
+			OutputDebugStringA(errstr.c_str());
+		}
+		return nullptr;
+	}
+	return blob;
+}
+
+std::wstring ShaderCache::GetCachePath(
+  const std::wstring& filePath, const D3D_SHADER_MACRO* defines, const char* target,
+  UINT flags) {
+	// ソースとインクルードの内容
+	uint64_t hash = kFnvOffsetBasis;
+	std::vector<std::filesystem::path> visited;
+	if (!HashSource(filePath, hash, visited)) {
+		return std::wstring();
+	}
+
+	// マクロ定義・ターゲット・コンパイルオプション
+	for (const D3D_SHADER_MACRO* define = defines; define && define->Name; define++) {
+		hash = HashString(hash, define->Name);
+		hash = HashString(hash, define->Definition ? define->Definition : "");
+	}
+	hash = HashString(hash, target);
+	hash = HashBytes(hash, &flags, sizeof(flags));
+
+	// 元のファイル名を残して、どのシェーダか分かるようにする
+	wchar_t name[32];
+	swprintf_s(name, L"_%016llx.cso", static_cast<unsigned long long>(hash));
+	return kCacheDirectory + std::filesystem::path(filePath).stem().wstring() + name;
+}
+
+std::wstring ShaderCache::GetBlobKey(
+  const std::wstring& filePath, const D3D_SHADER_MACRO* defines, const char* target) {
+	// 一覧とコードで区切り文字の違う同じパスを同一視する
+	std::wstring key = std::filesystem::path(filePath).lexically_normal().wstring();
+	for (const D3D_SHADER_MACRO* define = defines; define && define->Name; define++) {
+		const char* definition = define->Definition ? define->Definition : "";
+		key += L'|';
+		key.append(define->Name, define->Name + strlen(define->Name));
+		key += L'=';
+		key.append(definition, definition + strlen(definition));
+	}
+	key += L'|';
+	key.append(target, target + strlen(target));
+	return key;
+}
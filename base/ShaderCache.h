@@ -0,0 +1,141 @@
+﻿#pragma once
+
+#include "TaskGraph.h"
+#include <Windows.h>
+#include <d3dcompiler.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <wrl.h>
+
+/// <summary>
+/// シェーダのバイトコードキャッシュ
+/// ソース（インクルードを含む）のハッシュ・マクロ定義・ターゲットをキーに、最適化済みの
+/// バイトコードをファイルに保存しておき、起動時のコンパイルを省く
+/// Debugビルドはデバッグ情報付きで毎回コンパイルする（キャッシュは使わない）
+/// 読み込んだバイトコードはメモリにも残すので、起動時に並列で先読みしておける
+/// </summary>
+class ShaderCache {
+  public: // 定数
+	// キャッシュの保存先
+	static const std::wstring kCacheDirectory;
+	// 事前コンパイルするシェーダの一覧
+	static const std::wstring kManifestPath;
+
+  public: // サブクラス
+	// 統計
+	struct Statistics {
+		uint32_t loadCount = 0;    // 読み込み数
+		uint32_t hitCount = 0;     // キャッシュから読み込んだ数
+		uint32_t compileCount = 0; // コンパイルした数
+		uint32_t reuseCount = 0;   // 読み込み済みのものを使った数
+		double seconds = 0.0;      // 読み込みにかかった時間
+	};
+
+  public: // 静的メンバ関数
+	/// <summary>
+	/// シングルトンインスタンスの取得
+	/// </summary>
+	/// <returns>シングルトンインスタンス</returns>
+	static ShaderCache* GetInstance();
+
+  public: // メンバ関数
+	/// <summary>
+	/// シェーダの読み込み（失敗したらエラー内容を出力して終了、ワーカースレッドから呼べる）
+	/// </summary>
+	/// <param name="filePath">シェーダファイル名</param>
+	/// <param name="defines">マクロ定義（nullptr終端、なければnullptr）</param>
+	/// <param name="target">シェーダーモデル指定</param>
+	/// <returns>バイトコード</returns>
+	Microsoft::WRL::ComPtr<ID3DBlob>
+	  Load(const std::wstring& filePath, const D3D_SHADER_MACRO* defines, const char* target);
+
+	/// <summary>
+	/// 一覧のシェーダを全てコンパイルしてキャッシュに保存する（ビルド後の処理から呼ぶ）
+	/// 一覧は1行に「ファイル名 ターゲット [名前=値 ...]」で、ファイル名は一覧からの相対パス
+	/// </summary>
+	/// <param name="manifestPath">シェーダの一覧</param>
+	/// <returns>全て成功したか</returns>
+	bool Build(const std::wstring& manifestPath = kManifestPath);
+
+	/// <summary>
+	/// 一覧のシェーダを1つずつ読み込むタスクを追加する
+	/// </summary>
+	/// <param name="taskGraph">タスクグラフ</param>
+	/// <param name="manifestPath">シェーダの一覧</param>
+	/// <returns>追加したタスク</returns>
+	std::vector<TaskGraph::TaskId>
+	  AddPreloadTasks(TaskGraph& taskGraph, const std::wstring& manifestPath = kManifestPath);
+
+	/// <summary>
+	/// 統計の取得
+	/// </summary>
+	/// <returns>統計</returns>
+	Statistics GetStatistics() const;
+
+	/// <summary>
+	/// 統計を出力ウィンドウに表示
+	/// </summary>
+	void OutputStatistics() const;
+
+  private: // メンバ関数
+	ShaderCache() = default;
+	~ShaderCache() = default;
+	ShaderCache(const ShaderCache&) = delete;
+	ShaderCache& operator=(const ShaderCache&) = delete;
+
+	/// <summary>
+	/// キャッシュから読み込む（なければ最適化コンパイルして保存する）
+	/// </summary>
+	/// <param name="filePath">シェーダファイル名</param>
+	/// <param name="defines">マクロ定義</param>
+	/// <param name="target">シェーダーモデル指定</param>
+	/// <param name="hit">キャッシュから読み込めたか</param>
+	/// <returns>バイトコード（コンパイルに失敗したらnullptr）</returns>
+	static Microsoft::WRL::ComPtr<ID3DBlob> LoadCached(
+	  const std::wstring& filePath, const D3D_SHADER_MACRO* defines, const char* target,
+	  bool& hit);
+
+	/// <summary>
+	/// コンパイル（失敗したらエラー内容を出力ウィンドウに表示）
+	/// </summary>
+	/// <param name="filePath">シェーダファイル名</param>
+	/// <param name="defines">マクロ定義</param>
+	/// <param name="target">シェーダーモデル指定</param>
+	/// <param name="flags">コンパイルオプション</param>
+	/// <returns>バイトコード（失敗したらnullptr）</returns>
+	static Microsoft::WRL::ComPtr<ID3DBlob> Compile(
+	  const std::wstring& filePath, const D3D_SHADER_MACRO* defines, const char* target,
+	  UINT flags);
+
+	/// <summary>
+	/// キャッシュファイル名を求める
+	/// </summary>
+	/// <param name="filePath">シェーダファイル名</param>
+	/// <param name="defines">マクロ定義</param>
+	/// <param name="target">シェーダーモデル指定</param>
+	/// <param name="flags">コンパイルオプション</param>
+	/// <returns>キャッシュファイル名（ソースが読めなければ空）</returns>
+	static std::wstring GetCachePath(
+	  const std::wstring& filePath, const D3D_SHADER_MACRO* defines, const char* target,
+	  UINT flags);
+
+	/// <summary>
+	/// 読み込み済みバイトコードのキーを求める
+	/// </summary>
+	/// <param name="filePath">シェーダファイル名</param>
+	/// <param name="defines">マクロ定義</param>
+	/// <param name="target">シェーダーモデル指定</param>
+	/// <returns>キー</returns>
+	static std::wstring
+	  GetBlobKey(const std::wstring& filePath, const D3D_SHADER_MACRO* defines, const char* target);
+
+  private: // メンバ変数
+	// 統計
+	Statistics statistics_;
+	// 読み込み済みバイトコード
+	std::unordered_map<std::wstring, Microsoft::WRL::ComPtr<ID3DBlob>> blobs_;
+	// 排他制御
+	mutable std::mutex mutex_;
+};
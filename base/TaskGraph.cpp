@@ -0,0 +1,163 @@
+﻿#include "TaskGraph.h"
+#include <Windows.h>
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+using namespace std;
+
+TaskGraph::TaskId TaskGraph::Add(
+  const std::string& name, std::function<void()> function,
+  const std::vector<TaskId>& dependencies, Thread thread) {
+	TaskId id = static_cast<TaskId>(tasks_.size());
+	Task task;
+	task.name = name;
+	task.function = std::move(function);
+	task.thread = thread;
+	task.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	tasks_.push_back(std::move(task));
+
+	// 依存先は追加済みのタスクなので、循環はできない
+	for (TaskId dependency : dependencies) {
+		assert(dependency < id);
+		tasks_[dependency].dependents.push_back(id);
+	}
+	return id;
+}
+
+void TaskGraph::Run(uint32_t workerCount) {
+	if (workerCount == 0) {
+		workerCount = max<uint32_t>(thread::hardware_concurrency(), 2) - 1;
+	}
+	workerCount_ = workerCount;
+	startTime_ = chrono::steady_clock::now();
+	finishedCount_ = 0;
+	runningCount_ = 0;
+	readyWorkerTasks_.clear();
+	readyMainTasks_.clear();
+
+	// 依存のないタスクから始める
+	for (TaskId id = 0; id < tasks_.size(); id++) {
+		Task& task = tasks_[id];
+		task.remainingCount = task.dependencyCount;
+		if (task.remainingCount == 0) {
+			(task.thread == Thread::kMain ? readyMainTasks_ : readyWorkerTasks_).push_back(id);
+		}
+	}
+
+	vector<thread> workers;
+	workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; i++) {
+		workers.emplace_back(&TaskGraph::WorkerMain, this, i + 1);
+	}
+
+	// メインスレッド用のタスクを実行
+	for (;;) {
+		TaskId id;
+		{
+			unique_lock<mutex> lock(mutex_);
+			condition_.wait(lock, [this]() {
+				return !readyMainTasks_.empty() || finishedCount_ == tasks_.size();
+			});
+			if (readyMainTasks_.empty()) {
+				break;
+			}
+			id = readyMainTasks_.front();
+			readyMainTasks_.pop_front();
+			runningCount_++;
+		}
+		Execute(id, 0);
+	}
+
+	for (thread& worker : workers) {
+		worker.join();
+	}
+	totalSeconds_ = chrono::duration<double>(chrono::steady_clock::now() - startTime_).count();
+}
+
+std::vector<TaskGraph::TimelineEntry> TaskGraph::GetTimeline() const {
+	vector<TimelineEntry> timeline;
+	timeline.reserve(tasks_.size());
+	for (const Task& task : tasks_) {
+		timeline.push_back({task.name, task.threadIndex, task.startSeconds, task.endSeconds});
+	}
+	sort(timeline.begin(), timeline.end(), [](const TimelineEntry& a, const TimelineEntry& b) {
+		return a.startSeconds < b.startSeconds;
+	});
+	return timeline;
+}
+
+void TaskGraph::OutputTimeline() const {
+	char str[256];
+	double serialSeconds = 0.0;
+	for (const TimelineEntry& entry : GetTimeline()) {
+		double seconds = entry.endSeconds - entry.startSeconds;
+		serialSeconds += seconds;
+		char threadName[16];
+		if (entry.threadIndex == 0) {
+			sprintf_s(threadName, "main");
+		} else {
+			sprintf_s(threadName, "worker%u", entry.threadIndex);
+		}
+		sprintf_s(
+		  str, "TaskGraph: %-24s %-8s %9.3fms - %9.3fms (%8.3fms)\n", entry.name.c_str(),
+		  threadName, entry.startSeconds * 1000.0, entry.endSeconds * 1000.0, seconds * 1000.0);
+		OutputDebugStringA(str);
+	}
+	sprintf_s(
+	  str, "TaskGraph: %zu tasks on %u workers + main, %.3fms (serial %.3fms x%.2f)\n",
+	  tasks_.size(), workerCount_, totalSeconds_ * 1000.0, serialSeconds * 1000.0,
+	  totalSeconds_ > 0.0 ? serialSeconds / totalSeconds_ : 0.0);
+	OutputDebugStringA(str);
+}
+
+void TaskGraph::WorkerMain(uint32_t threadIndex) {
+	// WICなどCOMを使うタスクのため
+	HRESULT result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	for (;;) {
+		TaskId id;
+		{
+			unique_lock<mutex> lock(mutex_);
+			condition_.wait(lock, [this]() {
+				return !readyWorkerTasks_.empty() || finishedCount_ == tasks_.size();
+			});
+			if (readyWorkerTasks_.empty()) {
+				break;
+			}
+			id = readyWorkerTasks_.front();
+			readyWorkerTasks_.pop_front();
+			runningCount_++;
+		}
+		Execute(id, threadIndex);
+	}
+
+	if (SUCCEEDED(result)) {
+		CoUninitialize();
+	}
+}
+
+void TaskGraph::Execute(TaskId id, uint32_t threadIndex) {
+	Task& task = tasks_[id];
+	task.threadIndex = threadIndex;
+	task.startSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime_).count();
+	if (task.function) {
+		task.function();
+	}
+	task.endSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime_).count();
+
+	// 依存していたタスクを実行可能にする
+	{
+		lock_guard<mutex> lock(mutex_);
+		for (TaskId dependent : task.dependents) {
+			Task& next = tasks_[dependent];
+			if (--next.remainingCount == 0) {
+				(next.thread == Thread::kMain ? readyMainTasks_ : readyWorkerTasks_)
+				  .push_back(dependent);
+			}
+		}
+		runningCount_--;
+		finishedCount_++;
+	}
+	condition_.notify_all();
+}
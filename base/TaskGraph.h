@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// 依存関係つきのタスクを並列に実行する
+/// 依存するタスクが全て終わったものから、ワーカースレッドかメインスレッドで実行する
+/// GPUリソースの生成など、メインスレッドでしか呼べない処理はkMainを指定する
+/// 実行後はタスクごとの開始・終了時刻をタイムラインとして出力できる
+/// </summary>
+class TaskGraph {
+  public: // 型
+	// タスクの番号
+	using TaskId = uint32_t;
+
+  public: // 列挙子
+	// 実行するスレッド
+	enum class Thread {
+		kWorker, // ワーカースレッド
+		kMain,   // Runを呼んだスレッド
+	};
+
+  public: // サブクラス
+	// タイムラインの1項目
+	struct TimelineEntry {
+		std::string name;     // タスク名
+		uint32_t threadIndex; // 実行したスレッド（0がメイン、1以降がワーカー）
+		double startSeconds;  // Runの開始からの開始時刻
+		double endSeconds;    // Runの開始からの終了時刻
+	};
+
+  public: // メンバ関数
+	/// <summary>
+	/// タスクの追加
+	/// </summary>
+	/// <param name="name">タスク名（タイムライン用）</param>
+	/// <param name="function">処理</param>
+	/// <param name="dependencies">先に終わっている必要のあるタスク</param>
+	/// <param name="thread">実行するスレッド</param>
+	/// <returns>タスクの番号</returns>
+	TaskId Add(
+	  const std::string& name, std::function<void()> function,
+	  const std::vector<TaskId>& dependencies = {}, Thread thread = Thread::kWorker);
+
+	/// <summary>
+	/// 全てのタスクを実行し、終わるまで待つ
+	/// </summary>
+	/// <param name="workerCount">ワーカースレッド数（0なら論理コア数-1、最低1）</param>
+	void Run(uint32_t workerCount = 0);
+
+	/// <summary>
+	/// タイムラインの取得（開始時刻順）
+	/// </summary>
+	/// <returns>タイムライン</returns>
+	std::vector<TimelineEntry> GetTimeline() const;
+
+	/// <summary>
+	/// タイムラインを出力ウィンドウに表示
+	/// </summary>
+	void OutputTimeline() const;
+
+  private: // サブクラス
+	// タスク
+	struct Task {
+		std::string name;                // タスク名
+		std::function<void()> function;  // 処理
+		Thread thread;                   // 実行するスレッド
+		std::vector<TaskId> dependents;  // このタスクに依存するタスク
+		uint32_t dependencyCount = 0;    // 依存するタスクの数
+		uint32_t remainingCount = 0;     // 終わっていない依存タスクの数（実行中）
+		uint32_t threadIndex = 0;        // 実行したスレッド
+		double startSeconds = 0.0;       // 開始時刻
+		double endSeconds = 0.0;         // 終了時刻
+	};
+
+  private: // メンバ関数
+	/// <summary>
+	/// ワーカースレッドの処理
+	/// </summary>
+	/// <param name="threadIndex">スレッドの番号</param>
+	void WorkerMain(uint32_t threadIndex);
+
+	/// <summary>
+	/// タスクを実行し、依存するタスクを実行可能にする
+	/// </summary>
+	/// <param name="id">タスクの番号</param>
+	/// <param name="threadIndex">スレッドの番号</param>
+	void Execute(TaskId id, uint32_t threadIndex);
+
+  private: // メンバ変数
+	// タスク
+	std::vector<Task> tasks_;
+	// 実行可能なタスク（ワーカー用）
+	std::deque<TaskId> readyWorkerTasks_;
+	// 実行可能なタスク（メインスレッド用）
+	std::deque<TaskId> readyMainTasks_;
+	// 終わったタスクの数
+	uint32_t finishedCount_ = 0;
+	// 実行中のタスクの数
+	uint32_t runningCount_ = 0;
+	// ワーカースレッド数
+	uint32_t workerCount_ = 0;
+	// 全体の所要時間
+	double totalSeconds_ = 0.0;
+	// 排他制御
+	std::mutex mutex_;
+	// 実行可能なタスクの追加と全タスクの終了の通知
+	std::condition_variable condition_;
+	// Runの開始時刻
+	std::chrono::steady_clock::time_point startTime_;
+};
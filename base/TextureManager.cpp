@@ -1,6 +1,8 @@
 ﻿#include "TextureManager.h"
-#include <DirectXTex.h>
+#include "GpuMemoryAllocator.h"
+#include "UploadManager.h"
 #include <cassert>
+#include <vector>
 
 using namespace DirectX;
 
@@ -8,21 +10,58 @@ uint32_t TextureManager::Load(const std::string& fileName) {
 	return TextureManager::GetInstance()->LoadInternal(fileName);
 }
 
+void TextureManager::Preload(const std::string& fileName) {
+	TextureManager* textureManager = TextureManager::GetInstance();
+	{
+		std::lock_guard<std::mutex> lock(textureManager->preloadMutex_);
+		if (textureManager->preloadedImages_.count(fileName)) {
+			return;
+		}
+	}
+
+	// デコードは排他制御の外で行う
+	ScratchImage image{};
+	textureManager->Decode(fileName, image);
+
+	std::lock_guard<std::mutex> lock(textureManager->preloadMutex_);
+	textureManager->preloadedImages_.emplace(fileName, std::move(image));
+}
+
+void TextureManager::Unload(uint32_t textureHandle) {
+	TextureManager::GetInstance()->UnloadInternal(textureHandle);
+}
+
 TextureManager* TextureManager::GetInstance() {
 	static TextureManager instance;
 	return &instance;
 }
 
-void TextureManager::Initialize(ID3D12Device* device, std::string directoryPath) {
+void TextureManager::Initialize(
+  ID3D12Device* device, std::string directoryPath, uint32_t numDescriptors) {
 	assert(device);
+	assert(0 < numDescriptors && numDescriptors <= DescriptorAllocator::kMaxCapacity);
 
 	device_ = device;
 	directoryPath_ = directoryPath;
+	numDescriptors_ = numDescriptors;
 
 	// デスクリプタサイズを取得
 	sDescriptorHandleIncrementSize_ =
 	  device_->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
+	// 非有界のSRVテーブルはリソースバインディングTier2以上で使える
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options{};
+	HRESULT result =
+	  device_->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options));
+	bindless_ =
+	  SUCCEEDED(result) && options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_2;
+
+	char str[128];
+	sprintf_s(
+	  str, "TextureManager: bindless %s (resource binding tier %d)\n", bindless_ ? "on" : "off",
+	  SUCCEEDED(result) ? static_cast<int>(options.ResourceBindingTier) : 0);
+	OutputDebugStringA(str);
+
 	// 全テクスチャリセット
 	ResetAll();
 }
@@ -34,89 +73,124 @@ void TextureManager::ResetAll() {
 	D3D12_DESCRIPTOR_HEAP_DESC descHeapDesc = {};
 	descHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	descHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE; // シェーダから見えるように
-	descHeapDesc.NumDescriptors = kNumDescriptors; // シェーダーリソースビュー1つ
+	descHeapDesc.NumDescriptors = numDescriptors_; // テクスチャ1枚につきシェーダーリソースビュー1つ
 	result = device_->CreateDescriptorHeap(&descHeapDesc, IID_PPV_ARGS(&descriptorHeap_)); // 生成
 	assert(SUCCEEDED(result));
 
-	indexNextDescriptorHeap_ = 0;
+	descriptorAllocator_.Initialize(numDescriptors_);
+	handles_.clear();
+
+	// 未使用の番号を参照しても黒になるように、全デスクリプタをnullのSRVで埋める
+	for (uint32_t i = 0; i < numDescriptors_; i++) {
+		CreateNullShaderResourceView(i);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(preloadMutex_);
+		preloadedImages_.clear();
+	}
 
 	// 全テクスチャを初期化
-	for (size_t i = 0; i < kNumDescriptors; i++) {
-		textures_[i].resource.Reset();
-		textures_[i].cpuDescHandleSRV.ptr = 0;
-		textures_[i].gpuDescHandleSRV.ptr = 0;
-		textures_[i].name.clear();
+	textures_.clear();
+	textures_.resize(numDescriptors_);
+}
+
+void TextureManager::FinishFrame(uint64_t fenceValue) {
+	descriptorAllocator_.FinishFrame(fenceValue);
+}
+
+void TextureManager::Release(uint64_t completedFenceValue) {
+	releasedIndices_.clear();
+	descriptorAllocator_.Release(completedFenceValue, releasedIndices_);
+	for (uint32_t index : releasedIndices_) {
+		// リソースを解放し、空いた番号は黒のテクスチャにしておく
+		Texture& texture = textures_[index];
+		texture.resource.Reset();
+		texture.cpuDescHandleSRV.ptr = 0;
+		texture.gpuDescHandleSRV.ptr = 0;
+		CreateNullShaderResourceView(index);
 	}
 }
 
 const D3D12_RESOURCE_DESC TextureManager::GetResoureDesc(uint32_t textureHandle) {
 
-	assert(textureHandle < textures_.size());
-	Texture& texture = textures_.at(textureHandle);
+	assert(IsValid(textureHandle));
+	Texture& texture = textures_.at(DescriptorAllocator::GetIndex(textureHandle));
 	return texture.resource->GetDesc();
 }
 
+D3D12_GPU_DESCRIPTOR_HANDLE TextureManager::GetGpuDescHandleSRV(uint32_t textureHandle) {
+	assert(IsValid(textureHandle));
+	return textures_[DescriptorAllocator::GetIndex(textureHandle)].gpuDescHandleSRV;
+}
+
+uint32_t TextureManager::GetDescriptorIndex(uint32_t textureHandle) const {
+	assert(IsValid(textureHandle));
+	return DescriptorAllocator::GetIndex(textureHandle);
+}
+
+void TextureManager::SetGraphicsRootBindlessTable(
+  ID3D12GraphicsCommandList* commandList, UINT rootParamIndex) {
+	assert(bindless_);
+	ID3D12DescriptorHeap* ppHeaps[] = {descriptorHeap_.Get()};
+	commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+
+	// ヒープ全体をテーブルとしてセットし、テクスチャは描画ごとの番号で選ぶ
+	commandList->SetGraphicsRootDescriptorTable(rootParamIndex, GetGpuDescHandleTable());
+}
+
 void TextureManager::SetGraphicsRootDescriptorTable(
   ID3D12GraphicsCommandList* commandList, UINT rootParamIndex,
   uint32_t textureHandle) { // デスクリプタヒープの配列
-	assert(textureHandle < textures_.size());
+	assert(IsValid(textureHandle));
+	// バインドレスのルートシグネチャではテーブル全体とテクスチャ番号をセットする
+	assert(!bindless_);
 	ID3D12DescriptorHeap* ppHeaps[] = {descriptorHeap_.Get()};
 	commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
 
 	// シェーダリソースビューをセット
 	commandList->SetGraphicsRootDescriptorTable(
-	  rootParamIndex, textures_[textureHandle].gpuDescHandleSRV);
+	  rootParamIndex, textures_[DescriptorAllocator::GetIndex(textureHandle)].gpuDescHandleSRV);
 }
 
 uint32_t TextureManager::LoadInternal(const std::string& fileName) {
 
-	assert(indexNextDescriptorHeap_ < kNumDescriptors);
-	uint32_t handle = indexNextDescriptorHeap_;
-
 	// 読み込み済みテクスチャを検索
-	auto it = std::find_if(textures_.begin(), textures_.end(), [&](const auto& texture) {
-		return texture.name == fileName;
-	});
-	if (it != textures_.end()) {
-		// 読み込み済みテクスチャの要素番号を取得
-		handle = static_cast<uint32_t>(std::distance(textures_.begin(), it));
-		return handle;
+	auto it = handles_.find(fileName);
+	if (it != handles_.end()) {
+		return it->second;
 	}
 
+	// 空いているデスクリプタヒープの番号を割り当てる
+	uint32_t handle = descriptorAllocator_.Allocate();
+	assert(handle != DescriptorAllocator::kInvalidHandle);
+	uint32_t index = DescriptorAllocator::GetIndex(handle);
+	handles_.emplace(fileName, handle);
+
 	// 書き込むテクスチャの参照
-	Texture& texture = textures_.at(handle);
+	Texture& texture = textures_.at(index);
 	texture.name = fileName;
 
-	// ディレクトリパスとファイル名を連結してフルパスを得る
-	bool currentRelative = false;
-	if (2 < fileName.size()) {
-		currentRelative = (fileName[0] == '.') && (fileName[1] == '/');
-	}
-	std::string fullPath = currentRelative ? fileName : directoryPath_ + fileName;
-
-	// ユニコード文字列に変換
-	wchar_t wfilePath[256];
-	MultiByteToWideChar(CP_ACP, 0, fullPath.c_str(), -1, wfilePath, _countof(wfilePath));
-
 	HRESULT result;
 
-	TexMetadata metadata{};
+	// 事前読み込み済みの画像があれば使う
 	ScratchImage scratchImg{};
-
-	// WICテクスチャのロード
-	result = LoadFromWICFile(wfilePath, WIC_FLAGS_NONE, &metadata, scratchImg);
-	assert(SUCCEEDED(result));
-
-	ScratchImage mipChain{};
-	// ミップマップ生成
-	result = GenerateMipMaps(
-	  scratchImg.GetImages(), scratchImg.GetImageCount(), scratchImg.GetMetadata(),
-	  TEX_FILTER_DEFAULT, 0, mipChain);
-	if (SUCCEEDED(result)) {
-		scratchImg = std::move(mipChain);
-		metadata = scratchImg.GetMetadata();
+	bool preloaded = false;
+	{
+		std::lock_guard<std::mutex> lock(preloadMutex_);
+		auto preloadedIt = preloadedImages_.find(fileName);
+		if (preloadedIt != preloadedImages_.end()) {
+			scratchImg = std::move(preloadedIt->second);
+			preloadedImages_.erase(preloadedIt);
+			preloaded = true;
+		}
+	}
+	if (!preloaded) {
+		Decode(fileName, scratchImg);
 	}
 
+	TexMetadata metadata = scratchImg.GetMetadata();
+
 	// 読み込んだディフューズテクスチャをSRGBとして扱う
 	metadata.format = MakeSRGB(metadata.format);
 
@@ -125,35 +199,27 @@ uint32_t TextureManager::LoadInternal(const std::string& fileName) {
 	  metadata.format, metadata.width, (UINT)metadata.height, (UINT16)metadata.arraySize,
 	  (UINT16)metadata.mipLevels);
 
-	// ヒーププロパティ
-	CD3DX12_HEAP_PROPERTIES heapProps =
-	  CD3DX12_HEAP_PROPERTIES(D3D12_CPU_PAGE_PROPERTY_WRITE_BACK, D3D12_MEMORY_POOL_L0);
-
-	// テクスチャ用バッファの生成
-	result = device_->CreateCommittedResource(
-	  &heapProps, D3D12_HEAP_FLAG_NONE, &texresDesc,
-	  D3D12_RESOURCE_STATE_GENERIC_READ, // テクスチャ用指定
-	  nullptr, IID_PPV_ARGS(&texture.resource));
+	// テクスチャ用バッファの生成（コピーキューで書き込むのでCOMMON状態）
+	result = GpuMemoryAllocator::GetInstance()->CreateResource(
+	  texresDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&texture.resource));
 	assert(SUCCEEDED(result));
 
-	// テクスチャバッファにデータ転送
+	// テクスチャバッファへのデータ転送を予約
+	std::vector<D3D12_SUBRESOURCE_DATA> subresources(metadata.mipLevels);
 	for (size_t i = 0; i < metadata.mipLevels; i++) {
 		const Image* img = scratchImg.GetImage(i, 0, 0); // 生データ抽出
-		result = texture.resource->WriteToSubresource(
-		  (UINT)i,
-		  nullptr,              // 全領域へコピー
-		  img->pixels,          // 元データアドレス
-		  (UINT)img->rowPitch,  // 1ラインサイズ
-		  (UINT)img->slicePitch // 1枚サイズ
-		);
-		assert(SUCCEEDED(result));
+		subresources[i].pData = img->pixels;              // 元データアドレス
+		subresources[i].RowPitch = img->rowPitch;         // 1ラインサイズ
+		subresources[i].SlicePitch = img->slicePitch;     // 1枚サイズ
 	}
+	UploadManager::GetInstance()->UploadTexture(
+	  texture.resource.Get(), subresources.data(), static_cast<UINT>(subresources.size()));
 
 	// シェーダリソースビュー作成
 	texture.cpuDescHandleSRV = CD3DX12_CPU_DESCRIPTOR_HANDLE(
-	  descriptorHeap_->GetCPUDescriptorHandleForHeapStart(), handle, sDescriptorHandleIncrementSize_);
+	  descriptorHeap_->GetCPUDescriptorHandleForHeapStart(), index, sDescriptorHandleIncrementSize_);
 	texture.gpuDescHandleSRV = CD3DX12_GPU_DESCRIPTOR_HANDLE(
-	  descriptorHeap_->GetGPUDescriptorHandleForHeapStart(), handle, sDescriptorHandleIncrementSize_);
+	  descriptorHeap_->GetGPUDescriptorHandleForHeapStart(), index, sDescriptorHandleIncrementSize_);
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{}; // 設定構造体
 	D3D12_RESOURCE_DESC resDesc = texture.resource->GetDesc();
@@ -168,7 +234,61 @@ uint32_t TextureManager::LoadInternal(const std::string& fileName) {
 	  &srvDesc,               //テクスチャ設定情報
 	  texture.cpuDescHandleSRV);
 
-	indexNextDescriptorHeap_++;
-
 	return handle;
 }
+
+void TextureManager::UnloadInternal(uint32_t textureHandle) {
+	// 解放済みなどの無効なハンドルは無視
+	if (!descriptorAllocator_.Free(textureHandle)) {
+		return;
+	}
+
+	// 名前の索引からはすぐに外し、同じ名前の読み込みは別の番号に作り直す
+	// （リソースとデスクリプタはGPUが使い終わってからReleaseで解放する）
+	Texture& texture = textures_[DescriptorAllocator::GetIndex(textureHandle)];
+	handles_.erase(texture.name);
+	texture.name.clear();
+}
+
+void TextureManager::CreateNullShaderResourceView(uint32_t index) {
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+	srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = 1;
+	device_->CreateShaderResourceView(
+	  nullptr, &srvDesc,
+	  CD3DX12_CPU_DESCRIPTOR_HANDLE(
+	    descriptorHeap_->GetCPUDescriptorHandleForHeapStart(), index,
+	    sDescriptorHandleIncrementSize_));
+}
+
+void TextureManager::Decode(const std::string& fileName, ScratchImage& image) {
+	// ディレクトリパスとファイル名を連結してフルパスを得る
+	bool currentRelative = false;
+	if (2 < fileName.size()) {
+		currentRelative = (fileName[0] == '.') && (fileName[1] == '/');
+	}
+	std::string fullPath = currentRelative ? fileName : directoryPath_ + fileName;
+
+	// ユニコード文字列に変換
+	wchar_t wfilePath[256];
+	MultiByteToWideChar(CP_ACP, 0, fullPath.c_str(), -1, wfilePath, _countof(wfilePath));
+
+	HRESULT result;
+
+	TexMetadata metadata{};
+
+	// WICテクスチャのロード
+	result = LoadFromWICFile(wfilePath, WIC_FLAGS_NONE, &metadata, image);
+	assert(SUCCEEDED(result));
+
+	ScratchImage mipChain{};
+	// ミップマップ生成
+	result = GenerateMipMaps(
+	  image.GetImages(), image.GetImageCount(), image.GetMetadata(), TEX_FILTER_DEFAULT, 0,
+	  mipChain);
+	if (SUCCEEDED(result)) {
+		image = std::move(mipChain);
+	}
+}
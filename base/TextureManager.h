@@ -1,18 +1,23 @@
 ﻿#pragma once
 
-#include <array>
+#include "DescriptorAllocator.h"
+#include <DirectXTex.h>
 #include <d3dx12.h>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <wrl.h>
 
 /// <summary>
 /// テクスチャマネージャ
+/// テクスチャハンドルはデスクリプタヒープの番号と世代番号を詰めたもので、
+/// Unloadした後の古いハンドルは番号が再利用されても無効として扱う
 /// </summary>
 class TextureManager {
   public:
-	// デスクリプターの数
-	static const size_t kNumDescriptors = 256;
+	// デスクリプターの数の既定値
+	static const uint32_t kDefaultNumDescriptors = 256;
 
 	/// <summary>
 	/// テクスチャ
@@ -35,6 +40,20 @@ class TextureManager {
 	/// <returns>テクスチャハンドル</returns>
 	static uint32_t Load(const std::string& fileName);
 
+	/// <summary>
+	/// 事前読み込み（ワーカースレッドから呼べる）
+	/// 画像のデコードとミップマップ生成だけを行い、GPUリソースはLoadで生成する
+	/// </summary>
+	/// <param name="fileName">ファイル名</param>
+	static void Preload(const std::string& fileName);
+
+	/// <summary>
+	/// 解放
+	/// ハンドルはすぐに無効になり、リソースとデスクリプタはGPUが使い終わってから再利用する
+	/// </summary>
+	/// <param name="textureHandle">テクスチャハンドル（無効なハンドルは無視する）</param>
+	static void Unload(uint32_t textureHandle);
+
 	/// <summary>
 	/// シングルトンインスタンスの取得
 	/// </summary>
@@ -45,13 +64,44 @@ class TextureManager {
 	/// システム初期化
 	/// </summary>
 	/// <param name="device">デバイス</param>
-	void Initialize(ID3D12Device* device, std::string directoryPath = "Resources/");
+	/// <param name="directoryPath">読み込みディレクトリパス</param>
+	/// <param name="numDescriptors">デスクリプターの数（同時に読み込めるテクスチャの数）</param>
+	void Initialize(
+	  ID3D12Device* device, std::string directoryPath = "Resources/",
+	  uint32_t numDescriptors = kDefaultNumDescriptors);
 
 	/// <summary>
 	/// 全テクスチャリセット
 	/// </summary>
 	void ResetAll();
 
+	/// <summary>
+	/// フレームの終了（ここまでにUnloadしたテクスチャをフェンス値と結び付ける）
+	/// </summary>
+	/// <param name="fenceValue">このフレームのフェンス値</param>
+	void FinishFrame(uint64_t fenceValue);
+
+	/// <summary>
+	/// GPUの処理が完了したフレームでUnloadしたテクスチャを解放する
+	/// </summary>
+	/// <param name="completedFenceValue">完了済みのフェンス値</param>
+	void Release(uint64_t completedFenceValue);
+
+	/// <summary>
+	/// ハンドルが読み込み済みのテクスチャを指しているか
+	/// </summary>
+	/// <param name="textureHandle">テクスチャハンドル</param>
+	/// <returns>有効ならtrue</returns>
+	bool IsValid(uint32_t textureHandle) const {
+		return descriptorAllocator_.IsValid(textureHandle);
+	}
+
+	/// <summary>
+	/// 読み込み済みのテクスチャの数を取得
+	/// </summary>
+	/// <returns>テクスチャの数</returns>
+	uint32_t GetLoadedCount() const { return descriptorAllocator_.GetUsedCount(); }
+
 	/// <summary>
 	/// リソース情報取得
 	/// </summary>
@@ -60,7 +110,50 @@ class TextureManager {
 	const D3D12_RESOURCE_DESC GetResoureDesc(uint32_t textureHandle);
 
 	/// <summary>
-	/// デスクリプタテーブルをセット
+	/// シェーダリソースビューのハンドル(GPU)を取得
+	/// </summary>
+	/// <param name="textureHandle">テクスチャハンドル</param>
+	/// <returns>シェーダリソースビューのハンドル</returns>
+	D3D12_GPU_DESCRIPTOR_HANDLE GetGpuDescHandleSRV(uint32_t textureHandle);
+
+	/// <summary>
+	/// デスクリプタヒープを取得
+	/// </summary>
+	/// <returns>デスクリプタヒープ</returns>
+	ID3D12DescriptorHeap* GetDescriptorHeap() const { return descriptorHeap_.Get(); }
+
+	/// <summary>
+	/// バインドレス描画に対応しているか
+	/// 対応していれば全テクスチャを1つのデスクリプタテーブルで渡し、シェーダで番号を指定する
+	/// </summary>
+	/// <returns>リソースバインディングTier2以上ならtrue</returns>
+	bool IsBindless() const { return bindless_; }
+
+	/// <summary>
+	/// シェーダから参照するテクスチャ番号（デスクリプタヒープ内の位置）を取得
+	/// </summary>
+	/// <param name="textureHandle">テクスチャハンドル</param>
+	/// <returns>テクスチャ番号</returns>
+	uint32_t GetDescriptorIndex(uint32_t textureHandle) const;
+
+	/// <summary>
+	/// 全テクスチャのデスクリプタテーブルの先頭(GPU)を取得
+	/// </summary>
+	/// <returns>デスクリプタヒープの先頭のハンドル</returns>
+	D3D12_GPU_DESCRIPTOR_HANDLE GetGpuDescHandleTable() const {
+		return descriptorHeap_->GetGPUDescriptorHandleForHeapStart();
+	}
+
+	/// <summary>
+	/// 全テクスチャのデスクリプタテーブルをセット（バインドレス描画用）
+	/// </summary>
+	/// <param name="commandList">コマンドリスト</param>
+	/// <param name="rootParamIndex">ルートパラメータ番号</param>
+	void SetGraphicsRootBindlessTable(
+	  ID3D12GraphicsCommandList* commandList, UINT rootParamIndex);
+
+	/// <summary>
+	/// デスクリプタテーブルをセット（バインドレスでない場合）
 	/// </summary>
 	/// <param name="commandList">コマンドリスト</param>
 	/// <param name="rootParamIndex">ルートパラメータ番号</param>
@@ -82,14 +175,45 @@ class TextureManager {
 	std::string directoryPath_;
 	// デスクリプタヒープ
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descriptorHeap_;
-	// 次に使うデスクリプタヒープの番号
-	uint32_t indexNextDescriptorHeap_ = 0u;
-	// テクスチャコンテナ
-	std::array<Texture, kNumDescriptors> textures_;
+	// バインドレス描画に対応しているか
+	bool bindless_ = false;
+	// デスクリプターの数
+	uint32_t numDescriptors_ = kDefaultNumDescriptors;
+	// デスクリプタヒープの番号の割り当て
+	DescriptorAllocator descriptorAllocator_;
+	// テクスチャコンテナ（デスクリプタヒープの番号順）
+	std::vector<Texture> textures_;
+	// 名前から読み込み済みテクスチャのハンドルへの索引
+	std::unordered_map<std::string, uint32_t> handles_;
+	// 解放したデスクリプタヒープの番号（Releaseの作業領域）
+	std::vector<uint32_t> releasedIndices_;
+	// 事前読み込みした画像
+	std::unordered_map<std::string, DirectX::ScratchImage> preloadedImages_;
+	// 事前読み込みの排他制御
+	std::mutex preloadMutex_;
 
 	/// <summary>
 	/// 読み込み
 	/// </summary>
 	/// <param name="fileName">ファイル名</param>
 	uint32_t LoadInternal(const std::string& fileName);
+
+	/// <summary>
+	/// 解放
+	/// </summary>
+	/// <param name="textureHandle">テクスチャハンドル</param>
+	void UnloadInternal(uint32_t textureHandle);
+
+	/// <summary>
+	/// nullのシェーダリソースビューを書き込む（未使用の番号を参照しても黒になるように）
+	/// </summary>
+	/// <param name="index">デスクリプタヒープの番号</param>
+	void CreateNullShaderResourceView(uint32_t index);
+
+	/// <summary>
+	/// 画像のデコードとミップマップ生成
+	/// </summary>
+	/// <param name="fileName">ファイル名</param>
+	/// <param name="image">画像</param>
+	void Decode(const std::string& fileName, DirectX::ScratchImage& image);
 };
@@ -0,0 +1,330 @@
+﻿#include "TlsfAllocator.h"
+#include <algorithm>
+#include <cassert>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+// 最上位ビットの位置（valueは0以外）
+inline uint32_t FindLastSet(uint64_t value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return index;
+#else
+	return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+// 最下位ビットの位置（valueは0以外）
+inline uint32_t FindFirstSet(uint64_t value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return index;
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+} // namespace
+
+void TlsfAllocator::Initialize(uint64_t size) {
+	size_ = size;
+	liveBytes_ = 0;
+	blocks_.clear();
+	unusedBlocks_.clear();
+	allocations_.clear();
+	firstLevelBitmap_ = 0;
+	std::fill(std::begin(secondLevelBitmaps_), std::end(secondLevelBitmaps_), 0u);
+	for (auto& heads : freeHeads_) {
+		for (uint32_t& head : heads) {
+			head = kNull;
+		}
+	}
+
+	// 全体を1つの空き領域にする
+	if (size > 0) {
+		InsertFreeBlock(CreateBlock(0, size));
+	}
+}
+
+uint64_t TlsfAllocator::Allocate(uint64_t size, uint64_t alignment) {
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+	if (size == 0 || size > size_) {
+		return kInvalidOffset;
+	}
+
+	// アラインメントで先頭を捨てても足りる大きさで探す
+	uint64_t searchSize = size + (alignment > 1 ? alignment - 1 : 0);
+	uint32_t index = FindFreeBlock(searchSize);
+	if (index == kNull) {
+		return kInvalidOffset;
+	}
+	RemoveFreeBlock(index);
+
+	// 先頭の余りは空き領域として戻す
+	uint64_t alignedOffset = (blocks_[index].offset + alignment - 1) & ~(alignment - 1);
+	uint64_t padding = alignedOffset - blocks_[index].offset;
+	if (padding > 0) {
+		SplitBlock(index, padding);
+		uint32_t next = blocks_[index].nextPhys;
+		// SplitBlockで後ろが空きリストに入ったので、それを割り当て対象にする
+		RemoveFreeBlock(next);
+		InsertFreeBlock(index);
+		index = next;
+	}
+
+	// 後ろの余りを空き領域として戻す
+	SplitBlock(index, size);
+	blocks_[index].free = false;
+	liveBytes_ += blocks_[index].size;
+	allocations_.emplace(blocks_[index].offset, index);
+	return blocks_[index].offset;
+}
+
+void TlsfAllocator::Free(uint64_t offset) {
+	auto itr = allocations_.find(offset);
+	assert(itr != allocations_.end());
+	if (itr == allocations_.end()) {
+		return;
+	}
+	uint32_t index = itr->second;
+	allocations_.erase(itr);
+	liveBytes_ -= blocks_[index].size;
+
+	// 前の空き領域と結合
+	uint32_t prev = blocks_[index].prevPhys;
+	if (prev != kNull && blocks_[prev].free) {
+		RemoveFreeBlock(prev);
+		blocks_[prev].size += blocks_[index].size;
+		blocks_[prev].nextPhys = blocks_[index].nextPhys;
+		if (blocks_[index].nextPhys != kNull) {
+			blocks_[blocks_[index].nextPhys].prevPhys = prev;
+		}
+		DestroyBlock(index);
+		index = prev;
+	}
+
+	// 後ろの空き領域と結合
+	uint32_t next = blocks_[index].nextPhys;
+	if (next != kNull && blocks_[next].free) {
+		RemoveFreeBlock(next);
+		blocks_[index].size += blocks_[next].size;
+		blocks_[index].nextPhys = blocks_[next].nextPhys;
+		if (blocks_[next].nextPhys != kNull) {
+			blocks_[blocks_[next].nextPhys].prevPhys = index;
+		}
+		DestroyBlock(next);
+	}
+
+	InsertFreeBlock(index);
+}
+
+TlsfAllocator::Statistics TlsfAllocator::GetStatistics() const {
+	Statistics statistics;
+	statistics.size = size_;
+	statistics.liveBytes = liveBytes_;
+	statistics.freeBytes = size_ - liveBytes_;
+	statistics.allocationCount = static_cast<uint32_t>(allocations_.size());
+
+	// 空き領域を数え、最大のものを探す
+	for (uint32_t fl = 0; fl < kFirstLevelCount; fl++) {
+		for (uint32_t sl = 0; sl < kSecondLevelCount; sl++) {
+			for (uint32_t i = freeHeads_[fl][sl]; i != kNull; i = blocks_[i].nextFree) {
+				statistics.freeBlockCount++;
+				statistics.largestFreeBlock =
+				  std::max(statistics.largestFreeBlock, blocks_[i].size);
+			}
+		}
+	}
+	if (statistics.freeBytes > 0) {
+		statistics.fragmentation =
+		  1.0f - static_cast<float>(
+		           static_cast<double>(statistics.largestFreeBlock) / statistics.freeBytes);
+	}
+	return statistics;
+}
+
+bool TlsfAllocator::Validate() const {
+	// 領域をアドレス順にたどる
+	uint32_t first = kNull;
+	uint32_t usedBlockCount = static_cast<uint32_t>(blocks_.size() - unusedBlocks_.size());
+	for (uint32_t i = 0; i < blocks_.size(); i++) {
+		if (
+		  std::find(unusedBlocks_.begin(), unusedBlocks_.end(), i) == unusedBlocks_.end() &&
+		  blocks_[i].prevPhys == kNull) {
+			if (first != kNull) {
+				return false;
+			}
+			first = i;
+		}
+	}
+	uint64_t offset = 0;
+	uint64_t liveBytes = 0;
+	uint32_t count = 0;
+	uint32_t freeCount = 0;
+	for (uint32_t i = first, prev = kNull; i != kNull; prev = i, i = blocks_[i].nextPhys) {
+		const Block& block = blocks_[i];
+		if (block.offset != offset || block.size == 0 || block.prevPhys != prev) {
+			return false;
+		}
+		// 隣接する空き領域は結合されているはず
+		if (block.free && prev != kNull && blocks_[prev].free) {
+			return false;
+		}
+		if (block.free) {
+			freeCount++;
+		} else {
+			liveBytes += block.size;
+			auto itr = allocations_.find(block.offset);
+			if (itr == allocations_.end() || itr->second != i) {
+				return false;
+			}
+		}
+		offset += block.size;
+		count++;
+	}
+	if (
+	  offset != size_ || count != usedBlockCount || liveBytes != liveBytes_ ||
+	  count - freeCount != allocations_.size()) {
+		return false;
+	}
+
+	// 空きリストとビットマップ
+	uint32_t listedCount = 0;
+	for (uint32_t fl = 0; fl < kFirstLevelCount; fl++) {
+		if (((firstLevelBitmap_ >> fl) & 1) != (secondLevelBitmaps_[fl] != 0 ? 1u : 0u)) {
+			return false;
+		}
+		for (uint32_t sl = 0; sl < kSecondLevelCount; sl++) {
+			bool hasList = freeHeads_[fl][sl] != kNull;
+			if (((secondLevelBitmaps_[fl] >> sl) & 1) != (hasList ? 1u : 0u)) {
+				return false;
+			}
+			for (uint32_t i = freeHeads_[fl][sl], prev = kNull; i != kNull;
+			     prev = i, i = blocks_[i].nextFree) {
+				uint32_t blockFl, blockSl;
+				Mapping(blocks_[i].size, blockFl, blockSl);
+				if (
+				  !blocks_[i].free || blocks_[i].prevFree != prev || blockFl != fl ||
+				  blockSl != sl) {
+					return false;
+				}
+				listedCount++;
+			}
+		}
+	}
+	return listedCount == freeCount;
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) {
+	if (size < kSecondLevelCount) {
+		// 小さいサイズは第1段0番を1バイト刻みで使う
+		firstLevel = 0;
+		secondLevel = static_cast<uint32_t>(size);
+	} else {
+		uint32_t msb = FindLastSet(size);
+		firstLevel = msb - kSecondLevelLog2 + 1;
+		secondLevel = static_cast<uint32_t>(size >> (msb - kSecondLevelLog2)) - kSecondLevelCount;
+	}
+}
+
+uint32_t TlsfAllocator::CreateBlock(uint64_t offset, uint64_t size) {
+	Block block{offset, size, kNull, kNull, kNull, kNull, true};
+	if (!unusedBlocks_.empty()) {
+		uint32_t index = unusedBlocks_.back();
+		unusedBlocks_.pop_back();
+		blocks_[index] = block;
+		return index;
+	}
+	blocks_.push_back(block);
+	return static_cast<uint32_t>(blocks_.size() - 1);
+}
+
+void TlsfAllocator::DestroyBlock(uint32_t index) { unusedBlocks_.push_back(index); }
+
+void TlsfAllocator::InsertFreeBlock(uint32_t index) {
+	uint32_t fl, sl;
+	Mapping(blocks_[index].size, fl, sl);
+	Block& block = blocks_[index];
+	block.free = true;
+	block.prevFree = kNull;
+	block.nextFree = freeHeads_[fl][sl];
+	if (block.nextFree != kNull) {
+		blocks_[block.nextFree].prevFree = index;
+	}
+	freeHeads_[fl][sl] = index;
+	firstLevelBitmap_ |= 1ull << fl;
+	secondLevelBitmaps_[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::RemoveFreeBlock(uint32_t index) {
+	uint32_t fl, sl;
+	Mapping(blocks_[index].size, fl, sl);
+	Block& block = blocks_[index];
+	if (block.prevFree != kNull) {
+		blocks_[block.prevFree].nextFree = block.nextFree;
+	} else {
+		freeHeads_[fl][sl] = block.nextFree;
+	}
+	if (block.nextFree != kNull) {
+		blocks_[block.nextFree].prevFree = block.prevFree;
+	}
+	block.free = false;
+
+	// リストが空になったらビットを落とす
+	if (freeHeads_[fl][sl] == kNull) {
+		secondLevelBitmaps_[fl] &= ~(1u << sl);
+		if (secondLevelBitmaps_[fl] == 0) {
+			firstLevelBitmap_ &= ~(1ull << fl);
+		}
+	}
+}
+
+uint32_t TlsfAllocator::FindFreeBlock(uint64_t size) const {
+	// 区間の上端まで切り上げ、見つかったリストのどの領域でも足りるようにする
+	if (size >= kSecondLevelCount) {
+		uint64_t round = (1ull << (FindLastSet(size) - kSecondLevelLog2)) - 1;
+		if (size > UINT64_MAX - round) {
+			return kNull;
+		}
+		size += round;
+	}
+	uint32_t fl, sl;
+	Mapping(size, fl, sl);
+
+	// 同じ第1段で大きい区間、なければ上の第1段から探す
+	uint32_t secondLevelMap = secondLevelBitmaps_[fl] & (~0u << sl);
+	if (secondLevelMap == 0) {
+		uint64_t firstLevelMap = fl + 1 < 64 ? firstLevelBitmap_ & (~0ull << (fl + 1)) : 0;
+		if (firstLevelMap == 0) {
+			return kNull;
+		}
+		fl = FindFirstSet(firstLevelMap);
+		secondLevelMap = secondLevelBitmaps_[fl];
+	}
+	sl = FindFirstSet(secondLevelMap);
+	return freeHeads_[fl][sl];
+}
+
+void TlsfAllocator::SplitBlock(uint32_t index, uint64_t size) {
+	uint64_t remain = blocks_[index].size - size;
+	if (remain == 0) {
+		return;
+	}
+	uint32_t rest = CreateBlock(blocks_[index].offset + size, remain);
+	// CreateBlockでblocks_が再確保されることがあるので、ここから参照を取る
+	Block& block = blocks_[index];
+	block.size = size;
+	blocks_[rest].prevPhys = index;
+	blocks_[rest].nextPhys = block.nextPhys;
+	if (block.nextPhys != kNull) {
+		blocks_[block.nextPhys].prevPhys = rest;
+	}
+	block.nextPhys = rest;
+	InsertFreeBlock(rest);
+}
+
@@ -0,0 +1,145 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// 二段階の分離適合(TLSF)による領域の割り当て
+/// サイズを2の累乗の区間(第1段)とそれを16等分した区間(第2段)に分けて空き領域をリストで持ち、
+/// ビットマップから適合するリストをO(1)で探す。解放時は隣接する空き領域と結合する
+/// 管理情報は領域の外に持つので、GPUのヒープのようにCPUから触れないメモリにも使える
+/// </summary>
+class TlsfAllocator {
+  public: // 定数
+	// 割り当て失敗
+	static const uint64_t kInvalidOffset = UINT64_MAX;
+
+  public: // サブクラス
+	// 統計
+	struct Statistics {
+		uint64_t size = 0;             // 全体のバイト数
+		uint64_t liveBytes = 0;        // 割り当て中のバイト数（アラインメントの余りを含む）
+		uint64_t freeBytes = 0;        // 空きのバイト数
+		uint64_t largestFreeBlock = 0; // 最大の空き領域のバイト数
+		uint32_t allocationCount = 0;  // 割り当て中の数
+		uint32_t freeBlockCount = 0;   // 空き領域の数
+		float fragmentation = 0.0f;    // 断片化率（1 - 最大の空き領域 / 空きの合計）
+	};
+
+  public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="size">全体のバイト数</param>
+	void Initialize(uint64_t size);
+
+	/// <summary>
+	/// 割り当て
+	/// </summary>
+	/// <param name="size">バイト数</param>
+	/// <param name="alignment">アラインメント（2の累乗）</param>
+	/// <returns>オフセット（空きがなければkInvalidOffset）</returns>
+	uint64_t Allocate(uint64_t size, uint64_t alignment);
+
+	/// <summary>
+	/// 解放
+	/// </summary>
+	/// <param name="offset">Allocateが返したオフセット</param>
+	void Free(uint64_t offset);
+
+	/// <summary>
+	/// 割り当て中の領域がないか
+	/// </summary>
+	/// <returns>空か</returns>
+	bool IsEmpty() const { return allocations_.empty(); }
+
+	/// <summary>
+	/// 統計の取得
+	/// </summary>
+	/// <returns>統計</returns>
+	Statistics GetStatistics() const;
+
+	/// <summary>
+	/// 内部状態の整合性を検証する
+	/// 領域が隙間なく並んでいるか、隣接する空き領域が結合済みか、リストとビットマップが一致するか
+	/// </summary>
+	/// <returns>整合しているか</returns>
+	bool Validate() const;
+
+  private: // 定数
+	// 第2段の分割数の log2
+	static const uint32_t kSecondLevelLog2 = 4;
+	// 第2段の分割数
+	static const uint32_t kSecondLevelCount = 1u << kSecondLevelLog2;
+	// 第1段の数
+	static const uint32_t kFirstLevelCount = 64 - kSecondLevelLog2 + 1;
+	// リストの終端
+	static const uint32_t kNull = UINT32_MAX;
+
+  private: // サブクラス
+	// 領域
+	struct Block {
+		uint64_t offset;   // オフセット
+		uint64_t size;     // バイト数
+		uint32_t prevPhys; // アドレスが前の領域
+		uint32_t nextPhys; // アドレスが次の領域
+		uint32_t prevFree; // 同じ空きリストの前の領域
+		uint32_t nextFree; // 同じ空きリストの次の領域
+		bool free;         // 空きか
+	};
+
+  private: // メンバ関数
+	/// <summary>
+	/// サイズから空きリストの番号を求める
+	/// </summary>
+	static void Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+	/// <summary>
+	/// 領域の管理情報を確保する
+	/// </summary>
+	uint32_t CreateBlock(uint64_t offset, uint64_t size);
+
+	/// <summary>
+	/// 領域の管理情報を返却する
+	/// </summary>
+	void DestroyBlock(uint32_t index);
+
+	/// <summary>
+	/// 空きリストに追加する
+	/// </summary>
+	void InsertFreeBlock(uint32_t index);
+
+	/// <summary>
+	/// 空きリストから外す
+	/// </summary>
+	void RemoveFreeBlock(uint32_t index);
+
+	/// <summary>
+	/// 指定のサイズ以上の空き領域を探す
+	/// </summary>
+	uint32_t FindFreeBlock(uint64_t size) const;
+
+	/// <summary>
+	/// 領域の前方をsizeで切り分け、後ろの残りを空き領域にする
+	/// </summary>
+	void SplitBlock(uint32_t index, uint64_t size);
+
+  private: // メンバ変数
+	// 全体のバイト数
+	uint64_t size_ = 0;
+	// 割り当て中のバイト数
+	uint64_t liveBytes_ = 0;
+	// 領域の管理情報
+	std::vector<Block> blocks_;
+	// 再利用できる管理情報の番号
+	std::vector<uint32_t> unusedBlocks_;
+	// 第1段のビットマップ
+	uint64_t firstLevelBitmap_ = 0;
+	// 第2段のビットマップ
+	uint32_t secondLevelBitmaps_[kFirstLevelCount] = {};
+	// 空きリストの先頭
+	uint32_t freeHeads_[kFirstLevelCount][kSecondLevelCount];
+	// 割り当て中の領域（オフセット → 管理情報の番号）
+	std::unordered_map<uint64_t, uint32_t> allocations_;
+};
@@ -0,0 +1,220 @@
+﻿#include "UploadManager.h"
+#include <cassert>
+#include <cstring>
+#include <d3dx12.h>
+#include <vector>
+
+using namespace Microsoft::WRL;
+
+UploadManager* UploadManager::GetInstance() {
+	static UploadManager instance;
+	return &instance;
+}
+
+UploadManager::~UploadManager() {
+	if (fenceEvent_) {
+		// 転送中のバッファを解放しないように完了を待つ
+		WaitForCompletion(Flush());
+		CloseHandle(fenceEvent_);
+	}
+}
+
+void UploadManager::Initialize(ID3D12Device* device, size_t stagingSize) {
+	assert(device);
+	device_ = device;
+	HRESULT result;
+
+	// コピーキューを生成
+	D3D12_COMMAND_QUEUE_DESC queueDesc{};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	result = device_->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&commandQueue_));
+	assert(SUCCEEDED(result));
+
+	// コマンドリストを生成（記録開始までは閉じておく）
+	result = device_->CreateCommandAllocator(
+	  D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&commandAllocator_));
+	assert(SUCCEEDED(result));
+	result = device_->CreateCommandList(
+	  0, D3D12_COMMAND_LIST_TYPE_COPY, commandAllocator_.Get(), nullptr,
+	  IID_PPV_ARGS(&commandList_));
+	assert(SUCCEEDED(result));
+	commandList_->Close();
+	pendingAllocators_.push_back({commandAllocator_, 0});
+	commandAllocator_.Reset();
+
+	// フェンスを生成
+	result = device_->CreateFence(fenceValue_, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence_));
+	assert(SUCCEEDED(result));
+	fenceEvent_ = CreateEvent(nullptr, false, false, nullptr);
+	assert(fenceEvent_);
+
+	// ステージング用バッファを生成し、常時マップしておく
+	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(stagingSize);
+	result = device_->CreateCommittedResource(
+	  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+	  IID_PPV_ARGS(&stagingBuffer_));
+	assert(SUCCEEDED(result));
+	result = stagingBuffer_->Map(0, nullptr, reinterpret_cast<void**>(&stagingMap_));
+	assert(SUCCEEDED(result));
+	stagingAllocator_.Initialize(stagingSize);
+}
+
+void UploadManager::UploadBuffer(ID3D12Resource* dest, const void* data, size_t size) {
+	assert(dest && data);
+	if (size == 0) {
+		return;
+	}
+
+	// ステージングに書き込んでコピーを記録
+	Staging staging = AllocateStaging(size, 16);
+	memcpy(staging.cpuAddress, data, size);
+	BeginRecording();
+	commandList_->CopyBufferRegion(dest, 0, staging.resource, staging.offset, size);
+
+	// 次に送信する転送と一緒に完了するまで転送先を保持する
+	pendingDestinations_.push_back({dest, fenceValue_ + 1});
+}
+
+void UploadManager::UploadTexture(
+  ID3D12Resource* dest, const D3D12_SUBRESOURCE_DATA* subresources, UINT subresourceCount) {
+	assert(dest && subresources);
+
+	// サブリソースごとのステージング上の配置を求める
+	D3D12_RESOURCE_DESC desc = dest->GetDesc();
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(subresourceCount);
+	std::vector<UINT> rowCounts(subresourceCount);
+	std::vector<UINT64> rowSizes(subresourceCount);
+	UINT64 totalSize = 0;
+	device_->GetCopyableFootprints(
+	  &desc, 0, subresourceCount, 0, layouts.data(), rowCounts.data(), rowSizes.data(),
+	  &totalSize);
+
+	Staging staging = AllocateStaging(totalSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+	BeginRecording();
+	for (UINT i = 0; i < subresourceCount; i++) {
+		// 行ピッチの違いを吸収して1行ずつ書き込む
+		const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = layouts[i];
+		const uint8_t* src = static_cast<const uint8_t*>(subresources[i].pData);
+		uint8_t* dst = staging.cpuAddress + layout.Offset;
+		const UINT64 slicePitch = UINT64(layout.Footprint.RowPitch) * rowCounts[i];
+		for (UINT z = 0; z < layout.Footprint.Depth; z++) {
+			for (UINT row = 0; row < rowCounts[i]; row++) {
+				memcpy(
+				  dst + slicePitch * z + UINT64(layout.Footprint.RowPitch) * row,
+				  src + subresources[i].SlicePitch * z + subresources[i].RowPitch * row,
+				  static_cast<size_t>(rowSizes[i]));
+			}
+		}
+
+		// コピーを記録
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT placed = layout;
+		placed.Offset += staging.offset;
+		CD3DX12_TEXTURE_COPY_LOCATION dstLocation(dest, i);
+		CD3DX12_TEXTURE_COPY_LOCATION srcLocation(staging.resource, placed);
+		commandList_->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
+	}
+
+	// 次に送信する転送と一緒に完了するまで転送先を保持する
+	pendingDestinations_.push_back({dest, fenceValue_ + 1});
+}
+
+UINT64 UploadManager::Flush() {
+	if (!recording_) {
+		return fenceValue_;
+	}
+
+	// コピーキューに送信
+	commandList_->Close();
+	ID3D12CommandList* cmdLists[] = {commandList_.Get()};
+	commandQueue_->ExecuteCommandLists(1, cmdLists);
+	commandQueue_->Signal(fence_.Get(), ++fenceValue_);
+	recording_ = false;
+
+	// 使用した資源を完了まで保持する
+	stagingAllocator_.FinishFrame(fenceValue_);
+	pendingAllocators_.push_back({commandAllocator_, fenceValue_});
+	commandAllocator_.Reset();
+	return fenceValue_;
+}
+
+void UploadManager::Submit(ID3D12CommandQueue* queue) {
+	UINT64 fenceValue = Flush();
+	// 未完了の転送があればGPU上で待たせる（CPUは止めない）
+	if (!IsCompleted(fenceValue)) {
+		queue->Wait(fence_.Get(), fenceValue);
+	}
+	Release();
+}
+
+void UploadManager::WaitForCompletion(UINT64 fenceValue) {
+	if (!IsCompleted(fenceValue)) {
+		fence_->SetEventOnCompletion(fenceValue, fenceEvent_);
+		WaitForSingleObject(fenceEvent_, INFINITE);
+	}
+	Release();
+}
+
+void UploadManager::BeginRecording() {
+	if (recording_) {
+		return;
+	}
+
+	// 完了済みのアロケータがあれば使い回す
+	HRESULT result;
+	if (!pendingAllocators_.empty() && IsCompleted(pendingAllocators_.front().fenceValue)) {
+		commandAllocator_ = pendingAllocators_.front().allocator;
+		pendingAllocators_.pop_front();
+		result = commandAllocator_->Reset();
+		assert(SUCCEEDED(result));
+	} else {
+		result = device_->CreateCommandAllocator(
+		  D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&commandAllocator_));
+		assert(SUCCEEDED(result));
+	}
+	result = commandList_->Reset(commandAllocator_.Get(), nullptr);
+	assert(SUCCEEDED(result));
+	recording_ = true;
+}
+
+UploadManager::Staging UploadManager::AllocateStaging(uint64_t size, uint64_t alignment) {
+	Release();
+	uint64_t offset = stagingAllocator_.Allocate(size, alignment);
+	if (offset == RingAllocator::kInvalidOffset && size <= stagingAllocator_.GetSize()) {
+		// 記録中の転送を送信し、リングが空くのを待つ
+		WaitForCompletion(Flush());
+		offset = stagingAllocator_.Allocate(size, alignment);
+	}
+	if (offset != RingAllocator::kInvalidOffset) {
+		return {stagingBuffer_.Get(), offset, stagingMap_ + offset};
+	}
+
+	// リングより大きい転送は専用の一時バッファを使う
+	TemporaryBuffer temporary{};
+	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+	HRESULT result = device_->CreateCommittedResource(
+	  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+	  IID_PPV_ARGS(&temporary.resource));
+	assert(SUCCEEDED(result));
+	uint8_t* map = nullptr;
+	result = temporary.resource->Map(0, nullptr, reinterpret_cast<void**>(&map));
+	assert(SUCCEEDED(result));
+
+	// 次に送信する転送と一緒に完了する
+	temporary.fenceValue = fenceValue_ + 1;
+	temporaryBuffers_.push_back(temporary);
+	return {temporary.resource.Get(), 0, map};
+}
+
+void UploadManager::Release() {
+	UINT64 completedValue = fence_->GetCompletedValue();
+	stagingAllocator_.Release(completedValue);
+	while (!temporaryBuffers_.empty() && temporaryBuffers_.front().fenceValue <= completedValue) {
+		temporaryBuffers_.pop_front();
+	}
+	while (!pendingDestinations_.empty() &&
+	       pendingDestinations_.front().fenceValue <= completedValue) {
+		pendingDestinations_.pop_front();
+	}
+}
@@ -0,0 +1,161 @@
+﻿#pragma once
+
+#include "RingAllocator.h"
+#include <Windows.h>
+#include <d3d12.h>
+#include <deque>
+#include <wrl.h>
+
+/// <summary>
+/// デフォルトヒープへのデータ転送
+/// ステージング用のアップロードリングにデータを書き込み、コピーキューでまとめて転送する
+/// 転送はフレームの描画コマンドと一緒に送信し、描画側のキューはフェンスで完了を待つ
+/// （メインスレッドからのみ使用する）
+/// </summary>
+class UploadManager {
+  public: // 定数
+	// ステージング用リングのデフォルトのバイト数
+	static const size_t kDefaultStagingSize = 32 * 1024 * 1024;
+
+  public: // 静的メンバ関数
+	/// <summary>
+	/// シングルトンインスタンスの取得
+	/// </summary>
+	/// <returns>シングルトンインスタンス</returns>
+	static UploadManager* GetInstance();
+
+  public: // メンバ関数
+	/// <summary>
+	/// 初期化
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="stagingSize">ステージング用リングのバイト数</param>
+	void Initialize(ID3D12Device* device, size_t stagingSize = kDefaultStagingSize);
+
+	/// <summary>
+	/// バッファへの転送を予約する
+	/// 転送先はCOMMON状態で生成したデフォルトヒープのバッファ
+	/// 転送先は転送の完了まで参照を保持するので、呼び出し側は先に解放してよい
+	/// </summary>
+	/// <param name="dest">転送先</param>
+	/// <param name="data">転送元</param>
+	/// <param name="size">バイト数</param>
+	void UploadBuffer(ID3D12Resource* dest, const void* data, size_t size);
+
+	/// <summary>
+	/// テクスチャへの転送を予約する
+	/// 転送先はCOMMON状態で生成したデフォルトヒープのテクスチャ
+	/// 転送先は転送の完了まで参照を保持するので、呼び出し側は先に解放してよい
+	/// </summary>
+	/// <param name="dest">転送先</param>
+	/// <param name="subresources">サブリソースごとの転送元</param>
+	/// <param name="subresourceCount">サブリソース数</param>
+	void UploadTexture(
+	  ID3D12Resource* dest, const D3D12_SUBRESOURCE_DATA* subresources, UINT subresourceCount);
+
+	/// <summary>
+	/// 予約した転送をコピーキューに送信する
+	/// </summary>
+	/// <returns>完了を示すフェンス値</returns>
+	UINT64 Flush();
+
+	/// <summary>
+	/// 予約した転送を送信し、指定のキューのこれ以降のコマンドを転送の完了まで待たせる
+	/// </summary>
+	/// <param name="queue">転送したリソースを使うキュー</param>
+	void Submit(ID3D12CommandQueue* queue);
+
+	/// <summary>
+	/// 転送が完了したか
+	/// </summary>
+	/// <param name="fenceValue">フェンス値</param>
+	/// <returns>完了したか</returns>
+	bool IsCompleted(UINT64 fenceValue) const { return fence_->GetCompletedValue() >= fenceValue; }
+
+	/// <summary>
+	/// 転送の完了をCPUで待つ
+	/// </summary>
+	/// <param name="fenceValue">フェンス値</param>
+	void WaitForCompletion(UINT64 fenceValue);
+
+  private: // サブクラス
+	// 完了待ちのコマンドアロケータ
+	struct PendingAllocator {
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+		UINT64 fenceValue;
+	};
+
+	// リングに収まらない転送用の一時バッファ
+	struct TemporaryBuffer {
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		UINT64 fenceValue;
+	};
+
+	// 転送中の転送先（コピーの完了まで解放させない）
+	struct PendingDestination {
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		UINT64 fenceValue;
+	};
+
+	// ステージングの割り当て結果
+	struct Staging {
+		ID3D12Resource* resource; // ステージング用バッファ
+		uint64_t offset;          // バッファ内のオフセット
+		uint8_t* cpuAddress;      // 書き込み先
+	};
+
+  private: // メンバ関数
+	UploadManager() = default;
+	~UploadManager();
+	UploadManager(const UploadManager&) = delete;
+	UploadManager& operator=(const UploadManager&) = delete;
+
+	/// <summary>
+	/// コマンドの記録を開始する（記録中なら何もしない）
+	/// </summary>
+	void BeginRecording();
+
+	/// <summary>
+	/// ステージング領域の割り当て
+	/// 空きがなければ転送の完了を待ち、リングより大きければ一時バッファを作る
+	/// </summary>
+	/// <param name="size">バイト数</param>
+	/// <param name="alignment">アラインメント</param>
+	/// <returns>割り当て結果</returns>
+	Staging AllocateStaging(uint64_t size, uint64_t alignment);
+
+	/// <summary>
+	/// 完了した転送の資源を解放する
+	/// </summary>
+	void Release();
+
+  private: // メンバ変数
+	// デバイス
+	ID3D12Device* device_ = nullptr;
+	// コピーキュー
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue_;
+	// コマンドリスト
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList_;
+	// 記録中のコマンドアロケータ
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator_;
+	// 完了待ちのコマンドアロケータ（古い順）
+	std::deque<PendingAllocator> pendingAllocators_;
+	// 完了待ちの一時バッファ（古い順）
+	std::deque<TemporaryBuffer> temporaryBuffers_;
+	// 完了待ちの転送先（古い順）
+	std::deque<PendingDestination> pendingDestinations_;
+	// フェンス
+	Microsoft::WRL::ComPtr<ID3D12Fence> fence_;
+	// 最後に送信した転送のフェンス値
+	UINT64 fenceValue_ = 0;
+	// フェンス待ち用のイベント
+	HANDLE fenceEvent_ = nullptr;
+	// ステージング用バッファ
+	Microsoft::WRL::ComPtr<ID3D12Resource> stagingBuffer_;
+	// ステージング用バッファのマップ済みアドレス
+	uint8_t* stagingMap_ = nullptr;
+	// ステージング用バッファのオフセットの割り当て
+	RingAllocator stagingAllocator_;
+	// コマンドを記録中か
+	bool recording_ = false;
+};
@@ -2,11 +2,23 @@
 #include "AxisIndicator.h"
 #include "DirectXCommon.h"
 #include "GameScene.h"
+#include "PipelineCache.h"
+#include "ShaderCache.h"
+#include "TaskGraph.h"
 #include "TextureManager.h"
 #include "WinApp.h"
+#include <chrono>
 
 // Windowsアプリでのエントリーポイント(main関数)
-int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
+int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR lpCmdLine, int) {
+	// ビルド後の処理から呼ばれたらシェーダを事前コンパイルして終了
+	if (strstr(lpCmdLine, "--build-shader-cache")) {
+		return ShaderCache::GetInstance()->Build() ? 0 : 1;
+	}
+
+	// 起動から最初のフレームまでの時間を計る
+	auto startTime = std::chrono::steady_clock::now();
+
 	WinApp* win = nullptr;
 	DirectXCommon* dxCommon = nullptr;
 	// 汎用機能
@@ -22,41 +34,88 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 
 	// 変更テスト
 
+	// 起動処理のタスクグラフ
+	// GPUを使う処理はメインスレッド、ファイル読み込みやデコードはワーカースレッドで並列に行う
+	using Thread = TaskGraph::Thread;
+	TaskGraph startup;
+
 	// DirectX初期化処理
 	dxCommon = DirectXCommon::GetInstance();
-	dxCommon->Initialize(win);
+	TaskGraph::TaskId dxCommonTask = startup.Add(
+	  "DirectXCommon", [&]() { dxCommon->Initialize(win); }, {}, Thread::kMain);
+
+	// シェーダの読み込み（デバイスに依存しない）
+	std::vector<TaskGraph::TaskId> shaderTasks =
+	  ShaderCache::GetInstance()->AddPreloadTasks(startup);
 
 #pragma region 汎用機能初期化
 	// 入力の初期化
 	input = Input::GetInstance();
-	input->Initialize();
+	startup.Add("Input", [&]() { input->Initialize(); }, {}, Thread::kMain);
 
 	// オーディオの初期化
 	audio = Audio::GetInstance();
-	audio->Initialize();
+	TaskGraph::TaskId audioTask = startup.Add("Audio", [&]() { audio->Initialize(); });
 
 	// テクスチャマネージャの初期化
-	TextureManager::GetInstance()->Initialize(dxCommon->GetDevice());
-	TextureManager::Load("white1x1.png");
+	TaskGraph::TaskId textureManagerTask = startup.Add(
+	  "TextureManager",
+	  [&]() {
+		  TextureManager::GetInstance()->Initialize(dxCommon->GetDevice());
+		  TextureManager::Load("white1x1.png");
+	  },
+	  {dxCommonTask}, Thread::kMain);
 
 	// スプライト静的初期化
-	Sprite::StaticInitialize(dxCommon->GetDevice(), WinApp::kWindowWidth, WinApp::kWindowHeight);
+	std::vector<TaskGraph::TaskId> spriteDependencies = shaderTasks;
+	spriteDependencies.push_back(textureManagerTask);
+	TaskGraph::TaskId spriteTask = startup.Add(
+	  "Sprite",
+	  [&]() {
+		  Sprite::StaticInitialize(
+		    dxCommon->GetDevice(), WinApp::kWindowWidth, WinApp::kWindowHeight);
+	  },
+	  spriteDependencies, Thread::kMain);
 
 	// デバッグテキスト初期化
+	TaskGraph::TaskId debugFontTask = startup.Add(
+	  "debugfont.png", []() { TextureManager::Preload("debugfont.png"); }, {textureManagerTask});
 	debugText = DebugText::GetInstance();
-	debugText->Initialize();
+	TaskGraph::TaskId debugTextTask = startup.Add(
+	  "DebugText", [&]() { debugText->Initialize(); }, {spriteTask, debugFontTask}, Thread::kMain);
 
 	// 3Dモデル静的初期化
-	Model::StaticInitialize();
+	std::vector<TaskGraph::TaskId> modelDependencies = shaderTasks;
+	modelDependencies.push_back(textureManagerTask);
+	TaskGraph::TaskId modelTask =
+	  startup.Add("Model", []() { Model::StaticInitialize(); }, modelDependencies, Thread::kMain);
 
 	// 軸方向表示初期化
 	axisIndicator = AxisIndicator::GetInstance();
-	axisIndicator->Initialize();
+	TaskGraph::TaskId axisIndicatorTask = startup.Add(
+	  "AxisIndicator", [&]() { axisIndicator->Initialize(); }, {modelTask}, Thread::kMain);
 #pragma endregion
 
-	// ゲームシーンの初期化
+	// ゲームシーンの初期化（素材の読み込みは先にワーカースレッドで行う）
+	std::vector<TaskGraph::TaskId> gameSceneDependencies =
+	  GameScene::AddPreloadTasks(startup, textureManagerTask, audioTask);
+	gameSceneDependencies.insert(
+	  gameSceneDependencies.end(), {debugTextTask, modelTask, axisIndicatorTask});
 	gameScene = new GameScene();
-	gameScene->Initialize();
+	startup.Add(
+	  "GameScene", [&]() { gameScene->Initialize(); }, gameSceneDependencies, Thread::kMain);
+
+	startup.Run();
+	startup.OutputTimeline();
+
+	// シェーダの読み込み時間をデバッグ出力
+	ShaderCache::GetInstance()->OutputStatistics();
+
+	// 生成したパイプラインを次回の起動のために保存
+	PipelineCache::GetInstance()->Save();
+	PipelineCache::GetInstance()->OutputStatistics();
+
+	bool firstFrame = true;
 
 	// メインループ
 	while (true) {
@@ -67,6 +126,8 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 
 		// 入力関連の毎フレーム処理
 		input->Update();
+		// モデルの非同期読み込みの更新
+		Model::UpdateAsyncLoads();
 		// ゲームシーンの毎フレーム処理
 		gameScene->Update();
 		// 軸表示の更新
@@ -80,9 +141,21 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		axisIndicator->Draw();
 		// 描画終了
 		dxCommon->PostDraw();
+
+		// 最初のフレームまでの時間をデバッグ出力
+		if (firstFrame) {
+			firstFrame = false;
+			char str[128];
+			sprintf_s(
+			  str, "Startup: time to first frame %.3fms\n",
+			  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() *
+			    1000.0);
+			OutputDebugStringA(str);
+		}
 	}
 
-	// 各種解放
+	// GPUの処理完了を待ってから各種解放
+	dxCommon->WaitForGpu();
 	SafeDelete(gameScene);
 	audio->Finalize();
 
@@ -1,20 +1,63 @@
 ﻿#include "GameScene.h"
+#include "GpuMemoryAllocator.h"
 #include "TextureManager.h"
 #include <cassert>
 #include <time.h>
 
 using namespace DirectX;
 
+namespace {
+
+// Initializeで読み込むテクスチャ
+const char* const kTextureFileNames[] = {
+  "bg.jpg",    "stage2.jpg", "player.png", "beam.png",
+  "enemy.png", "title.png",  "enter.png",  "gameover.png",
+};
+
+// Initializeで読み込むWAV
+const char* const kWaveFileNames[] = {
+  "Audio/Ring05.wav", "Audio/Ring08.wav", "Audio/Ring09.wav", "Audio/chord.wav", "Audio/tada.wav",
+};
+
+} // namespace
+
+std::vector<TaskGraph::TaskId> GameScene::AddPreloadTasks(
+  TaskGraph& taskGraph, TaskGraph::TaskId textureManagerTask, TaskGraph::TaskId audioTask) {
+	std::vector<TaskGraph::TaskId> tasks;
+
+	// テクスチャのデコード
+	for (const char* fileName : kTextureFileNames) {
+		tasks.push_back(taskGraph.Add(
+		  fileName, [fileName]() { TextureManager::Preload(fileName); }, {textureManagerTask}));
+	}
+
+	// モデルの解析（マテリアルのテクスチャもデコードする）
+	tasks.push_back(taskGraph.Add(
+	  Model::GetDefaultModelName() + ".obj",
+	  []() { ModelManager::Preload(Model::GetDefaultModelName()); }, {textureManagerTask}));
+	// ステージ用の量子化頂点のモデル（頂点フォーマットが違うので別に読み込む）
+	tasks.push_back(taskGraph.Add(
+	  Model::GetDefaultModelName() + ".obj (packed)",
+	  []() {
+		  ModelManager::Preload(Model::GetDefaultModelName(), false, Mesh::VertexFormat::kPacked);
+	  },
+	  {textureManagerTask}));
+
+	// WAVの読み込み（読み込み済みならInitializeのLoadWaveは同じハンドルを返す）
+	for (const char* fileName : kWaveFileNames) {
+		tasks.push_back(taskGraph.Add(
+		  fileName, [fileName]() { Audio::GetInstance()->LoadWave(fileName); }, {audioTask}));
+	}
+
+	return tasks;
+}
+
 // コンストラクタ
 GameScene::GameScene() {}
 
 // デストラクタ
 GameScene::~GameScene() {
 	delete spriteBG_;
-	delete modelStage_;
-	delete modelPlayer_;
-	delete modelBeam_;
-	delete modelEnemy_;
 	delete spriteTitle_;
 	delete spriteEnter_;
 	delete spriteGameOver_;
@@ -42,7 +85,10 @@ void GameScene::Initialize() {
 
 	// ステージ
 	textureHandleStage_ = TextureManager::Load("stage2.jpg");
-	modelStage_ = Model::Create();
+	// 同じメッシュを並べてインスタンス描画するので量子化頂点で読み込み、頂点バッファを小さくする
+	// （スクロールはワールド行列で行うので、量子化の誤差はモデル空間の中に収まる）
+	modelStage_ = ModelManager::Load(
+	  Model::GetDefaultModelName(), false, Mesh::VertexFormat::kPacked);
 	for (int i = 0; i < 20; i++) {
 		worldTransformStage_[i].translation_ = {0, -1.5f, 2.0f * i - 5};
 		worldTransformStage_[i].scale_ = {4.5f, 1, 1};
@@ -51,13 +97,13 @@ void GameScene::Initialize() {
 
 	// プレイヤー
 	textureHandlePlayer_ = TextureManager::Load("player.png");
-	modelPlayer_ = Model::Create();
+	modelPlayer_ = ModelManager::Load(Model::GetDefaultModelName());
 	worldTransformPlayer_.scale_ = {0.5f, 0.5f, 0.5f};
 	worldTransformPlayer_.Initialize();
 
 	// ビーム
 	textureHandleBeam_ = TextureManager::Load("beam.png");
-	modelBeam_ = Model::Create();
+	modelBeam_ = ModelManager::Load(Model::GetDefaultModelName());
 	for (int i = 0; i < 10; i++) {
 		worldTransformBeam_[i].scale_ = {0.3f, 0.3f, 0.3f};
 		worldTransformBeam_[i].Initialize();
@@ -65,11 +111,17 @@ void GameScene::Initialize() {
 
 	// 敵
 	textureHandleEnemy_ = TextureManager::Load("enemy.png");
-	modelEnemy_ = Model::Create();
+	modelEnemy_ = ModelManager::Load(Model::GetDefaultModelName());
 	for (int i = 0; i < 10; i++) {
 		worldTransformEnemy_[i].scale_ = {0.5f, 0.5f, 0.5f};
 		worldTransformEnemy_[i].Initialize();
 	}
+
+	// モデルの共有状況をデバッグ出力
+	ModelManager::GetInstance()->OutputStatistics();
+	// GPUメモリの使用状況をデバッグ出力
+	GpuMemoryAllocator::GetInstance()->OutputStatistics();
+
 	// タイトル(2Dスプライト)
 	textureHandleTitle_ = TextureManager::Load("title.png");
 	spriteTitle_ = Sprite::Create(textureHandleTitle_, {0, 0});
@@ -216,26 +268,30 @@ void GameScene::GamePlayUpdate() {
 // ゲームプレイ3D表示
 void GameScene::GamePlayDraw3D() {
 	// ステージ
-	for (int i = 0; i < 20; i++) {
-		modelStage_->Draw(worldTransformStage_[i], viewProjection_, textureHandleStage_);
-	}
+	modelStage_->DrawInstanced(worldTransformStage_, 20, viewProjection_, textureHandleStage_);
 
 	// プレイヤー
 	modelPlayer_->Draw(worldTransformPlayer_, viewProjection_, textureHandlePlayer_);
 
 	// ビーム
+	const WorldTransform* beams[10];
+	size_t beamCount = 0;
 	for (int i = 0; i < 10; i++) {
 		if (beamFlag_[i] == 1) {
-			modelBeam_->Draw(worldTransformBeam_[i], viewProjection_, textureHandleBeam_);
+			beams[beamCount++] = &worldTransformBeam_[i];
 		}
 	}
+	modelBeam_->DrawInstanced(beams, beamCount, viewProjection_, textureHandleBeam_);
 
 	// 敵
+	const WorldTransform* enemies[10];
+	size_t enemyCount = 0;
 	for (int i = 0; i < 10; i++) {
 		if (enemyFlag_[i] != 0) {
-			modelEnemy_->Draw(worldTransformEnemy_[i], viewProjection_, textureHandleEnemy_);
+			enemies[enemyCount++] = &worldTransformEnemy_[i];
 		}
 	}
+	modelEnemy_->DrawInstanced(enemies, enemyCount, viewProjection_, textureHandleEnemy_);
 }
 
 // ゲームプレイ背景2D表示
@@ -250,6 +306,29 @@ void GameScene::GamePlayDraw2DNear() {
 
 	sprintf_s(str, "LIFE %d", playerLife_);
 	debugText_->Print(str, 900, 10, 2);
+
+#ifdef _DEBUG
+	// 描画の統計
+	const Model::DrawStatistics& statistics = Model::GetDrawStatistics();
+	sprintf_s(
+	  str, "DRAW %u CULL %u CALL %u OVER %u", statistics.visibleMeshCount,
+	  statistics.culledMeshCount, statistics.drawCallCount, statistics.overflowInstanceCount);
+	debugText_->Print(str, 200, 50, 1);
+
+	// 描画の並べ替え（ソート時間と、同じ状態の連続で省いたバインド数）
+	const RenderQueue::Statistics& queue = Model::GetRenderQueueStatistics();
+	sprintf_s(
+	  str, "SORT %.3fms BIND %u SAVED %u", queue.sortSeconds * 1000.0, queue.bindCount,
+	  queue.savedBindCount);
+	debugText_->Print(str, 200, 90, 1);
+
+	// フレーム時間とGPUの完了待ち時間（待ちが短いほどCPU側の余裕がある）
+	const DirectXCommon::FrameStatistics& frame = dxCommon_->GetFrameStatistics();
+	sprintf_s(
+	  str, "FRAME %.2fms WAIT %.2fms x%u", frame.frameMilliseconds, frame.waitMilliseconds,
+	  DirectXCommon::kFrameCount);
+	debugText_->Print(str, 200, 70, 1);
+#endif
 }
 
 // ゲームプレイ初期化
@@ -310,9 +389,7 @@ void GameScene::BeamUpdate() {
 	BeamBorn();
 
 	//行列更新
-	for (int i = 0; i < 10; i++) {
-		worldTransformBeam_[i].UpdateMatrix();
-	}
+	WorldTransform::UpdateMatrices(worldTransformBeam_, 10);
 }
 
 // ビーム移動
@@ -388,9 +465,7 @@ void GameScene::EnemyUpdate() {
 	EnemyJump();
 
 	//行列更新
-	for (int i = 0; i < 10; i++) {
-		worldTransformEnemy_[i].UpdateMatrix();
-	}
+	WorldTransform::UpdateMatrices(worldTransformEnemy_, 10);
 }
 
 // 敵移動
@@ -574,9 +649,9 @@ void GameScene::StageUpdate() {
 		if (worldTransformStage_[i].translation_.z < -5) {
 			worldTransformStage_[i].translation_.z += 40;
 		}
-		//行列更新
-		worldTransformStage_[i].UpdateMatrix();
 	}
+	//行列更新
+	WorldTransform::UpdateMatrices(worldTransformStage_, 20);
 }
 
 // ******************************************
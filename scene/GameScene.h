@@ -5,8 +5,10 @@
 #include "DirectXCommon.h"
 #include "Input.h"
 #include "Model.h"
+#include "ModelManager.h"
 #include "SafeDelete.h"
 #include "Sprite.h"
+#include "TaskGraph.h"
 #include "ViewProjection.h"
 #include "WorldTransform.h"
 #include <DirectXMath.h>
@@ -16,6 +18,18 @@
 /// </summary>
 class GameScene {
 
+  public: // 静的メンバ関数
+	/// <summary>
+	/// 初期化で使う素材を先に読み込むタスクを追加する
+	/// テクスチャのデコード・モデルの解析・WAVの読み込みをワーカースレッドで並列に行う
+	/// </summary>
+	/// <param name="taskGraph">タスクグラフ</param>
+	/// <param name="textureManagerTask">テクスチャマネージャの初期化タスク</param>
+	/// <param name="audioTask">オーディオの初期化タスク</param>
+	/// <returns>追加したタスク</returns>
+	static std::vector<TaskGraph::TaskId> AddPreloadTasks(
+	  TaskGraph& taskGraph, TaskGraph::TaskId textureManagerTask, TaskGraph::TaskId audioTask);
+
   public: // メンバ関数
 	/// <summary>
 	/// コンストクラタ
@@ -61,23 +75,23 @@ class GameScene {
 
 	// ステージ
 	uint32_t textureHandleStage_ = 0;
-	Model* modelStage_ = nullptr;
+	std::shared_ptr<Model> modelStage_;
 	WorldTransform worldTransformStage_[20];
 
 	// プレイヤー
 	uint32_t textureHandlePlayer_ = 0;
-	Model* modelPlayer_ = nullptr;
+	std::shared_ptr<Model> modelPlayer_;
 	WorldTransform worldTransformPlayer_;
 
 	// ビ－ム
 	uint32_t textureHandleBeam_ = 0;
-	Model* modelBeam_ = nullptr;
+	std::shared_ptr<Model> modelBeam_;
 	WorldTransform worldTransformBeam_[10];
 	int beamFlag_[10] = {}; // ビーム存在フラグ（0:存在しない、1:存在する）
 
 	// 敵
 	uint32_t textureHandleEnemy_ = 0;
-	Model* modelEnemy_ = nullptr;
+	std::shared_ptr<Model> modelEnemy_;
 	WorldTransform worldTransformEnemy_[10];
 	int enemyFlag_[10] = {};    // 敵存在フラグ（0:存在しない、1:存在する）
 	float enemySpeed_[10] = {}; // 敵のスピード
@@ -0,0 +1,154 @@
+﻿#include "DescriptorAllocator.h"
+#include "TestCommon.h"
+#include <chrono>
+#include <random>
+
+namespace {
+
+/// <summary>
+/// 基本動作（番号の順序、世代番号、フェンス値までの再利用の保留）
+/// </summary>
+void TestBasic() {
+	DescriptorAllocator allocator;
+	allocator.Initialize(2);
+
+	// 小さい番号から使い、空きがなければ失敗
+	uint32_t a = allocator.Allocate();
+	uint32_t b = allocator.Allocate();
+	TEST_CHECK(DescriptorAllocator::GetIndex(a) == 0);
+	TEST_CHECK(DescriptorAllocator::GetIndex(b) == 1);
+	TEST_CHECK(allocator.Allocate() == DescriptorAllocator::kInvalidHandle);
+	TEST_CHECK(!allocator.IsValid(DescriptorAllocator::kInvalidHandle));
+
+	// 解放したハンドルはすぐ無効になり、二重解放もできない
+	TEST_CHECK(allocator.Free(a));
+	TEST_CHECK(!allocator.IsValid(a));
+	TEST_CHECK(!allocator.Free(a));
+	TEST_CHECK(allocator.GetUsedCount() == 1);
+	TEST_CHECK(allocator.GetPendingCount() == 1);
+
+	// フェンス値が完了するまで番号は再利用しない
+	std::vector<uint32_t> released;
+	allocator.FinishFrame(1);
+	allocator.Release(0, released);
+	TEST_CHECK(released.empty());
+	TEST_CHECK(allocator.Allocate() == DescriptorAllocator::kInvalidHandle);
+	allocator.Release(1, released);
+	TEST_CHECK(released.size() == 1 && released[0] == 0);
+	TEST_CHECK(allocator.GetPendingCount() == 0);
+
+	// 同じ番号でも世代が違うので古いハンドルとは一致しない
+	uint32_t c = allocator.Allocate();
+	TEST_CHECK(DescriptorAllocator::GetIndex(c) == 0);
+	TEST_CHECK(c != a);
+	TEST_CHECK(allocator.IsValid(c) && !allocator.IsValid(a));
+}
+
+/// <summary>
+/// 2フレーム遅れで完了するGPUを模して割り当てと解放を繰り返す
+/// </summary>
+/// <param name="frameCount">フレーム数</param>
+/// <param name="verify">番号ごとの使用状況と解放済みのハンドルを記録して確かめるか</param>
+/// <param name="allocationCount">成功した割り当ての数</param>
+/// <param name="failureCount">失敗した割り当ての数</param>
+/// <returns>使用中の番号の重なりや無効なハンドルの誤判定がなければtrue</returns>
+bool Simulate(
+  uint32_t frameCount, bool verify, uint32_t& allocationCount, uint32_t& failureCount) {
+	const uint32_t kCapacity = 256;
+	const uint32_t kLatency = 2;
+	const uint32_t kOperationsPerFrame = 32;
+
+	DescriptorAllocator allocator;
+	allocator.Initialize(kCapacity);
+	std::mt19937 random(12345);
+	// 番号が使用中か、GPUの完了待ちか
+	std::vector<bool> used(kCapacity, false), inFlight(kCapacity, false);
+	std::vector<uint32_t> live, stale, released;
+	bool ok = true;
+	allocationCount = 0;
+	failureCount = 0;
+
+	for (uint32_t frame = 1; frame <= frameCount; frame++) {
+		for (uint32_t i = 0; i < kOperationsPerFrame; i++) {
+			// 使用数が半分前後で揺れるように、割り当てと解放を選ぶ
+			bool allocate = live.empty() || random() % kCapacity >= live.size() / 2 + 64;
+			if (allocate) {
+				uint32_t handle = allocator.Allocate();
+				if (handle == DescriptorAllocator::kInvalidHandle) {
+					failureCount++;
+					continue;
+				}
+				allocationCount++;
+				live.push_back(handle);
+				if (!verify) {
+					continue;
+				}
+				uint32_t index = DescriptorAllocator::GetIndex(handle);
+				ok &= index < kCapacity && !used[index] && !inFlight[index];
+				used[index] = true;
+			} else {
+				size_t pick = random() % live.size();
+				uint32_t handle = live[pick];
+				live[pick] = live.back();
+				live.pop_back();
+				ok &= allocator.Free(handle);
+				if (verify) {
+					used[DescriptorAllocator::GetIndex(handle)] = false;
+					inFlight[DescriptorAllocator::GetIndex(handle)] = true;
+					stale.push_back(handle);
+				}
+			}
+		}
+		// フェンス値はフレーム番号と同じ
+		allocator.FinishFrame(frame);
+		if (frame > kLatency) {
+			released.clear();
+			allocator.Release(frame - kLatency, released);
+			for (uint32_t index : released) {
+				if (verify) {
+					ok &= inFlight[index];
+					inFlight[index] = false;
+				}
+			}
+		}
+		if (verify) {
+			// 解放済みのハンドルは、同じ番号が再利用されていても無効
+			for (uint32_t handle : stale) {
+				ok &= !allocator.IsValid(handle) && !allocator.Free(handle);
+			}
+			if (stale.size() > kCapacity) {
+				stale.erase(stale.begin(), stale.begin() + kCapacity / 2);
+			}
+			for (uint32_t handle : live) {
+				ok &= allocator.IsValid(handle);
+			}
+			ok &= allocator.GetUsedCount() == live.size();
+		}
+	}
+	return ok;
+}
+
+} // namespace
+
+int main() {
+	const uint32_t kFrameCount = 1000;
+
+	TestBasic();
+
+	uint32_t allocationCount = 0;
+	uint32_t failureCount = 0;
+	TEST_CHECK(Simulate(kFrameCount, true, allocationCount, failureCount));
+	TEST_CHECK(allocationCount > 0);
+
+	// 1回あたりの時間
+	auto startTime = std::chrono::steady_clock::now();
+	Simulate(kFrameCount, false, allocationCount, failureCount);
+	double seconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	printf(
+	  "DescriptorAllocator %u frames: %u allocations (%u failed) %.1fns/alloc\n", kFrameCount,
+	  allocationCount, failureCount,
+	  allocationCount > 0 ? seconds * 1.0e9 / allocationCount : 0.0);
+
+	return Test::Finish("DescriptorAllocatorTest");
+}
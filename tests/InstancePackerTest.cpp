@@ -0,0 +1,145 @@
+﻿#include "InstancePacker.h"
+#include "TestCommon.h"
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+
+// 境界球（モデル座標の原点を中心とした半径1）
+const XMFLOAT3 kBoundCenter = {0.0f, 0.0f, 0.0f};
+const float kBoundRadius = 1.0f;
+
+/// <summary>
+/// 原点を見るカメラの視錐台（z=0の平面で見える範囲は約±4.1）
+/// </summary>
+/// <returns>視錐台</returns>
+Frustum MakeFrustum() {
+	XMMATRIX matView = XMMatrixLookAtLH(
+	  XMVectorSet(0.0f, 0.0f, -10.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX matProjection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.0f, 0.1f, 100.0f);
+	Frustum frustum;
+	frustum.Update(matView * matProjection);
+	return frustum;
+}
+
+/// <summary>
+/// ワールド行列の設定
+/// </summary>
+/// <param name="transform">ワールドトランスフォーム</param>
+/// <param name="scale">拡大率</param>
+/// <param name="translation">平行移動</param>
+void SetWorld(WorldTransform& transform, const XMFLOAT3& scale, const XMFLOAT3& translation) {
+	transform.scale_ = scale;
+	transform.translation_ = translation;
+	transform.matWorld_ = XMMatrixScaling(scale.x, scale.y, scale.z) *
+	                      XMMatrixTranslation(translation.x, translation.y, translation.z);
+}
+
+/// <summary>
+/// 書き込んだ行列がワールド行列と同じ値か
+/// </summary>
+/// <param name="dest">書き込み先</param>
+/// <param name="transform">ワールドトランスフォーム</param>
+/// <returns>同じ値ならtrue</returns>
+bool IsSameMatrix(const XMFLOAT4X4& dest, const WorldTransform& transform) {
+	XMFLOAT4X4 expected;
+	XMStoreFloat4x4(&expected, transform.matWorld_);
+	return memcmp(&dest, &expected, sizeof(XMFLOAT4X4)) == 0;
+}
+
+/// <summary>
+/// 視錐台の外のインスタンスの除外、書き込み先の容量、元の番号
+/// </summary>
+void TestPack() {
+	const Frustum frustum = MakeFrustum();
+	std::vector<WorldTransform> transforms(11);
+	SetWorld(transforms[0], {1, 1, 1}, {-20, 0, 0});
+	SetWorld(transforms[1], {1, 1, 1}, {-2, 0, 0});
+	SetWorld(transforms[2], {1, 1, 1}, {0, 0, 0});
+	SetWorld(transforms[3], {1, 1, 1}, {2, 1, 0});
+	SetWorld(transforms[4], {1, 1, 1}, {20, 0, 0});
+	SetWorld(transforms[5], {1, 1, 1}, {0, 0, -20}); // カメラの後ろ
+	SetWorld(transforms[6], {1, 1, 1}, {1, 0, 200}); // 奥のクリップ面の外
+	SetWorld(transforms[7], {1, 1, 1}, {3, 0, 0});
+	SetWorld(transforms[8], {1, 1, 1}, {-3, -3, 0});
+	SetWorld(transforms[9], {1, 1, 1}, {0, 50, 0});
+	// 半径1では外側だが、拡大率で広げた境界球は重なる
+	SetWorld(transforms[10], {3, 1, 1}, {6.5f, 0, 0});
+
+	std::vector<const WorldTransform*> pointers;
+	for (const WorldTransform& transform : transforms) {
+		pointers.push_back(&transform);
+	}
+	const std::vector<uint32_t> visible = {1, 2, 3, 7, 8, 10};
+
+	// 全て書き込める場合
+	std::vector<XMFLOAT4X4> dest(pointers.size());
+	std::vector<uint32_t> packedIndices(pointers.size(), UINT32_MAX);
+	InstancePacker::Result result = InstancePacker::Pack(
+	  pointers.data(), pointers.size(), kBoundCenter, kBoundRadius, frustum, dest.data(),
+	  dest.size(), packedIndices.data());
+	TEST_CHECK(result.packedCount == visible.size());
+	TEST_CHECK(result.culledCount == pointers.size() - visible.size());
+	for (size_t i = 0; i < visible.size() && i < result.packedCount; i++) {
+		TEST_CHECK(packedIndices[i] == visible[i]);
+		TEST_CHECK(IsSameMatrix(dest[i], transforms[visible[i]]));
+	}
+
+	// 一杯になったら残りは調べない（4番目以降の書き込み先は変えない）
+	const uint32_t kCapacity = 3;
+	std::vector<XMFLOAT4X4> smallDest(kCapacity + 1);
+	XMStoreFloat4x4(&smallDest[kCapacity], XMMatrixIdentity());
+	result = InstancePacker::Pack(
+	  pointers.data(), pointers.size(), kBoundCenter, kBoundRadius, frustum, smallDest.data(),
+	  kCapacity, nullptr);
+	TEST_CHECK(result.packedCount == kCapacity);
+	TEST_CHECK(result.culledCount == 1);
+	for (uint32_t i = 0; i < kCapacity; i++) {
+		TEST_CHECK(IsSameMatrix(smallDest[i], transforms[visible[i]]));
+	}
+	WorldTransform identity;
+	identity.matWorld_ = XMMatrixIdentity();
+	TEST_CHECK(IsSameMatrix(smallDest[kCapacity], identity));
+
+	// 空の配列
+	result = InstancePacker::Pack(
+	  pointers.data(), 0, kBoundCenter, kBoundRadius, frustum, dest.data(), dest.size(), nullptr);
+	TEST_CHECK(result.packedCount == 0 && result.culledCount == 0);
+}
+
+} // namespace
+
+int main() {
+	const uint32_t kCount = 10000;
+
+	TestPack();
+
+	// 格子状に並べたインスタンスの詰め込み時間（視錐台の外のものを含む）
+	const Frustum frustum = MakeFrustum();
+	std::vector<WorldTransform> transforms(kCount);
+	std::vector<const WorldTransform*> pointers(kCount);
+	for (uint32_t i = 0; i < kCount; i++) {
+		float x = static_cast<float>(i % 100) * 0.1f - 5.0f;
+		float y = static_cast<float>(i / 100) * 0.1f - 5.0f;
+		SetWorld(transforms[i], {0.1f, 0.1f, 0.1f}, {x * 1.5f, y * 1.5f, 0.0f});
+		pointers[i] = &transforms[i];
+	}
+	std::vector<XMFLOAT4X4> dest(kCount);
+	std::vector<uint32_t> packedIndices(kCount);
+	auto startTime = std::chrono::steady_clock::now();
+	InstancePacker::Result result = InstancePacker::Pack(
+	  pointers.data(), kCount, kBoundCenter, kBoundRadius, frustum, dest.data(), dest.size(),
+	  packedIndices.data());
+	double seconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	TEST_CHECK(result.packedCount + result.culledCount == kCount);
+	TEST_CHECK(result.packedCount > 0 && result.culledCount > 0);
+	printf(
+	  "InstancePacker %u instances: %u packed, %u culled, %.1fns/instance\n", kCount,
+	  result.packedCount, result.culledCount, seconds * 1.0e9 / kCount);
+
+	return Test::Finish("InstancePackerTest");
+}
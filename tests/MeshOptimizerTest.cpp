@@ -0,0 +1,147 @@
+﻿#include "MeshOptimizer.h"
+#include "TestCommon.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace {
+
+/// <summary>
+/// 格子状のメッシュのインデックス配列を作る（三角形の順番はシャッフルする）
+/// </summary>
+/// <param name="width">横の頂点数</param>
+/// <param name="height">縦の頂点数</param>
+/// <returns>インデックス配列</returns>
+std::vector<uint32_t> MakeShuffledGrid(uint32_t width, uint32_t height) {
+	std::vector<std::array<uint32_t, 3>> triangles;
+	for (uint32_t y = 0; y + 1 < height; y++) {
+		for (uint32_t x = 0; x + 1 < width; x++) {
+			uint32_t v = y * width + x;
+			triangles.push_back({v, v + width, v + 1});
+			triangles.push_back({v + 1, v + width, v + width + 1});
+		}
+	}
+	std::mt19937 random(12345);
+	std::shuffle(triangles.begin(), triangles.end(), random);
+
+	std::vector<uint32_t> indices;
+	for (const auto& triangle : triangles) {
+		indices.insert(indices.end(), triangle.begin(), triangle.end());
+	}
+	return indices;
+}
+
+/// <summary>
+/// 三角形の集合（頂点の順番は保ったまま、三角形の並びだけを無視して比べる）
+/// </summary>
+/// <param name="indices">インデックス配列</param>
+/// <returns>整列した三角形の配列</returns>
+std::vector<std::array<uint32_t, 3>> GetTriangleSet(const std::vector<uint32_t>& indices) {
+	std::vector<std::array<uint32_t, 3>> triangles;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		triangles.push_back({indices[i], indices[i + 1], indices[i + 2]});
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+/// <summary>
+/// FIFOキャッシュの解析（LRUと結果が異なる並びで確かめる）
+/// </summary>
+void TestAnalyzeVertexCache() {
+	// 同じ三角形の繰り返しは最初の3頂点だけがミス
+	MeshOptimizer::CacheStatistics repeated =
+	  MeshOptimizer::AnalyzeVertexCache({0, 1, 2, 0, 1, 2}, 3);
+	TEST_CHECK(repeated.triangleCount == 2);
+	TEST_CHECK(repeated.vertexCount == 3);
+	TEST_CHECK(repeated.missCount == 3);
+
+	// サイズ3のFIFOでは、ヒットした0は先頭に戻らないので3の追加で追い出される
+	// （LRUなら0は残り、ミスは4回になる）
+	MeshOptimizer::CacheStatistics fifo =
+	  MeshOptimizer::AnalyzeVertexCache({0, 1, 2, 0, 3, 0}, 4, 3);
+	TEST_CHECK(fifo.triangleCount == 2);
+	TEST_CHECK(fifo.vertexCount == 4);
+	TEST_CHECK(fifo.missCount == 5);
+
+	// 空の配列
+	MeshOptimizer::CacheStatistics empty = MeshOptimizer::AnalyzeVertexCache({}, 0);
+	TEST_CHECK(empty.triangleCount == 0);
+	TEST_CHECK(empty.missCount == 0);
+	TEST_CHECK(empty.GetAcmr() == 0.0f);
+}
+
+/// <summary>
+/// 頂点キャッシュ最適化（三角形を失わず、ACMRが下がること）
+/// </summary>
+/// <param name="indices">インデックス配列</param>
+/// <param name="vertexCount">頂点数</param>
+void TestOptimizeVertexCache(std::vector<uint32_t> indices, size_t vertexCount) {
+	MeshOptimizer::CacheStatistics before =
+	  MeshOptimizer::AnalyzeVertexCache(indices, vertexCount);
+	std::vector<std::array<uint32_t, 3>> triangles = GetTriangleSet(indices);
+
+	MeshOptimizer::OptimizeVertexCache(indices, vertexCount);
+	MeshOptimizer::CacheStatistics after = MeshOptimizer::AnalyzeVertexCache(indices, vertexCount);
+
+	TEST_CHECK(GetTriangleSet(indices) == triangles);
+	TEST_CHECK(after.vertexCount == before.vertexCount);
+	TEST_CHECK(after.missCount < before.missCount);
+	// 格子のACMRの理想値は0.5付近（シャッフルした状態では3近くになる）
+	TEST_CHECK(after.GetAcmr() < 0.8f);
+	printf(
+	  "MeshOptimizer %zu triangles: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+	  after.triangleCount, before.GetAcmr(), after.GetAcmr(), before.GetAtvr(),
+	  after.GetAtvr());
+}
+
+/// <summary>
+/// 頂点フェッチ最適化（参照順の番号と、対応表が置換になっていること）
+/// </summary>
+void TestOptimizeVertexFetch() {
+	// 頂点1と4は参照されない
+	const size_t kVertexCount = 6;
+	const std::vector<uint32_t> original = {5, 2, 3, 3, 2, 0};
+	std::vector<uint32_t> indices = original;
+	std::vector<uint32_t> remap = MeshOptimizer::OptimizeVertexFetch(indices, kVertexCount);
+
+	TEST_CHECK((indices == std::vector<uint32_t>{0, 1, 2, 2, 1, 3}));
+	TEST_CHECK(remap.size() == kVertexCount);
+	for (size_t i = 0; i < original.size(); i++) {
+		TEST_CHECK(remap[original[i]] == indices[i]);
+	}
+	// 未参照の頂点は末尾に元の順番で詰める
+	TEST_CHECK(remap[1] == 4);
+	TEST_CHECK(remap[4] == 5);
+
+	std::vector<uint32_t> sorted = remap;
+	std::sort(sorted.begin(), sorted.end());
+	for (uint32_t i = 0; i < kVertexCount; i++) {
+		TEST_CHECK(sorted[i] == i);
+	}
+}
+
+} // namespace
+
+int main() {
+	const uint32_t kGridSize = 128;
+
+	TestAnalyzeVertexCache();
+	TestOptimizeVertexFetch();
+
+	std::vector<uint32_t> indices = MakeShuffledGrid(kGridSize, kGridSize);
+	TestOptimizeVertexCache(indices, kGridSize * kGridSize);
+
+	// 最適化の時間
+	auto startTime = std::chrono::steady_clock::now();
+	MeshOptimizer::OptimizeVertexCache(indices, kGridSize * kGridSize);
+	double seconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	printf(
+	  "MeshOptimizer::OptimizeVertexCache %zu triangles: %.2fms\n", indices.size() / 3,
+	  seconds * 1.0e3);
+
+	return Test::Finish("MeshOptimizerTest");
+}
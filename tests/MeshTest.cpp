@@ -0,0 +1,160 @@
+﻿#include "Mesh.h"
+#include "TestCommon.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+
+/// <summary>
+/// 旧実装（座標インデックスをキーにしたハッシュマップ）による平滑化
+/// </summary>
+/// <param name="vertices">頂点データ</param>
+/// <param name="smoothData">エッジ平滑化データ</param>
+void CalculateSmoothedVertexNormalsReference(
+  std::vector<Mesh::VertexPosNormalUv>& vertices, const std::vector<Mesh::SmoothData>& smoothData) {
+	std::unordered_map<uint32_t, std::vector<uint32_t>> map;
+	for (const Mesh::SmoothData& data : smoothData) {
+		map[data.indexPosition].emplace_back(data.indexVertex);
+	}
+	for (auto& pair : map) {
+		const std::vector<uint32_t>& v = pair.second;
+		XMVECTOR normal = {};
+		for (uint32_t index : v) {
+			normal += XMLoadFloat3(&vertices[index].normal);
+		}
+		normal = XMVector3Normalize(normal / (float)v.size());
+		for (uint32_t index : v) {
+			XMStoreFloat3(&vertices[index].normal, normal);
+		}
+	}
+}
+
+/// <summary>
+/// 法線の要素ごとの差の最大値
+/// </summary>
+/// <param name="a">頂点データ</param>
+/// <param name="b">頂点データ</param>
+/// <returns>差の最大値（頂点数が違えば無限大）</returns>
+float GetMaxError(
+  const std::vector<Mesh::VertexPosNormalUv>& a, const std::vector<Mesh::VertexPosNormalUv>& b) {
+	float maxError = a.size() == b.size() ? 0.0f : INFINITY;
+	for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+		maxError = std::max(
+		  {maxError, std::fabs(a[i].normal.x - b[i].normal.x),
+		   std::fabs(a[i].normal.y - b[i].normal.y), std::fabs(a[i].normal.z - b[i].normal.z)});
+	}
+	return maxError;
+}
+
+/// <summary>
+/// 小さい例（共有する座標の平均、逆向きの法線、平滑化しない頂点）
+/// </summary>
+void TestBasic() {
+	Mesh mesh;
+	mesh.AddVertex({{0, 0, 0}, {1, 0, 0}, {0, 0}});
+	mesh.AddVertex({{0, 0, 0}, {0, 1, 0}, {0, 0}});
+	mesh.AddVertex({{1, 0, 0}, {0, 0, 1}, {0, 0}});
+	mesh.AddVertex({{1, 0, 0}, {0, 0, -1}, {0, 0}});
+	mesh.AddVertex({{2, 0, 0}, {0, 2, 0}, {0, 0}});
+	mesh.AddSmoothData(0, 0);
+	mesh.AddSmoothData(0, 1);
+	mesh.AddSmoothData(1, 2);
+	mesh.AddSmoothData(1, 3);
+	mesh.CalculateSmoothedVertexNormals();
+
+	const std::vector<Mesh::VertexPosNormalUv>& vertices = mesh.GetVertices();
+	const float kHalfSqrt2 = 0.70710678f;
+	for (int i = 0; i < 2; i++) {
+		TEST_CHECK(std::fabs(vertices[i].normal.x - kHalfSqrt2) <= 1.0e-6f);
+		TEST_CHECK(std::fabs(vertices[i].normal.y - kHalfSqrt2) <= 1.0e-6f);
+		TEST_CHECK(vertices[i].normal.z == 0.0f);
+	}
+	// 打ち消し合う法線は長さ0のまま
+	for (int i = 2; i < 4; i++) {
+		TEST_CHECK(vertices[i].normal.x == 0.0f && vertices[i].normal.y == 0.0f);
+		TEST_CHECK(vertices[i].normal.z == 0.0f);
+	}
+	// 平滑化データのない頂点は正規化もしない
+	TEST_CHECK(vertices[4].normal.y == 2.0f);
+}
+
+/// <summary>
+/// 起伏のある格子を面ごとの法線で作る（四角形ごとに4頂点、座標は隣の面と共有）
+/// </summary>
+/// <param name="gridSize">格子の1辺の分割数（頂点数は4×gridSizeの2乗）</param>
+/// <param name="vertices">頂点データ</param>
+/// <param name="smoothData">エッジ平滑化データ</param>
+void MakeGrid(
+  uint32_t gridSize, std::vector<Mesh::VertexPosNormalUv>& vertices,
+  std::vector<Mesh::SmoothData>& smoothData) {
+	const uint32_t rowSize = gridSize + 1;
+	auto height = [gridSize](uint32_t x, uint32_t y) {
+		return std::sin(x * 0.3f) * std::cos(y * 0.2f) * 4.0f / (1.0f + gridSize * 0.001f);
+	};
+	for (uint32_t y = 0; y < gridSize; y++) {
+		for (uint32_t x = 0; x < gridSize; x++) {
+			const uint32_t cornerX[4] = {x, x + 1, x + 1, x};
+			const uint32_t cornerY[4] = {y, y, y + 1, y + 1};
+			XMFLOAT3 pos[4];
+			for (int k = 0; k < 4; k++) {
+				pos[k] = {float(cornerX[k]), height(cornerX[k], cornerY[k]), float(cornerY[k])};
+			}
+			XMFLOAT3 normal;
+			XMStoreFloat3(
+			  &normal, XMVector3Normalize(XMVector3Cross(
+			             XMLoadFloat3(&pos[2]) - XMLoadFloat3(&pos[0]),
+			             XMLoadFloat3(&pos[1]) - XMLoadFloat3(&pos[0]))));
+			for (int k = 0; k < 4; k++) {
+				uint32_t indexVertex = static_cast<uint32_t>(vertices.size());
+				vertices.push_back({pos[k], normal, {0.0f, 0.0f}});
+				smoothData.push_back({cornerY[k] * rowSize + cornerX[k], indexVertex});
+			}
+		}
+	}
+}
+
+} // namespace
+
+int main() {
+	const uint32_t kGridSize = 256;
+
+	TestBasic();
+
+	std::vector<Mesh::VertexPosNormalUv> reference;
+	std::vector<Mesh::SmoothData> smoothData;
+	MakeGrid(kGridSize, reference, smoothData);
+	Mesh mesh;
+	for (const Mesh::VertexPosNormalUv& vertex : reference) {
+		mesh.AddVertex(vertex);
+	}
+
+	// 旧実装
+	auto startTime = std::chrono::steady_clock::now();
+	CalculateSmoothedVertexNormalsReference(reference, smoothData);
+	double referenceSeconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	// 新実装（登録も計測に含める）
+	startTime = std::chrono::steady_clock::now();
+	for (const Mesh::SmoothData& data : smoothData) {
+		mesh.AddSmoothData(data.indexPosition, data.indexVertex);
+	}
+	mesh.CalculateSmoothedVertexNormals();
+	double seconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	float maxError = GetMaxError(mesh.GetVertices(), reference);
+	TEST_CHECK(maxError <= 1.0e-5f);
+	printf(
+	  "Mesh::CalculateSmoothedVertexNormals %u x %u: vertices %zu, hashmap %.3fms, csr %.3fms "
+	  "x%.2f, max error %g\n",
+	  kGridSize, kGridSize, reference.size(), referenceSeconds * 1.0e3, seconds * 1.0e3,
+	  seconds > 0.0 ? referenceSeconds / seconds : 0.0, maxError);
+
+	return Test::Finish("MeshTest");
+}
@@ -0,0 +1,262 @@
+﻿#include "Model.h"
+#include "TestCommon.h"
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+
+// テスト用に生成するモデル名
+const char kModelName[] = "model_test";
+
+// 基準の読み込み結果のメッシュ
+struct ReferenceMesh {
+	std::string name;                              // 名前
+	std::vector<Mesh::VertexPosNormalUv> vertices; // 頂点データ（角ごと）
+	std::vector<uint32_t> indices;                 // インデックス
+	std::vector<Mesh::SmoothData> smoothData;      // エッジ平滑化データ
+};
+
+/// <summary>
+/// 座標インデックスごとに法線を平均する（旧実装のハッシュマップ方式）
+/// </summary>
+/// <param name="mesh">メッシュ</param>
+void SmoothNormals(ReferenceMesh& mesh) {
+	std::unordered_map<uint32_t, std::vector<uint32_t>> map;
+	for (const Mesh::SmoothData& data : mesh.smoothData) {
+		map[data.indexPosition].emplace_back(data.indexVertex);
+	}
+	for (auto& pair : map) {
+		XMVECTOR normal = {};
+		for (uint32_t index : pair.second) {
+			normal += XMLoadFloat3(&mesh.vertices[index].normal);
+		}
+		normal = XMVector3Normalize(normal / (float)pair.second.size());
+		for (uint32_t index : pair.second) {
+			XMStoreFloat3(&mesh.vertices[index].normal, normal);
+		}
+	}
+}
+
+/// <summary>
+/// 旧実装と同じ、ifstreamとistringstreamで1行ずつ解析する読み込み
+/// （マテリアルなしのOBJのみ。角ごとに頂点を持ち、溶接しない）
+/// </summary>
+/// <param name="filePath">.objファイルのパス</param>
+/// <param name="smoothing">エッジ平滑化フラグ</param>
+/// <returns>メッシュ</returns>
+std::vector<ReferenceMesh> LoadReference(const std::string& filePath, bool smoothing) {
+	std::vector<ReferenceMesh> meshes(1);
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	std::ifstream file(filePath);
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream lineStream(line);
+		std::string key;
+		std::getline(lineStream, key, ' ');
+
+		if (key == "g") {
+			if (!meshes.back().name.empty() && !meshes.back().vertices.empty()) {
+				meshes.emplace_back();
+			}
+			lineStream >> meshes.back().name;
+		} else if (key == "v" || key == "vn") {
+			XMFLOAT3 value{};
+			lineStream >> value.x >> value.y >> value.z;
+			(key == "v" ? positions : normals).push_back(value);
+		} else if (key == "f") {
+			ReferenceMesh& mesh = meshes.back();
+			const uint32_t base = static_cast<uint32_t>(mesh.vertices.size());
+			uint32_t faceIndexCount = 0;
+			std::string indexString;
+			while (std::getline(lineStream, indexString, ' ')) {
+				std::istringstream indexStream(indexString);
+				uint32_t indexPosition = 0, indexTexcoord = 0, indexNormal = 0;
+				indexStream >> indexPosition;
+				indexStream.seekg(1, std::ios_base::cur); // スラッシュを飛ばす
+				Mesh::VertexPosNormalUv vertex{};
+				vertex.pos = positions[indexPosition - 1];
+				if (indexStream.peek() == '/') {
+					// スラッシュ2連続の場合、頂点番号のみ
+					vertex.normal = {0, 0, 1};
+				} else {
+					indexStream >> indexTexcoord;
+					indexStream.seekg(1, std::ios_base::cur); // スラッシュを飛ばす
+					indexStream >> indexNormal;
+					vertex.normal = normals[indexNormal - 1];
+					mesh.smoothData.push_back(
+					  {indexPosition, static_cast<uint32_t>(mesh.vertices.size())});
+				}
+				mesh.vertices.push_back(vertex);
+
+				// 4点目以降は n-1,n,n-3 の順で三角形を構築する
+				const uint32_t index = base + faceIndexCount;
+				if (faceIndexCount >= 3) {
+					mesh.indices.insert(mesh.indices.end(), {index - 1, index, index - 3});
+				} else {
+					mesh.indices.push_back(index);
+				}
+				faceIndexCount++;
+			}
+		}
+	}
+	if (smoothing) {
+		for (ReferenceMesh& mesh : meshes) {
+			SmoothNormals(mesh);
+		}
+	}
+	return meshes;
+}
+
+/// <summary>
+/// グループ、三角形から六角形までの面、"v//vn"形式の面を含むOBJを書き出す
+/// </summary>
+/// <param name="filePath">.objファイルのパス</param>
+/// <param name="gridSize">グループごとの格子の一辺の数</param>
+/// <param name="groupCount">グループ数</param>
+void WriteObj(const std::string& filePath, uint32_t gridSize, uint32_t groupCount) {
+	std::ofstream file(filePath);
+	const uint32_t rowSize = gridSize + 1;
+	for (uint32_t y = 0; y <= gridSize * groupCount; y++) {
+		for (uint32_t x = 0; x <= gridSize; x++) {
+			float height = std::sin(x * 0.3f) * std::cos(y * 0.2f);
+			file << "v " << x << " " << height << " " << y << "\n";
+		}
+	}
+	for (uint32_t i = 0; i < 64; i++) {
+		float angle = i * 0.1f;
+		file << "vn " << std::cos(angle) << " " << 1 << " " << std::sin(angle) << "\n";
+	}
+	file << "vt 0.5 0.5\n";
+
+	// 三角形から六角形までを順に並べる（五角形と六角形は角を重複させて作る）
+	for (uint32_t g = 0; g < groupCount; g++) {
+		file << "g group" << g << "\n";
+		for (uint32_t y = g * gridSize; y < (g + 1) * gridSize; y++) {
+			for (uint32_t x = 0; x < gridSize; x++) {
+				uint32_t v00 = y * rowSize + x + 1;
+				uint32_t v10 = v00 + 1;
+				uint32_t v01 = v00 + rowSize;
+				uint32_t v11 = v01 + 1;
+				std::vector<uint32_t> corners;
+				switch ((x + y) % 4) {
+				case 0:
+					corners = {v00, v01, v10};
+					break;
+				case 1:
+					corners = {v00, v01, v11, v10};
+					break;
+				case 2:
+					corners = {v00, v01, v11, v10, v00};
+					break;
+				default:
+					corners = {v00, v01, v01, v11, v10, v10};
+					break;
+				}
+				file << "f";
+				for (size_t k = 0; k < corners.size(); k++) {
+					uint32_t normal = (corners[k] + static_cast<uint32_t>(k)) % 64 + 1;
+					if (x % 3 == 0) {
+						file << " " << corners[k] << "//" << normal;
+					} else {
+						file << " " << corners[k] << "/1/" << normal;
+					}
+				}
+				file << "\n";
+			}
+		}
+	}
+}
+
+/// <summary>
+/// 読み込み結果を三角形の頂点列に展開して比較する
+/// </summary>
+/// <param name="model">モデル</param>
+/// <param name="reference">基準の読み込み結果</param>
+/// <returns>一致すればtrue</returns>
+bool IsSameTriangles(Model& model, const std::vector<ReferenceMesh>& reference) {
+	const float kTolerance = 1.0e-5f;
+	const std::vector<Mesh*>& meshes = model.GetMeshes();
+	if (meshes.size() != reference.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < meshes.size(); i++) {
+		const std::vector<Mesh::VertexPosNormalUv>& vertices = meshes[i]->GetVertices();
+		const std::vector<uint32_t>& indices = meshes[i]->GetIndices();
+		if (meshes[i]->GetName() != reference[i].name ||
+		    indices.size() != reference[i].indices.size()) {
+			return false;
+		}
+		for (size_t k = 0; k < indices.size(); k++) {
+			const Mesh::VertexPosNormalUv& a = vertices[indices[k]];
+			const Mesh::VertexPosNormalUv& b = reference[i].vertices[reference[i].indices[k]];
+			const float values[][2] = {
+			  {a.pos.x, b.pos.x},       {a.pos.y, b.pos.y},       {a.pos.z, b.pos.z},
+			  {a.normal.x, b.normal.x}, {a.normal.y, b.normal.y}, {a.normal.z, b.normal.z},
+			  {a.uv.x, b.uv.x},         {a.uv.y, b.uv.y}};
+			for (const auto& value : values) {
+				if (std::fabs(value[0] - value[1]) > kTolerance) {
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// 読み込み結果の比較と時間
+/// </summary>
+/// <param name="filePath">.objファイルのパス</param>
+/// <param name="smoothing">エッジ平滑化フラグ</param>
+void TestImport(const std::string& filePath, bool smoothing) {
+	auto startTime = std::chrono::steady_clock::now();
+	std::vector<ReferenceMesh> reference = LoadReference(filePath, smoothing);
+	double streamSeconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	// 1回目はOBJを解析してキャッシュを保存する
+	startTime = std::chrono::steady_clock::now();
+	std::unique_ptr<Model> model(Model::ImportFromOBJ(kModelName, smoothing));
+	double seconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	TEST_CHECK(IsSameTriangles(*model, reference));
+
+	// 2回目はキャッシュから読む（CPU側の頂点は持たないのでメッシュの構成だけ比べる）
+	std::unique_ptr<Model> cached(Model::ImportFromOBJ(kModelName, smoothing));
+	TEST_CHECK(cached->GetMeshes().size() == reference.size());
+	for (size_t i = 0; i < cached->GetMeshes().size() && i < reference.size(); i++) {
+		TEST_CHECK(cached->GetMeshes()[i]->GetName() == reference[i].name);
+	}
+
+	double megaBytes = std::filesystem::file_size(filePath) / (1024.0 * 1024.0);
+	printf(
+	  "Model::ImportFromOBJ %.3fMB smoothing %d: stream %.1fMB/s, mapped %.1fMB/s x%.2f\n",
+	  megaBytes, smoothing ? 1 : 0, streamSeconds > 0.0 ? megaBytes / streamSeconds : 0.0,
+	  seconds > 0.0 ? megaBytes / seconds : 0.0, seconds > 0.0 ? streamSeconds / seconds : 0.0);
+}
+
+} // namespace
+
+int main() {
+	// 作業ディレクトリのResources以下にOBJを生成する（前回のキャッシュは消しておく）
+	const std::string directoryPath = std::string("Resources/") + kModelName + "/";
+	std::filesystem::remove_all(directoryPath);
+	std::filesystem::create_directories(directoryPath);
+	const std::string filePath = directoryPath + kModelName + ".obj";
+	WriteObj(filePath, 128, 4);
+
+	TestImport(filePath, false);
+	TestImport(filePath, true);
+
+	return Test::Finish("ModelTest");
+}
@@ -0,0 +1,213 @@
+﻿#include "ObjChunkParser.h"
+#include "TestCommon.h"
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// <summary>
+/// 配列の内容が同一か
+/// </summary>
+template<class T> bool IsSame(const std::vector<T>& a, const std::vector<T>& b) {
+	return a.size() == b.size() &&
+	       (a.empty() || memcmp(a.data(), b.data(), sizeof(T) * a.size()) == 0);
+}
+
+/// <summary>
+/// 命令と面の頂点をファイル順に連結する
+/// </summary>
+/// <param name="parser">解析結果</param>
+/// <param name="commands">命令（面の頂点の位置は連結後の位置に直す）</param>
+/// <param name="corners">面の頂点</param>
+void Flatten(
+  const ObjChunkParser& parser, std::vector<ObjChunkParser::Command>& commands,
+  std::vector<ObjChunkParser::Corner>& corners) {
+	for (const ObjChunkParser::Chunk& chunk : parser.GetChunks()) {
+		for (ObjChunkParser::Command command : chunk.commands) {
+			if (command.type == ObjChunkParser::CommandType::kFace) {
+				command.cornerBegin += static_cast<uint32_t>(corners.size());
+			}
+			commands.push_back(command);
+		}
+		corners.insert(corners.end(), chunk.corners.begin(), chunk.corners.end());
+	}
+}
+
+/// <summary>
+/// 2つの解析結果が同一か
+/// </summary>
+bool IsSameResult(const ObjChunkParser& a, const ObjChunkParser& b) {
+	if (
+	  !IsSame(a.GetPositions(), b.GetPositions()) || !IsSame(a.GetNormals(), b.GetNormals()) ||
+	  !IsSame(a.GetTexcoords(), b.GetTexcoords())) {
+		return false;
+	}
+
+	std::vector<ObjChunkParser::Command> commandsA, commandsB;
+	std::vector<ObjChunkParser::Corner> cornersA, cornersB;
+	Flatten(a, commandsA, cornersA);
+	Flatten(b, commandsB, cornersB);
+	if (commandsA.size() != commandsB.size() || cornersA.size() != cornersB.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < commandsA.size(); i++) {
+		const ObjChunkParser::Command& ca = commandsA[i];
+		const ObjChunkParser::Command& cb = commandsB[i];
+		if (
+		  ca.type != cb.type || ca.name != cb.name || ca.cornerBegin != cb.cornerBegin ||
+		  ca.cornerCount != cb.cornerCount) {
+			return false;
+		}
+	}
+	for (size_t i = 0; i < cornersA.size(); i++) {
+		const ObjChunkParser::Corner& ca = cornersA[i];
+		const ObjChunkParser::Corner& cb = cornersB[i];
+		if (
+		  ca.position != cb.position || ca.texcoord != cb.texcoord || ca.normal != cb.normal ||
+		  ca.positionOnly != cb.positionOnly) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// 小さいテキストの解析結果を1つずつ確かめる
+/// </summary>
+void TestBasic() {
+	const std::string text = "# comment\r\n"
+	                         "mtllib cube.mtl\r\n"
+	                         "v 1 2 3\n"
+	                         "v -1.5 0.25 4\n"
+	                         "v 0 0 0\n"
+	                         "vt 0.25 0.75\n"
+	                         "vn 0 1 0\n"
+	                         "g body\n"
+	                         "usemtl red\n"
+	                         "f 1/1/1 2/1/1 3/1/1\n"
+	                         "f 3//1 2//1 1//1 2//1\n";
+	ObjChunkParser parser;
+	parser.Parse(text.data(), text.size(), 4);
+
+	// 小さいテキストはスレッドを立てない
+	TEST_CHECK(parser.GetThreadCount() == 1);
+
+	const auto& positions = parser.GetPositions();
+	TEST_CHECK(positions.size() == 3);
+	TEST_CHECK(positions.size() == 3 && positions[1].x == -1.5f && positions[1].y == 0.25f);
+	TEST_CHECK(positions.size() == 3 && positions[1].z == 4.0f);
+	// V方向は反転する
+	const auto& texcoords = parser.GetTexcoords();
+	TEST_CHECK(texcoords.size() == 1 && texcoords[0].x == 0.25f && texcoords[0].y == 0.25f);
+	TEST_CHECK(parser.GetNormals().size() == 1 && parser.GetNormals()[0].y == 1.0f);
+
+	std::vector<ObjChunkParser::Command> commands;
+	std::vector<ObjChunkParser::Corner> corners;
+	Flatten(parser, commands, corners);
+	TEST_CHECK(commands.size() == 5);
+	TEST_CHECK(corners.size() == 7);
+	if (commands.size() != 5 || corners.size() != 7) {
+		return;
+	}
+	TEST_CHECK(commands[0].type == ObjChunkParser::CommandType::kMaterialLibrary);
+	TEST_CHECK(commands[0].name == "cube.mtl");
+	TEST_CHECK(commands[1].type == ObjChunkParser::CommandType::kGroup);
+	TEST_CHECK(commands[1].name == "body");
+	TEST_CHECK(commands[2].type == ObjChunkParser::CommandType::kUseMaterial);
+	TEST_CHECK(commands[2].name == "red");
+	TEST_CHECK(commands[3].type == ObjChunkParser::CommandType::kFace);
+	TEST_CHECK(commands[3].cornerBegin == 0 && commands[3].cornerCount == 3);
+	TEST_CHECK(commands[4].type == ObjChunkParser::CommandType::kFace);
+	TEST_CHECK(commands[4].cornerBegin == 3 && commands[4].cornerCount == 4);
+
+	TEST_CHECK(corners[1].position == 2 && corners[1].texcoord == 1 && corners[1].normal == 1);
+	TEST_CHECK(!corners[1].positionOnly);
+	// "v//vn"形式はUV番号を省略する
+	TEST_CHECK(corners[3].position == 3 && corners[3].texcoord == 0 && corners[3].normal == 1);
+	TEST_CHECK(corners[3].positionOnly);
+}
+
+/// <summary>
+/// 複数チャンクに分かれる大きさのOBJテキストを作る
+/// </summary>
+/// <param name="gridSize">頂点の格子の一辺の数</param>
+/// <returns>OBJテキスト</returns>
+std::string MakeLargeObj(uint32_t gridSize) {
+	std::string text = "mtllib grid.mtl\n";
+	char line[128];
+	for (uint32_t y = 0; y < gridSize; y++) {
+		for (uint32_t x = 0; x < gridSize; x++) {
+			snprintf(line, sizeof(line), "v %u.5 %u.25 -%u.125\n", x, y, x + y);
+			text += line;
+			snprintf(line, sizeof(line), "vt 0.%03u 0.%03u\n", x % 1000, y % 1000);
+			text += line;
+			snprintf(line, sizeof(line), "vn 0 %u 1\n", x % 2);
+			text += line;
+		}
+	}
+	for (uint32_t y = 0; y + 1 < gridSize; y++) {
+		// 行ごとにグループとマテリアルを切り替える
+		snprintf(line, sizeof(line), "g row%u\nusemtl material%u\n", y, y % 4);
+		text += line;
+		for (uint32_t x = 0; x + 1 < gridSize; x++) {
+			uint32_t v = y * gridSize + x + 1;
+			if (x % 2 == 0) {
+				snprintf(
+				  line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", v, v, v,
+				  v + gridSize, v + gridSize, v + gridSize, v + gridSize + 1, v + gridSize + 1,
+				  v + gridSize + 1, v + 1, v + 1, v + 1);
+			} else {
+				snprintf(
+				  line, sizeof(line), "f %u//%u %u//%u %u//%u\n", v, v, v + gridSize, v + gridSize,
+				  v + 1, v + 1);
+			}
+			text += line;
+		}
+	}
+	return text;
+}
+
+} // namespace
+
+int main() {
+	const uint32_t kGridSize = 256;
+	const uint32_t kMaxThreadCount = 8;
+
+	TestBasic();
+
+	std::string text = MakeLargeObj(kGridSize);
+	double megaBytes = text.size() / (1024.0 * 1024.0);
+
+	// 1スレッドの結果を基準に、スレッド数を変えても結果が同一であること
+	ObjChunkParser reference;
+	double referenceSeconds = 0.0;
+	for (uint32_t threadCount = 1; threadCount <= kMaxThreadCount; threadCount++) {
+		ObjChunkParser parser;
+		auto startTime = std::chrono::steady_clock::now();
+		parser.Parse(text.data(), text.size(), threadCount);
+		double seconds =
+		  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		TEST_CHECK(parser.GetThreadCount() == threadCount);
+
+		if (threadCount == 1) {
+			referenceSeconds = seconds;
+			TEST_CHECK(parser.GetPositions().size() == kGridSize * kGridSize);
+			TEST_CHECK(parser.GetTexcoords().size() == kGridSize * kGridSize);
+			TEST_CHECK(parser.GetNormals().size() == kGridSize * kGridSize);
+		} else {
+			TEST_CHECK(IsSameResult(reference, parser));
+		}
+		printf(
+		  "ObjChunkParser %.1fMB: %u threads %.3fms %.1fMB/s x%.2f\n", megaBytes, threadCount,
+		  seconds * 1.0e3, seconds > 0.0 ? megaBytes / seconds : 0.0,
+		  seconds > 0.0 ? referenceSeconds / seconds : 0.0);
+
+		if (threadCount == 1) {
+			reference = std::move(parser);
+		}
+	}
+
+	return Test::Finish("ObjChunkParserTest");
+}
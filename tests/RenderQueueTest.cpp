@@ -0,0 +1,170 @@
+﻿#include "RenderQueue.h"
+#include "TestCommon.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace {
+
+using SortItem = RenderQueue::SortItem;
+
+/// <summary>
+/// 基数ソートの結果がstd::stable_sortと一致するか
+/// </summary>
+/// <param name="items">並べ替える要素</param>
+/// <returns>一致すればtrue</returns>
+bool IsSameAsStableSort(const std::vector<SortItem>& items) {
+	std::vector<SortItem> sorted = items;
+	std::vector<SortItem> work;
+	RenderQueue::RadixSort(sorted, work);
+
+	std::vector<SortItem> reference = items;
+	std::stable_sort(reference.begin(), reference.end(), [](const SortItem& a, const SortItem& b) {
+		return a.key < b.key;
+	});
+
+	if (sorted.size() != reference.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < sorted.size(); i++) {
+		if (sorted[i].key != reference[i].key || sorted[i].index != reference[i].index) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// 実際の描画に近い、種類の少ない状態と散らばった深度のキーを作る
+/// </summary>
+/// <param name="count">要素数</param>
+/// <param name="translucentRate">半透明にする割合（1/n、0なら全て不透明）</param>
+/// <returns>要素（番号は追加した順）</returns>
+std::vector<SortItem> MakeItems(uint32_t count, uint32_t translucentRate) {
+	std::mt19937_64 random(2024);
+	std::vector<SortItem> items(count);
+	for (uint32_t i = 0; i < count; i++) {
+		uint64_t value = random();
+		float depth = static_cast<float>((value >> 40) % 10000) / 10000.0f;
+		if (translucentRate > 0 && value % translucentRate == 0) {
+			items[i].key = RenderQueue::MakeTranslucentSortKey(depth);
+		} else {
+			uint32_t pipeline = static_cast<uint32_t>(value % 4);
+			uint64_t material = (value >> 8) % 32;
+			uint32_t texture = static_cast<uint32_t>((value >> 16) % 64);
+			uint64_t mesh = (value >> 24) % 128;
+			items[i].key = RenderQueue::MakeSortKey(pipeline, material, texture, mesh, depth);
+		}
+		items[i].index = i;
+	}
+	return items;
+}
+
+/// <summary>
+/// ソートキーの並び（パイプラインが最優先、不透明は手前から、半透明は不透明の後に奥から）
+/// </summary>
+void TestSortKey() {
+	// パイプラインは他の項目より優先する
+	TEST_CHECK(
+	  RenderQueue::MakeSortKey(0, 0xffffffff, 0xfff, 0xffffffff, 1.0f) <
+	  RenderQueue::MakeSortKey(1, 0, 0, 0, 0.0f));
+	// 同じ状態なら手前から
+	uint64_t nearKey = RenderQueue::MakeSortKey(2, 0x1000, 3, 0x2000, 0.2f);
+	uint64_t farKey = RenderQueue::MakeSortKey(2, 0x1000, 3, 0x2000, 0.8f);
+	TEST_CHECK(nearKey < farKey);
+	// 深度の違いは下位ビットだけ
+	TEST_CHECK((nearKey >> RenderQueue::kDepthBits) == (farKey >> RenderQueue::kDepthBits));
+	// 範囲外の深度は[0,1]に収める
+	TEST_CHECK(
+	  RenderQueue::MakeSortKey(2, 0x1000, 3, 0x2000, -1.0f) ==
+	  RenderQueue::MakeSortKey(2, 0x1000, 3, 0x2000, 0.0f));
+	TEST_CHECK(
+	  RenderQueue::MakeSortKey(2, 0x1000, 3, 0x2000, 2.0f) ==
+	  RenderQueue::MakeSortKey(2, 0x1000, 3, 0x2000, 1.0f));
+
+	// 不透明のキーは最上位ビットを使わない
+	uint64_t maxOpaqueKey = RenderQueue::MakeSortKey(0xf, 0xffffffff, 0xfff, 0xffffffff, 1.0f);
+	TEST_CHECK((maxOpaqueKey & RenderQueue::kTranslucentBit) == 0);
+	// 半透明は不透明の後に、奥から
+	uint64_t nearTranslucent = RenderQueue::MakeTranslucentSortKey(0.1f);
+	uint64_t farTranslucent = RenderQueue::MakeTranslucentSortKey(0.9f);
+	TEST_CHECK(maxOpaqueKey < farTranslucent);
+	TEST_CHECK(farTranslucent < nearTranslucent);
+	TEST_CHECK(
+	  RenderQueue::MakeTranslucentSortKey(-1.0f) == RenderQueue::MakeTranslucentSortKey(0.0f));
+}
+
+/// <summary>
+/// 描画1回あたりのバインド数
+/// </summary>
+void TestBindCount() {
+	RenderQueue::DrawCommand command{};
+	TEST_CHECK(RenderQueue::GetBindCount(command) == 9);
+	command.packed = true;
+	TEST_CHECK(RenderQueue::GetBindCount(command) == 10);
+	command.bindless = true;
+	TEST_CHECK(RenderQueue::GetBindCount(command) == 11);
+}
+
+/// <summary>
+/// 基数ソート（端の要素数、同じキーの安定性、半透明の混在）
+/// </summary>
+void TestRadixSort() {
+	TEST_CHECK(IsSameAsStableSort({}));
+	TEST_CHECK(IsSameAsStableSort({{5, 0}}));
+	// 同じキーは追加した順のまま
+	TEST_CHECK(IsSameAsStableSort({{3, 0}, {1, 1}, {3, 2}, {1, 3}, {2, 4}, {3, 5}}));
+	// 全て同じキー（全桁を飛ばす）
+	TEST_CHECK(IsSameAsStableSort({{7, 0}, {7, 1}, {7, 2}}));
+	// 奇数回の入れ替えになる桁の組み合わせ
+	TEST_CHECK(IsSameAsStableSort({{0x0200, 0}, {0x0100, 1}, {0x0300, 2}}));
+
+	std::vector<SortItem> items = MakeItems(1000, 4);
+	TEST_CHECK(IsSameAsStableSort(items));
+	// 半透明は全て不透明の後に奥から並ぶ
+	std::vector<SortItem> work;
+	RenderQueue::RadixSort(items, work);
+	bool translucent = false;
+	bool ordered = true;
+	for (const SortItem& item : items) {
+		bool isTranslucent = (item.key & RenderQueue::kTranslucentBit) != 0;
+		ordered &= !translucent || isTranslucent;
+		translucent |= isTranslucent;
+	}
+	TEST_CHECK(translucent);
+	TEST_CHECK(ordered);
+}
+
+} // namespace
+
+int main() {
+	const uint32_t kCount = 10000;
+
+	TestSortKey();
+	TestBindCount();
+	TestRadixSort();
+
+	// 基数ソートとstd::stable_sortの時間
+	std::vector<SortItem> items = MakeItems(kCount, 0);
+	TEST_CHECK(IsSameAsStableSort(items));
+	std::vector<SortItem> sorted = items;
+	std::vector<SortItem> work;
+	auto startTime = std::chrono::steady_clock::now();
+	RenderQueue::RadixSort(sorted, work);
+	double radixSeconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	startTime = std::chrono::steady_clock::now();
+	std::stable_sort(items.begin(), items.end(), [](const SortItem& a, const SortItem& b) {
+		return a.key < b.key;
+	});
+	double stdSeconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	printf(
+	  "RenderQueue::RadixSort %u keys: radix %.3fms, stable_sort %.3fms x%.2f\n", kCount,
+	  radixSeconds * 1.0e3, stdSeconds * 1.0e3,
+	  radixSeconds > 0.0 ? stdSeconds / radixSeconds : 0.0);
+
+	return Test::Finish("RenderQueueTest");
+}
@@ -0,0 +1,131 @@
+﻿#include "RingAllocator.h"
+#include "TestCommon.h"
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace {
+
+const uint64_t kRingSize = 128 * 1024;
+const uint64_t kAlignment = 256;
+
+/// <summary>
+/// 基本動作（アラインメント、折り返し、空き不足、解放）
+/// </summary>
+void TestBasic() {
+	RingAllocator allocator;
+	allocator.Initialize(1024);
+
+	// 0バイトとリングより大きい割り当ては失敗
+	TEST_CHECK(allocator.Allocate(0, 16) == RingAllocator::kInvalidOffset);
+	TEST_CHECK(allocator.Allocate(2048, 16) == RingAllocator::kInvalidOffset);
+
+	// アラインメントの分だけ読み飛ばす
+	TEST_CHECK(allocator.Allocate(100, 16) == 0);
+	TEST_CHECK(allocator.Allocate(100, 256) == 256);
+	TEST_CHECK(allocator.GetUsedSize() == 356);
+	allocator.FinishFrame(1);
+
+	// 末尾に収まらなければ残りを捨てて先頭から切り出すが、先頭はまだ使用中
+	TEST_CHECK(allocator.Allocate(600, 16) == 368);
+	TEST_CHECK(allocator.Allocate(200, 16) == RingAllocator::kInvalidOffset);
+	allocator.FinishFrame(2);
+
+	// フレーム1が完了すれば先頭を使える
+	allocator.Release(1);
+	TEST_CHECK(allocator.Allocate(200, 16) == 0);
+	// フレーム2の612バイト（アラインメント込み）と、折り返しで捨てた末尾と今回の分
+	TEST_CHECK(allocator.GetUsedSize() == 612 + (1024 - 968) + 200);
+	allocator.FinishFrame(3);
+
+	// 全て完了すれば空になる
+	allocator.Release(3);
+	TEST_CHECK(allocator.GetUsedSize() == 0);
+	TEST_CHECK(allocator.Allocate(1024, 16) == 0);
+}
+
+/// <summary>
+/// 2フレーム遅れで完了するGPUを模して割り当てと解放を繰り返す
+/// </summary>
+/// <param name="frameCount">フレーム数</param>
+/// <param name="verify">バイトごとの持ち主のフレームを記録して重なりを調べるか</param>
+/// <param name="allocationCount">成功した割り当ての数</param>
+/// <param name="failureCount">失敗した割り当ての数</param>
+/// <returns>重なりがなければtrue</returns>
+bool Simulate(
+  uint32_t frameCount, bool verify, uint32_t& allocationCount, uint32_t& failureCount) {
+	const uint32_t kLatency = 2;
+	const uint32_t kAllocationsPerFrame = 64;
+
+	RingAllocator allocator;
+	allocator.Initialize(kRingSize);
+	std::mt19937 random(12345);
+	std::uniform_int_distribution<uint32_t> sizeDist(1, 1024);
+	std::vector<uint32_t> owner(verify ? kRingSize : 0, 0);
+	// フレームごとの割り当て（オフセット、バイト数）
+	std::vector<std::vector<std::pair<uint64_t, uint64_t>>> live(frameCount + 1);
+	bool overlapped = false;
+	allocationCount = 0;
+	failureCount = 0;
+
+	for (uint32_t frame = 1; frame <= frameCount; frame++) {
+		for (uint32_t i = 0; i < kAllocationsPerFrame; i++) {
+			uint64_t size = sizeDist(random);
+			uint64_t offset = allocator.Allocate(size, kAlignment);
+			if (offset == RingAllocator::kInvalidOffset) {
+				failureCount++;
+				continue;
+			}
+			allocationCount++;
+			if (!verify) {
+				continue;
+			}
+			overlapped |= offset % kAlignment != 0 || offset + size > kRingSize;
+			for (uint64_t b = offset; b < offset + size && b < kRingSize; b++) {
+				overlapped |= owner[b] != 0;
+				owner[b] = frame;
+			}
+			live[frame].emplace_back(offset, size);
+		}
+		// フェンス値はフレーム番号と同じ
+		allocator.FinishFrame(frame);
+		if (frame > kLatency) {
+			uint32_t completed = frame - kLatency;
+			allocator.Release(completed);
+			if (verify) {
+				for (const auto& allocation : live[completed]) {
+					for (uint64_t b = allocation.first; b < allocation.first + allocation.second;
+					     b++) {
+						owner[b] = 0;
+					}
+				}
+			}
+		}
+	}
+	return !overlapped;
+}
+
+} // namespace
+
+int main() {
+	const uint32_t kFrameCount = 1000;
+
+	TestBasic();
+
+	uint32_t allocationCount = 0;
+	uint32_t failureCount = 0;
+	TEST_CHECK(Simulate(kFrameCount, true, allocationCount, failureCount));
+	TEST_CHECK(allocationCount > 0);
+
+	// 1回あたりの時間
+	auto startTime = std::chrono::steady_clock::now();
+	Simulate(kFrameCount, false, allocationCount, failureCount);
+	double seconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	printf(
+	  "RingAllocator %u frames: %u allocations (%u failed) %.1fns/alloc\n", kFrameCount,
+	  allocationCount, failureCount,
+	  allocationCount > 0 ? seconds * 1.0e9 / allocationCount : 0.0);
+
+	return Test::Finish("RingAllocatorTest");
+}
@@ -0,0 +1,147 @@
+﻿#include "ShaderCache.h"
+#include "TestCommon.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+
+// 一覧の1項目
+struct ManifestEntry {
+	std::wstring filePath;                                    // シェーダファイル名
+	std::string target;                                       // シェーダーモデル指定
+	std::vector<std::pair<std::string, std::string>> defines; // マクロ定義の文字列
+	std::vector<D3D_SHADER_MACRO> macros;                     // マクロ定義（nullptr終端）
+};
+
+/// <summary>
+/// シェーダの一覧を読み込む（1行に「ファイル名 ターゲット [名前=値 ...]」、#から行末はコメント）
+/// </summary>
+/// <param name="manifestPath">シェーダの一覧</param>
+/// <returns>項目</returns>
+std::vector<ManifestEntry> LoadManifest(const std::wstring& manifestPath) {
+	std::vector<ManifestEntry> entries;
+	std::filesystem::path path = manifestPath;
+	std::ifstream file(path);
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream stream(line.substr(0, line.find('#')));
+		std::string fileName, target;
+		if (!(stream >> fileName >> target)) {
+			continue;
+		}
+		ManifestEntry entry;
+		entry.filePath = (path.parent_path() / fileName).wstring();
+		entry.target = target;
+		std::string define;
+		while (stream >> define) {
+			size_t pos = define.find('=');
+			entry.defines.emplace_back(
+			  define.substr(0, pos), pos != std::string::npos ? define.substr(pos + 1) : "1");
+		}
+		entries.push_back(std::move(entry));
+	}
+	for (ManifestEntry& entry : entries) {
+		for (const auto& define : entry.defines) {
+			entry.macros.push_back({define.first.c_str(), define.second.c_str()});
+		}
+		entry.macros.push_back({nullptr, nullptr});
+	}
+	return entries;
+}
+
+/// <summary>
+/// コンパイル
+/// </summary>
+/// <param name="entry">一覧の項目</param>
+/// <param name="flags">コンパイルオプション</param>
+/// <returns>バイトコード（失敗したらnullptr）</returns>
+ComPtr<ID3DBlob> Compile(const ManifestEntry& entry, UINT flags) {
+	ComPtr<ID3DBlob> blob;
+	ComPtr<ID3DBlob> errorBlob;
+	HRESULT result = D3DCompileFromFile(
+	  entry.filePath.c_str(), entry.macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, "main",
+	  entry.target.c_str(), flags, 0, &blob, &errorBlob);
+	if (FAILED(result)) {
+		if (errorBlob) {
+			fprintf(stderr, "%s\n", static_cast<const char*>(errorBlob->GetBufferPointer()));
+		}
+		return nullptr;
+	}
+	return blob;
+}
+
+/// <summary>
+/// バイトコードが同一か
+/// </summary>
+/// <param name="a">バイトコード</param>
+/// <param name="b">バイトコード</param>
+/// <returns>どちらもnullptrでなく、内容が同一ならtrue</returns>
+bool IsSameBlob(ID3DBlob* a, ID3DBlob* b) {
+	return a && b && a->GetBufferSize() == b->GetBufferSize() &&
+	       memcmp(a->GetBufferPointer(), b->GetBufferPointer(), a->GetBufferSize()) == 0;
+}
+
+} // namespace
+
+int main() {
+	// 作業ディレクトリはリポジトリのルート
+	std::vector<ManifestEntry> entries = LoadManifest(ShaderCache::kManifestPath);
+	TEST_CHECK(!entries.empty());
+
+	// 事前コンパイル（2回目は全てキャッシュ済み）
+	ShaderCache* shaderCache = ShaderCache::GetInstance();
+	TEST_CHECK(shaderCache->Build());
+	TEST_CHECK(shaderCache->Build());
+
+	double compileSeconds = 0.0;
+	double loadSeconds = 0.0;
+	for (const ManifestEntry& entry : entries) {
+		// これまでの実行時コンパイル
+		auto startTime = std::chrono::steady_clock::now();
+		ComPtr<ID3DBlob> compiled =
+		  Compile(entry, D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION);
+		compileSeconds +=
+		  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		TEST_CHECK(compiled != nullptr);
+
+		startTime = std::chrono::steady_clock::now();
+		ComPtr<ID3DBlob> loaded =
+		  shaderCache->Load(entry.filePath, entry.macros.data(), entry.target.c_str());
+		loadSeconds +=
+		  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		TEST_CHECK(loaded != nullptr);
+#ifndef _DEBUG
+		// キャッシュの内容は最適化コンパイルの結果と一致する
+		ComPtr<ID3DBlob> optimized = Compile(entry, D3DCOMPILE_OPTIMIZATION_LEVEL3);
+		TEST_CHECK(IsSameBlob(loaded.Get(), optimized.Get()));
+#endif
+
+		// 2回目は読み込み済みのものを使う
+		ComPtr<ID3DBlob> reused =
+		  shaderCache->Load(entry.filePath, entry.macros.data(), entry.target.c_str());
+		TEST_CHECK(reused.Get() == loaded.Get());
+	}
+
+	ShaderCache::Statistics statistics = shaderCache->GetStatistics();
+	TEST_CHECK(statistics.loadCount == entries.size() * 2);
+	TEST_CHECK(statistics.reuseCount == entries.size());
+#ifndef _DEBUG
+	TEST_CHECK(statistics.hitCount == entries.size());
+#else
+	// Debugビルドはキャッシュを使わずに毎回コンパイルする
+	TEST_CHECK(statistics.compileCount == entries.size());
+#endif
+	printf(
+	  "ShaderCache %zu shaders: compile %.3fms, load %.3fms x%.1f\n", entries.size(),
+	  compileSeconds * 1.0e3, loadSeconds * 1.0e3,
+	  loadSeconds > 0.0 ? compileSeconds / loadSeconds : 0.0);
+
+	return Test::Finish("ShaderCacheTest");
+}
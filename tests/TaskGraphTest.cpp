@@ -0,0 +1,116 @@
+﻿#include "TaskGraph.h"
+#include "TestCommon.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// <summary>
+/// 小さい例（依存するタスクの順序、メインスレッド指定、空の処理）
+/// </summary>
+void TestBasic() {
+	TaskGraph graph;
+	std::atomic<uint32_t> count = 0;
+	TaskGraph::TaskId first = graph.Add("first", [&count]() { count++; });
+	graph.Add("main", [&count]() { count++; }, {first}, TaskGraph::Thread::kMain);
+	graph.Add("empty", nullptr, {first});
+	graph.Run(1);
+
+	std::vector<TaskGraph::TimelineEntry> timeline = graph.GetTimeline();
+	TEST_CHECK(count == 2);
+	TEST_CHECK(timeline.size() == 3);
+	double firstEndSeconds = 0.0;
+	for (const TaskGraph::TimelineEntry& entry : timeline) {
+		if (entry.name == "first") {
+			firstEndSeconds = entry.endSeconds;
+		}
+	}
+	for (const TaskGraph::TimelineEntry& entry : timeline) {
+		TEST_CHECK((entry.name == "main") == (entry.threadIndex == 0));
+		TEST_CHECK(entry.startSeconds <= entry.endSeconds);
+		TEST_CHECK(entry.name == "first" || firstEndSeconds <= entry.startSeconds);
+	}
+}
+
+} // namespace
+
+int main() {
+	const uint32_t kTaskCount = 1000;
+
+	TestBasic();
+
+	// 各タスクは0.1～1msの処理で、手前のタスクにランダムに依存する
+	std::mt19937 random(2024);
+	std::uniform_int_distribution<uint32_t> microsecondsDist(100, 1000);
+	std::uniform_int_distribution<uint32_t> dependencyCountDist(0, 3);
+	std::uniform_int_distribution<uint32_t> threadDist(0, 9);
+
+	TaskGraph graph;
+	std::vector<std::vector<TaskGraph::TaskId>> dependencies(kTaskCount);
+	std::vector<bool> mainThread(kTaskCount);
+	std::vector<uint32_t> runCounts(kTaskCount, 0);
+	for (uint32_t i = 0; i < kTaskCount; i++) {
+		uint32_t dependencyCount = std::min<uint32_t>(dependencyCountDist(random), i);
+		for (uint32_t k = 0; k < dependencyCount; k++) {
+			TaskGraph::TaskId dependency = random() % i;
+			if (
+			  std::find(dependencies[i].begin(), dependencies[i].end(), dependency) ==
+			  dependencies[i].end()) {
+				dependencies[i].push_back(dependency);
+			}
+		}
+		auto duration = std::chrono::microseconds(microsecondsDist(random));
+		uint32_t* runCount = &runCounts[i];
+		mainThread[i] = threadDist(random) == 0;
+		graph.Add(
+		  "task" + std::to_string(i),
+		  [duration, runCount]() {
+			  // スリープだと精度が粗いので、ビジーループで時間を使う
+			  auto endTime = std::chrono::steady_clock::now() + duration;
+			  while (std::chrono::steady_clock::now() < endTime) {
+			  }
+			  (*runCount)++;
+		  },
+		  dependencies[i], mainThread[i] ? TaskGraph::Thread::kMain : TaskGraph::Thread::kWorker);
+	}
+	auto startTime = std::chrono::steady_clock::now();
+	graph.Run();
+	double seconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	// タイムラインをタスク番号順に並べ直す
+	std::vector<TaskGraph::TimelineEntry> timeline = graph.GetTimeline();
+	TEST_CHECK(timeline.size() == kTaskCount);
+	std::vector<const TaskGraph::TimelineEntry*> entries(kTaskCount, nullptr);
+	for (const TaskGraph::TimelineEntry& entry : timeline) {
+		uint32_t index = static_cast<uint32_t>(std::stoul(entry.name.substr(4)));
+		TEST_CHECK(index < kTaskCount && entries[index] == nullptr);
+		if (index < kTaskCount) {
+			entries[index] = &entry;
+		}
+	}
+
+	// 全タスクが1回ずつ、指定のスレッドで、依存するタスクの終了後に実行されたか
+	double serialSeconds = 0.0;
+	for (uint32_t i = 0; i < kTaskCount; i++) {
+		TEST_CHECK(runCounts[i] == 1);
+		if (!entries[i]) {
+			continue;
+		}
+		TEST_CHECK(mainThread[i] == (entries[i]->threadIndex == 0));
+		for (TaskGraph::TaskId dependency : dependencies[i]) {
+			TEST_CHECK(
+			  entries[dependency] && entries[dependency]->endSeconds <= entries[i]->startSeconds);
+		}
+		serialSeconds += entries[i]->endSeconds - entries[i]->startSeconds;
+	}
+	printf(
+	  "TaskGraph %u tasks: %.3fms (serial %.3fms x%.2f)\n", kTaskCount, seconds * 1.0e3,
+	  serialSeconds * 1.0e3, seconds > 0.0 ? serialSeconds / seconds : 0.0);
+
+	return Test::Finish("TaskGraphTest");
+}
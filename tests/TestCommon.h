@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include <cstdio>
+
+/// <summary>
+/// テストの検証と結果の集計
+/// assertと違いリリースビルドでも評価し、失敗しても最後まで実行して全て報告する
+/// </summary>
+namespace Test {
+
+/// <summary>
+/// 失敗した検証の数を取得
+/// </summary>
+/// <returns>失敗数</returns>
+inline int& GetFailureCount() {
+	static int failureCount = 0;
+	return failureCount;
+}
+
+/// <summary>
+/// 検証（失敗したら場所と式を表示する）
+/// </summary>
+/// <param name="condition">条件</param>
+/// <param name="expression">条件の式</param>
+/// <param name="file">ファイル名</param>
+/// <param name="line">行番号</param>
+inline void Check(bool condition, const char* expression, const char* file, int line) {
+	if (!condition) {
+		fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+		GetFailureCount()++;
+	}
+}
+
+/// <summary>
+/// 結果の表示
+/// </summary>
+/// <param name="name">テスト名</param>
+/// <returns>終了コード（失敗があれば1）</returns>
+inline int Finish(const char* name) {
+	int failureCount = GetFailureCount();
+	printf("%s: %s (%d failed)\n", name, failureCount == 0 ? "OK" : "FAILED", failureCount);
+	return failureCount == 0 ? 0 : 1;
+}
+
+} // namespace Test
+
+// 条件がfalseなら失敗として記録する
+#define TEST_CHECK(condition) Test::Check(!!(condition), #condition, __FILE__, __LINE__)
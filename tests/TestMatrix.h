@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+#include <algorithm>
+
+namespace Test {
+
+/// <summary>
+/// 行列の要素ごとの誤差の最大値（要素の大きさが1未満なら絶対誤差、1以上なら相対誤差）
+/// </summary>
+/// <param name="result">検証する行列</param>
+/// <param name="reference">基準の行列</param>
+/// <returns>誤差</returns>
+inline float GetMaxError(const DirectX::XMMATRIX& result, const DirectX::XMMATRIX& reference) {
+	using namespace DirectX;
+	float maxError = 0.0f;
+	for (int r = 0; r < 4; r++) {
+		XMVECTOR diff = XMVectorAbs(XMVectorSubtract(result.r[r], reference.r[r]));
+		XMVECTOR scale = XMVectorMax(XMVectorAbs(reference.r[r]), XMVectorSplatOne());
+		XMVECTOR error = XMVectorDivide(diff, scale);
+		maxError = std::max(
+		  {maxError, XMVectorGetX(error), XMVectorGetY(error), XMVectorGetZ(error),
+		   XMVectorGetW(error)});
+	}
+	return maxError;
+}
+
+} // namespace Test
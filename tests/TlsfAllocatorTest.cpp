@@ -0,0 +1,178 @@
+﻿#include "TestCommon.h"
+#include "TlsfAllocator.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace {
+
+/// <summary>
+/// 基本動作（アラインメント、空き不足、隣接する空き領域の結合）
+/// </summary>
+void TestBasic() {
+	TlsfAllocator allocator;
+	allocator.Initialize(1024);
+
+	// 0バイトと全体より大きい割り当ては失敗
+	TEST_CHECK(allocator.Allocate(0, 1) == TlsfAllocator::kInvalidOffset);
+	TEST_CHECK(allocator.Allocate(2048, 1) == TlsfAllocator::kInvalidOffset);
+
+	uint64_t a = allocator.Allocate(100, 1);
+	uint64_t b = allocator.Allocate(100, 256);
+	uint64_t c = allocator.Allocate(100, 1);
+	TEST_CHECK(a == 0);
+	TEST_CHECK(b != TlsfAllocator::kInvalidOffset && b % 256 == 0);
+	TEST_CHECK(c != TlsfAllocator::kInvalidOffset);
+	TEST_CHECK(allocator.Validate());
+	TEST_CHECK(allocator.GetStatistics().allocationCount == 3);
+
+	// 残りより大きい割り当ては失敗
+	TEST_CHECK(allocator.Allocate(1000, 1) == TlsfAllocator::kInvalidOffset);
+
+	// 真ん中を解放してから両隣を解放すると1つの空き領域に戻る
+	allocator.Free(b);
+	TEST_CHECK(allocator.Validate());
+	allocator.Free(a);
+	allocator.Free(c);
+	TEST_CHECK(allocator.Validate());
+	TEST_CHECK(allocator.IsEmpty());
+	TlsfAllocator::Statistics statistics = allocator.GetStatistics();
+	TEST_CHECK(statistics.freeBlockCount == 1);
+	TEST_CHECK(statistics.largestFreeBlock == 1024);
+	TEST_CHECK(statistics.fragmentation == 0.0f);
+
+	// 全体をちょうど使い切れる
+	TEST_CHECK(allocator.Allocate(1024, 1) == 0);
+	TEST_CHECK(allocator.Allocate(1, 1) == TlsfAllocator::kInvalidOffset);
+}
+
+// 操作
+struct Operation {
+	bool allocate;      // 割り当てか解放か
+	uint64_t size;      // バイト数
+	uint64_t alignment; // アラインメント
+	uint32_t target;    // 解放する割り当ての選択に使う乱数
+};
+
+/// <summary>
+/// ランダムな操作列を作る
+/// GPUヒープを想定して64KB単位の大きさと小さな端数を混ぜ、割り当てと解放を半々で行う
+/// </summary>
+/// <param name="operationCount">操作の回数</param>
+/// <param name="seed">乱数の種</param>
+/// <returns>操作列</returns>
+std::vector<Operation> MakeOperations(uint32_t operationCount, uint32_t seed) {
+	std::mt19937 random(seed);
+	std::uniform_int_distribution<uint32_t> sizeDist(1, 64);
+	std::uniform_int_distribution<uint32_t> smallDist(1, 65536);
+	std::uniform_int_distribution<uint32_t> alignmentDist(0, 16);
+	std::uniform_int_distribution<uint32_t> actionDist(0, 99);
+
+	std::vector<Operation> operations(operationCount);
+	for (Operation& operation : operations) {
+		operation.allocate = actionDist(random) < 50;
+		operation.size = actionDist(random) < 70 ? uint64_t(sizeDist(random)) * 65536
+		                                         : uint64_t(smallDist(random));
+		operation.alignment = 1ull << alignmentDist(random);
+		operation.target = random();
+	}
+	return operations;
+}
+
+/// <summary>
+/// 操作列の実行
+/// </summary>
+/// <param name="operations">操作列</param>
+/// <param name="verify">割り当て同士の重なりと内部状態を検証するか</param>
+/// <param name="statistics">全て解放する前の統計</param>
+/// <param name="failureCount">失敗した割り当ての数</param>
+/// <returns>検証に通ればtrue</returns>
+bool Run(
+  const std::vector<Operation>& operations, bool verify, TlsfAllocator::Statistics& statistics,
+  uint32_t& failureCount) {
+	const uint64_t kSize = 256ull * 1024 * 1024;
+
+	TlsfAllocator allocator;
+	allocator.Initialize(kSize);
+	std::vector<std::pair<uint64_t, uint64_t>> live;
+	bool ok = true;
+	failureCount = 0;
+	for (size_t i = 0; i < operations.size(); i++) {
+		const Operation& operation = operations[i];
+		if (operation.allocate || live.empty()) {
+			uint64_t offset = allocator.Allocate(operation.size, operation.alignment);
+			if (offset == TlsfAllocator::kInvalidOffset) {
+				failureCount++;
+				continue;
+			}
+			if (verify) {
+				ok &= offset % operation.alignment == 0 && offset + operation.size <= kSize;
+			}
+			live.emplace_back(offset, operation.size);
+		} else {
+			size_t index = operation.target % live.size();
+			allocator.Free(live[index].first);
+			live[index] = live.back();
+			live.pop_back();
+		}
+		if (verify && (i % 1024 == 0)) {
+			ok &= allocator.Validate();
+		}
+	}
+
+	if (verify) {
+		// 割り当て同士が重ならないか
+		std::vector<std::pair<uint64_t, uint64_t>> sorted = live;
+		std::sort(sorted.begin(), sorted.end());
+		for (size_t i = 1; i < sorted.size(); i++) {
+			ok &= sorted[i - 1].first + sorted[i - 1].second <= sorted[i].first;
+		}
+		ok &= allocator.Validate();
+	}
+	statistics = allocator.GetStatistics();
+
+	// 全て解放すれば1つの空き領域に戻るはず
+	for (const auto& allocation : live) {
+		allocator.Free(allocation.first);
+	}
+	if (verify) {
+		TlsfAllocator::Statistics empty = allocator.GetStatistics();
+		ok &= allocator.Validate() && empty.freeBlockCount == 1 &&
+		      empty.largestFreeBlock == kSize && allocator.IsEmpty();
+	}
+	return ok;
+}
+
+} // namespace
+
+int main() {
+	const uint32_t kOperationCount = 100000;
+	const uint32_t kSeedCount = 8;
+
+	TestBasic();
+
+	// 乱数の種を変えて繰り返す
+	TlsfAllocator::Statistics statistics;
+	uint32_t failureCount = 0;
+	for (uint32_t seed = 0; seed < kSeedCount; seed++) {
+		std::vector<Operation> operations = MakeOperations(kOperationCount, 2024 + seed);
+		TEST_CHECK(Run(operations, true, statistics, failureCount));
+		TEST_CHECK(statistics.allocationCount > 0);
+	}
+
+	// 1回あたりの時間
+	std::vector<Operation> operations = MakeOperations(kOperationCount, 2024);
+	auto startTime = std::chrono::steady_clock::now();
+	Run(operations, false, statistics, failureCount);
+	double seconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	printf(
+	  "TlsfAllocator %u ops: %.1fns/op, live %.1fMB in %u allocations (%u failed), "
+	  "%u free blocks, fragmentation %.3f\n",
+	  kOperationCount, seconds * 1.0e9 / kOperationCount,
+	  statistics.liveBytes / (1024.0 * 1024.0), statistics.allocationCount, failureCount,
+	  statistics.freeBlockCount, statistics.fragmentation);
+
+	return Test::Finish("TlsfAllocatorTest");
+}
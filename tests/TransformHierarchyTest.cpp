@@ -0,0 +1,201 @@
+﻿#include "TestCommon.h"
+#include "TestMatrix.h"
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+
+// 許容する誤差
+const float kMaxError = 1.0e-4f;
+
+/// <summary>
+/// 4分木状の階層を作る（親は配列の前方）
+/// </summary>
+/// <param name="transforms">ワールドトランスフォームの配列</param>
+void MakeTree(std::vector<WorldTransform>& transforms) {
+	for (size_t i = 0; i < transforms.size(); i++) {
+		float f = static_cast<float>(i);
+		transforms[i].scale_ = {1.0f, 1.0f + std::fmod(f, 2.0f) * 0.1f, 1.0f};
+		transforms[i].rotation_ = {f * 0.01f, f * 0.02f, f * 0.03f};
+		transforms[i].translation_ = {1.0f, f * 0.001f, -1.0f};
+		transforms[i].parent_ = i > 0 ? &transforms[(i - 1) / 4] : nullptr;
+	}
+}
+
+/// <summary>
+/// 親から順にUpdateMatrixする（基準の計算用）
+/// </summary>
+/// <param name="transforms">ワールドトランスフォームの配列</param>
+/// <param name="updated">更新済みか</param>
+/// <param name="index">更新する要素の番号</param>
+void UpdateFromRoot(
+  std::vector<WorldTransform>& transforms, std::vector<bool>& updated, size_t index) {
+	if (updated[index]) {
+		return;
+	}
+	if (transforms[index].parent_) {
+		UpdateFromRoot(transforms, updated, transforms[index].parent_ - transforms.data());
+	}
+	transforms[index].UpdateMatrix();
+	updated[index] = true;
+}
+
+/// <summary>
+/// 階層の更新結果が、親から順にUpdateMatrixした結果と一致するか
+/// </summary>
+/// <param name="transforms">ワールドトランスフォームの配列（親も配列の中にあること）</param>
+/// <returns>誤差の最大値</returns>
+float CompareWithUpdateMatrix(const std::vector<WorldTransform>& transforms) {
+	std::vector<WorldTransform> reference = transforms;
+	for (size_t i = 0; i < reference.size(); i++) {
+		reference[i].matWorld_ = XMMatrixIdentity();
+		if (transforms[i].parent_) {
+			reference[i].parent_ = &reference[transforms[i].parent_ - transforms.data()];
+		}
+	}
+	std::vector<bool> updated(reference.size(), false);
+	float maxError = 0.0f;
+	for (size_t i = 0; i < transforms.size(); i++) {
+		UpdateFromRoot(reference, updated, i);
+		maxError =
+		  std::max(maxError, Test::GetMaxError(transforms[i].matWorld_, reference[i].matWorld_));
+	}
+	return maxError;
+}
+
+/// <summary>
+/// 差分更新（変更のあったノードと子孫だけを更新する）
+/// </summary>
+void TestDirtyUpdate() {
+	// 0 ← 1 ← 2、0 ← 3 の階層を、子から先に追加する
+	std::vector<WorldTransform> transforms(4);
+	MakeTree(transforms);
+	transforms[2].parent_ = &transforms[1];
+	transforms[3].parent_ = &transforms[0];
+	TransformHierarchy hierarchy;
+	hierarchy.Add(&transforms[2]);
+	hierarchy.Add(&transforms[3]);
+	hierarchy.Update();
+	TEST_CHECK(hierarchy.GetStatistics().nodeCount == 4);
+	TEST_CHECK(hierarchy.GetStatistics().updatedCount == 4);
+	TEST_CHECK(CompareWithUpdateMatrix(transforms) <= kMaxError);
+
+	// 変更がなければ何も更新しない
+	hierarchy.Update();
+	TEST_CHECK(hierarchy.GetStatistics().localCount == 0);
+	TEST_CHECK(hierarchy.GetStatistics().updatedCount == 0);
+
+	// 1を動かすと1と2だけを更新する
+	transforms[1].translation_.y += 1.0f;
+	hierarchy.Update();
+	TEST_CHECK(hierarchy.GetStatistics().localCount == 1);
+	TEST_CHECK(hierarchy.GetStatistics().updatedCount == 2);
+	TEST_CHECK(CompareWithUpdateMatrix(transforms) <= kMaxError);
+
+	// MarkDirtyは値が同じでも子孫ごと更新する
+	hierarchy.MarkDirty(&transforms[0]);
+	hierarchy.Update();
+	TEST_CHECK(hierarchy.GetStatistics().localCount == 1);
+	TEST_CHECK(hierarchy.GetStatistics().updatedCount == 4);
+
+	// 親の付け替え
+	transforms[2].parent_ = &transforms[3];
+	hierarchy.Update();
+	TEST_CHECK(hierarchy.GetStatistics().updatedCount == 1);
+	TEST_CHECK(CompareWithUpdateMatrix(transforms) <= kMaxError);
+}
+
+/// <summary>
+/// 親の削除と登録し直し（子のparent_は書き換えない）
+/// </summary>
+void TestRemoveParent() {
+	std::vector<WorldTransform> transforms(3);
+	MakeTree(transforms);
+	transforms[2].parent_ = &transforms[1];
+	TransformHierarchy hierarchy;
+	for (WorldTransform& transform : transforms) {
+		hierarchy.Add(&transform);
+	}
+	hierarchy.Update();
+
+	// 削除した親から外した子はルートとして更新する
+	hierarchy.Remove(&transforms[1]);
+	hierarchy.Update();
+	TEST_CHECK(transforms[2].parent_ == &transforms[1]);
+	TEST_CHECK(hierarchy.GetStatistics().nodeCount == 2);
+	WorldTransform root = transforms[2];
+	root.parent_ = nullptr;
+	root.UpdateMatrix();
+	TEST_CHECK(Test::GetMaxError(transforms[2].matWorld_, root.matWorld_) <= kMaxError);
+
+	// 親を登録し直せば付け直す
+	hierarchy.Add(&transforms[1]);
+	hierarchy.Update();
+	TEST_CHECK(hierarchy.GetStatistics().nodeCount == 3);
+	TEST_CHECK(CompareWithUpdateMatrix(transforms) <= kMaxError);
+
+	// 全削除
+	hierarchy.Clear();
+	hierarchy.Update();
+	TEST_CHECK(hierarchy.GetStatistics().nodeCount == 0);
+}
+
+} // namespace
+
+int main() {
+	const size_t kNodeCount = 10000;
+	const size_t kChangedCount = 100;
+	const int kFrameCount = 16;
+
+	TestDirtyUpdate();
+	TestRemoveParent();
+
+	std::vector<WorldTransform> transforms(kNodeCount);
+	MakeTree(transforms);
+	TransformHierarchy hierarchy;
+	for (WorldTransform& transform : transforms) {
+		hierarchy.Add(&transform);
+	}
+	hierarchy.Update();
+	TEST_CHECK(CompareWithUpdateMatrix(transforms) <= kMaxError);
+
+	// 数フレーム分、葉に近い側から一部のノードだけ動かす
+	double seconds = 0.0;
+	double referenceSeconds = 0.0;
+	uint32_t updatedCount = 0;
+	float maxError = 0.0f;
+	for (int frame = 0; frame < kFrameCount; frame++) {
+		for (size_t i = 0; i < kChangedCount; i++) {
+			transforms[kNodeCount - 1 - i].translation_.x += 0.01f;
+		}
+
+		auto startTime = std::chrono::steady_clock::now();
+		hierarchy.Update();
+		seconds +=
+		  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		// 動かしたのは葉なので、更新するのは動かしたノードだけ
+		TEST_CHECK(hierarchy.GetStatistics().updatedCount == kChangedCount);
+		updatedCount += hierarchy.GetStatistics().updatedCount;
+		maxError = std::max(maxError, CompareWithUpdateMatrix(transforms));
+
+		// 毎フレーム全ノードを更新する場合
+		startTime = std::chrono::steady_clock::now();
+		WorldTransform::UpdateMatrices(transforms.data(), kNodeCount);
+		referenceSeconds +=
+		  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	}
+	TEST_CHECK(maxError <= kMaxError);
+	printf(
+	  "TransformHierarchy %zu nodes, %zu changed: full %.3fms, dirty %.3fms x%.2f "
+	  "(%u updated/frame), max error %g\n",
+	  kNodeCount, kChangedCount, referenceSeconds * 1.0e3 / kFrameCount,
+	  seconds * 1.0e3 / kFrameCount, seconds > 0.0 ? referenceSeconds / seconds : 0.0,
+	  updatedCount / kFrameCount, maxError);
+
+	return Test::Finish("TransformHierarchyTest");
+}
@@ -0,0 +1,167 @@
+﻿#include "TestCommon.h"
+#include "VertexQuantizer.h"
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+
+// 座標の許容誤差（量子化幅に対する比率。幅の半分に浮動小数点の丸めを見込む）
+const float kMaxPosErrorSteps = 0.5f + 0.25f;
+// 法線の許容誤差（度）
+const float kMaxNormalErrorDegrees = 0.1f;
+// UVの許容誤差（相対誤差。半精度の仮数部は10bit）
+const float kMaxUvError = 1.0f / 2048.0f;
+
+// 最大誤差
+struct ErrorStatistics {
+	size_t vertexCount = 0;      // 検証した頂点数
+	float maxPosError = 0.0f;    // 座標の誤差（量子化幅に対する比率）
+	float maxNormalError = 0.0f; // 法線の角度の誤差（度）
+	float maxUvError = 0.0f;     // UVの相対誤差
+};
+
+// AABBの1軸の大きさ
+inline float GetExtent(float min, float max) { return max > min ? max - min : 0.0f; }
+
+/// <summary>
+/// 1頂点の量子化と復元を行い、誤差を検証して最大誤差を更新する
+/// </summary>
+void RoundTrip(
+  const XMFLOAT3& pos, const XMFLOAT3& normal, const XMFLOAT2& uv, const XMFLOAT3& aabbMin,
+  const XMFLOAT3& aabbMax, ErrorStatistics& statistics) {
+	VertexQuantizer::PackedVertex vertex =
+	  VertexQuantizer::Encode(pos, normal, uv, aabbMin, aabbMax);
+	TEST_CHECK(VertexQuantizer::IsWithinErrorBounds(pos, normal, uv, vertex, aabbMin, aabbMax));
+	statistics.vertexCount++;
+
+	XMFLOAT3 decodedPos, decodedNormal;
+	XMFLOAT2 decodedUv;
+	VertexQuantizer::Decode(vertex, aabbMin, aabbMax, decodedPos, decodedNormal, decodedUv);
+
+	// 座標
+	const float extent[3] = {
+	  GetExtent(aabbMin.x, aabbMax.x), GetExtent(aabbMin.y, aabbMax.y),
+	  GetExtent(aabbMin.z, aabbMax.z)};
+	const float original[3] = {pos.x, pos.y, pos.z};
+	const float decoded[3] = {decodedPos.x, decodedPos.y, decodedPos.z};
+	for (int j = 0; j < 3; j++) {
+		if (extent[j] > 0.0f) {
+			float error = std::fabs(decoded[j] - original[j]) / (extent[j] / 65535.0f);
+			statistics.maxPosError = std::fmax(statistics.maxPosError, error);
+		} else {
+			// 厚さ0の軸はAABBの値がそのまま戻る
+			TEST_CHECK(decoded[j] == original[j]);
+		}
+	}
+
+	// 法線（復元結果は正規化されている）
+	float decodedLength = std::sqrt(
+	  decodedNormal.x * decodedNormal.x + decodedNormal.y * decodedNormal.y +
+	  decodedNormal.z * decodedNormal.z);
+	TEST_CHECK(std::fabs(decodedLength - 1.0f) < 1.0e-5f);
+	float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+	float cos =
+	  (normal.x * decodedNormal.x + normal.y * decodedNormal.y + normal.z * decodedNormal.z) /
+	  length;
+	float angle = XMConvertToDegrees(std::acos(std::fmin(cos, 1.0f)));
+	statistics.maxNormalError = std::fmax(statistics.maxNormalError, angle);
+
+	// UV（0付近は半精度の正規化数の最小値を基準にする）
+	const float originalUv[2] = {uv.x, uv.y};
+	const float decodedUvs[2] = {decodedUv.x, decodedUv.y};
+	for (int j = 0; j < 2; j++) {
+		float scale = std::fmax(std::fabs(originalUv[j]), 1.0f / 16384.0f);
+		float error = std::fabs(decodedUvs[j] - originalUv[j]) / scale;
+		statistics.maxUvError = std::fmax(statistics.maxUvError, error);
+	}
+}
+
+/// <summary>
+/// 八面体エンコードの境界（極と辺）が正確に戻るか
+/// </summary>
+void TestOctahedralEdges() {
+	const XMFLOAT3 axes[] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+	for (const XMFLOAT3& axis : axes) {
+		int16_t encoded[2];
+		VertexQuantizer::EncodeOctahedral(axis, encoded);
+		XMFLOAT3 decoded = VertexQuantizer::DecodeOctahedral(encoded);
+		TEST_CHECK(std::fabs(decoded.x - axis.x) < 1.0e-6f);
+		TEST_CHECK(std::fabs(decoded.y - axis.y) < 1.0e-6f);
+		TEST_CHECK(std::fabs(decoded.z - axis.z) < 1.0e-6f);
+	}
+
+	// 長さ0の法線は+Z
+	int16_t encoded[2];
+	VertexQuantizer::EncodeOctahedral(XMFLOAT3(0, 0, 0), encoded);
+	XMFLOAT3 decoded = VertexQuantizer::DecodeOctahedral(encoded);
+	TEST_CHECK(decoded.x == 0.0f && decoded.y == 0.0f && decoded.z == 1.0f);
+}
+
+} // namespace
+
+int main() {
+	const uint32_t kSampleCount = 4096;
+
+	TestOctahedralEdges();
+
+	// AABB（原点付近、原点から遠い位置、厚さ0の軸を含むもの）
+	const XMFLOAT3 aabbs[][2] = {
+	  {{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}},
+	  {{-1000.0f, 250.0f, -3.0f}, {-990.0f, 4250.0f, 3.0f}},
+	  {{-2.0f, 5.0f, -0.5f}, {2.0f, 5.0f, 0.5f}},
+	};
+
+	// 法線：座標軸（極を含む）、八面体の辺と折り返しの境界、球面上に均等に並べた点
+	std::vector<XMFLOAT3> normals = {
+	  {1, 0, 0},            {-1, 0, 0},           {0, 1, 0},          {0, -1, 0},
+	  {0, 0, 1},            {0, 0, -1},           {1, 1, 0},          {1, -1, 0},
+	  {-1, 1, 0},           {-1, -1, 0},          {1, 0, -1e-6f},     {0, -1, -1e-6f},
+	  {0.5f, 0.5f, -1e-6f}, {-0.5f, 0.5f, 1e-6f}, {1e-6f, 1e-6f, -1}, {-1e-7f, 0, -1},
+	  {1e-6f, -1e-6f, 1},   {3, 4, 0},            {0, 0, -5},         {1, 1, 1},
+	};
+	const float kGoldenAngle = 2.39996323f;
+	for (uint32_t i = 0; i < kSampleCount; i++) {
+		float z = 1.0f - 2.0f * (i + 0.5f) / kSampleCount;
+		float r = std::sqrt(1.0f - z * z);
+		float phi = kGoldenAngle * i;
+		normals.push_back(XMFLOAT3(r * std::cos(phi), r * std::sin(phi), z));
+	}
+
+	// UV：0と1、負の値、1を超える値、半精度の非正規化数と最大値
+	std::vector<XMFLOAT2> uvs = {
+	  {0.0f, 1.0f},  {1.0f, 0.0f},    {0.5f, -0.5f},
+	  {-1.0f, 2.5f}, {1e-6f, -3e-7f}, {65504.0f, -65504.0f},
+	};
+	for (uint32_t i = 0; i <= 64; i++) {
+		float t = i / 64.0f;
+		uvs.push_back(XMFLOAT2(t, -4.0f + 8.0f * t));
+	}
+
+	ErrorStatistics statistics;
+	for (const auto& aabb : aabbs) {
+		const XMFLOAT3& aabbMin = aabb[0];
+		const XMFLOAT3& aabbMax = aabb[1];
+		for (size_t i = 0; i < normals.size(); i++) {
+			// 座標はAABBの両端と内部を走査（量子化の丸めの境界になる半端な位置も含む）
+			float t = i % 4 == 0 ? 0.0f : (i % 4 == 1 ? 1.0f : float(i) / normals.size());
+			float s = (float(i % 65535) + 0.5f) / 65535.0f;
+			const XMFLOAT3 pos(
+			  aabbMin.x + GetExtent(aabbMin.x, aabbMax.x) * t,
+			  aabbMin.y + GetExtent(aabbMin.y, aabbMax.y) * s,
+			  aabbMin.z + GetExtent(aabbMin.z, aabbMax.z) * (1.0f - t));
+			RoundTrip(pos, normals[i], uvs[i % uvs.size()], aabbMin, aabbMax, statistics);
+		}
+	}
+
+	TEST_CHECK(statistics.maxPosError <= kMaxPosErrorSteps);
+	TEST_CHECK(statistics.maxNormalError <= kMaxNormalErrorDegrees);
+	TEST_CHECK(statistics.maxUvError <= kMaxUvError);
+	printf(
+	  "VertexQuantizer %zu vertices: max error pos %.3f steps, normal %.5fdeg, uv %.2e\n",
+	  statistics.vertexCount, statistics.maxPosError, statistics.maxNormalError,
+	  statistics.maxUvError);
+
+	return Test::Finish("VertexQuantizerTest");
+}
@@ -0,0 +1,90 @@
+﻿#include "TestCommon.h"
+#include "TestMatrix.h"
+#include "WorldTransform.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+
+// 許容する誤差
+const float kMaxError = 1.0e-4f;
+
+/// <summary>
+/// 適当な値を入れたワールドトランスフォームの配列を作る
+/// </summary>
+/// <param name="count">要素数</param>
+/// <returns>配列（一部は直前の要素を親にする）</returns>
+std::vector<WorldTransform> MakeTransforms(size_t count) {
+	std::vector<WorldTransform> transforms(count);
+	for (size_t i = 0; i < count; i++) {
+		float f = static_cast<float>(i);
+		transforms[i].scale_ = {1.0f + std::fmod(f, 3.0f), 0.5f, 2.0f};
+		transforms[i].rotation_ = {f * 0.01f, f * 0.02f, f * 0.03f};
+		transforms[i].translation_ = {f, -f, f * 0.5f};
+		transforms[i].parent_ = (i % 8 == 7) ? &transforms[i - 1] : nullptr;
+	}
+	return transforms;
+}
+
+/// <summary>
+/// まとめて更新した結果が1個ずつのUpdateMatrixと一致するか
+/// </summary>
+/// <param name="count">要素数</param>
+/// <returns>誤差の最大値</returns>
+float CompareWithUpdateMatrix(size_t count) {
+	// 末尾の1個は範囲外への書き込みがないかの番兵
+	std::vector<WorldTransform> transforms = MakeTransforms(count + 1);
+	std::vector<XMMATRIX> reference(count);
+	for (size_t i = 0; i < count; i++) {
+		transforms[i].UpdateMatrix();
+		reference[i] = transforms[i].matWorld_;
+	}
+	for (WorldTransform& transform : transforms) {
+		transform.matWorld_ = XMMatrixIdentity();
+	}
+
+	WorldTransform::UpdateMatrices(transforms.data(), count);
+
+	float maxError = 0.0f;
+	for (size_t i = 0; i < count; i++) {
+		maxError = std::max(maxError, Test::GetMaxError(transforms[i].matWorld_, reference[i]));
+	}
+	TEST_CHECK(Test::GetMaxError(transforms[count].matWorld_, XMMatrixIdentity()) == 0.0f);
+	return maxError;
+}
+
+} // namespace
+
+int main() {
+	const size_t kCount = 10000;
+
+	// 4個に満たない端数も含めて確かめる
+	for (size_t count = 1; count <= 9; count++) {
+		TEST_CHECK(CompareWithUpdateMatrix(count) <= kMaxError);
+	}
+	float maxError = CompareWithUpdateMatrix(kCount);
+	TEST_CHECK(maxError <= kMaxError);
+
+	// 1個ずつの合成とまとめて更新の時間
+	std::vector<WorldTransform> transforms = MakeTransforms(kCount);
+	auto startTime = std::chrono::steady_clock::now();
+	for (WorldTransform& transform : transforms) {
+		transform.UpdateMatrix();
+	}
+	double referenceSeconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	startTime = std::chrono::steady_clock::now();
+	WorldTransform::UpdateMatrices(transforms.data(), transforms.size());
+	double seconds =
+	  std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	printf(
+	  "WorldTransform::UpdateMatrices %zu: single %.3fms, batch %.3fms x%.2f, max error %g\n",
+	  kCount, referenceSeconds * 1.0e3, seconds * 1.0e3,
+	  seconds > 0.0 ? referenceSeconds / seconds : 0.0, maxError);
+
+	return Test::Finish("WorldTransformTest");
+}